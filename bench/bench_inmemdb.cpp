@@ -0,0 +1,619 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "inmemdb/executor.hpp"
+#include "inmemdb/lexer.hpp"
+#include "inmemdb/parser.hpp"
+#include "inmemdb/predicate.hpp"
+#include "inmemdb/simd.hpp"
+#include "inmemdb/storage.hpp"
+
+using namespace inmemdb;
+using Clock = std::chrono::steady_clock;
+
+static double ms_since(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+// users(id, name) with n rows; orders(user_id, total) with n rows spread over the users
+static void fill_join_tables(Database& db, size_t n) {
+    db.create_table(CreateTableStmt{"users", {{"id", ColumnType::Int}, {"name", ColumnType::Text}}});
+    db.create_table(CreateTableStmt{"orders", {{"user_id", ColumnType::Int}, {"total", ColumnType::Int}}});
+    for (size_t i = 0; i < n; ++i) {
+        db.insert_row(InsertStmt{"users", {std::to_string(i), "user" + std::to_string(i)}});
+        db.insert_row(InsertStmt{"orders", {std::to_string((i * 7919) % n), std::to_string(i % 1000)}});
+    }
+}
+
+static void bench_join(size_t max_rows) {
+    std::cout << "== INNER JOIN users.id = orders.user_id ==\n";
+    std::cout << "rows\tjoin_ms\tresult_rows\n";
+    SelectStmt stmt;
+    stmt.items = {{"users.name", std::nullopt}, {"orders.total", std::nullopt}};
+    stmt.table = "users";
+    stmt.joins.push_back(JoinClause{"orders", "users.id", "orders.user_id"});
+    for (size_t n = 1000; n <= max_rows; n *= 10) {
+        Database db;
+        fill_join_tables(db, n);
+        auto t0 = Clock::now();
+        auto qr = db.select_rows(stmt);
+        double ms = ms_since(t0);
+        std::cout << n << '\t' << ms << '\t' << qr.rows.size() << "\n";
+    }
+}
+
+// 1000 WHERE id = k lookups, first as full scans and then through each index kind
+static void bench_point_lookup(size_t rows) {
+    std::cout << "== point lookup, " << rows << " rows ==\n";
+    std::cout << "access\tus_per_query\n";
+    Database db;
+    db.create_table(CreateTableStmt{"t", {{"id", ColumnType::Int}, {"v", ColumnType::Int}}});
+    for (size_t i = 0; i < rows; ++i) db.insert_row(InsertStmt{"t", {std::to_string(i), std::to_string(i % 97)}});
+    auto run = [&](char const* label) {
+        const size_t queries = 1000;
+        SelectStmt stmt;
+        stmt.items = {{"v", std::nullopt}};
+        stmt.table = "t";
+        auto t0 = Clock::now();
+        for (size_t q = 0; q < queries; ++q) {
+            stmt.where = WhereCond{"id", CompareOp::Eq, std::to_string((q * 7919) % rows)};
+            db.select_rows(stmt);
+        }
+        std::cout << label << '\t' << ms_since(t0) * 1000.0 / queries << "\n";
+    };
+    run("scan");
+    db.create_index(CreateIndexStmt{"t_id_tree", "t", "id", IndexKind::BTree});
+    run("btree");
+    db.create_index(CreateIndexStmt{"t_id_hash", "t", "id", IndexKind::Hash});
+    run("hash");
+}
+
+// Single-column filter `v < 500` over an INT column with values 0..999:
+// the old per-row interpretation (string operator compare plus variant
+// compare) against the compiled predicate kernel
+static void bench_filter(size_t rows) {
+    std::cout << "== filter v < 500, " << rows << " rows ==\n";
+    std::cout << "mode\tms\tmrows_per_sec\tmatches\n";
+    ColumnData col = IntColumn{};
+    auto& ints = std::get<IntColumn>(col);
+    for (size_t i = 0; i < rows; ++i) ints.push_back(static_cast<int64_t>((i * 7919) % 1000));
+    auto report = [&](char const* mode, double ms, size_t matches) {
+        std::cout << mode << '\t' << ms << '\t' << rows / ms / 1000.0 << '\t' << matches << "\n";
+    };
+
+    std::vector<size_t> sel(rows);
+    {
+        std::string const op = "<";
+        Value const literal = int64_t{500};
+        auto t0 = Clock::now();
+        size_t n = 0;
+        for (size_t r = 0; r < rows; ++r) {
+            Value cell = ints.at(r);
+            int c = 0;
+            try {
+                auto a = std::get<int64_t>(cell), b = std::get<int64_t>(literal);
+                c = (a > b) - (a < b);
+            } catch (std::exception const&) { return; }
+            bool keep = op == "=" ? c == 0 : op == "!=" ? c != 0 : op == "<" ? c < 0
+                      : op == "<=" ? c <= 0 : op == ">" ? c > 0 : c >= 0;
+            if (keep) sel[n++] = r;
+        }
+        report("interpreted", ms_since(t0), n);
+    }
+    {
+        Predicate pred = compile_predicate(col, CompareOp::Lt, int64_t{500});
+        auto t0 = Clock::now();
+        size_t n = 0;
+        for (size_t b = 0; b < rows; b += Cursor::kBatchRows)
+            n += pred.filter(b, std::min(b + Cursor::kBatchRows, rows), sel.data() + n);
+        report("compiled", ms_since(t0), n);
+    }
+}
+
+// INT filter kernels for every operator at each SIMD level this CPU supports;
+// values 0..999 and a literal of 500 give about 50% selectivity
+static void bench_simd_filter(size_t rows) {
+    std::cout << "== SIMD INT filter kernels, " << rows << " rows (cpu: " << to_string(detect_simd_level()) << ") ==\n";
+    std::cout << "level\top\tms\tmrows_per_sec\tmatches\n";
+    std::vector<int64_t> data(rows);
+    for (size_t i = 0; i < rows; ++i) data[i] = static_cast<int64_t>((i * 7919) % 1000);
+    std::vector<size_t> sel(Cursor::kBatchRows);
+    for (auto level : {SimdLevel::Scalar, SimdLevel::SSE42, SimdLevel::AVX2}) {
+        if (static_cast<int>(level) > static_cast<int>(detect_simd_level())) continue;
+        for (int o = 0; o < 6; ++o) {
+            auto op = static_cast<CompareOp>(o);
+            IntFilterKernel kernel = int_filter_kernel(op, level);
+            auto t0 = Clock::now();
+            size_t matches = 0;
+            for (size_t b = 0; b < rows; b += Cursor::kBatchRows)
+                matches += kernel(data.data(), b, std::min(b + Cursor::kBatchRows, rows), 500, sel.data());
+            double ms = ms_since(t0);
+            std::cout << to_string(level) << '\t' << to_string(op) << '\t' << ms << '\t'
+                      << rows / ms / 1000.0 << '\t' << matches << "\n";
+        }
+    }
+}
+
+// status = 'pending' over a 3-value TEXT column, plain vs dictionary-encoded
+static void bench_dict_filter(size_t rows) {
+    std::cout << "== TEXT equality filter, " << rows << " rows ==\n";
+    std::cout << "encoding\tcolumn_mb\tms\tmrows_per_sec\tmatches\n";
+    char const* statuses[] = {"open", "closed", "pending"};
+    TextColumn plain;
+    for (size_t i = 0; i < rows; ++i) plain.push_back(statuses[(i * 7919) % 3]);
+    ColumnData cols[] = {plain, DictColumn::encode(plain)};
+    double mb[] = {(plain.offsets.size() * sizeof(uint64_t) + plain.bytes.size()) / 1e6,
+                   std::get<DictColumn>(cols[1]).codes.size() * sizeof(uint32_t) / 1e6};
+    std::vector<size_t> sel(Cursor::kBatchRows);
+    for (int i = 0; i < 2; ++i) {
+        Predicate pred = compile_predicate(cols[i], CompareOp::Eq, std::string("pending"));
+        auto t0 = Clock::now();
+        size_t matches = 0;
+        for (size_t b = 0; b < rows; b += Cursor::kBatchRows)
+            matches += pred.filter(b, std::min(b + Cursor::kBatchRows, rows), sel.data());
+        double ms = ms_since(t0);
+        std::cout << (i ? "dict" : "plain") << '\t' << mb[i] << '\t' << ms << '\t' << rows / ms / 1000.0 << '\t' << matches << "\n";
+    }
+}
+
+// SUM(v) per group: pulling every row into QueryResult and aggregating in the
+// client against GROUP BY, and the ungrouped fast path
+static void bench_group_by(size_t rows) {
+    std::cout << "== SUM(v) GROUP BY g, " << rows << " rows, 100 groups ==\n";
+    std::cout << "plan\tms\tresult_rows\n";
+    Database db;
+    db.create_table(CreateTableStmt{"t", {{"g", ColumnType::Int}, {"v", ColumnType::Int}}});
+    for (size_t i = 0; i < rows; ++i) db.insert_row(InsertStmt{"t", {std::to_string(i % 100), std::to_string(i % 1000)}});
+    SelectStmt stmt;
+    stmt.table = "t";
+    stmt.items = {{"g", std::nullopt}, {"v", std::nullopt}};
+    auto t0 = Clock::now();
+    auto all = db.select_rows(stmt);
+    std::unordered_map<std::string, int64_t> sums;
+    for (auto const& r : all.rows) sums[r[0]] += std::strtoll(r[1].c_str(), nullptr, 10);
+    std::cout << "client\t" << ms_since(t0) << '\t' << all.rows.size() << "\n";
+    stmt.items = {{"g", std::nullopt}, {"v", AggFunc::Sum}};
+    stmt.group_by = {"g"};
+    t0 = Clock::now();
+    auto grouped = db.select_rows(stmt);
+    std::cout << "group_by\t" << ms_since(t0) << '\t' << grouped.rows.size() << "\n";
+    stmt.items = {{"v", AggFunc::Sum}};
+    stmt.group_by.clear();
+    t0 = Clock::now();
+    auto total = db.select_rows(stmt);
+    std::cout << "no_group\t" << ms_since(t0) << '\t' << total.rows.size() << "\n";
+}
+
+// SELECT * ... LIMIT 10 against a full scan, and ORDER BY v DESC LIMIT 10
+// (bounded heap) against ORDER BY with a full sort
+static void bench_order_limit(size_t rows) {
+    std::cout << "== ORDER BY / LIMIT, " << rows << " rows ==\n";
+    std::cout << "query\tms\tresult_rows\n";
+    Database db;
+    db.create_table(CreateTableStmt{"big", {{"id", ColumnType::Int}, {"v", ColumnType::Int}}});
+    for (size_t i = 0; i < rows; ++i) db.insert_row(InsertStmt{"big", {std::to_string(i), std::to_string((i * 7919) % 1000003)}});
+    auto run = [&](char const* label, std::vector<OrderItem> order, std::optional<size_t> limit) {
+        SelectStmt stmt;
+        stmt.table = "big";
+        stmt.select_all = true;
+        stmt.order_by = std::move(order);
+        stmt.limit = limit;
+        auto t0 = Clock::now();
+        auto qr = db.select_rows(stmt);
+        std::cout << label << '\t' << ms_since(t0) << '\t' << qr.rows.size() << "\n";
+    };
+    std::vector<OrderItem> by_v{{{"v", std::nullopt}, true}};
+    run("scan", {}, std::nullopt);
+    run("limit_10", {}, 10);
+    run("sort", by_v, std::nullopt);
+    run("topk_10", by_v, 10);
+}
+
+// Filter+project, hash join and GROUP BY drained through a cursor (no cell
+// formatting) at 1..max_dop worker threads
+static void bench_parallel_scaling(size_t rows, size_t max_dop) {
+    std::cout << "== parallel scaling, " << rows << " rows ==\n";
+    std::cout << "query\tthreads\tms\tspeedup\tresult_rows\n";
+    Database db;
+    db.create_table(CreateTableStmt{"facts", {{"k", ColumnType::Int}, {"v", ColumnType::Int}}});
+    db.create_table(CreateTableStmt{"dims", {{"k", ColumnType::Int}, {"w", ColumnType::Int}}});
+    for (size_t i = 0; i < rows; ++i) {
+        db.insert_row(InsertStmt{"facts", {std::to_string((i * 7919) % (rows / 2)), std::to_string(i % 1000)}});
+        if (i % 2 == 0) db.insert_row(InsertStmt{"dims", {std::to_string(i / 2), std::to_string(i % 100)}});
+    }
+    auto parse = [](std::string const& q) { return std::get<SelectStmt>(Parser(Lexer(q)).parse_all()[0]); };
+    std::pair<char const*, SelectStmt> queries[] = {
+        {"filter", parse("SELECT k, v FROM facts WHERE v < 500;")},
+        {"join", parse("SELECT facts.v, dims.w FROM facts JOIN dims ON facts.k = dims.k;")},
+        {"group_by", parse("SELECT v, COUNT(*), SUM(k) FROM facts GROUP BY v;")},
+    };
+    for (auto const& [label, stmt] : queries) {
+        double base = 0;
+        for (size_t dop = 1; dop <= max_dop; dop *= 2) {
+            auto t0 = Clock::now();
+            Cursor cur = db.open_cursor(stmt, dop);
+            Batch batch;
+            size_t n = 0;
+            while (cur.next(batch)) n += batch.rows;
+            double ms = ms_since(t0);
+            if (dop == 1) base = ms;
+            std::cout << label << '\t' << dop << '\t' << ms << '\t' << base / ms << '\t' << n << "\n";
+        }
+    }
+}
+
+// Writers inserting and readers running an aggregate scan at the same time
+// for `ms` milliseconds: every call behind one global mutex (how clients had
+// to use the engine) against the engine's own snapshot isolation
+static void bench_concurrency(size_t rows, size_t writers, size_t readers, int ms) {
+    std::cout << "== concurrent INSERT/SELECT, " << rows << " preloaded rows, " << writers << " writers, "
+              << readers << " readers, " << ms << " ms ==\n";
+    std::cout << "mode\tinserts_per_sec\tselects_per_sec\n";
+    SelectStmt scan = std::get<SelectStmt>(Parser(Lexer("SELECT COUNT(*), SUM(v) FROM t WHERE v < 500;")).parse_all()[0]);
+    for (bool global_lock : {true, false}) {
+        Database db;
+        db.create_table(CreateTableStmt{"t", {{"id", ColumnType::Int}, {"v", ColumnType::Int}}});
+        for (size_t i = 0; i < rows; ++i) db.insert_row(InsertStmt{"t", {std::to_string(i), std::to_string(i % 1000)}});
+        std::mutex mu;
+        std::atomic<bool> stop{false};
+        std::atomic<size_t> inserts{0}, selects{0};
+        std::vector<std::thread> threads;
+        for (size_t w = 0; w < writers; ++w) {
+            threads.emplace_back([&, w] {
+                for (size_t i = 0; !stop; ++i) {
+                    InsertStmt ins{"t", {std::to_string(w * 1000000000 + i), std::to_string(i % 1000)}};
+                    if (global_lock) { std::lock_guard<std::mutex> lock(mu); db.insert_row(ins); }
+                    else db.insert_row(ins);
+                    ++inserts;
+                }
+            });
+        }
+        for (size_t r = 0; r < readers; ++r) {
+            threads.emplace_back([&] {
+                while (!stop) {
+                    if (global_lock) { std::lock_guard<std::mutex> lock(mu); db.select_rows(scan, 1); }
+                    else db.select_rows(scan, 1);
+                    ++selects;
+                }
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+        stop = true;
+        for (auto& t : threads) t.join();
+        double secs = ms / 1000.0;
+        std::cout << (global_lock ? "global_mutex" : "snapshots") << '\t' << inserts / secs << '\t' << selects / secs << "\n";
+    }
+}
+
+static void bench_wal(size_t writers, int ms) {
+    std::cout << "== WAL INSERT throughput, " << writers << " writers, " << ms << " ms ==\n";
+    std::cout << "sync\tinserts_per_sec\twal_mb\n";
+    struct Mode { char const* name; bool wal; SyncPolicy sync; };
+    Mode modes[] = {{"none", false, SyncPolicy::OsBuffered},
+                    {"os", true, SyncPolicy::OsBuffered},
+                    {"group", true, SyncPolicy::Group},
+                    {"every", true, SyncPolicy::EveryCommit}};
+    std::string path = "inmemdb_bench.wal";
+    for (auto const& m : modes) {
+        std::remove(path.c_str());
+        Database db;
+        if (m.wal) db.attach_wal(WalOptions{path, m.sync});
+        db.create_table(CreateTableStmt{"t", {{"id", ColumnType::Int}, {"v", ColumnType::Int}, {"note", ColumnType::Text}}});
+        std::atomic<bool> stop{false};
+        std::atomic<size_t> inserts{0};
+        std::vector<std::thread> threads;
+        for (size_t w = 0; w < writers; ++w) {
+            threads.emplace_back([&, w] {
+                for (size_t i = 0; !stop; ++i) {
+                    db.insert_row(InsertStmt{"t", {std::to_string(w * 1000000000 + i), std::to_string(i % 1000), "row" + std::to_string(i)}});
+                    ++inserts;
+                }
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+        stop = true;
+        for (auto& t : threads) t.join();
+        std::ifstream f(path, std::ios::binary | std::ios::ate);
+        double mb = m.wal && f ? f.tellg() / 1e6 : 0.0;
+        std::cout << m.name << '\t' << inserts / (ms / 1000.0) << '\t' << mb << "\n";
+    }
+    std::remove(path.c_str());
+}
+
+static void bench_snapshot(size_t rows) {
+    std::cout << "== startup: WAL replay vs snapshot load, " << rows << " rows ==\n";
+    std::cout << "step\tms\tfile_mb\n";
+    std::string wal_path = "inmemdb_bench_startup.wal", snap_path = "inmemdb_bench.snap";
+    std::remove(wal_path.c_str());
+    auto file_mb = [](std::string const& path) {
+        std::ifstream f(path, std::ios::binary | std::ios::ate);
+        return f ? f.tellg() / 1e6 : 0.0;
+    };
+    char const* statuses[] = {"open", "closed", "pending"};
+    {
+        Database db;
+        db.attach_wal(WalOptions{wal_path, SyncPolicy::OsBuffered});
+        db.create_table(CreateTableStmt{"t", {{"id", ColumnType::Int}, {"v", ColumnType::Int}, {"status", ColumnType::Text}, {"note", ColumnType::Text}}});
+        for (size_t i = 0; i < rows; ++i)
+            db.insert_row(InsertStmt{"t", {std::to_string(i), std::to_string(i % 1000), statuses[i % 3], "note" + std::to_string(i)}});
+        auto t0 = Clock::now();
+        db.save_snapshot(snap_path);
+        std::cout << "save_snapshot\t" << ms_since(t0) << '\t' << file_mb(snap_path) << "\n";
+    }
+    SelectStmt scan = std::get<SelectStmt>(Parser(Lexer("SELECT COUNT(*), SUM(v) FROM t WHERE v < 500;")).parse_all()[0]);
+    {
+        Database db;
+        auto t0 = Clock::now();
+        db.attach_wal(WalOptions{wal_path, SyncPolicy::OsBuffered});
+        std::cout << "wal_replay\t" << ms_since(t0) << '\t' << file_mb(wal_path) << "\n";
+    }
+    {
+        Database db;
+        auto t0 = Clock::now();
+        db.load_snapshot(snap_path);
+        std::cout << "snapshot_load\t" << ms_since(t0) << '\t' << file_mb(snap_path) << "\n";
+        t0 = Clock::now();
+        db.select_rows(scan, 1);
+        std::cout << "first_scan\t" << ms_since(t0) << "\t-\n";
+        t0 = Clock::now();
+        db.select_rows(scan, 1);
+        std::cout << "second_scan\t" << ms_since(t0) << "\t-\n";
+    }
+    std::remove(wal_path.c_str());
+    std::remove(snap_path.c_str());
+}
+
+static void bench_bulk_load(size_t rows, size_t max_dop) {
+    std::cout << "== bulk load, " << rows << " rows ==\n";
+    std::cout << "method\tthreads\tms\tmrows_per_sec\n";
+    char const* statuses[] = {"open", "closed", "pending"};
+    auto row_text = [&](size_t i, char sep) {
+        return std::to_string(i) + sep + std::to_string(i % 1000) + sep + statuses[i % 3] + sep + "note" + std::to_string(i);
+    };
+    auto fresh = [](Database& db) {
+        db.create_table(CreateTableStmt{"t", {{"id", ColumnType::Int}, {"v", ColumnType::Int}, {"status", ColumnType::Text}, {"note", ColumnType::Text}}});
+    };
+    auto report = [&](char const* method, size_t threads, double ms, size_t n) {
+        std::cout << method << '\t' << threads << '\t' << ms << '\t' << n / ms / 1000.0 << "\n";
+    };
+    // SQL scripts go through the lexer, parser and executor like CLI input
+    for (size_t per_stmt : {size_t(1), size_t(1000)}) {
+        std::string sql;
+        size_t n = per_stmt == 1 ? std::min<size_t>(rows, 200000) : rows;
+        for (size_t i = 0; i < n; i += per_stmt) {
+            sql += "INSERT INTO t VALUES ";
+            for (size_t j = i; j < std::min(n, i + per_stmt); ++j) sql += (j > i ? ", (" : "(") + row_text(j, ',') + ")";
+            sql += ";\n";
+        }
+        Database db;
+        fresh(db);
+        Executor exec(db);
+        auto t0 = Clock::now();
+        for (auto const& st : Parser(Lexer(sql)).parse_all()) exec.execute(st);
+        report(per_stmt == 1 ? "insert_1_row" : "insert_1000_rows", 1, ms_since(t0), n);
+    }
+    std::string path = "inmemdb_bench.csv";
+    {
+        std::ofstream f(path, std::ios::binary);
+        for (size_t i = 0; i < rows; ++i) f << row_text(i, ',') << '\n';
+    }
+    for (size_t dop = 1; dop <= max_dop; dop *= 2) {
+        Database db;
+        db.set_parallelism(dop);
+        fresh(db);
+        auto t0 = Clock::now();
+        size_t n = db.copy_from(CopyStmt{"t", path});
+        report("copy", dop, ms_since(t0), n);
+    }
+    std::remove(path.c_str());
+}
+
+// Hash-indexed point lookups issued as SQL text: lexed, parsed and planned
+// every time, through the plan cache by text, and through a prepared handle
+static void bench_prepared(size_t rows) {
+    std::cout << "== prepared point lookup, " << rows << " rows ==\n";
+    std::cout << "method\tus_per_query\n";
+    Database db;
+    db.create_table(CreateTableStmt{"t", {{"id", ColumnType::Int}, {"v", ColumnType::Int}}});
+    for (size_t i = 0; i < rows; ++i) db.insert_row(InsertStmt{"t", {std::to_string(i), std::to_string(i % 97)}});
+    db.create_index(CreateIndexStmt{"t_id", "t", "id", IndexKind::Hash});
+    const size_t queries = 20000;
+    auto key = [&](size_t q) { return std::to_string((q * 7919) % rows); };
+    Executor exec(db);
+    auto t0 = Clock::now();
+    for (size_t q = 0; q < queries; ++q)
+        for (auto const& st : Parser(Lexer("SELECT v FROM t WHERE id = " + key(q) + ";")).parse_all()) exec.execute(st);
+    std::cout << "sql_text\t" << ms_since(t0) * 1000.0 / queries << "\n";
+    // 100 distinct literal queries over and over: plan cache hits after the first pass
+    t0 = Clock::now();
+    for (size_t q = 0; q < queries; ++q) db.select_rows(*db.prepare("SELECT v FROM t WHERE id = " + key(q % 100) + ";"), {});
+    std::cout << "cached_text\t" << ms_since(t0) * 1000.0 / queries << "\n";
+    auto ps = db.prepare("SELECT v FROM t WHERE id = ?;");
+    std::vector<Value> params(1);
+    t0 = Clock::now();
+    for (size_t q = 0; q < queries; ++q) {
+        params[0] = int64_t((q * 7919) % rows);
+        db.select_rows(*ps, params);
+    }
+    std::cout << "prepared\t" << ms_since(t0) * 1000.0 / queries << "\n";
+}
+
+// Lexing and parsing alone: single-row INSERTs, 100-row INSERTs (a tenth as
+// many statements) and SELECTs
+static void bench_parse(size_t statements) {
+    std::cout << "== parse, " << statements << " statements ==\n";
+    std::cout << "workload\tms\tstmts_per_sec\n";
+    auto run = [&](char const* label, size_t count, auto make) {
+        std::string sql;
+        for (size_t i = 0; i < count; ++i) sql += make(i);
+        auto t0 = Clock::now();
+        size_t n = Parser(Lexer(sql)).parse_all().size();
+        double ms = ms_since(t0);
+        std::cout << label << '\t' << ms << '\t' << n / ms * 1000.0 << "\n";
+    };
+    run("insert_1_row", statements, [](size_t i) {
+        return "INSERT INTO orders VALUES (" + std::to_string(i) + ", 'customer " + std::to_string(i % 1000) + "', " + std::to_string(i % 977) + ");\n";
+    });
+    run("insert_100_rows", statements / 10, [](size_t i) {
+        std::string s = "insert into orders values ";
+        for (size_t j = 0; j < 100; ++j) s += (j ? ", (" : "(") + std::to_string(i * 100 + j) + ", status_" + std::to_string(j % 3) + ", " + std::to_string(j) + ")";
+        return s + ";\n";
+    });
+    run("select", statements, [](size_t i) {
+        return "SELECT users.name, SUM(orders.total) FROM users JOIN orders ON users.id = orders.user_id WHERE orders.total >= " +
+               std::to_string(i % 1000) + " GROUP BY users.name ORDER BY SUM(orders.total) DESC LIMIT 10;\n";
+    });
+}
+
+// Insert rows into a table with hash and B+tree indexes on INT and TEXT
+// columns, then print memory_usage() per column and index
+static void bench_memory(size_t rows) {
+    std::cout << "== memory usage, " << rows << " rows ==\n";
+    Database db;
+    db.create_table(CreateTableStmt{"t", {{"id", ColumnType::Int}, {"name", ColumnType::Text}, {"v", ColumnType::Int}, {"status", ColumnType::Text}}});
+    db.create_index(CreateIndexStmt{"t_id", "t", "id", IndexKind::Hash});
+    db.create_index(CreateIndexStmt{"t_v", "t", "v", IndexKind::BTree});
+    db.create_index(CreateIndexStmt{"t_name", "t", "name", IndexKind::Hash});
+    char const* statuses[] = {"open", "closed", "pending"};
+    auto t0 = Clock::now();
+    for (size_t i = 0; i < rows; ++i)
+        db.insert_row(InsertStmt{"t", {std::to_string(i), "customer name " + std::to_string(i % 50000), std::to_string(i * 7919 % 1000003), statuses[i % 3]}});
+    std::cout << "insert_ms\t" << ms_since(t0) << "\n";
+    std::cout << "object\tbytes\tallocations\n";
+    auto mu = db.memory_usage();
+    for (auto const& t : mu.tables) {
+        for (auto const& c : t.columns) std::cout << "column " << c.name << '\t' << c.usage.bytes << '\t' << c.usage.allocations << "\n";
+        for (auto const& ix : t.indexes) std::cout << "index " << ix.name << '\t' << ix.usage.bytes << '\t' << ix.usage.allocations << "\n";
+    }
+    std::cout << "total\t" << mu.total.bytes << '\t' << mu.total.allocations << "\n";
+}
+
+// Sealed INT segments against the same values in one plain array: bytes per
+// row, a `v < median` filter (about 50% selectivity) and decoding every row
+static void bench_int_compression(size_t rows) {
+    std::cout << "== INT compression, " << rows << " rows ==\n";
+    std::cout << "data\tencoding\tplain_bytes_per_row\tbytes_per_row\tratio\tplain_filter_ms\tfilter_ms\tplain_decode_ms\tdecode_ms\n";
+    struct Shape { char const* name; int64_t (*value)(size_t); };
+    Shape shapes[] = {
+        {"timestamps", [](size_t i) { return int64_t{1700000000000} + static_cast<int64_t>(i) * 1000 + static_cast<int64_t>(i * 7919 % 17); }},
+        {"counters", [](size_t i) { return static_cast<int64_t>(i * 7919 % 1000); }},
+        {"status", [](size_t i) { return static_cast<int64_t>(i / 3000 % 4); }},
+        {"random", [](size_t i) { return static_cast<int64_t>(i * 0x9E3779B97F4A7C15ull); }},
+    };
+    std::vector<size_t> sel(Cursor::kBatchRows), all(Cursor::kBatchRows);
+    std::vector<int64_t> out(Cursor::kBatchRows);
+    for (auto const& shape : shapes) {
+        std::vector<int64_t> values(rows);
+        for (size_t i = 0; i < rows; ++i) values[i] = shape.value(i);
+        ColumnData cols[2] = {IntColumn{}, IntColumn{}};
+        std::get<IntColumn>(cols[0]).tail.append(values.data(), rows); // never sealed
+        std::get<IntColumn>(cols[1]).append(values.data(), rows);
+        auto const& packed = std::get<IntColumn>(cols[1]);
+        size_t counts[4] = {};
+        for (auto const& seg : packed.segments) ++counts[static_cast<size_t>(seg->encoding)];
+        auto top = std::max_element(std::begin(counts), std::end(counts)) - std::begin(counts);
+        std::nth_element(values.begin(), values.begin() + rows / 2, values.end());
+        int64_t median = values[rows / 2];
+
+        double bytes[2], filter_ms[2], decode_ms[2];
+        for (int c = 0; c < 2; ++c) {
+            bytes[c] = static_cast<double>(memory_stats(cols[c]).bytes) / rows;
+            Predicate pred = compile_predicate(cols[c], CompareOp::Lt, median);
+            auto t0 = Clock::now();
+            size_t matches = 0;
+            for (size_t b = 0; b < rows; b += Cursor::kBatchRows)
+                matches += pred.filter(b, std::min(b + Cursor::kBatchRows, rows), sel.data());
+            filter_ms[c] = ms_since(t0);
+            auto const& col = std::get<IntColumn>(cols[c]);
+            t0 = Clock::now();
+            int64_t sum = 0;
+            for (size_t b = 0; b < rows; b += Cursor::kBatchRows) {
+                size_t n = std::min(Cursor::kBatchRows, rows - b);
+                for (size_t i = 0; i < n; ++i) all[i] = b + i;
+                col.gather(all.data(), n, out.data());
+                for (size_t i = 0; i < n; ++i) sum += out[i];
+            }
+            decode_ms[c] = ms_since(t0);
+            volatile int64_t keep = sum + static_cast<int64_t>(matches); // the loops are not dead
+            (void)keep;
+        }
+        std::cout << shape.name << '\t' << to_string(static_cast<IntEncoding>(top)) << '\t' << bytes[0] << '\t' << bytes[1] << '\t'
+                  << bytes[0] / bytes[1] << '\t' << filter_ms[0] << '\t' << filter_ms[1] << '\t' << decode_ms[0] << '\t' << decode_ms[1] << "\n";
+    }
+}
+
+// Time-range filters on append-ordered columns keeping the last 1% of rows:
+// the zone-mapped scan against the same predicate with zones ignored
+static void bench_zone_maps(size_t rows) {
+    std::cout << "== zone maps, last 1% of " << rows << " rows ==\n";
+    std::cout << "column\tfull_scan_ms\tzoned_ms\tmatches\n";
+    ColumnData ts = IntColumn{};
+    ColumnData day = TextColumn{};
+    for (size_t i = 0; i < rows; ++i) {
+        std::get<IntColumn>(ts).push_back(1700000000 + static_cast<int64_t>(i) * 60 + static_cast<int64_t>(i * 7919 % 60));
+        std::string d = std::to_string(i / 100);
+        std::get<TextColumn>(day).push_back("2024-" + std::string(8 - d.size(), '0') + d);
+    }
+    extend_zones(ts);
+    extend_zones(day);
+    size_t from = rows - rows / 100;
+    std::string d = std::to_string(from / 100);
+    std::pair<char const*, Predicate> preds[] = {
+        {"int", compile_predicate(ts, CompareOp::Ge, int64_t(1700000000 + static_cast<int64_t>(from) * 60))},
+        {"text", compile_predicate(day, CompareOp::Ge, "2024-" + std::string(8 - d.size(), '0') + d)},
+    };
+    std::vector<size_t> sel(Cursor::kMorselRows);
+    for (auto& [name, pred] : preds) {
+        double ms[2];
+        size_t matches = 0;
+        for (int zoned = 0; zoned < 2; ++zoned) {
+            Predicate p = pred;
+            if (!zoned) p.zones = 0;
+            auto t0 = Clock::now();
+            matches = 0;
+            for (size_t b = 0; b < rows; b += Cursor::kMorselRows)
+                matches += p.filter(b, std::min(b + Cursor::kMorselRows, rows), sel.data());
+            ms[zoned] = ms_since(t0);
+        }
+        std::cout << name << '\t' << ms[0] << '\t' << ms[1] << '\t' << matches << "\n";
+    }
+}
+
+// bench_suite.cpp: `inmemdb_bench suite [options]`
+int run_suite(int argc, char** argv);
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "suite") return run_suite(argc - 2, argv + 2);
+    size_t max_rows = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    size_t max_dop = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : std::max(1u, std::thread::hardware_concurrency());
+    bench_join(max_rows);
+    bench_point_lookup(max_rows);
+    bench_group_by(max_rows * 10);
+    bench_order_limit(max_rows * 10);
+    bench_parallel_scaling(max_rows * 10, max_dop);
+    bench_concurrency(max_rows, 2, std::max<size_t>(2, max_dop), 500);
+    bench_wal(8, 500);
+    bench_wal(64, 500);
+    bench_snapshot(max_rows * 10);
+    bench_bulk_load(max_rows * 10, max_dop);
+    bench_prepared(max_rows);
+    bench_parse(max_rows);
+    bench_memory(max_rows * 10);
+    size_t filter_rows = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10000000;
+    bench_filter(filter_rows);
+    bench_simd_filter(filter_rows);
+    bench_dict_filter(filter_rows);
+    bench_int_compression(filter_rows);
+    bench_zone_maps(filter_rows);
+    return 0;
+}
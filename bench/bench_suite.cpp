@@ -0,0 +1,447 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "inmemdb/lexer.hpp"
+#include "inmemdb/parser.hpp"
+#include "inmemdb/storage.hpp"
+
+// Regression suite: fixed scenarios over generated data, reported as ns/op,
+// rows/s and heap allocations/op, optionally written as JSON (one scenario
+// per line) and compared against an earlier JSON file of a run with the
+// same options.
+//
+//   inmemdb_bench suite [rows=N] [cardinality=K] [skew=S] [dop=D] [repeat=R]
+//                       [seed=X] [json=PATH] [baseline=PATH] [max_slowdown=F]
+
+using namespace inmemdb;
+using Clock = std::chrono::steady_clock;
+
+// Heap allocations of the process, library threads included, counted only
+// while the suite runs so the other inmemdb_bench modes keep an untouched
+// allocator: outside the suite the hook costs one relaxed load.
+static std::atomic<bool> g_counting{false};
+static std::atomic<uint64_t> g_allocations{0};
+
+static void* counted_alloc(std::size_t n, std::size_t align) {
+    if (g_counting.load(std::memory_order_relaxed)) g_allocations.fetch_add(1, std::memory_order_relaxed);
+    n = n ? n : 1;
+    void* p = align <= alignof(std::max_align_t) ? std::malloc(n) : std::aligned_alloc(align, (n + align - 1) / align * align);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+// Every replaceable form, so each pointer is freed by the family that made it
+void* operator new(std::size_t n) { return counted_alloc(n, 0); }
+void* operator new[](std::size_t n) { return counted_alloc(n, 0); }
+void* operator new(std::size_t n, std::align_val_t a) { return counted_alloc(n, static_cast<std::size_t>(a)); }
+void* operator new[](std::size_t n, std::align_val_t a) { return counted_alloc(n, static_cast<std::size_t>(a)); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace {
+
+struct Config {
+    size_t rows = 1000000;
+    size_t cardinality = 10000; // distinct values of events.key
+    double skew = 0;            // Zipf exponent of key frequencies; 0 is uniform
+    size_t dop = 1;
+    size_t repeat = 3;          // read scenarios keep their fastest run
+    uint64_t seed = 42;
+    std::string json, baseline;
+    double max_slowdown = 0; // with a baseline: fail when a scenario is this many times slower
+};
+
+// Values in [0, n) where value k has weight 1 / (k + 1)^skew
+class Zipf {
+public:
+    Zipf(size_t n, double skew, uint64_t seed) : cdf_(std::max<size_t>(1, n)), rng_(seed) {
+        double sum = 0;
+        for (size_t k = 0; k < cdf_.size(); ++k) cdf_[k] = sum += 1.0 / std::pow(static_cast<double>(k + 1), skew);
+        for (auto& c : cdf_) c /= sum;
+    }
+    size_t next() {
+        double u = std::uniform_real_distribution<double>(0, 1)(rng_);
+        return std::min<size_t>(std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin(), cdf_.size() - 1);
+    }
+
+private:
+    std::vector<double> cdf_;
+    std::mt19937_64 rng_;
+};
+
+// events(id INT, key INT, category TEXT, amount INT): ids ascend, keys and
+// categories follow the configured skew, amounts are uniform in [0, 1000)
+class EventGen {
+public:
+    explicit EventGen(Config const& c)
+        : keys_(c.cardinality, c.skew, c.seed), cats_(std::min<size_t>(c.cardinality, 1000), c.skew, c.seed + 1), rng_(c.seed + 2) {}
+
+    static CreateTableStmt schema(std::string name) {
+        return {std::move(name), {{"id", ColumnType::Int}, {"key", ColumnType::Int}, {"category", ColumnType::Text}, {"amount", ColumnType::Int}}};
+    }
+    // Append the values of rows [id, id + n) to an INSERT
+    void rows(InsertStmt& ins, size_t id, size_t n) {
+        for (size_t i = id; i < id + n; ++i) {
+            ins.values.push_back(std::to_string(i));
+            ins.values.push_back(std::to_string(keys_.next()));
+            ins.values.push_back("category_" + std::to_string(cats_.next()));
+            ins.values.push_back(std::to_string(rng_() % 1000));
+        }
+        ins.rows += n;
+    }
+
+private:
+    Zipf keys_, cats_;
+    std::mt19937_64 rng_;
+};
+
+struct Result {
+    std::string name;
+    uint64_t ops = 0, rows = 0, allocations = 0;
+    double ns = 0;
+
+    double ns_per_op() const { return ops ? ns / static_cast<double>(ops) : 0; }
+    double rows_per_sec() const { return ns > 0 ? static_cast<double>(rows) * 1e9 / ns : 0; }
+    double allocs_per_op() const { return ops ? static_cast<double>(allocations) / static_cast<double>(ops) : 0; }
+};
+
+// Time and allocations of code between construction and stop()
+class Meter {
+public:
+    Meter() : allocs_(g_allocations.load(std::memory_order_relaxed)), t0_(Clock::now()) {}
+    void stop(Result& r) const {
+        r.ns += std::chrono::duration<double, std::nano>(Clock::now() - t0_).count();
+        r.allocations += g_allocations.load(std::memory_order_relaxed) - allocs_;
+    }
+
+private:
+    uint64_t allocs_;
+    Clock::time_point t0_;
+};
+
+class Suite {
+public:
+    explicit Suite(Config const& c) : c_(c) {}
+
+    std::vector<Result> run() {
+        insert_rows();
+        insert_batches();
+        load_events();
+        point_lookup();
+        range_scan();
+        filter_scan();
+        compound_filter();
+        full_scan();
+        group_by();
+        for (size_t ratio : {1, 10, 100}) join(ratio);
+        parse();
+        return std::move(results_);
+    }
+
+private:
+    // Best of `repeat` runs of a read-only scenario; body(r) adds ops and rows
+    template <class Body>
+    void measure(std::string name, Body body) {
+        Result best{name};
+        for (size_t i = 0; i < std::max<size_t>(1, c_.repeat); ++i) {
+            Result r{name};
+            body(r);
+            if (i == 0 || r.ns < best.ns) best = r;
+        }
+        report(best);
+    }
+
+    void report(Result const& r) {
+        std::printf("%-22s %10llu %12.1f %14.0f %10.2f\n", r.name.c_str(), static_cast<unsigned long long>(r.ops), r.ns_per_op(),
+                    r.rows_per_sec(), r.allocs_per_op());
+        results_.push_back(r);
+    }
+
+    size_t drain(Cursor& cur) {
+        size_t n = 0;
+        while (cur.next(batch_)) n += batch_.rows;
+        return n;
+    }
+
+    SelectStmt select(std::string const& sql) { return std::get<SelectStmt>(Parser(Lexer(sql)).parse_all().at(0)); }
+
+    // Single-row INSERTs of the generated rows; statements are built outside the timed part
+    void insert_rows() {
+        Database db;
+        db.create_table(EventGen::schema("events"));
+        EventGen gen(c_);
+        Result r{"insert_row"};
+        std::vector<InsertStmt> chunk(1024);
+        for (size_t id = 0; id < c_.rows; id += chunk.size()) {
+            size_t n = std::min(chunk.size(), c_.rows - id);
+            for (size_t i = 0; i < n; ++i) {
+                chunk[i] = InsertStmt{"events", {}, 0, {}};
+                gen.rows(chunk[i], id + i, 1);
+            }
+            Meter m;
+            for (size_t i = 0; i < n; ++i) db.insert_row(chunk[i]);
+            m.stop(r);
+            r.ops += n;
+            r.rows += n;
+        }
+        report(r);
+    }
+
+    // 1000-row INSERTs
+    void insert_batches() {
+        Database db;
+        db.create_table(EventGen::schema("events"));
+        EventGen gen(c_);
+        Result r{"insert_batch_1000"};
+        for (size_t id = 0; id < c_.rows; id += 1000) {
+            InsertStmt ins{"events", {}, 0, {}};
+            gen.rows(ins, id, std::min<size_t>(1000, c_.rows - id));
+            Meter m;
+            db.insert_row(ins);
+            m.stop(r);
+            ++r.ops;
+            r.rows += ins.rows;
+        }
+        report(r);
+    }
+
+    // The table the read scenarios share, with a hash and a B+tree index on id
+    void load_events() {
+        db_.set_parallelism(c_.dop);
+        db_.create_table(EventGen::schema("events"));
+        EventGen gen(c_);
+        for (size_t id = 0; id < c_.rows; id += 1000) {
+            InsertStmt ins{"events", {}, 0, {}};
+            gen.rows(ins, id, std::min<size_t>(1000, c_.rows - id));
+            db_.insert_row(ins);
+        }
+        db_.create_index(CreateIndexStmt{"events_id_hash", "events", "id", IndexKind::Hash});
+        db_.create_index(CreateIndexStmt{"events_id_tree", "events", "id", IndexKind::BTree});
+    }
+
+    // Prepared `id = ?` through the hash index
+    void point_lookup() {
+        auto ps = db_.prepare("SELECT key, amount FROM events WHERE id = ?;");
+        size_t queries = std::min<size_t>(c_.rows, 100000);
+        std::vector<Value> params(1);
+        measure("point_lookup", [&](Result& r) {
+            Meter m;
+            for (size_t q = 0; q < queries; ++q) {
+                params[0] = static_cast<int64_t>((q * 7919) % c_.rows);
+                Cursor cur = db_.open_cursor(*ps, params);
+                r.rows += drain(cur);
+            }
+            m.stop(r);
+            r.ops = queries;
+        });
+    }
+
+    // The last 1% of ids through the B+tree
+    void range_scan() {
+        SelectStmt stmt = select("SELECT id, amount FROM events WHERE id >= " + std::to_string(c_.rows - c_.rows / 100) + ";");
+        measure("range_scan_btree", [&](Result& r) {
+            Meter m;
+            for (int q = 0; q < 10; ++q) {
+                Cursor cur = db_.open_cursor(stmt);
+                r.rows += drain(cur);
+            }
+            m.stop(r);
+            r.ops = 10;
+        });
+    }
+
+    // About 10% of the rows by a filtered scan. Here and below, rows/s
+    // counts the table rows a query goes through.
+    void filter_scan() {
+        SelectStmt stmt = select("SELECT id, category FROM events WHERE amount < 100;");
+        measure("filter_scan", [&](Result& r) {
+            Meter m;
+            Cursor cur = db_.open_cursor(stmt);
+            drain(cur);
+            m.stop(r);
+            r.ops = 1;
+            r.rows = c_.rows;
+        });
+    }
+
+    // Three terms written costliest first; the filter runs the INT ones
+    // before the string IN
+    void compound_filter() {
+        SelectStmt stmt = select("SELECT id, category FROM events WHERE category IN ('category_1', 'category_2', 'category_3') "
+                                 "AND amount BETWEEN 100 AND 199 AND key != 0;");
+        measure("compound_filter", [&](Result& r) {
+            Meter m;
+            Cursor cur = db_.open_cursor(stmt);
+            drain(cur);
+            m.stop(r);
+            r.ops = 1;
+            r.rows = c_.rows;
+        });
+    }
+
+    // Every row, every column
+    void full_scan() {
+        SelectStmt stmt = select("SELECT id, key, category, amount FROM events;");
+        measure("full_scan_project", [&](Result& r) {
+            Meter m;
+            Cursor cur = db_.open_cursor(stmt);
+            r.rows = drain(cur);
+            m.stop(r);
+            r.ops = 1;
+        });
+    }
+
+    void group_by() {
+        SelectStmt stmt = select("SELECT key, COUNT(*), SUM(amount) FROM events GROUP BY key;");
+        measure("group_by_key", [&](Result& r) {
+            Meter m;
+            Cursor cur = db_.open_cursor(stmt);
+            drain(cur);
+            m.stop(r);
+            r.ops = 1;
+            r.rows = c_.rows;
+        });
+    }
+
+    // events joined to a dimension table 1/ratio its size; keys outside the
+    // dimension find no match
+    void join(size_t ratio) {
+        std::string dims = "dims_" + std::to_string(ratio);
+        size_t n = std::max<size_t>(1, c_.rows / ratio);
+        db_.create_table(CreateTableStmt{dims, {{"key", ColumnType::Int}, {"name", ColumnType::Text}}});
+        for (size_t id = 0; id < n; id += 1000) {
+            InsertStmt ins{dims, {}, 0, {}};
+            for (size_t i = id; i < std::min(n, id + 1000); ++i) {
+                ins.values.push_back(std::to_string(i));
+                ins.values.push_back("name_" + std::to_string(i));
+                ++ins.rows;
+            }
+            db_.insert_row(ins);
+        }
+        SelectStmt stmt = select("SELECT events.amount, " + dims + ".name FROM events JOIN " + dims + " ON events.key = " + dims + ".key;");
+        measure("join_1_to_" + std::to_string(ratio), [&](Result& r) {
+            Meter m;
+            Cursor cur = db_.open_cursor(stmt);
+            drain(cur);
+            m.stop(r);
+            r.ops = 1;
+            r.rows = c_.rows;
+        });
+    }
+
+    // Lexing and parsing a script of single-row INSERTs and SELECTs; ops are statements
+    void parse() {
+        std::string sql;
+        size_t statements = std::min<size_t>(c_.rows, 100000);
+        for (size_t i = 0; i < statements; ++i) {
+            if (i % 2) {
+                sql += "INSERT INTO events VALUES (" + std::to_string(i) + ", " + std::to_string(i % 977) + ", 'category " +
+                       std::to_string(i % 100) + "', " + std::to_string(i % 1000) + ");\n";
+            } else {
+                sql += "SELECT events.key, SUM(events.amount) FROM events JOIN dims ON events.key = dims.key WHERE events.amount >= " +
+                       std::to_string(i % 1000) + " GROUP BY events.key ORDER BY SUM(events.amount) DESC LIMIT 10;\n";
+            }
+        }
+        measure("parse", [&](Result& r) {
+            Meter m;
+            r.ops = Parser(Lexer(sql)).parse_all().size();
+            m.stop(r);
+            r.rows = r.ops;
+        });
+    }
+
+    Config const& c_;
+    Database db_;
+    Batch batch_;
+    std::vector<Result> results_;
+};
+
+void write_json(Config const& c, std::vector<Result> const& results) {
+    std::ofstream out(c.json);
+    if (!out) throw std::runtime_error("Cannot write " + c.json);
+    out.precision(12);
+    out << "{\n  \"suite\": \"inmemdb_bench\",\n";
+    out << "  \"config\": {\"rows\": " << c.rows << ", \"cardinality\": " << c.cardinality << ", \"skew\": " << c.skew
+        << ", \"dop\": " << c.dop << ", \"repeat\": " << c.repeat << ", \"seed\": " << c.seed << "},\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        Result const& r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"ops\": " << r.ops << ", \"rows\": " << r.rows << ", \"ns_per_op\": " << r.ns_per_op()
+            << ", \"rows_per_sec\": " << r.rows_per_sec() << ", \"allocs_per_op\": " << r.allocs_per_op() << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+// ns_per_op by scenario name from a file written by write_json
+std::vector<std::pair<std::string, double>> read_baseline(std::string const& path) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("Cannot read " + path);
+    std::vector<std::pair<std::string, double>> out;
+    std::string line;
+    while (std::getline(in, line)) {
+        auto name = line.find("\"name\": \"");
+        auto ns = line.find("\"ns_per_op\": ");
+        if (name == std::string::npos || ns == std::string::npos) continue;
+        name += 9;
+        out.emplace_back(line.substr(name, line.find('"', name) - name), std::strtod(line.c_str() + ns + 13, nullptr));
+    }
+    return out;
+}
+
+} // namespace
+
+int run_suite(int argc, char** argv) {
+    Config c;
+    for (int i = 0; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto eq = arg.find('=');
+        std::string key = arg.substr(0, eq), value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        if (key == "rows") c.rows = std::max<size_t>(100, std::strtoull(value.c_str(), nullptr, 10));
+        else if (key == "cardinality") c.cardinality = std::max<size_t>(1, std::strtoull(value.c_str(), nullptr, 10));
+        else if (key == "skew") c.skew = std::strtod(value.c_str(), nullptr);
+        else if (key == "dop") c.dop = std::max<size_t>(1, std::strtoull(value.c_str(), nullptr, 10));
+        else if (key == "repeat") c.repeat = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "seed") c.seed = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "json") c.json = value;
+        else if (key == "baseline") c.baseline = value;
+        else if (key == "max_slowdown") c.max_slowdown = std::strtod(value.c_str(), nullptr);
+        else { std::cerr << "Unknown suite option: " << arg << "\n"; return 2; }
+    }
+    std::printf("== suite: rows=%zu cardinality=%zu skew=%g dop=%zu ==\n", c.rows, c.cardinality, c.skew, c.dop);
+    std::printf("%-22s %10s %12s %14s %10s\n", "scenario", "ops", "ns_per_op", "rows_per_sec", "allocs_op");
+    g_counting.store(true);
+    auto results = Suite(c).run();
+    g_counting.store(false);
+    if (!c.json.empty()) write_json(c, results);
+    if (c.baseline.empty()) return 0;
+
+    std::printf("== against %s ==\n%-22s %12s %12s %8s\n", c.baseline.c_str(), "scenario", "base_ns", "ns_per_op", "ratio");
+    int status = 0;
+    for (auto const& [name, base] : read_baseline(c.baseline)) {
+        auto it = std::find_if(results.begin(), results.end(), [&](Result const& r) { return r.name == name; });
+        if (it == results.end() || base <= 0) continue;
+        double ratio = it->ns_per_op() / base;
+        bool slow = c.max_slowdown > 0 && ratio > c.max_slowdown;
+        std::printf("%-22s %12.1f %12.1f %8.2f%s\n", name.c_str(), base, it->ns_per_op(), ratio, slow ? "  SLOWER" : "");
+        if (slow) status = 1;
+    }
+    return status;
+}
@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "inmemdb/client.hpp"
+
+// Load generator for inmemdb_server: `connections` clients each keep
+// `depth` queries in flight for `seconds`, and the run reports throughput
+// and latency percentiles. Latency runs from a query's send to the arrival
+// of its answer, so with depth > 1 it includes time queued behind the rest
+// of the pipeline.
+//
+//   inmemdb_loadgen [host=ADDR] [port=N] [unix=PATH] [connections=C] [depth=D]
+//                   [seconds=S] [rows=N] [setup=0|1] [seed=X] [query=SQL]
+//
+// With setup=1 (default) it first creates kv(id INT, v INT) with `rows`
+// rows and a hash index on id. `{key}` in the query is replaced by a random
+// key in [0, rows); the default query is a point lookup on kv.
+
+using namespace inmemdb;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Config {
+    std::string host = "127.0.0.1";
+    uint16_t port = 5433;
+    std::string unix_path;
+    size_t connections = 4;
+    size_t depth = 16;
+    double seconds = 5;
+    size_t rows = 100000;
+    bool setup = true;
+    uint64_t seed = 42;
+    std::string query = "SELECT v FROM kv WHERE id = {key};";
+};
+
+Client open_client(Config const& cfg) {
+    return cfg.unix_path.empty() ? Client::connect_tcp(cfg.host, cfg.port) : Client::connect_unix(cfg.unix_path);
+}
+
+void check(std::vector<wire::StatementResult> const& results) {
+    for (auto const& r : results)
+        if (!r.success) throw std::runtime_error(r.message);
+}
+
+void setup(Config const& cfg) {
+    Client c = open_client(cfg);
+    check(c.query("CREATE TABLE kv (id INT, v INT);"));
+    check(c.query("CREATE INDEX kv_id ON kv(id) USING HASH;"));
+    constexpr size_t kChunk = 1000;
+    for (size_t at = 0; at < cfg.rows; at += kChunk) {
+        std::string sql;
+        for (size_t i = at; i < std::min(cfg.rows, at + kChunk); ++i)
+            sql += "INSERT INTO kv VALUES (" + std::to_string(i) + ", " + std::to_string(i * 7 % 1000) + ");";
+        c.send(sql);
+    }
+    // Answers to the pipelined inserts
+    for (size_t at = 0; at < cfg.rows; at += kChunk) check(c.receive().results);
+}
+
+struct Worker {
+    std::vector<uint64_t> latencies_ns;
+    size_t errors = 0;
+    std::string failure;
+};
+
+void run_connection(Config const& cfg, size_t index, Clock::time_point end, Worker& out) {
+    try {
+        Client c = open_client(cfg);
+        std::mt19937_64 rng(cfg.seed + index);
+        std::uniform_int_distribution<size_t> key(0, std::max<size_t>(cfg.rows, 1) - 1);
+        size_t slot = cfg.query.find("{key}");
+        std::deque<Clock::time_point> sent;
+        while (true) {
+            auto now = Clock::now();
+            if (now < end) {
+                while (sent.size() < cfg.depth) {
+                    std::string sql = cfg.query;
+                    if (slot != std::string::npos) sql.replace(slot, 5, std::to_string(key(rng)));
+                    c.send(sql);
+                    sent.push_back(now);
+                }
+                c.flush();
+            }
+            if (sent.empty()) break;
+            auto res = c.receive();
+            out.latencies_ns.push_back(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - sent.front()).count()));
+            sent.pop_front();
+            for (auto const& r : res.results) out.errors += !r.success;
+        }
+    } catch (std::exception const& ex) {
+        out.failure = ex.what();
+    }
+}
+
+double percentile_us(std::vector<uint64_t> const& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t i = std::min(sorted.size() - 1, static_cast<size_t>(p * static_cast<double>(sorted.size())));
+    return static_cast<double>(sorted[i]) / 1e3;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Config cfg;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto eq = arg.find('=');
+        if (eq == std::string::npos) {
+            std::cerr << "Expected key=value, got " << arg << "\n";
+            return 2;
+        }
+        std::string key = arg.substr(0, eq), val = arg.substr(eq + 1);
+        if (key == "host") cfg.host = val;
+        else if (key == "port") cfg.port = static_cast<uint16_t>(std::stoul(val));
+        else if (key == "unix") cfg.unix_path = val;
+        else if (key == "connections") cfg.connections = std::max<size_t>(1, std::stoull(val));
+        else if (key == "depth") cfg.depth = std::max<size_t>(1, std::stoull(val));
+        else if (key == "seconds") cfg.seconds = std::stod(val);
+        else if (key == "rows") cfg.rows = std::stoull(val);
+        else if (key == "setup") cfg.setup = val != "0";
+        else if (key == "seed") cfg.seed = std::stoull(val);
+        else if (key == "query") cfg.query = val;
+        else {
+            std::cerr << "Unknown option " << key << "\n";
+            return 2;
+        }
+    }
+
+    try {
+        if (cfg.setup) setup(cfg);
+    } catch (std::exception const& ex) {
+        std::cerr << "Setup failed: " << ex.what() << "\n";
+        return 1;
+    }
+
+    std::vector<Worker> workers(cfg.connections);
+    std::vector<std::thread> threads;
+    auto start = Clock::now();
+    auto end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(cfg.seconds));
+    for (size_t i = 0; i < cfg.connections; ++i) threads.emplace_back(run_connection, std::cref(cfg), i, end, std::ref(workers[i]));
+    for (auto& t : threads) t.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<uint64_t> all;
+    size_t errors = 0;
+    for (auto const& w : workers) {
+        if (!w.failure.empty()) {
+            std::cerr << "Connection failed: " << w.failure << "\n";
+            return 1;
+        }
+        all.insert(all.end(), w.latencies_ns.begin(), w.latencies_ns.end());
+        errors += w.errors;
+    }
+    std::sort(all.begin(), all.end());
+    std::printf("connections=%zu depth=%zu seconds=%.1f\n", cfg.connections, cfg.depth, elapsed);
+    std::printf("requests=%zu errors=%zu qps=%.0f\n", all.size(), errors, static_cast<double>(all.size()) / elapsed);
+    std::printf("latency_us p50=%.1f p99=%.1f p999=%.1f max=%.1f\n", percentile_us(all, 0.5), percentile_us(all, 0.99),
+                percentile_us(all, 0.999), all.empty() ? 0.0 : static_cast<double>(all.back()) / 1e3);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "inmemdb/batch.hpp"
+#include "inmemdb/column.hpp"
+#include "inmemdb/parser.hpp"
+
+namespace inmemdb {
+
+// A stored column read by the aggregator, and which row-id list addresses it
+struct AggColumn {
+    ColumnData const* data;
+    ColumnType type;
+    int sel;    // table of the query (FROM/JOIN order) whose row ids address it
+    size_t idx; // column of that table; plans bind data from it per cursor
+};
+
+// Hash aggregation over typed columns. It is fed row ids straight from the
+// scan or join, so input rows are never materialised; without GROUP BY there
+// is exactly one group and no hashing at all. Groups come out in the order
+// they were first seen, also after merging partial aggregators built by
+// parallel workers. There are no NULLs, so SUM/MIN/MAX/AVG over an empty
+// input yield 0 (or '' for TEXT).
+class HashAggregator {
+public:
+    struct Aggregate {
+        AggFunc func;
+        std::optional<AggColumn> input; // empty for COUNT(*)
+    };
+    struct Output {
+        bool is_key; // GROUP BY column, or aggregate
+        size_t idx;  // into keys or aggregates
+    };
+
+    HashAggregator(std::vector<AggColumn> keys, std::vector<Aggregate> aggs, std::vector<Output> outputs);
+
+    std::vector<ColumnType> output_types() const;
+    size_t group_count() const { return group_count_; }
+    // Approximate bytes held by the groups, their hash maps and the chunk scratch
+    size_t footprint() const;
+
+    // Fold one chunk of input rows: rows[t] holds the row id of table t for
+    // each of them (table 0 is always read, so its list sets the count)
+    void consume(std::vector<size_t> const* rows);
+    // Same, with row i of the chunk at input position pos + i; positions only
+    // order the groups, so chunks may arrive in any order
+    void consume(std::vector<size_t> const* rows, uint64_t pos);
+    // Fold in a partial aggregator over the same columns and aggregates
+    void merge(HashAggregator const& other);
+    // Replace `out` with up to max_rows finished groups; false once exhausted
+    bool next(Batch& out, size_t max_rows);
+
+private:
+    // Per-aggregate state, one slot per group
+    struct State {
+        std::vector<int64_t> count; // rows folded in
+        std::vector<__int128> sum;  // SUM / AVG; wide enough never to overflow, SUM is range-checked on output
+        std::vector<int64_t> ival;  // MIN / MAX over INT
+        std::vector<std::string> sval; // MIN / MAX over TEXT
+    };
+
+    void assign_groups(std::vector<size_t> const* rows);
+    uint32_t add_group(size_t i, std::vector<size_t> const* rows);
+    uint32_t new_group(uint64_t first_pos);
+    void update(Aggregate const& agg, State& st, std::vector<size_t> const* rows);
+
+    std::vector<AggColumn> keys_;
+    std::vector<Aggregate> aggs_;
+    std::vector<Output> outputs_;
+
+    // Group lookup: a typed map for a single INT key, encoded key bytes otherwise
+    std::unordered_map<int64_t, uint32_t> int_groups_;
+    std::unordered_map<std::string, uint32_t> groups_;
+    std::string key_buf_;
+    std::vector<BatchColumn> key_values_; // GROUP BY values of each group
+    std::vector<State> states_;
+    std::vector<uint64_t> first_pos_; // earliest input position of each group
+    size_t group_count_ = 0;
+    uint64_t chunk_pos_ = 0; // input position of the current chunk's first row
+    uint64_t end_pos_ = 0;   // furthest input position consumed so far
+
+    std::vector<uint32_t> gids_; // group of each row in the current chunk
+    std::vector<int64_t> ivals_; // INT key or input values of the chunk, decoded once
+    std::vector<uint32_t> order_; // groups by first_pos_, built on the first next()
+    size_t emitted_ = 0;
+};
+
+} // namespace inmemdb
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "inmemdb/parser.hpp"
+
+namespace inmemdb {
+
+// One output column of a Batch: `ints` for INT, `reals` for REAL, offsets/bytes for TEXT
+struct BatchColumn {
+    ColumnType type = ColumnType::Int;
+    std::vector<int64_t> ints;
+    std::vector<double> reals;
+    std::vector<uint64_t> offsets{0}; // text value i is bytes[offsets[i], offsets[i+1])
+    std::string bytes;
+
+    size_t size() const {
+        if (type == ColumnType::Int) return ints.size();
+        if (type == ColumnType::Real) return reals.size();
+        return offsets.size() - 1;
+    }
+    int64_t int_at(size_t i) const { return ints[i]; }
+    double real_at(size_t i) const { return reals[i]; }
+    std::string_view text_at(size_t i) const {
+        return {bytes.data() + offsets[i], static_cast<size_t>(offsets[i + 1] - offsets[i])};
+    }
+    void push_int(int64_t v) { ints.push_back(v); }
+    void push_real(double v) { reals.push_back(v); }
+    void push_text(std::string_view v) { bytes.append(v); offsets.push_back(bytes.size()); }
+    // Bytes of the values held (TEXT: characters plus offsets)
+    size_t byte_size() const {
+        return ints.size() * sizeof(int64_t) + reals.size() * sizeof(double) + bytes.size() + (offsets.size() - 1) * sizeof(uint64_t);
+    }
+    void clear() { ints.clear(); reals.clear(); offsets.assign(1, 0); bytes.clear(); }
+    // Append values [begin, end) of a column of the same type
+    void append(BatchColumn const& src, size_t begin, size_t end) {
+        if (type == ColumnType::Int) { ints.insert(ints.end(), src.ints.begin() + begin, src.ints.begin() + end); return; }
+        if (type == ColumnType::Real) { reals.insert(reals.end(), src.reals.begin() + begin, src.reals.begin() + end); return; }
+        uint64_t base = bytes.size();
+        bytes.append(src.bytes, src.offsets[begin], src.offsets[end] - src.offsets[begin]);
+        for (size_t i = begin + 1; i <= end; ++i) offsets.push_back(base + (src.offsets[i] - src.offsets[begin]));
+    }
+};
+
+// A slice of a result set, stored column by column with typed values
+struct Batch {
+    std::vector<BatchColumn> columns;
+    size_t rows = 0;
+
+    size_t byte_size() const {
+        size_t n = 0;
+        for (auto const& c : columns) n += c.byte_size();
+        return n;
+    }
+};
+
+} // namespace inmemdb
@@ -0,0 +1,125 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+namespace inmemdb {
+
+// In-memory B+tree from keys to row ids. Duplicate keys are allowed: entries
+// are ordered by (key, row) so each one is unique. Leaves are chained left to
+// right so range scans walk them without going back up the tree. Nodes and
+// their arrays are allocated from `mr` (and so are the keys, when K is
+// allocator-aware like std::pmr::string).
+template <typename K, size_t MaxEntries = 64>
+class BPlusTree {
+public:
+    using Entry = std::pair<K, size_t>;
+
+    explicit BPlusTree(std::pmr::memory_resource* mr = std::pmr::get_default_resource()) : mr_(mr), root_(make_node(true)) {}
+
+    size_t size() const { return size_; }
+
+    void insert(K const& key, size_t row) {
+        Entry e{key, row};
+        auto split = insert_into(*root_, e);
+        if (split.second) {
+            // Root overflowed: grow the tree by one level
+            auto root = make_node(false);
+            root->entries.push_back(std::move(split.first));
+            root->children.push_back(std::move(root_));
+            root->children.push_back(std::move(split.second));
+            root_ = std::move(root);
+        }
+        ++size_;
+    }
+
+    // Visit the row of every entry with key in the given range, in key order.
+    // A null bound is open; the *_incl flags select <= / >= over < / >.
+    // Q is any type that compares with K (e.g. std::string_view for text).
+    template <typename Q, typename F>
+    void scan(Q const* lo, bool lo_incl, Q const* hi, bool hi_incl, F&& f) const {
+        Node const* n = root_.get();
+        while (!n->leaf) {
+            size_t i = 0;
+            if (lo) i = static_cast<size_t>(std::partition_point(n->entries.begin(), n->entries.end(),
+                [&](Entry const& s) { return lo_incl ? s.first < *lo : !(*lo < s.first); }) - n->entries.begin());
+            n = n->children[i].get();
+        }
+        for (; n; n = n->next) {
+            for (auto const& e : n->entries) {
+                if (lo && (lo_incl ? e.first < *lo : !(*lo < e.first))) continue;
+                if (hi && (hi_incl ? *hi < e.first : !(e.first < *hi))) return;
+                f(e.second);
+            }
+        }
+    }
+
+private:
+    // Leaves hold entries; internal nodes hold separators, where everything in
+    // children[i] is below entries[i] and everything in children[i + 1] is not.
+    struct Node;
+    struct NodeDeleter {
+        std::pmr::memory_resource* mr;
+        void operator()(Node* n) const { std::pmr::polymorphic_allocator<Node>(mr).delete_object(n); }
+    };
+    using NodePtr = std::unique_ptr<Node, NodeDeleter>;
+    struct Node {
+        Node(std::pmr::memory_resource* mr, bool is_leaf) : leaf(is_leaf), entries(mr), children(mr) {}
+        bool leaf = false;
+        std::pmr::vector<Entry> entries;
+        std::pmr::vector<NodePtr> children;
+        Node* next = nullptr; // right sibling, leaves only
+    };
+    using Split = std::pair<Entry, NodePtr>;
+
+    // Nodes get their full capacity up front (one entry over MaxEntries
+    // before a split): arrays never regrow, and a split half keeps ~1 KB
+    // instead of the 2x capacity a grown vector would hold on to
+    NodePtr make_node(bool leaf) {
+        NodePtr n(std::pmr::polymorphic_allocator<Node>(mr_).template new_object<Node>(mr_, leaf), NodeDeleter{mr_});
+        n->entries.reserve(MaxEntries + 1);
+        if (!leaf) n->children.reserve(MaxEntries + 2);
+        return n;
+    }
+
+    // Insert below n; returns the separator and new right sibling if n split
+    Split insert_into(Node& n, Entry const& e) {
+        auto pos = std::upper_bound(n.entries.begin(), n.entries.end(), e);
+        if (n.leaf) {
+            n.entries.insert(pos, e);
+        } else {
+            size_t ci = static_cast<size_t>(pos - n.entries.begin());
+            auto child = insert_into(*n.children[ci], e);
+            if (!child.second) return {};
+            n.entries.insert(n.entries.begin() + static_cast<std::ptrdiff_t>(ci), std::move(child.first));
+            n.children.insert(n.children.begin() + static_cast<std::ptrdiff_t>(ci) + 1, std::move(child.second));
+        }
+        if (n.entries.size() <= MaxEntries) return {};
+
+        auto right = make_node(n.leaf);
+        size_t mid = n.entries.size() / 2;
+        Entry sep = n.entries[mid];
+        if (n.leaf) {
+            // The separator is copied up; the right leaf keeps it as its first entry
+            right->entries.assign(n.entries.begin() + static_cast<std::ptrdiff_t>(mid), n.entries.end());
+            right->next = n.next;
+            n.next = right.get();
+        } else {
+            // The separator moves up; its right child becomes right's first child
+            right->entries.assign(n.entries.begin() + static_cast<std::ptrdiff_t>(mid) + 1, n.entries.end());
+            for (size_t i = mid + 1; i < n.children.size(); ++i) right->children.push_back(std::move(n.children[i]));
+            n.children.resize(mid + 1);
+        }
+        n.entries.resize(mid);
+        return {std::move(sep), std::move(right)};
+    }
+
+    std::pmr::memory_resource* mr_;
+    NodePtr root_;
+    size_t size_ = 0;
+};
+
+} // namespace inmemdb
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "inmemdb/protocol.hpp"
+
+namespace inmemdb {
+
+// Blocking client for inmemdb_server. Queries can be pipelined: send()
+// several, then receive() the answers, which come back in send order.
+class Client {
+public:
+    static Client connect_tcp(std::string const& host, uint16_t port);
+    static Client connect_unix(std::string const& path);
+    Client(Client&& other) noexcept;
+    Client& operator=(Client&& other) noexcept;
+    ~Client();
+
+    // Queue a query and return its request id; it goes out with the next
+    // flush() or receive()
+    uint32_t send(std::string_view sql);
+    void flush();
+
+    struct Response {
+        uint32_t id = 0;
+        std::vector<wire::StatementResult> results; // one per statement
+    };
+    // The oldest unanswered query's response
+    Response receive();
+    // send + receive
+    std::vector<wire::StatementResult> query(std::string_view sql);
+
+private:
+    explicit Client(int fd) : fd_(fd) {}
+    int fd_ = -1;
+    uint32_t next_id_ = 1;
+    std::string out_, in_;
+    size_t in_pos_ = 0; // start of the unparsed input
+};
+
+} // namespace inmemdb
@@ -0,0 +1,66 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace inmemdb {
+
+// Little-endian varint / zigzag / length-prefixed string codec for WAL records and snapshot catalogs
+struct ByteWriter {
+    std::string& out;
+
+    void put_u8(uint8_t v) { out.push_back(static_cast<char>(v)); }
+    void put_varint(uint64_t v) {
+        while (v >= 0x80) { out.push_back(static_cast<char>(v | 0x80)); v >>= 7; }
+        out.push_back(static_cast<char>(v));
+    }
+    void put_svarint(int64_t v) { put_varint((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63)); }
+    void put_string(std::string_view s) { put_varint(s.size()); out.append(s); }
+};
+
+struct ByteReader {
+    std::string_view in;
+    size_t pos = 0;
+
+    uint8_t get_u8() {
+        if (pos >= in.size()) throw std::runtime_error("Truncated record");
+        return static_cast<uint8_t>(in[pos++]);
+    }
+    uint64_t get_varint() {
+        uint64_t v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            uint8_t b = get_u8();
+            v |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        throw std::runtime_error("Bad varint in record");
+    }
+    int64_t get_svarint() { uint64_t v = get_varint(); return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+    std::string_view get_string() {
+        uint64_t n = get_varint();
+        if (n > in.size() - pos) throw std::runtime_error("Truncated record");
+        std::string_view s = in.substr(pos, n);
+        pos += n;
+        return s;
+    }
+};
+
+// CRC-32 (IEEE), used to detect torn or corrupt records
+inline uint32_t crc32(std::string_view data) {
+    static const auto table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t c = 0xFFFFFFFFu;
+    for (char ch : data) c = table[(c ^ static_cast<uint8_t>(ch)) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+} // namespace inmemdb
@@ -0,0 +1,239 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <variant>
+#include <unordered_map>
+#include "inmemdb/memory.hpp"
+
+namespace inmemdb {
+
+using Value = std::variant<int64_t, std::string>;
+
+// Parse a whole string as a base-10 int64; false on junk or overflow
+bool parse_int64(const std::string& raw, int64_t& out);
+
+// Append-only contiguous array whose copies share storage. A copy keeps its
+// own length, and push_back only writes past the end of the newest copy (or
+// moves to a larger block), so a copy taken as a snapshot never sees later
+// appends and stays valid while the original grows. Only one copy may be
+// appended to at a time; appending to an older copy forks it into its own
+// block instead of overwriting the shared one.
+template <class T>
+class AppendBuffer {
+public:
+    // Read-only view of n items kept alive by `backing` (e.g. a mapped
+    // snapshot file); the first append copies them into a heap block
+    static AppendBuffer view(T const* items, size_t n, std::shared_ptr<void const> backing) {
+        AppendBuffer buf;
+        if (n == 0) return buf;
+        auto b = std::make_shared<Block>();
+        b->items = const_cast<T*>(items); // never written: used == capacity
+        b->capacity = b->used = n;
+        b->backing = std::move(backing);
+        buf.block_ = std::move(b);
+        buf.size_ = n;
+        return buf;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    T const* data() const { return block_ ? block_->items : nullptr; }
+    T const* begin() const { return data(); }
+    T const* end() const { return data() + size_; }
+    T const& operator[](size_t i) const { return block_->items[i]; }
+    T const& back() const { return block_->items[size_ - 1]; }
+
+    // The current block: its whole capacity, and one allocation unless it is a view
+    MemoryStats memory() const {
+        if (!block_) return {};
+        return {block_->capacity * sizeof(T), block_->owned ? size_t(1) : size_t(0)};
+    }
+
+    void reserve(size_t n) { if (!block_ || n > block_->capacity) regrow(n); }
+    void push_back(T const& v) { append(&v, 1); }
+    void append(T const* src, size_t n) {
+        if (!block_ || size_ != block_->used || size_ + n > block_->capacity) regrow(size_ + n);
+        std::copy(src, src + n, block_->items + size_);
+        size_ += n;
+        block_->used = size_;
+    }
+
+private:
+    struct Block {
+        std::unique_ptr<T[]> owned;
+        T* items = nullptr; // owned, or memory kept alive by backing
+        size_t capacity = 0;
+        size_t used = 0; // length of the copy that last appended
+        std::shared_ptr<void const> backing;
+    };
+
+    void regrow(size_t min_capacity) {
+        auto b = std::make_shared<Block>();
+        b->capacity = std::max<size_t>({16, min_capacity, block_ && size_ == block_->used ? 2 * block_->capacity : 0});
+        b->owned.reset(new T[b->capacity]);
+        b->items = b->owned.get();
+        if (size_) std::copy(data(), data() + size_, b->items);
+        b->used = size_;
+        block_ = std::move(b);
+    }
+
+    std::shared_ptr<Block> block_;
+    size_t size_ = 0;
+};
+
+// Rows per zone-map block (one cursor batch). Each full block of a column
+// records its smallest and largest value so scans can skip it; the open
+// block at the end has no zone yet and is always scanned.
+inline constexpr size_t kZoneRows = 1024;
+
+struct IntZone {
+    int64_t min;
+    int64_t max;
+};
+
+// TEXT zones name the rows holding the smallest and largest value
+struct TextZone {
+    uint64_t min_row;
+    uint64_t max_row;
+};
+
+// How a sealed INT segment stores its values
+enum class IntEncoding : uint8_t {
+    Plain = 0,     // one int64_t per row
+    BitPacked = 1, // frame of reference: v - min in `bits` bits per row
+    Delta = 2,     // first value of each block, then step - base in `bits` bits per row
+    RunLength = 3, // one value and end row per run
+};
+
+const char* to_string(IntEncoding e);
+
+// Sealed, immutable rows of an INT column, stored in whichever encoding is
+// smallest for them. Packed codes form one bit stream; a 64-row block takes
+// exactly `bits` words, so unpacking a block needs no bounds checks.
+struct IntSegment {
+    static constexpr size_t kBlockRows = 64;
+
+    IntEncoding encoding = IntEncoding::Plain;
+    uint8_t bits = 0;
+    size_t rows = 0;
+    int64_t min = 0, max = 0;
+    int64_t base = 0;                // BitPacked: min; Delta: smallest step
+    AppendBuffer<int64_t> values;    // Plain: each row; Delta: first row of each block; RunLength: each run
+    AppendBuffer<uint64_t> packed;   // BitPacked codes or Delta steps
+    AppendBuffer<uint32_t> run_ends; // RunLength: end row (exclusive) of each run
+
+    static IntSegment encode(int64_t const* items, size_t n);
+
+    size_t blocks() const { return (rows + kBlockRows - 1) / kBlockRows; }
+    int64_t at(size_t i) const;
+    // Decode rows [begin, end) into out
+    void decode(size_t begin, size_t end, int64_t* out) const;
+    // The 64 raw codes of block b (BitPacked and Delta)
+    void unpack(size_t b, uint64_t* out) const;
+    // Array sizes match the encoding, runs ascend; checked on snapshot load
+    bool consistent() const;
+    MemoryStats memory() const;
+};
+
+// INT column: full segments of kSegmentRows rows are sealed into compressed
+// IntSegments; the rows after them stay in a plain tail. Sealing swaps in a
+// new tail, so copies taken as snapshots keep their own.
+struct IntColumn {
+    static constexpr size_t kSegmentRows = 16 * 1024; // one scan morsel
+
+    AppendBuffer<std::shared_ptr<IntSegment const>> segments;
+    AppendBuffer<int64_t> tail;
+    AppendBuffer<IntZone> zones; // one per full kZoneRows block
+
+    size_t sealed_rows() const { return segments.size() * kSegmentRows; }
+    size_t size() const { return sealed_rows() + tail.size(); }
+    int64_t at(size_t row) const {
+        size_t s = row / kSegmentRows;
+        if (s < segments.size()) return segments[s]->at(row % kSegmentRows);
+        return tail[row - sealed_rows()];
+    }
+    void push_back(int64_t v) { append(&v, 1); }
+    void append(int64_t const* items, size_t n);
+    // out[i] = at(rows[i]); ascending rows decode each 64-row block once
+    void gather(size_t const* rows, size_t n, int64_t* out) const;
+    // Compress every full segment of the tail
+    void seal();
+    // Add the zones of blocks filled since the last call
+    void extend_zones();
+};
+
+// Variable-width TEXT column: row i is bytes[offsets[i], offsets[i+1])
+struct TextColumn {
+    AppendBuffer<uint64_t> offsets;
+    AppendBuffer<char> bytes;
+    AppendBuffer<TextZone> zones; // one per full kZoneRows block, kept by extend_zones()
+
+    TextColumn() { offsets.push_back(0); }
+
+    size_t size() const { return offsets.size() - 1; }
+    std::string_view at(size_t row) const {
+        return {bytes.data() + offsets[row], static_cast<size_t>(offsets[row + 1] - offsets[row])};
+    }
+    void push_back(std::string_view v) { bytes.append(v.data(), v.size()); offsets.push_back(bytes.size()); }
+    void extend_zones();
+};
+
+// Writer-side value -> code map of a DictColumn, keys kept in its own arena
+struct DictLookup {
+    Arena arena;
+    std::pmr::unordered_map<std::pmr::string, uint32_t, TextHash, std::equal_to<>> map{arena.resource()};
+
+    // Code of v, inserting it as `next` when it is new; second tells which
+    std::pair<uint32_t, bool> insert(std::string_view v, uint32_t next) {
+        auto it = map.find(v);
+        if (it != map.end()) return {it->second, false};
+        map.emplace(std::pmr::string(v, map.get_allocator()), next);
+        return {next, true};
+    }
+};
+
+// Dictionary-encoded TEXT column: a 32-bit code per row into a table of the
+// distinct values, for low-cardinality columns (status, country, tenant)
+struct DictColumn {
+    static constexpr uint32_t kNoCode = UINT32_MAX; // code of a value not in the dictionary
+
+    AppendBuffer<uint32_t> codes;
+    TextColumn dict; // code c is dict.at(c)
+    AppendBuffer<TextZone> zones; // one per full kZoneRows block, kept by extend_zones()
+    // Writer-side value -> code map; shared by copies, so snapshots use find()
+    std::shared_ptr<DictLookup> lookup = std::make_shared<DictLookup>();
+
+    size_t size() const { return codes.size(); }
+    std::string_view at(size_t row) const { return dict.at(codes[row]); }
+    void push_back(std::string_view v);
+    // Code for v, or kNoCode when no row holds it. Reads only the dictionary,
+    // so it is safe on a snapshot while the table grows.
+    uint32_t find(std::string_view v) const;
+    void extend_zones();
+    // Re-encode a plain TEXT column
+    static DictColumn encode(TextColumn const& col);
+    // Back to plain TEXT, for a dictionary that stopped paying off
+    TextColumn decode() const;
+};
+
+// Column storage; INT columns are IntColumn, TEXT columns TextColumn or
+// DictColumn. Copies are cheap snapshots that share the appended data.
+using ColumnData = std::variant<IntColumn, TextColumn, DictColumn>;
+
+// Storage behind one column (for a DictColumn including its lookup map)
+MemoryStats memory_stats(ColumnData const& col);
+
+// Bring the zone map of any column up to its full blocks
+void extend_zones(ColumnData& col);
+
+// TEXT cell of either representation
+inline std::string_view text_at(ColumnData const& col, size_t row) {
+    if (auto dc = std::get_if<DictColumn>(&col)) return dc->at(row);
+    return std::get<TextColumn>(col).at(row);
+}
+
+} // namespace inmemdb
@@ -0,0 +1,154 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <variant>
+#include <optional>
+#include <unordered_map>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+#include "inmemdb/batch.hpp"
+#include "inmemdb/aggregate.hpp"
+#include "inmemdb/column.hpp"
+#include "inmemdb/operators.hpp"
+#include "inmemdb/optimizer.hpp"
+#include "inmemdb/parser.hpp"
+#include "inmemdb/predicate.hpp"
+#include "inmemdb/sort.hpp"
+
+namespace inmemdb {
+
+struct Table;
+class Database;
+
+// A SELECT resolved against the table schemas: column references, the WHERE
+// literals typed for their columns (or the parameters supplying them),
+// output and sort layout, the access path and the join conditions. Plans
+// hold no row data, so one plan serves any number of cursors. Tables and
+// their columns never change shape and indexes are only added, so a plan
+// stays correct; a newer schema may just offer a better access path.
+struct SelectPlan {
+    struct ColRef { int sel; size_t idx; }; // sel: position of the table in `tables`
+    using JoinAlgo = inmemdb::JoinAlgo;
+
+    std::vector<std::string> tables; // the FROM table, then the joined ones in query order
+    std::vector<std::string> header;
+    std::vector<ColumnType> types;
+    std::vector<ColumnType> row_types; // produced columns: types plus hidden ORDER BY keys
+    std::vector<ColRef> proj;
+
+    // A WHERE node with its columns resolved and literals typed. Leaves
+    // take one operand (Compare), the low and high bound (Between) or the
+    // list (In); `sel` is the table every column below it reads.
+    struct Cond {
+        using Kind = WhereExpr::Kind;
+        struct Operand {
+            Value literal;
+            std::optional<size_t> param; // the literal is this parameter instead
+        };
+        Kind kind = Kind::Compare;
+        ColRef col{0, 0};
+        CompareOp op = CompareOp::Eq;
+        std::vector<Operand> operands;
+        std::vector<Cond> children;
+        int sel = 0;
+    };
+
+    // WHERE as its top-level AND terms. A Compare term may be answered by
+    // where_index (position in the only table's indexes); the others filter
+    // the table they read.
+    std::vector<Cond> where;
+    std::optional<size_t> where_index;
+    size_t where_indexed = 0; // the term where_index answers
+
+    // One condition per JOIN: left op right, where right reads the joined
+    // table and left a table before it. The scanned table, the join order
+    // and each join's algorithm are chosen per cursor from the table
+    // statistics, since they shift as the tables grow.
+    struct Join {
+        ColRef left, right;
+        CompareOp op = CompareOp::Eq;
+    };
+    std::vector<Join> joins;
+
+    // GROUP BY / aggregates; AggColumn::data is bound per cursor
+    bool aggregate = false;
+    std::vector<AggColumn> agg_keys;
+    std::vector<HashAggregator::Aggregate> aggs;
+    std::vector<HashAggregator::Output> agg_outputs;
+
+    // ORDER BY (empty: none), OFFSET and LIMIT
+    std::vector<Sorter::Key> sort_keys;
+    size_t offset = 0;
+    std::optional<size_t> limit;
+};
+
+// Pull-based SELECT execution. Construction resolves tables, columns, the
+// WHERE literals and the access path once and assembles the operator
+// pipeline (operators.hpp): scan or index lookup, join probes and filters
+// over row ids, then project or aggregate, then sort or limit. Each next()
+// pulls the following batch from the top. The cursor reads tables in
+// place, so they must not be modified while it is open.
+//
+// With dop > 1, scans and joins over more than one morsel (a fixed range of
+// outer rows) run morsel-driven on the shared ThreadPool: every worker runs
+// the row pipeline over whole morsels and projects them, or folds them into
+// a partial aggregate. Projected morsels are produced a window of 2 x dop at
+// a time, not streamed: next() blocks while a window runs, and the window
+// holds that many morsels of output. They are handed out in morsel order so
+// rows come out as in a serial run. Index lookups and LIMIT without ORDER BY
+// stay serial, since they touch few rows.
+class Cursor {
+public:
+    static constexpr size_t kBatchRows = kChunkRows;
+    static constexpr size_t kMorselRows = inmemdb::kMorselRows;
+
+    Cursor(Database const& db, SelectStmt const& stmt, size_t dop = 1);
+    // Run a plan, taking `?`/`$n` values from params
+    Cursor(Database const& db, std::shared_ptr<SelectPlan const> plan, std::vector<Value> const& params, size_t dop = 1);
+
+    // Snapshots of the named tables as of one commit; throws on unknown names
+    static std::vector<std::shared_ptr<Table const>> snapshot(Database const& db, std::vector<std::string> const& names);
+    // Resolve a SELECT against its tables, in SelectStmt::tables() order
+    static std::shared_ptr<SelectPlan const> plan(std::vector<Table const*> const& tables, SelectStmt const& stmt);
+    // How a plan's joins run over these tables: order_joins() on their
+    // statistics and the estimated WHERE selectivities. Terms with a
+    // parameter missing from params get a fixed guess.
+    static JoinOrder join_order(SelectPlan const& p, std::vector<Table const*> const& tables, std::vector<Value> const& params);
+
+    std::vector<std::string> const& header() const { return plan_->header; }
+    std::vector<ColumnType> const& types() const { return plan_->types; }
+
+    // Replace `out` with up to max_rows further rows; false once exhausted
+    bool next(Batch& out, size_t max_rows = kBatchRows) { return root_->next(out, max_rows); }
+
+    // Count rows, bytes and time per operator from here on (off by default)
+    void set_profiling(bool on);
+    // Counters so far, with the working memory of the index lookup, join
+    // hash tables, aggregator and sorter filled in
+    CursorStats stats() const;
+    // The join order this cursor runs (no steps without a join)
+    JoinOrder const& join_order() const { return order_; }
+
+private:
+    using ColRef = SelectPlan::ColRef;
+
+    // Bind the plan to the snapshots and parameters and build the pipeline
+    void open(std::vector<Value> const& params);
+
+    std::shared_ptr<SelectPlan const> plan_;
+    // Snapshots of the plan's tables; tables_ points into them
+    std::vector<std::shared_ptr<Table const>> snaps_;
+    std::vector<Table const*> tables_;
+    JoinOrder order_;
+    size_t dop_ = 1;
+
+    // Operators keep references to these, so they live on the heap and the
+    // cursor stays movable
+    std::unique_ptr<OpContext> ctx_;
+    std::unique_ptr<RowSource> source_;
+    std::unique_ptr<BatchOperator> root_;
+};
+
+} // namespace inmemdb
@@ -1,5 +1,8 @@
 #pragma once
 #include "inmemdb/storage.hpp"
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <variant>
 
 namespace inmemdb {
@@ -8,8 +11,18 @@ class Executor {
 public:
     explicit Executor(Database& db) : db_(db) {}
     QueryResult execute(Statement const& stmt);
+
+    // Prepared statement handle, shared through the database's plan cache
+    std::shared_ptr<PreparedStatement const> prepare(std::string const& sql) { return db_.prepare(sql); }
+    QueryResult execute(PreparedStatement const& stmt, std::vector<Value> const& params);
+    // The statement PREPAREd under `name`, or null
+    std::shared_ptr<PreparedStatement const> prepared(std::string const& name) const {
+        auto it = prepared_.find(name);
+        return it == prepared_.end() ? nullptr : it->second;
+    }
 private:
     Database& db_;
+    std::unordered_map<std::string, std::shared_ptr<PreparedStatement const>> prepared_; // PREPARE name AS ...
 };
 
 }
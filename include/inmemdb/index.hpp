@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <shared_mutex>
+#include <memory_resource>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <variant>
+#include <unordered_map>
+#include "inmemdb/btree.hpp"
+#include "inmemdb/column.hpp"
+#include "inmemdb/parser.hpp"
+
+namespace inmemdb {
+
+// Equality-only index: key -> row ids in insertion order
+template <typename K>
+struct HashIndex {
+    using Hash = std::conditional_t<std::is_same_v<K, int64_t>, std::hash<int64_t>, TextHash>;
+    std::pmr::unordered_map<K, std::pmr::vector<size_t>, Hash, std::equal_to<>> map;
+
+    explicit HashIndex(std::pmr::memory_resource* mr) : map(mr) {}
+};
+
+// Text keys are std::pmr::string so they live in the index's arena too
+using IndexData = std::variant<HashIndex<int64_t>, HashIndex<std::pmr::string>,
+                               BPlusTree<int64_t>, BPlusTree<std::pmr::string>>;
+
+// Secondary index over one column of a table. Tables and their snapshots
+// share one Index, so it may hold rows a reader cannot see yet: lookups take
+// the reader's row count and skip rows at or past it. A reader/writer lock
+// keeps probes and the inserts of a concurrent INSERT apart. All of the
+// index's nodes, keys and row lists come from its own arena.
+struct Index {
+    std::string name;
+    size_t column;
+    IndexKind kind;
+    Arena arena; // before data, which allocates from it
+    IndexData data;
+    mutable std::shared_mutex mu;
+
+    Index(std::string name, size_t column, IndexKind kind, ColumnType type);
+
+    // Add row `row` of the indexed column
+    void insert(ColumnData const& col, size_t row);
+    // Whether lookup() can answer `key op value` (hash: =, B+tree: = < <= > >=)
+    bool supports(CompareOp op) const;
+    // Append the rows below `visible` whose key satisfies `key op value`, in no particular order
+    void lookup(CompareOp op, Value const& value, std::vector<size_t>& out, size_t visible = SIZE_MAX) const;
+    // Append the rows below `visible` whose key equals row `row` of `col` (index-nested-loop join)
+    void probe(ColumnData const& col, size_t row, std::vector<size_t>& out, size_t visible = SIZE_MAX) const;
+    MemoryStats memory() const { return arena.stats(); }
+};
+
+} // namespace inmemdb
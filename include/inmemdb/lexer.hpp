@@ -1,4 +1,5 @@
 #pragma once
+#include <deque>
 #include <string>
 #include <vector>
 #include "inmemdb/token.hpp"
@@ -19,6 +20,7 @@ private:
     void skip_ws(); // skip whitespace
 
     std::string input_;
+    std::deque<std::string> unescaped_; // string literals that had escapes; a deque keeps them in place
     std::size_t pos_{};
     Token lookahead_{TokenType::End, "", 0}; 
     bool has_lookahead_ = false; // whether lookahead_ is valid
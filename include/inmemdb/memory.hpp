@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory_resource>
+#include <string_view>
+
+namespace inmemdb {
+
+// Bytes held and the number of separate heap allocations behind them
+struct MemoryStats {
+    size_t bytes = 0;
+    size_t allocations = 0;
+
+    MemoryStats& operator+=(MemoryStats const& o) { bytes += o.bytes; allocations += o.allocations; return *this; }
+};
+
+// Forwards to `upstream` and counts what is outstanding
+class CountingResource : public std::pmr::memory_resource {
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) : upstream_(upstream) {}
+
+    MemoryStats stats() const { return {bytes_.load(std::memory_order_relaxed), allocations_.load(std::memory_order_relaxed)}; }
+
+private:
+    void* do_allocate(size_t bytes, size_t align) override {
+        void* p = upstream_->allocate(bytes, align);
+        bytes_.fetch_add(bytes, std::memory_order_relaxed);
+        allocations_.fetch_add(1, std::memory_order_relaxed);
+        return p;
+    }
+    void do_deallocate(void* p, size_t bytes, size_t align) override {
+        upstream_->deallocate(p, bytes, align);
+        bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+        allocations_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    bool do_is_equal(std::pmr::memory_resource const& o) const noexcept override { return this == &o; }
+
+    std::pmr::memory_resource* upstream_;
+    std::atomic<size_t> bytes_{0};       // read by memory_usage() while the writer allocates
+    std::atomic<size_t> allocations_{0};
+};
+
+// Slab arena behind one index or dictionary: small nodes, keys and row
+// lists come from size-class free lists carved out of large chunks, so a
+// structure with millions of entries makes a few hundred heap allocations
+// instead of one or more per entry. Not synchronized: the owner serializes
+// writes (index lock or commit lock), and readers never allocate.
+class Arena {
+public:
+    Arena() : pool_(std::pmr::pool_options{0, 0}, &counter_) {}
+    Arena(Arena const&) = delete;
+    Arena& operator=(Arena const&) = delete;
+
+    std::pmr::memory_resource* resource() { return &pool_; }
+    // Chunks taken from the heap, whether handed out or on free lists
+    MemoryStats stats() const { return counter_.stats(); }
+
+private:
+    CountingResource counter_;
+    std::pmr::unsynchronized_pool_resource pool_;
+};
+
+// Hash for std::pmr::string keys that also takes string_views, so lookups
+// (with std::equal_to<>) need not build a key
+struct TextHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>{}(s); }
+};
+
+} // namespace inmemdb
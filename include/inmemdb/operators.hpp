@@ -0,0 +1,407 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+#include "inmemdb/aggregate.hpp"
+#include "inmemdb/batch.hpp"
+#include "inmemdb/column.hpp"
+#include "inmemdb/parser.hpp"
+#include "inmemdb/predicate.hpp"
+#include "inmemdb/sort.hpp"
+
+// Operators of a SELECT pipeline. Row operators (scan, index lookup, join
+// probe, filter) pass chunks of row ids: selection vectors into the stored
+// columns, so nothing is copied before projection. Batch operators
+// (project, aggregate, sort, limit) pass typed value batches. Every operator
+// is pulled once per chunk of up to kChunkRows rows, so the virtual call is
+// amortised and the per-row work stays in tight loops over plain arrays.
+
+namespace inmemdb {
+
+struct Table;
+struct Index;
+
+inline constexpr size_t kChunkRows = 1024;
+inline constexpr size_t kMorselRows = 16 * kChunkRows;
+inline constexpr size_t kMaxTables = 8; // tables one query may join
+
+// Work of one operator in a cursor. Times of parallel workers add up, so
+// they are CPU time rather than wall time; bytes are estimated column bytes
+// read by a scan-side operator, or result bytes produced by the others.
+struct OperatorStats {
+    uint64_t ns = 0;
+    uint64_t rows_in = 0, rows_out = 0;
+    uint64_t bytes = 0;
+    uint64_t peak_bytes = 0; // working memory: hash table, sort buffer, groups
+
+    void merge(OperatorStats const& o) {
+        ns += o.ns; rows_in += o.rows_in; rows_out += o.rows_out; bytes += o.bytes;
+        peak_bytes = std::max(peak_bytes, o.peak_bytes);
+    }
+};
+
+// Per-operator counters of one cursor, for EXPLAIN ANALYZE. The index
+// lookup and join builds are always measured (they run once, in open);
+// the rest only after set_profiling(true). Filters and joins count per
+// table of the query.
+struct CursorStats {
+    OperatorStats index;      // WHERE answered by an index lookup
+    OperatorStats scan;       // row ids of the outer (or only) table
+    OperatorStats filter[kMaxTables];     // WHERE on each table, in its scan or after it is joined in
+    OperatorStats join_build[kMaxTables]; // hash table over each build side
+    OperatorStats join[kMaxTables];       // probe that joins each inner table in
+    OperatorStats aggregate;
+    OperatorStats project;
+    OperatorStats sort;
+    OperatorStats limit;      // OFFSET/LIMIT without ORDER BY
+
+    void merge(CursorStats const& o) {
+        index.merge(o.index); scan.merge(o.scan);
+        for (size_t t = 0; t < kMaxTables; ++t) { filter[t].merge(o.filter[t]); join_build[t].merge(o.join_build[t]); join[t].merge(o.join[t]); }
+        aggregate.merge(o.aggregate); project.merge(o.project); sort.merge(o.sort); limit.merge(o.limit);
+    }
+};
+
+// What the operators of one pipeline count into. Parallel workers each get
+// a copy with zeroed stats, merged when the run is over.
+struct OpContext {
+    bool profile = false;
+    CursorStats stats;
+    double where_row_bytes[kMaxTables] = {}; // column bytes the WHERE on each table reads per row
+    double probe_row_bytes[kMaxTables] = {}; // join key bytes read per probe, by inner table
+
+    // Count a WHERE call on `table` over n rows that kept `kept`
+    void count_filter(size_t table, size_t n, size_t kept) {
+        OperatorStats& st = stats.filter[table];
+        st.rows_in += n;
+        st.rows_out += kept;
+        st.bytes += static_cast<uint64_t>(static_cast<double>(n) * where_row_bytes[table]);
+    }
+};
+
+// Adds the time until it goes out of scope to *ns; with a null target it
+// does not read the clock
+class OpTimer {
+public:
+    explicit OpTimer(uint64_t* ns) : ns_(ns) { if (ns_) start_ = std::chrono::steady_clock::now(); }
+    ~OpTimer() { if (ns_) *ns_ += elapsed(); }
+    OpTimer(OpTimer const&) = delete;
+    OpTimer& operator=(OpTimer const&) = delete;
+    uint64_t elapsed() const {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count());
+    }
+
+private:
+    uint64_t* ns_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Row ids of the tuples flowing from scans through filters and joins:
+// tuple i pairs row rows[t][i] of every table t of the query (numbered in
+// FROM/JOIN order). The lists of tables not joined in yet are empty.
+struct RowChunk {
+    std::vector<size_t> rows[kMaxTables];
+
+    size_t size() const {
+        size_t n = 0;
+        for (auto const& list : rows) n = std::max(n, list.size());
+        return n;
+    }
+    void clear() { for (auto& list : rows) list.clear(); }
+    // Keep the tuples at positions sel[0..k)
+    void select(size_t const* sel, size_t k);
+};
+
+// Join hash table split into power-of-two partitions by key hash, so that
+// workers can build partitions independently; a serial build uses one
+template <class K>
+struct JoinHashTable {
+    std::vector<std::unordered_map<K, std::vector<size_t>>> parts;
+    unsigned bits = 0;
+
+    void init(unsigned partition_bits) { bits = partition_bits; parts.assign(size_t{1} << bits, {}); }
+    size_t part_of(K const& key) const {
+        if (bits == 0) return 0;
+        return static_cast<size_t>((std::hash<K>{}(key) * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+    }
+    std::vector<size_t> const* find(K const& key) const {
+        auto const& part = parts[part_of(key)];
+        auto it = part.find(key);
+        return it == part.end() ? nullptr : &it->second;
+    }
+};
+
+enum class JoinAlgo { None, Hash, IndexNestedLoop, NestedLoop };
+
+// Finds the inner-side rows that match one outer row: through a hash table
+// built over the inner side, an index on it, or a nested loop. Built once
+// per cursor and then only read, also by parallel probes.
+class JoinMatcher {
+public:
+    static constexpr unsigned kPartitionBits = 6; // parallel hash build
+
+    JoinMatcher(JoinAlgo algo, CompareOp op, ColumnData const& outer_col, ColumnData const& inner_col, size_t inner_rows)
+        : algo_(algo), op_(op), outer_col_(outer_col), inner_col_(inner_col), inner_rows_(inner_rows) {}
+
+    void use_index(Index const& index) { index_ = &index; }
+    // Hash the inner side, partitioned over the thread pool when dop > 1
+    void build(size_t dop);
+
+    // Inner rows matching outer_row, in table order; buf is scratch for non-hash joins
+    std::pair<size_t const*, size_t const*> find(size_t outer_row, std::vector<size_t>& buf) const;
+    // Approximate bytes of the hash table
+    size_t footprint() const;
+
+private:
+    using IntHash = JoinHashTable<int64_t>;
+    using TextHash = JoinHashTable<std::string_view>;
+    // Join of two dictionary columns: build rows bucketed by code, plus each
+    // probe-side code translated to the build side's code for the same string
+    struct CodeHash {
+        std::vector<std::vector<size_t>> buckets;
+        std::vector<uint32_t> xlate;
+    };
+
+    JoinAlgo algo_;
+    CompareOp op_;
+    ColumnData const& outer_col_;
+    ColumnData const& inner_col_;
+    size_t inner_rows_;
+    Index const* index_ = nullptr;
+    std::variant<std::monostate, IntHash, TextHash, CodeHash> hash_;
+};
+
+// Pipeline stage producing row ids. next() replaces `out` with between 1
+// and max_rows further tuples; false once exhausted.
+class RowOperator {
+public:
+    virtual ~RowOperator() = default;
+    virtual bool next(RowChunk& out, size_t max_rows) = 0;
+    // Fill in working memory this operator and its inputs hold
+    virtual void report(CursorStats&) const {}
+};
+
+// Rows [begin, end) of one table. A WHERE on that table is pushed down and
+// run on each stretch of rows, so zone maps and encoded segments answer it.
+class ScanOp final : public RowOperator {
+public:
+    ScanOp(OpContext& ctx, size_t table, size_t begin, size_t end, Filter const* where)
+        : ctx_(ctx), table_(table), pos_(begin), end_(end), where_(where) {}
+    bool next(RowChunk& out, size_t max_rows) override;
+
+private:
+    OpContext& ctx_;
+    size_t table_;
+    size_t pos_, end_;
+    Filter const* where_;
+};
+
+// Rows of one table answering `column op value` through an index, in table
+// order. The lookup runs in the constructor.
+class IndexLookupOp final : public RowOperator {
+public:
+    IndexLookupOp(OpContext& ctx, size_t table, Index const& index, CompareOp op, Value const& value, size_t visible);
+    bool next(RowChunk& out, size_t max_rows) override;
+    void report(CursorStats& s) const override { s.index.peak_bytes = rows_.capacity() * sizeof(size_t); }
+
+private:
+    size_t table_;
+    std::vector<size_t> rows_;
+    size_t pos_ = 0;
+};
+
+// Keeps the tuples whose row of `table` passes a WHERE; used when that
+// table's rows arrive through a join or an index lookup
+class FilterOp final : public RowOperator {
+public:
+    FilterOp(OpContext& ctx, std::unique_ptr<RowOperator> child, Filter const& where, size_t table)
+        : ctx_(ctx), child_(std::move(child)), where_(where), table_(table) {}
+    bool next(RowChunk& out, size_t max_rows) override;
+    void report(CursorStats& s) const override { child_->report(s); }
+
+private:
+    OpContext& ctx_;
+    std::unique_ptr<RowOperator> child_;
+    Filter const& where_;
+    size_t table_;
+    std::vector<size_t> sel_;
+};
+
+// Extends each outer tuple by every inner_table row its row of probe_table
+// matches, keeping its place across calls when a tuple has more matches
+// than fit in one chunk
+class JoinProbeOp final : public RowOperator {
+public:
+    JoinProbeOp(OpContext& ctx, std::unique_ptr<RowOperator> outer, JoinMatcher const& matcher, size_t probe_table, size_t inner_table)
+        : ctx_(ctx), outer_(std::move(outer)), matcher_(matcher), probe_table_(probe_table), inner_table_(inner_table) {}
+    bool next(RowChunk& out, size_t max_rows) override;
+    void report(CursorStats& s) const override { outer_->report(s); }
+
+private:
+    OpContext& ctx_;
+    std::unique_ptr<RowOperator> outer_;
+    JoinMatcher const& matcher_;
+    size_t probe_table_, inner_table_;
+    RowChunk in_;     // current chunk of outer tuples
+    std::vector<size_t> present_; // tables with rows in in_
+    size_t pos_ = 0;  // next tuple of in_ to probe
+    size_t tuple_ = 0; // outer tuple being extended
+    std::vector<size_t> buf_;
+    size_t const* it_ = nullptr;
+    size_t const* end_ = nullptr;
+    bool done_ = false;
+};
+
+// How a query's row pipeline is assembled over a range of outer rows: scan
+// the outer table with its WHERE pushed down, then for each join step probe
+// the inner table and filter on it. Shared by the per-morsel pipelines of
+// parallel workers.
+struct RowSource {
+    struct Join {
+        size_t probe_table; // joined earlier; its column looks up the matches
+        size_t inner_table;
+        JoinMatcher matcher;
+    };
+
+    size_t outer_table = 0;
+    size_t outer_rows = 0;
+    std::optional<Filter> where[kMaxTables]; // the WHERE conditions on each table
+    std::vector<Join> joins;                 // in pipeline order
+
+    std::unique_ptr<RowOperator> build(OpContext& ctx, size_t begin, size_t end) const;
+    size_t morsels() const { return (outer_rows + kMorselRows - 1) / kMorselRows; }
+};
+
+// Output columns of a projection and the table each one is read from
+struct Projection {
+    struct Column {
+        size_t table;
+        ColumnData const* data;
+    };
+    std::vector<Column> columns;
+    std::vector<ColumnType> const* types; // the plan's; may include hidden sort keys
+
+    // Empty `out` shaped for these columns
+    void reset(Batch& out) const;
+    // Append the tuples of a chunk to `out`
+    void append(Batch& out, RowChunk const& in) const;
+};
+
+// Pipeline stage producing value batches. next() replaces `out` with up to
+// max_rows further rows; false once exhausted.
+class BatchOperator {
+public:
+    virtual ~BatchOperator() = default;
+    virtual bool next(Batch& out, size_t max_rows) = 0;
+    // Discard up to n rows; returns how many were discarded
+    virtual size_t skip(size_t n);
+    // Fill in working memory this operator and its inputs hold
+    virtual void report(CursorStats&) const {}
+};
+
+// Materialises row ids into the selected columns
+class ProjectOp final : public BatchOperator {
+public:
+    ProjectOp(OpContext& ctx, std::unique_ptr<RowOperator> child, Projection proj)
+        : ctx_(ctx), child_(std::move(child)), proj_(std::move(proj)) {}
+    bool next(Batch& out, size_t max_rows) override;
+    // Skipped tuples are dropped as row ids, without projecting them
+    size_t skip(size_t n) override;
+    void report(CursorStats& s) const override;
+
+private:
+    OpContext& ctx_;
+    std::unique_ptr<RowOperator> child_;
+    Projection proj_;
+    RowChunk chunk_;
+};
+
+// Runs the row pipeline of the morsels on the thread pool and projects each
+// into one batch; the batches are handed out in morsel order, so rows come
+// out as in a serial run. Morsels run a window of kWindowPerWorker per
+// worker at a time, and the next window starts once the consumer drained
+// this one, so at most that many projected morsels are held.
+class MorselProjectOp final : public BatchOperator {
+public:
+    static constexpr size_t kWindowPerWorker = 2;
+
+    MorselProjectOp(OpContext& ctx, RowSource const& source, Projection proj, size_t dop)
+        : ctx_(ctx), source_(source), proj_(std::move(proj)), dop_(dop) {}
+    bool next(Batch& out, size_t max_rows) override;
+
+private:
+    void fill();
+
+    OpContext& ctx_;
+    RowSource const& source_;
+    Projection proj_;
+    size_t dop_;
+    size_t next_morsel_ = 0; // first morsel of the next window
+    std::vector<Batch> out_; // the current window
+    size_t idx_ = 0, off_ = 0;
+};
+
+// GROUP BY / aggregates. Blocking: every input tuple is folded in before
+// the first group comes out. Serially it pulls one row pipeline; with
+// dop > 1 each worker folds its morsels into a partial aggregate, and the
+// partials are merged with groups ordered by the morsel and row they were
+// first seen in.
+class AggregateOp final : public BatchOperator {
+public:
+    AggregateOp(OpContext& ctx, std::unique_ptr<RowOperator> child, HashAggregator agg)
+        : ctx_(ctx), child_(std::move(child)), agg_(std::move(agg)) {}
+    AggregateOp(OpContext& ctx, RowSource const& source, size_t dop, HashAggregator agg)
+        : ctx_(ctx), source_(&source), dop_(dop), agg_(std::move(agg)) {}
+    bool next(Batch& out, size_t max_rows) override;
+    void report(CursorStats& s) const override;
+
+private:
+    void consume_all();
+
+    OpContext& ctx_;
+    std::unique_ptr<RowOperator> child_;
+    RowSource const* source_ = nullptr; // parallel
+    size_t dop_ = 1;
+    HashAggregator agg_;
+    bool consumed_ = false;
+};
+
+// ORDER BY, with OFFSET/LIMIT applied by the sorter's bounded heap
+class SortOp final : public BatchOperator {
+public:
+    SortOp(OpContext& ctx, std::unique_ptr<BatchOperator> child, Sorter sorter)
+        : ctx_(ctx), child_(std::move(child)), sorter_(std::move(sorter)) {}
+    bool next(Batch& out, size_t max_rows) override;
+    void report(CursorStats& s) const override;
+
+private:
+    OpContext& ctx_;
+    std::unique_ptr<BatchOperator> child_;
+    Sorter sorter_;
+    bool sorted_ = false;
+};
+
+// OFFSET/LIMIT without ORDER BY: skips through the child and stops pulling
+// from it as soon as enough rows were returned
+class LimitOp final : public BatchOperator {
+public:
+    LimitOp(OpContext& ctx, std::unique_ptr<BatchOperator> child, size_t offset, std::optional<size_t> limit)
+        : ctx_(ctx), child_(std::move(child)), offset_(offset), limit_(limit) {}
+    bool next(Batch& out, size_t max_rows) override;
+    void report(CursorStats& s) const override { child_->report(s); }
+
+private:
+    OpContext& ctx_;
+    std::unique_ptr<BatchOperator> child_;
+    size_t offset_;
+    std::optional<size_t> limit_;
+    size_t emitted_ = 0;
+};
+
+} // namespace inmemdb
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <optional>
+#include <vector>
+#include "inmemdb/operators.hpp"
+#include "inmemdb/parser.hpp"
+#include "inmemdb/stats.hpp"
+
+// Join ordering. A join of several tables runs as one left-deep pipeline:
+// the outer table is scanned and every other table is joined in by a probe,
+// through a hash table built over it, one of its indexes, or a nested loop.
+// The optimizer picks the outer table, the order of the probes and the
+// algorithm of each by dynamic programming over connected sets of tables,
+// minimising the estimated work: rows hashed, probes made and tuples
+// produced by every step. Estimates assume independent conditions.
+
+namespace inmemdb {
+
+// The tables of a query and the conditions joining them
+struct JoinGraph {
+    struct Relation {
+        double rows = 0;        // stored rows
+        double selectivity = 1; // fraction its WHERE keeps
+    };
+    // a.column op b.column, keeping `selectivity` of the row pairs
+    struct Edge {
+        size_t a = 0, b = 0;
+        CompareOp op = CompareOp::Eq;
+        double selectivity = 1;
+        std::optional<size_t> index_a, index_b; // an equality index on that side's column (position in its table's indexes)
+    };
+    std::vector<Relation> tables;
+    std::vector<Edge> edges;
+};
+
+// One probe of the pipeline: `inner` is joined in through `edge`, whose
+// other side is the table `probe` joined earlier
+struct JoinStep {
+    size_t edge = 0;
+    size_t probe = 0, inner = 0;
+    JoinAlgo algo = JoinAlgo::Hash;
+    std::optional<size_t> index; // IndexNestedLoop: position in the inner table's indexes
+    double rows = 0; // estimated tuples after it and the inner table's WHERE
+};
+
+struct JoinOrder {
+    size_t outer = 0; // the scanned table
+    std::vector<JoinStep> steps;
+    double cost = 0;
+};
+
+// Relative work per row of each kind, with one hash probe as the unit
+inline constexpr double kHashBuildCost = 2;  // insert into the join hash table
+inline constexpr double kIndexProbeCost = 3; // index lookup, then sorting its matches
+inline constexpr double kTupleCost = 1;      // writing one tuple of a step's output
+
+// Fraction of row pairs satisfying `a op b`, from the columns' statistics:
+// equality matches 1/max(distinct) of the pairs, scaled by how much the
+// value ranges overlap; other comparisons are guessed
+double join_selectivity(ColumnStats const& a, ColumnStats const& b, CompareOp op);
+
+// Cheapest left-deep order; the graph must be connected
+JoinOrder order_joins(JoinGraph const& g);
+
+} // namespace inmemdb
@@ -7,42 +7,171 @@
 
 namespace inmemdb {
 
-enum class ColumnType { Int, Text };
+enum class ColumnType { Int, Text, Real }; // Real only appears in results (AVG)
 
 struct ColumnDef { 
     std::string name; 
     ColumnType type; 
+    bool dict = false; // TEXT DICT: dictionary-encode from the first row
 };
 
 struct CreateTableStmt { 
     std::string table; 
     std::vector<ColumnDef> columns; };
 
+enum class IndexKind { Hash, BTree };
+
+struct CreateIndexStmt {
+    std::string name;
+    std::string table;
+    std::string column;
+    IndexKind kind = IndexKind::BTree;
+};
+
 struct InsertStmt { 
     std::string table; 
-    std::vector<std::string> values; };
+    std::vector<std::string> values; // `rows` tuples back to back
+    size_t rows = 1;
+    std::vector<std::pair<size_t, size_t>> params = {}; // (value index, 0-based placeholder) for ?/$n values
+};
+
+// COPY table FROM 'file.csv' [HEADER]
+struct CopyStmt {
+    std::string table;
+    std::string path;
+    bool header = false; // skip the first line
+};
+
+enum class CompareOp { Eq, Ne, Lt, Le, Gt, Ge };
+
+inline const char* to_string(CompareOp op) {
+    switch (op) {
+        case CompareOp::Eq: return "=";
+        case CompareOp::Ne: return "!=";
+        case CompareOp::Lt: return "<";
+        case CompareOp::Le: return "<=";
+        case CompareOp::Gt: return ">";
+        case CompareOp::Ge: return ">=";
+    }
+    return "?";
+}
 
 struct WhereCond { 
     std::string column; 
-    std::string op;  // = != < > <= >=
+    CompareOp op = CompareOp::Eq;
     std::string value; 
+    std::optional<size_t> param = {}; // 0-based placeholder supplying the value instead
 }; 
 
+// A literal of an IN list or BETWEEN bound, or the placeholder supplying it
+struct WhereValue {
+    std::string text;
+    std::optional<size_t> param;
+};
+
+// WHERE as a boolean tree. Leaves are comparisons, `col IN (v, ...)` and
+// `col BETWEEN lo AND hi`; AND and OR have two or more children, NOT one.
+struct WhereExpr {
+    enum class Kind { Compare, In, Between, And, Or, Not };
+    Kind kind = Kind::Compare;
+    WhereCond cond;                  // Compare; In and Between only use its column
+    std::vector<WhereValue> values;  // In: the list; Between: low, high
+    std::vector<WhereExpr> children; // And, Or, Not
+
+    WhereExpr() = default;
+    WhereExpr(WhereCond c) : cond(std::move(c)) {}
+    WhereExpr(Kind k, std::vector<WhereExpr> operands) : kind(k), children(std::move(operands)) {}
+};
+
+// JOIN right_table ON left_col op right_col; one column belongs to
+// right_table and the other to a table before it in the query
 struct JoinClause {
     std::string right_table;
-    std::string left_col;  // column name on left table
-    std::string right_col; // column name on right table
+    std::string left_col;
+    std::string right_col;
+    CompareOp op = CompareOp::Eq; // Eq uses a hash join, anything else a nested loop
+};
+
+enum class AggFunc { Count, Sum, Min, Max, Avg };
+
+inline const char* to_string(AggFunc f) {
+    switch (f) {
+        case AggFunc::Count: return "COUNT";
+        case AggFunc::Sum: return "SUM";
+        case AggFunc::Min: return "MIN";
+        case AggFunc::Max: return "MAX";
+        case AggFunc::Avg: return "AVG";
+    }
+    return "?";
+}
+
+// One entry of the SELECT list: a column, or an aggregate over a column
+struct SelectItem {
+    std::string column;         // may be qualified like t.col; empty for COUNT(*)
+    std::optional<AggFunc> agg; // set for aggregate calls
+
+    // Header text, e.g. "t.col", "COUNT(*)" or "SUM(total)"
+    std::string name() const {
+        if (!agg) return column;
+        return std::string(to_string(*agg)) + "(" + (column.empty() ? "*" : column) + ")";
+    }
+};
+
+// One ORDER BY key: an output column or aggregate, ascending unless DESC
+struct OrderItem {
+    SelectItem item;
+    bool desc = false;
 };
 
 struct SelectStmt { 
-    std::vector<std::string> columns; // may include qualified names like t.col
+    std::vector<SelectItem> items;
     std::string table; // left table
-    std::optional<JoinClause> join; // optional INNER JOIN
-    std::optional<WhereCond> where; 
+    std::vector<JoinClause> joins; // INNER JOINs in query order
+    std::optional<WhereExpr> where; 
+    std::vector<std::string> group_by; // GROUP BY columns
+    std::vector<OrderItem> order_by;
+    std::optional<size_t> limit; // LIMIT n
+    size_t offset = 0;           // OFFSET m
     bool select_all = false; 
+
+    bool has_aggregates() const {
+        for (auto const& it : items) if (it.agg) return true;
+        return !group_by.empty();
+    }
+    // The FROM table, then each joined table
+    std::vector<std::string> tables() const {
+        std::vector<std::string> names{table};
+        for (auto const& j : joins) names.push_back(j.right_table);
+        return names;
+    }
+};
+
+// SNAPSHOT TO 'path'
+struct SnapshotStmt {
+    std::string path;
+};
+
+// PREPARE name AS statement; the statement is kept as SQL text
+struct PrepareStmt {
+    std::string name;
+    std::string sql;
+};
+
+// EXECUTE name [(value, ...)]: values for the placeholders in order
+struct ExecuteStmt {
+    std::string name;
+    std::vector<std::string> values;
+};
+
+// EXPLAIN [ANALYZE] select: the plan, and with ANALYZE the measured run
+struct ExplainStmt {
+    bool analyze = false;
+    SelectStmt select;
+    std::string sql; // source text of the SELECT, re-lexed and re-parsed to time those stages
 };
 
-using Statement = std::variant<CreateTableStmt, InsertStmt, SelectStmt>;
+using Statement = std::variant<CreateTableStmt, InsertStmt, SelectStmt, CreateIndexStmt, SnapshotStmt, CopyStmt, PrepareStmt, ExecuteStmt,
+                               ExplainStmt>;
 
 class Parser {
 public:
@@ -50,12 +179,28 @@ public:
     std::vector<Statement> parse_all();
 private:
     Statement parse_statement();
-    CreateTableStmt parse_create();
+    Statement parse_create();
+    CreateTableStmt parse_create_table();
+    CreateIndexStmt parse_create_index();
     InsertStmt parse_insert();
+    SnapshotStmt parse_snapshot();
+    CopyStmt parse_copy();
+    PrepareStmt parse_prepare();
+    ExecuteStmt parse_execute();
+    ExplainStmt parse_explain();
     SelectStmt parse_select();
 
     // helpers
     std::string parse_column_name(); // identifier or qualified identifier
+    std::optional<CompareOp> parse_compare_op(); // consumes the operator token if present
+    WhereExpr parse_or();        // a OR b ...
+    WhereExpr parse_and();       // a AND b ...
+    WhereExpr parse_not();       // [NOT] term
+    WhereExpr parse_condition(); // ( expr ) | col op value | col [NOT] IN (...) | col [NOT] BETWEEN lo AND hi
+    WhereValue parse_where_value();
+    SelectItem parse_select_item();
+    size_t parse_row_count(char const* clause); // non-negative integer after LIMIT/OFFSET
+    size_t parse_param(); // 0-based number of a ? or $n placeholder
 
     bool accept(TokenType t);
     void expect(TokenType t, const char* msg);
@@ -63,6 +208,7 @@ private:
     void advance();
 
     Lexer lex_;
+    size_t next_param_ = 0; // number of the next `?` in the current statement
     Token tok_{TokenType::End, "", 0};
     bool started_ = false;
 };
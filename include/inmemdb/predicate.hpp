@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "inmemdb/column.hpp"
+#include "inmemdb/parser.hpp"
+#include "inmemdb/simd.hpp"
+
+namespace inmemdb {
+
+// What a block's min/max decides for a condition over all of its rows
+enum class Zone { None, Some, All };
+
+// A WHERE condition compiled against one column: `column op literal`, an
+// IN list or a BETWEEN range. The operator and literal type are resolved
+// once into a kernel from a function table, so the filter loops carry no
+// string compares, variant dispatch or exception handling.
+struct Predicate {
+    enum class Kind { Compare, In, Between };
+
+    // Write to sel the rows in [begin, end) that match; returns how many
+    using RangeKernel = size_t (*)(Predicate const&, size_t begin, size_t end, size_t* sel);
+    // Write to pos each position i < n whose row rows[i] matches; returns how many
+    using GatherKernel = size_t (*)(Predicate const&, size_t const* rows, size_t n, size_t* pos);
+    // Verdict for zone-map block b of the column
+    using ZoneKernel = Zone (*)(Predicate const&, size_t b);
+
+    IntColumn const* ints = nullptr;   // set for INT columns
+    TextColumn const* texts = nullptr; // set for TEXT columns
+    DictColumn const* dict = nullptr;  // set for dictionary-encoded TEXT columns
+    Kind kind = Kind::Compare;
+    CompareOp op = CompareOp::Eq;
+    int64_t int_value = 0;  // the literal; BETWEEN low bound; smallest IN value
+    int64_t int_high = 0;   // BETWEEN high bound; largest IN value
+    std::string text_value; // as for INT
+    std::string text_high;
+    std::unordered_set<int64_t> int_set; // IN list
+    std::unordered_set<std::string, TextHash, std::equal_to<>> text_set;
+    uint32_t code = DictColumn::kNoCode; // literal's dictionary code for = and !=
+    std::vector<uint8_t> code_match;      // per-code result for range operators
+    RangeKernel range = nullptr;
+    GatherKernel gather = nullptr;
+    IntFilterKernel int_kernel = nullptr; // SIMD kernel for plain INT rows (tail, Plain segments)
+    ZoneKernel zone = nullptr;
+    size_t zones = 0; // blocks of the column with a zone
+    double cost = 1;  // work per row relative to an INT compare
+
+    size_t filter(size_t begin, size_t end, size_t* sel) const { return zones ? filter_zoned(begin, end, sel) : range(*this, begin, end, sel); }
+    size_t filter(size_t const* rows, size_t n, size_t* pos) const { return gather(*this, rows, n, pos); }
+    // Range filter that skips blocks whose zone rules every row out (or in)
+    size_t filter_zoned(size_t begin, size_t end, size_t* sel) const;
+};
+
+// Compile `column op literal`; throws if the literal type does not match
+Predicate compile_predicate(ColumnData const& column, CompareOp op, Value const& literal);
+// Compile `column IN (list)`, list non-empty
+Predicate compile_in(ColumnData const& column, std::vector<Value> const& list);
+// Compile `column BETWEEN low AND high`, bounds included
+Predicate compile_between(ColumnData const& column, Value const& low, Value const& high);
+
+// Estimated fraction of the column's rows a predicate keeps, from the
+// dictionary of a DICT column or the min/max of an INT column's segments
+// and zones; fixed guesses for plain TEXT
+double estimate_selectivity(Predicate const& p);
+
+// A WHERE over the columns of one table: predicates under AND, OR and NOT.
+// AND children each see only the rows the earlier ones kept and OR children
+// only the rows not matched yet, so combine() orders children to settle the
+// most rows for the least work first: by cost / (1 - selectivity) for AND
+// and cost / selectivity for OR. Cheap INT compares thus run before string
+// compares unless those are far more selective.
+struct Filter {
+    enum class Kind { Leaf, And, Or, Not };
+    Kind kind = Kind::Leaf;
+    Predicate pred;               // Leaf
+    std::vector<Filter> children; // And, Or: two or more; Not: one
+    double selectivity = 1;       // estimated fraction of rows kept
+    double cost = 1;              // estimated work per input row
+
+    static Filter leaf(Predicate p);
+    // Estimates and orders the children; one child is returned as is
+    static Filter combine(Kind kind, std::vector<Filter> children);
+
+    // Same contracts as Predicate::filter
+    size_t filter(size_t begin, size_t end, size_t* sel) const;
+    size_t filter(size_t const* rows, size_t n, size_t* pos) const;
+
+private:
+    size_t filter_block(size_t const* rows, size_t n, size_t* pos) const;
+};
+
+} // namespace inmemdb
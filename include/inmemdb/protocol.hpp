@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "inmemdb/batch.hpp"
+#include "inmemdb/storage.hpp"
+
+// Wire protocol of inmemdb_server. Every message is a frame:
+//   [u32 length][u8 type][u32 request id][payload]
+// with length covering everything after itself, integers little-endian.
+// A client may send any number of Query frames without waiting; the server
+// answers each with one Result frame carrying the same id, in request order
+// per connection, and packs the answers it has ready into one write. An
+// answer is sent as it is produced: every kResultChunk bytes of its payload
+// go out in a ResultPart frame, and the Result frame carries the rest. The
+// client joins the payloads of the parts and the Result.
+//
+// Query payload: SQL text, one or more statements.
+// Result payload: varint statement count, then per statement
+//   varint column count; per column u8 type and string name
+//   row chunks: varint rows (> 0), then per column the values of those rows
+//     (INT: zigzag varints, REAL: 8-byte doubles, TEXT: strings)
+//   varint 0, u8 success, string message
+// Strings are a varint byte count plus the bytes. Rows are streamed in
+// cursor batches, so a statement that fails midway ends with success 0.
+
+namespace inmemdb::wire {
+
+enum class FrameType : uint8_t { Query = 1, Result = 2, ResultPart = 3 };
+
+inline constexpr size_t kFrameHeader = 9;
+inline constexpr uint32_t kMaxFrame = 256u << 20; // larger frames are rejected
+inline constexpr size_t kResultChunk = 1u << 20;  // payload bytes per ResultPart frame
+
+struct Frame {
+    FrameType type;
+    uint32_t id;
+    std::string_view payload;
+};
+
+// Append a frame header with the length left open; end_frame() fills it in
+// once the payload was appended, or removes the frame and throws if it grew
+// past kMaxFrame. Returns the header's offset.
+size_t begin_frame(std::string& out, FrameType type, uint32_t id);
+void end_frame(std::string& out, size_t at);
+void append_frame(std::string& out, FrameType type, uint32_t id, std::string_view payload);
+// Parse the frame at the start of `buf`: the bytes it takes, or 0 when it is
+// not complete yet; throws on an oversized or unknown frame
+size_t parse_frame(std::string_view buf, Frame& frame);
+
+// Result payload pieces, in this order per statement
+void put_columns(std::string& out, std::vector<std::string> const& header, std::vector<ColumnType> const& types);
+void put_rows(std::string& out, Batch const& batch);
+void put_status(std::string& out, bool success, std::string_view message);
+// A whole statement result: a QueryResult's rows as TEXT columns, or an error
+void put_result(std::string& out, QueryResult const& qr);
+void put_error(std::string& out, std::string_view message);
+
+struct StatementResult {
+    bool success = true;
+    std::string message;
+    std::vector<std::string> header;
+    Batch rows; // typed columns, one per header entry
+};
+
+std::vector<StatementResult> decode_results(std::string_view payload);
+
+} // namespace inmemdb::wire
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include "inmemdb/storage.hpp"
+
+namespace inmemdb {
+
+struct ServerOptions {
+    std::string host = "127.0.0.1";
+    uint16_t port = 5433;  // 0: any free port, see Server::port()
+    bool tcp = true;
+    std::string unix_path; // also listen on this Unix socket when set
+    // Event loops. With more than one, each binds its own TCP listener to
+    // the port with SO_REUSEPORT and the kernel spreads connections over them.
+    size_t io_threads = 1;
+    // Threads that parse and execute statements
+    size_t workers = std::max(1u, std::thread::hardware_concurrency());
+};
+
+// TCP / Unix-socket front end speaking the wire protocol (protocol.hpp).
+// Event loops only accept, read, frame and write, all non-blocking through
+// epoll. Complete requests go to the worker threads: a connection's queued
+// requests run in arrival order on one worker at a time, so pipelined
+// statements see each other's effects, while different connections run in
+// parallel. Every connection is a session with its own PREPARE names.
+// SELECT results are encoded straight from cursor batches.
+class Server {
+public:
+    Server(Database& db, ServerOptions options);
+    ~Server(); // stops
+    Server(Server const&) = delete;
+    Server& operator=(Server const&) = delete;
+
+    // Bind the listeners and start the threads; throws if binding fails
+    void start();
+    // Close every connection and join the threads
+    void stop();
+    // The bound TCP port (useful with port 0)
+    uint16_t port() const { return port_; }
+
+private:
+    struct State;
+    Database& db_;
+    ServerOptions options_;
+    uint16_t port_ = 0;
+    std::unique_ptr<State> state_;
+};
+
+} // namespace inmemdb
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "inmemdb/parser.hpp"
+
+namespace inmemdb {
+
+// Instruction sets the INT filter kernels are compiled for
+enum class SimdLevel { Scalar, SSE42, AVX2 };
+
+const char* to_string(SimdLevel level);
+
+// Best level this CPU supports; detected once
+SimdLevel detect_simd_level();
+
+// Write to sel the rows r in [begin, end) with data[r] op value, in order;
+// returns how many. sel must have room for end - begin entries.
+using IntFilterKernel = size_t (*)(int64_t const* data, size_t begin, size_t end, int64_t value, size_t* sel);
+
+// Kernel for op at the given level; levels above detect_simd_level() fall back
+IntFilterKernel int_filter_kernel(CompareOp op, SimdLevel level = detect_simd_level());
+
+} // namespace inmemdb
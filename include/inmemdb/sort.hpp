@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include "inmemdb/batch.hpp"
+#include "inmemdb/parser.hpp"
+
+namespace inmemdb {
+
+// offset + limit, saturating: a top-K heap that large keeps every row anyway
+inline size_t top_k_bound(size_t offset, size_t limit) {
+    return limit > SIZE_MAX - offset ? SIZE_MAX : offset + limit;
+}
+
+// ORDER BY over produced batches, followed by OFFSET/LIMIT. Without a LIMIT
+// every row is buffered and sorted once. With one, a bounded max-heap keeps
+// only the best offset + limit rows (top-K): most rows are rejected by a
+// single comparison against the heap top and memory stays O(K). Ties keep
+// arrival order, so both paths return the same rows.
+class Sorter {
+public:
+    struct Key {
+        size_t column; // into the input batch
+        bool desc;
+    };
+
+    // `width` leading input columns are returned; the rest are sort-only keys
+    Sorter(std::vector<ColumnType> types, std::vector<Key> keys, size_t width, size_t offset, std::optional<size_t> limit);
+
+    void consume(Batch const& in);
+    void finish();
+    // Replace `out` with up to max_rows sorted rows; false once exhausted
+    bool next(Batch& out, size_t max_rows);
+    // Approximate bytes buffered
+    size_t footprint() const { return rows_.byte_size() + order_.capacity() * sizeof(size_t); }
+
+private:
+    int compare(Batch const& a, size_t ra, Batch const& b, size_t rb) const;
+    bool before(size_t a, size_t b) const; // buffered row a sorts before row b
+    void compact();
+
+    std::vector<ColumnType> types_;
+    std::vector<Key> keys_;
+    size_t width_;
+    size_t offset_;
+    std::optional<size_t> bound_; // offset + limit when there is a LIMIT
+    size_t compact_at_ = SIZE_MAX; // buffered rows that trigger compact()
+    Batch rows_;                  // buffered rows; rejected heap rows linger until compact()
+    std::vector<size_t> order_;   // heap of kept rows, then their sorted order
+    size_t pos_ = 0;              // next entry of order_ to return
+};
+
+} // namespace inmemdb
@@ -0,0 +1,41 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include "inmemdb/column.hpp"
+
+namespace inmemdb {
+
+// Distinct-value estimate in fixed space: a HyperLogLog sketch of 2^kBits
+// one-byte registers, about 6.5% standard error. Sketches are small enough
+// to be copied with every table snapshot.
+class HyperLogLog {
+public:
+    static constexpr unsigned kBits = 8;
+    static constexpr size_t kRegisters = size_t{1} << kBits;
+
+    void add(int64_t v);
+    void add(std::string_view v);
+    double estimate() const;
+
+private:
+    void add_hash(uint64_t h);
+
+    std::array<uint8_t, kRegisters> registers_{};
+};
+
+// Statistics of one column, kept current as rows are appended; the join
+// optimizer reads them to size join results
+struct ColumnStats {
+    uint64_t rows = 0;
+    HyperLogLog sketch;
+    std::optional<Value> min, max; // empty until the first row
+
+    // Fold rows [begin, end) of the column in
+    void add(ColumnData const& col, size_t begin, size_t end);
+    // Estimated number of distinct values, at most `rows`
+    double distinct() const;
+};
+
+} // namespace inmemdb
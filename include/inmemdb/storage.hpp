@@ -4,25 +4,50 @@
 #include <variant>
 #include <unordered_map>
 #include <optional>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <thread>
 #include "inmemdb/parser.hpp"
+#include "inmemdb/column.hpp"
+#include "inmemdb/index.hpp"
+#include "inmemdb/stats.hpp"
+#include "inmemdb/cursor.hpp"
+#include "inmemdb/wal.hpp"
 
 namespace inmemdb {
 
-using Value = std::variant<int64_t, std::string>;
-
 struct ColumnMeta {
     std::string name;
     ColumnType type;
+    bool dict = false;          // TEXT stored as a DictColumn
+    bool declared_dict = false; // TEXT DICT in the schema: stays a DictColumn whatever its cardinality
 };
 
-struct Row {
-    std::vector<Value> values; 
-};
+// Plain TEXT columns are sampled once the table reaches kDictSampleRows rows
+// and switched to a DictColumn when they have at most one distinct value per
+// kDictMinRowsPerValue rows. The sample can mislead, so past it every insert
+// rechecks the dictionaries picked this way (never declared ones): one
+// holding more than kDictMaxValues values, or over twice as many as
+// kDictMinRowsPerValue allows, is decoded back to plain TEXT for good.
+constexpr size_t kDictSampleRows = 4096;
+constexpr size_t kDictMinRowsPerValue = 8;
+constexpr size_t kDictMaxValues = size_t{1} << 16; // bounds find() scans and per-query code tables
 
+// COPY parses its input in chunks of about this many bytes
+constexpr size_t kCopyChunkBytes = 1 << 20;
+
+// A table, or a snapshot of one: copying a Table shares the column storage
+// and indexes, and the copy only ever reads its first row_count rows
 struct Table {
     std::string name;
     std::vector<ColumnMeta> columns;
-    std::vector<Row> rows;
+    std::vector<ColumnData> data; // one entry per column
+    size_t row_count = 0;
+    std::vector<std::shared_ptr<Index>> indexes; // secondary indexes, kept current by insert_row
+    std::vector<ColumnStats> stats; // one per column, kept current like the indexes
 
     std::optional<size_t> find_column(std::string const& col) const {
         for (size_t i = 0; i < columns.size(); ++i) 
@@ -31,20 +56,161 @@ struct Table {
     }
 };
 
+// Empty batch with one INT or TEXT column per table column
+Batch empty_batch(std::vector<ColumnMeta> const& columns);
+
+// A statement parsed once, with values for its `?`/`$n` placeholders passed
+// per execution. A SELECT also keeps its plan.
+struct PreparedStatement {
+    Statement stmt;
+    size_t params = 0; // number of placeholders
+    std::shared_ptr<SelectPlan const> plan; // SELECT only
+    uint64_t schema_version = 0;            // schema the plan was made for
+};
+
+struct PlanCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t entries = 0;
+};
+
+// Memory held by one column or index of a table
+struct ObjectMemory {
+    std::string name;
+    MemoryStats usage;
+};
+
+struct TableMemory {
+    std::string name;
+    size_t rows = 0;
+    std::vector<ObjectMemory> columns;
+    std::vector<ObjectMemory> indexes;
+    MemoryStats total; // columns plus indexes
+};
+
+// Column blocks count at capacity, including blocks mapped from a snapshot
+// file (which are not heap allocations); older blocks kept alive only by
+// open snapshots are not included
+struct MemoryUsage {
+    std::vector<TableMemory> tables; // by name
+    MemoryStats total;
+};
+
+// One operator of an explained plan, listed root first; depth is its
+// nesting level. The measured fields are filled by EXPLAIN ANALYZE only.
+struct OperatorProfile {
+    std::string name;   // e.g. HashJoin
+    std::string detail; // e.g. the condition and build side
+    size_t depth = 0;
+    double ms = 0; // time in this operator alone
+    uint64_t rows_in = 0, rows_out = 0;
+    uint64_t bytes = 0;      // see OperatorStats
+    uint64_t peak_bytes = 0; // working memory
+};
+
+struct QueryProfile {
+    bool analyzed = false;
+    double lex_ms = 0, parse_ms = 0, plan_ms = 0, execute_ms = 0;
+    uint64_t rows = 0; // rows the query returned
+    std::vector<OperatorProfile> operators;
+};
+
 struct QueryResult {
     bool success = true;
     std::string message;
     std::vector<std::string> header;
     std::vector<std::vector<std::string>> rows;
+    std::optional<QueryProfile> profile; // EXPLAIN; rows then hold its rendering
 };
 
+// Thread-safe. Tables are append-only, so a reader's snapshot is a copy of
+// the column handles plus the committed row count, taken under a short
+// commit lock. Queries then run on their snapshot without any lock: SELECTs
+// never wait for INSERTs to finish, and INSERTs never wait for SELECTs.
 class Database {
 public:
-    Table& create_table(CreateTableStmt const& stmt);
+    void create_table(CreateTableStmt const& stmt);
+    void create_index(CreateIndexStmt const& stmt);
     void insert_row(InsertStmt const& stmt);
-    QueryResult select_rows(SelectStmt const& stmt) const;
+    // Bulk-load a CSV file; returns the number of rows added. The file is
+    // mapped, split into chunks of about chunk_bytes at line boundaries and
+    // parsed in parallel; the rows are appended only if every line parses.
+    size_t copy_from(CopyStmt const& stmt, size_t chunk_bytes = kCopyChunkBytes);
+
+    // Replay the write-ahead log at options.path into this database, then log
+    // every later CREATE TABLE, CREATE INDEX and INSERT to it; each of those
+    // returns once its record is durable under options.sync. Records that
+    // loaded snapshots already hold are skipped; returns the number of
+    // replayed records. A change is visible before its record is
+    // written, so if the write or sync fails the change stays and the
+    // database turns read-only; every later write is refused.
+    size_t attach_wal(WalOptions const& options);
+
+    // Write every table (schema, column data and index definitions) as of one
+    // commit to a binary snapshot file; the file is replaced atomically. It
+    // records how many records of the attached WAL it holds and returns once
+    // those are durable, so the same log can be replayed on top of it.
+    void save_snapshot(std::string const& path) const;
+    // Add the tables of a snapshot file. Columns are served from a read-only
+    // mapping of the file and copied into memory only when appended to;
+    // indexes and column statistics are rebuilt. Returns the number of tables loaded.
+    size_t load_snapshot(std::string const& path);
+    // The live table; only safe to read while no other thread writes
+    Table const* find_table(std::string const& name) const;
+    // Consistent read view of the named tables as of one commit; nullptr for unknown names
+    std::vector<std::shared_ptr<Table const>> snapshot(std::vector<std::string> const& names) const;
+    // Streaming SELECT; throws on unknown tables/columns or bad literals.
+    // dop is the number of worker threads for this query, 0 for parallelism()
+    Cursor open_cursor(SelectStmt const& stmt, size_t dop = 0) const;
+    // Materialised SELECT with stringified cells, built on open_cursor()
+    QueryResult select_rows(SelectStmt const& stmt, size_t dop = 0) const;
+
+    // Parse and plan one statement, or reuse the cached result for the same
+    // SQL text (compared token by token, ignoring layout). Cached plans are
+    // redone once a table or index was created since they were made.
+    std::shared_ptr<PreparedStatement const> prepare(std::string const& sql);
+    // Run a prepared SELECT with `params` bound to its placeholders
+    Cursor open_cursor(PreparedStatement const& stmt, std::vector<Value> const& params, size_t dop = 0) const;
+    QueryResult select_rows(PreparedStatement const& stmt, std::vector<Value> const& params, size_t dop = 0) const;
+    // The plan of a SELECT, one row per operator; with ANALYZE the query is
+    // also run (results discarded) and each operator reports its time, rows
+    // in and out, bytes and working memory, after the lex, parse, plan and
+    // execute times
+    QueryResult explain(ExplainStmt const& stmt, size_t dop = 0) const;
+
+    // The LRU plan cache keeps up to this many statements (default 256)
+    void set_plan_cache_capacity(size_t n);
+    PlanCacheStats plan_cache_stats() const;
+
+    // Bytes and heap allocations behind every table, column and index
+    MemoryUsage memory_usage() const;
+
+    // Default degree of parallelism for queries; 1 runs them serially
+    size_t parallelism() const { return parallelism_; }
+    void set_parallelism(size_t dop) { parallelism_ = std::max<size_t>(1, dop); }
 private:
+    void apply_wal_record(WalRecordType type, std::string_view payload);
+    void check_index_name(std::string const& name) const; // with commit_mu_ held
+    uint64_t commit_batch(Table& tbl, Batch const& rows);  // with commit_mu_ held
+    void check_writable() const;                           // with commit_mu_ held
+    void wait_durable(uint64_t seq);
+    std::shared_ptr<SelectPlan const> plan_select(SelectStmt const& stmt) const;
+
+    mutable std::mutex commit_mu_; // guards tables_, wal_ appends and every write to a Table
     std::unordered_map<std::string, Table> tables_;
+    std::unique_ptr<WriteAheadLog> wal_;
+    std::string wal_failure_; // why the WAL failed; once set the database is read-only
+    uint64_t snapshot_wal_records_ = 0; // WAL records the loaded snapshots hold
+    std::atomic<uint64_t> schema_version_{0}; // bumped by every CREATE TABLE / CREATE INDEX
+
+    // Prepared statements by normalised SQL, most recently used first
+    using PlanLru = std::list<std::pair<std::string, std::shared_ptr<PreparedStatement const>>>;
+    mutable std::mutex plan_mu_;
+    PlanLru plan_lru_;
+    std::unordered_map<std::string, PlanLru::iterator> plan_cache_;
+    size_t plan_capacity_ = 256;
+    size_t plan_hits_ = 0, plan_misses_ = 0;
+    size_t parallelism_ = std::max(1u, std::thread::hardware_concurrency());
 };
 
 } // namespace inmemdb
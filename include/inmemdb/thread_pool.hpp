@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace inmemdb {
+
+// Worker threads for morsel-driven execution. run() splits morsels [0, n)
+// into one contiguous range per worker; a worker that drains its own range
+// steals morsels from the others, so a slow morsel does not stall the query.
+// The calling thread is always worker 0 and finishes the job by itself if no
+// helper is free, so concurrent queries can share one pool.
+class ThreadPool {
+public:
+    // fn(morsel, worker) with worker < dop
+    using MorselFn = std::function<void(size_t morsel, size_t worker)>;
+
+    explicit ThreadPool(size_t threads);
+    ~ThreadPool();
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    // Process-wide pool, grown on demand to dop - 1 helper threads
+    static ThreadPool& shared();
+
+    // Run fn over morsels [0, n) on up to dop workers; returns when all are
+    // done and rethrows the first exception a morsel raised
+    void run(size_t n, size_t dop, MorselFn const& fn);
+
+private:
+    struct Range {
+        std::atomic<size_t> next{0};
+        size_t end = 0;
+    };
+    struct Job {
+        MorselFn const* fn;
+        std::unique_ptr<Range[]> ranges;
+        size_t workers;
+        size_t claimed = 1; // worker slots handed out; 0 is the caller
+        size_t active = 0;  // helpers still inside work()
+        std::exception_ptr error;
+        std::mutex error_mu;
+    };
+
+    void ensure_threads(size_t n);
+    void helper_loop();
+    static void work(Job& job, size_t worker);
+
+    std::mutex mu_;
+    std::condition_variable wake_; // a job was queued, or stop
+    std::condition_variable idle_; // a helper left a job
+    std::deque<std::shared_ptr<Job>> queue_; // jobs with unclaimed worker slots
+    std::vector<std::thread> threads_;
+    bool stop_ = false;
+};
+
+} // namespace inmemdb
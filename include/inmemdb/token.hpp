@@ -10,6 +10,7 @@ enum class TokenType {
     Identifier,
     Integer,
     String,
+    Parameter, // ? (text empty) or $n (text n)
     Comma,
     LParen, // left parenthesis
     RParen, // right parenthesis
@@ -34,13 +35,46 @@ enum class TokenType {
     KeywordJoin,
     KeywordInner,
     KeywordOn,
+    KeywordIndex,
+    KeywordUsing,
+    KeywordHash,
+    KeywordBtree,
+    KeywordDict,
+    KeywordGroup,
+    KeywordBy,
+    KeywordCount,
+    KeywordSum,
+    KeywordMin,
+    KeywordMax,
+    KeywordAvg,
+    KeywordOrder,
+    KeywordAsc,
+    KeywordDesc,
+    KeywordLimit,
+    KeywordOffset,
+    KeywordSnapshot,
+    KeywordTo,
+    KeywordCopy,
+    KeywordHeader,
+    KeywordPrepare,
+    KeywordExecute,
+    KeywordAs,
+    KeywordExplain,
+    KeywordAnalyze,
+    KeywordAnd,
+    KeywordOr,
+    KeywordNot,
+    KeywordIn,
+    KeywordBetween,
     Dot,
 };
 
+// `text` views the lexer's input (or its store of unescaped string
+// literals), so a token is only valid while its Lexer lives
 struct Token {
     TokenType type;
-    std::string text; 
-    std::size_t pos{}; 
+    std::string_view text;
+    std::size_t pos{};
 };
 
 inline const char* to_string(TokenType t) {
@@ -49,6 +83,7 @@ inline const char* to_string(TokenType t) {
         case TokenType::Identifier: return "Identifier";
         case TokenType::Integer: return "Integer";
         case TokenType::String: return "String";
+        case TokenType::Parameter: return "Parameter";
         case TokenType::Comma: return ",";
         case TokenType::LParen: return "(";
         case TokenType::RParen: return ")";
@@ -73,6 +108,37 @@ inline const char* to_string(TokenType t) {
         case TokenType::KeywordJoin: return "JOIN";
         case TokenType::KeywordInner: return "INNER";
         case TokenType::KeywordOn: return "ON";
+        case TokenType::KeywordIndex: return "INDEX";
+        case TokenType::KeywordUsing: return "USING";
+        case TokenType::KeywordHash: return "HASH";
+        case TokenType::KeywordBtree: return "BTREE";
+        case TokenType::KeywordDict: return "DICT";
+        case TokenType::KeywordGroup: return "GROUP";
+        case TokenType::KeywordBy: return "BY";
+        case TokenType::KeywordCount: return "COUNT";
+        case TokenType::KeywordSum: return "SUM";
+        case TokenType::KeywordMin: return "MIN";
+        case TokenType::KeywordMax: return "MAX";
+        case TokenType::KeywordAvg: return "AVG";
+        case TokenType::KeywordOrder: return "ORDER";
+        case TokenType::KeywordAsc: return "ASC";
+        case TokenType::KeywordDesc: return "DESC";
+        case TokenType::KeywordLimit: return "LIMIT";
+        case TokenType::KeywordOffset: return "OFFSET";
+        case TokenType::KeywordSnapshot: return "SNAPSHOT";
+        case TokenType::KeywordTo: return "TO";
+        case TokenType::KeywordCopy: return "COPY";
+        case TokenType::KeywordHeader: return "HEADER";
+        case TokenType::KeywordPrepare: return "PREPARE";
+        case TokenType::KeywordExecute: return "EXECUTE";
+        case TokenType::KeywordAs: return "AS";
+        case TokenType::KeywordExplain: return "EXPLAIN";
+        case TokenType::KeywordAnalyze: return "ANALYZE";
+        case TokenType::KeywordAnd: return "AND";
+        case TokenType::KeywordOr: return "OR";
+        case TokenType::KeywordNot: return "NOT";
+        case TokenType::KeywordIn: return "IN";
+        case TokenType::KeywordBetween: return "BETWEEN";
         case TokenType::Dot: return ".";
     }
     return "?";
@@ -0,0 +1,77 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "inmemdb/codec.hpp"
+
+namespace inmemdb {
+
+// When an appended record counts as durable
+enum class SyncPolicy {
+    EveryCommit, // write and fdatasync before the commit returns
+    Group,       // a flusher syncs all records pending after group_window or group_records
+    OsBuffered,  // write(2) before the commit returns; the OS decides when to sync
+};
+
+struct WalOptions {
+    std::string path;
+    SyncPolicy sync = SyncPolicy::Group;
+    std::chrono::microseconds group_window{100};
+    size_t group_records = 512;
+};
+
+enum class WalRecordType : uint8_t { CreateTable = 1, Insert = 2, CreateIndex = 3 };
+
+// Append-only log file of framed records: [u32 size][u8 type][payload][u32 crc].
+// append() queues a record in commit order and returns its sequence number;
+// wait() blocks until that record is durable under the sync policy. Callers
+// append while holding their commit lock and wait after releasing it, so
+// concurrent commits share one write and fdatasync.
+class WriteAheadLog {
+public:
+    // `records` is the number already in the file; sequence numbers go on from there
+    explicit WriteAheadLog(WalOptions options, uint64_t records = 0);
+    ~WriteAheadLog(); // syncs whatever is still pending
+    WriteAheadLog(WriteAheadLog const&) = delete;
+    WriteAheadLog& operator=(WriteAheadLog const&) = delete;
+
+    uint64_t append(WalRecordType type, std::string_view payload);
+    // Throws if writing or syncing the log failed
+    void wait(uint64_t seq);
+    // Sequence number of the last appended record, written or not
+    uint64_t records();
+
+    // Feed every intact record of the log at `path` after the first `skip`
+    // to apply, in order; a torn or corrupt tail left by a crash is cut off.
+    // Returns the number of intact records, skipped ones included; a missing
+    // file has none.
+    static size_t replay(std::string const& path, std::function<void(WalRecordType, std::string_view)> const& apply,
+                         size_t skip = 0);
+
+private:
+    void flush_locked(std::unique_lock<std::mutex>& lock);
+    void flusher_loop();
+
+    WalOptions options_;
+    int fd_ = -1;
+    std::mutex mu_;
+    std::condition_variable durable_cv_; // written_ advanced or a flush finished
+    std::condition_variable work_cv_;    // group flusher: records pending or stop
+    std::string pending_;
+    size_t pending_records_ = 0;
+    std::chrono::steady_clock::time_point first_pending_;
+    uint64_t appended_ = 0; // last sequence number handed out
+    uint64_t written_ = 0;  // last sequence number durable under the policy
+    bool flushing_ = false;
+    bool stop_ = false;
+    std::exception_ptr error_;
+    std::thread flusher_;
+};
+
+} // namespace inmemdb
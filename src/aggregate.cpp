@@ -0,0 +1,257 @@
+#include "inmemdb/aggregate.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+namespace inmemdb {
+
+HashAggregator::HashAggregator(std::vector<AggColumn> keys, std::vector<Aggregate> aggs, std::vector<Output> outputs)
+    : keys_(std::move(keys)), aggs_(std::move(aggs)), outputs_(std::move(outputs)), states_(aggs_.size()) {
+    key_values_.resize(keys_.size());
+    for (size_t k = 0; k < keys_.size(); ++k) key_values_[k].type = keys_[k].type;
+    if (keys_.empty()) {
+        // The single group exists even when no row arrives: COUNT(*) is then 0
+        add_group(0, nullptr);
+    }
+}
+
+std::vector<ColumnType> HashAggregator::output_types() const {
+    std::vector<ColumnType> types;
+    for (auto const& o : outputs_) {
+        if (o.is_key) { types.push_back(keys_[o.idx].type); continue; }
+        auto const& a = aggs_[o.idx];
+        switch (a.func) {
+            case AggFunc::Count: case AggFunc::Sum: types.push_back(ColumnType::Int); break;
+            case AggFunc::Min: case AggFunc::Max: types.push_back(a.input->type); break;
+            case AggFunc::Avg: types.push_back(ColumnType::Real); break;
+        }
+    }
+    return types;
+}
+
+// Record the key values of a new group taken from input row i
+uint32_t HashAggregator::add_group(size_t i, std::vector<size_t> const* rows) {
+    for (size_t k = 0; k < keys_.size(); ++k) {
+        size_t row = rows[keys_[k].sel][i];
+        ColumnData const& col = *keys_[k].data;
+        if (auto ic = std::get_if<IntColumn>(&col)) key_values_[k].push_int(ic->at(row));
+        else key_values_[k].push_text(text_at(col, row));
+    }
+    return new_group(chunk_pos_ + i);
+}
+
+// Empty aggregate state for a group whose key values were just appended
+uint32_t HashAggregator::new_group(uint64_t first_pos) {
+    for (auto& st : states_) {
+        st.count.push_back(0);
+        st.sum.push_back(0);
+        st.ival.push_back(0);
+        st.sval.emplace_back();
+    }
+    first_pos_.push_back(first_pos);
+    return static_cast<uint32_t>(group_count_++);
+}
+
+void HashAggregator::assign_groups(std::vector<size_t> const* rows) {
+    size_t n = rows[0].size();
+    gids_.assign(n, 0);
+    if (keys_.empty()) return;
+    if (keys_.size() == 1 && keys_[0].type == ColumnType::Int) {
+        auto const& col = std::get<IntColumn>(*keys_[0].data);
+        ivals_.resize(n);
+        col.gather(rows[keys_[0].sel].data(), n, ivals_.data());
+        for (size_t i = 0; i < n; ++i) {
+            auto [it, added] = int_groups_.try_emplace(ivals_[i], static_cast<uint32_t>(group_count_));
+            if (added) add_group(i, rows);
+            gids_[i] = it->second;
+        }
+        return;
+    }
+    // Encode the key: 8 raw bytes per INT, the code for dictionary TEXT, and
+    // length-prefixed bytes for plain TEXT
+    for (size_t i = 0; i < n; ++i) {
+        key_buf_.clear();
+        for (auto const& k : keys_) {
+            size_t row = rows[k.sel][i];
+            if (auto ic = std::get_if<IntColumn>(k.data)) {
+                int64_t v = ic->at(row);
+                key_buf_.append(reinterpret_cast<char const*>(&v), sizeof v);
+            } else if (auto dc = std::get_if<DictColumn>(k.data)) {
+                uint32_t c = dc->codes[row];
+                key_buf_.append(reinterpret_cast<char const*>(&c), sizeof c);
+            } else {
+                std::string_view v = std::get<TextColumn>(*k.data).at(row);
+                uint32_t len = static_cast<uint32_t>(v.size());
+                key_buf_.append(reinterpret_cast<char const*>(&len), sizeof len);
+                key_buf_.append(v);
+            }
+        }
+        auto it = groups_.find(key_buf_);
+        if (it == groups_.end()) it = groups_.emplace(key_buf_, add_group(i, rows)).first;
+        gids_[i] = it->second;
+    }
+}
+
+// Fold the chunk into one aggregate; the column type is dispatched once per chunk
+void HashAggregator::update(Aggregate const& agg, State& st, std::vector<size_t> const* rows) {
+    size_t n = rows[0].size();
+    if (!agg.input) {
+        for (size_t i = 0; i < n; ++i) ++st.count[gids_[i]];
+        return;
+    }
+    auto const& in = rows[agg.input->sel];
+    ColumnData const& col = *agg.input->data;
+    if (auto ic = std::get_if<IntColumn>(&col)) {
+        switch (agg.func) {
+            case AggFunc::Count:
+                for (size_t i = 0; i < n; ++i) ++st.count[gids_[i]];
+                break;
+            case AggFunc::Sum: case AggFunc::Avg:
+                ivals_.resize(n);
+                ic->gather(in.data(), n, ivals_.data());
+                for (size_t i = 0; i < n; ++i) { uint32_t g = gids_[i]; st.sum[g] += ivals_[i]; ++st.count[g]; }
+                break;
+            case AggFunc::Min: case AggFunc::Max: {
+                bool is_min = agg.func == AggFunc::Min;
+                ivals_.resize(n);
+                ic->gather(in.data(), n, ivals_.data());
+                for (size_t i = 0; i < n; ++i) {
+                    uint32_t g = gids_[i];
+                    int64_t v = ivals_[i];
+                    if (st.count[g]++ == 0 || (is_min ? v < st.ival[g] : v > st.ival[g])) st.ival[g] = v;
+                }
+                break;
+            }
+        }
+        return;
+    }
+    // TEXT: only COUNT, MIN and MAX are accepted by the planner
+    if (agg.func == AggFunc::Count) {
+        for (size_t i = 0; i < n; ++i) ++st.count[gids_[i]];
+        return;
+    }
+    bool is_min = agg.func == AggFunc::Min;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t g = gids_[i];
+        std::string_view v = text_at(col, in[i]);
+        if (st.count[g]++ == 0 || (is_min ? v < st.sval[g] : v > st.sval[g])) st.sval[g].assign(v);
+    }
+}
+
+void HashAggregator::consume(std::vector<size_t> const* rows) {
+    consume(rows, chunk_pos_);
+}
+
+void HashAggregator::consume(std::vector<size_t> const* rows, uint64_t pos) {
+    bool out_of_order = pos < end_pos_;
+    chunk_pos_ = pos;
+    assign_groups(rows);
+    // A chunk from before anything already seen can move existing groups forward
+    if (out_of_order)
+        for (size_t i = 0; i < rows[0].size(); ++i) first_pos_[gids_[i]] = std::min(first_pos_[gids_[i]], pos + i);
+    for (size_t a = 0; a < aggs_.size(); ++a) update(aggs_[a], states_[a], rows);
+    chunk_pos_ = pos + rows[0].size();
+    end_pos_ = std::max(end_pos_, chunk_pos_);
+}
+
+// Both aggregators encode keys from the same columns, so the other's group
+// map keys can be looked up here directly
+void HashAggregator::merge(HashAggregator const& other) {
+    std::vector<uint32_t> to(other.group_count_, 0);
+    auto map_group = [&](auto& groups, auto const& key, uint32_t og) {
+        auto [it, added] = groups.try_emplace(key, static_cast<uint32_t>(group_count_));
+        if (added) {
+            for (size_t k = 0; k < keys_.size(); ++k) {
+                BatchColumn const& kv = other.key_values_[k];
+                if (kv.type == ColumnType::Int) key_values_[k].push_int(kv.int_at(og));
+                else key_values_[k].push_text(kv.text_at(og));
+            }
+            new_group(other.first_pos_[og]);
+        }
+        to[og] = it->second;
+        first_pos_[it->second] = std::min(first_pos_[it->second], other.first_pos_[og]);
+    };
+    if (keys_.empty()) first_pos_[0] = std::min(first_pos_[0], other.first_pos_[0]);
+    else if (keys_.size() == 1 && keys_[0].type == ColumnType::Int) for (auto const& [k, og] : other.int_groups_) map_group(int_groups_, k, og);
+    else for (auto const& [k, og] : other.groups_) map_group(groups_, k, og);
+
+    for (size_t a = 0; a < aggs_.size(); ++a) {
+        State& st = states_[a];
+        State const& os = other.states_[a];
+        bool is_min = aggs_[a].func == AggFunc::Min;
+        for (size_t og = 0; og < other.group_count_; ++og) {
+            uint32_t g = to[og];
+            if (os.count[og] == 0) continue;
+            bool take = st.count[g] == 0;
+            if (!take && (aggs_[a].func == AggFunc::Min || aggs_[a].func == AggFunc::Max)) {
+                take = aggs_[a].input->type == ColumnType::Int
+                    ? (is_min ? os.ival[og] < st.ival[g] : os.ival[og] > st.ival[g])
+                    : (is_min ? os.sval[og] < st.sval[g] : os.sval[og] > st.sval[g]);
+            }
+            if (take) { st.ival[g] = os.ival[og]; st.sval[g] = os.sval[og]; }
+            st.count[g] += os.count[og];
+            st.sum[g] += os.sum[og];
+        }
+    }
+}
+
+bool HashAggregator::next(Batch& out, size_t max_rows) {
+    auto types = output_types();
+    out.columns.resize(outputs_.size());
+    for (size_t c = 0; c < outputs_.size(); ++c) { out.columns[c].type = types[c]; out.columns[c].clear(); }
+    if (order_.size() != group_count_) {
+        order_.resize(group_count_);
+        for (size_t g = 0; g < group_count_; ++g) order_[g] = static_cast<uint32_t>(g);
+        if (!std::is_sorted(first_pos_.begin(), first_pos_.end()))
+            std::stable_sort(order_.begin(), order_.end(), [&](uint32_t a, uint32_t b) { return first_pos_[a] < first_pos_[b]; });
+    }
+    size_t end = std::min(group_count_, emitted_ + max_rows);
+    for (size_t c = 0; c < outputs_.size(); ++c) {
+        auto const& o = outputs_[c];
+        BatchColumn& dst = out.columns[c];
+        for (size_t j = emitted_; j < end; ++j) {
+            uint32_t g = order_[j];
+            if (o.is_key) {
+                BatchColumn const& kv = key_values_[o.idx];
+                if (kv.type == ColumnType::Int) dst.push_int(kv.int_at(g));
+                else dst.push_text(kv.text_at(g));
+                continue;
+            }
+            auto const& a = aggs_[o.idx];
+            State const& st = states_[o.idx];
+            switch (a.func) {
+                case AggFunc::Count: dst.push_int(st.count[g]); break;
+                case AggFunc::Sum:
+                    if (st.sum[g] < INT64_MIN || st.sum[g] > INT64_MAX) throw std::runtime_error("Integer overflow in SUM");
+                    dst.push_int(static_cast<int64_t>(st.sum[g]));
+                    break;
+                case AggFunc::Avg: dst.push_real(st.count[g] ? static_cast<double>(st.sum[g]) / static_cast<double>(st.count[g]) : 0.0); break;
+                case AggFunc::Min: case AggFunc::Max:
+                    if (a.input->type == ColumnType::Int) dst.push_int(st.ival[g]);
+                    else dst.push_text(st.sval[g]);
+                    break;
+            }
+        }
+    }
+    out.rows = end - emitted_;
+    emitted_ = end;
+    return out.rows > 0;
+}
+
+size_t HashAggregator::footprint() const {
+    // Map nodes hold the entry plus a next pointer; buckets are one pointer
+    // each; strings count their heap buffer beyond the inline one
+    size_t const inline_chars = std::string().capacity();
+    size_t n = int_groups_.size() * (sizeof(std::pair<int64_t const, uint32_t>) + sizeof(void*)) + int_groups_.bucket_count() * sizeof(void*);
+    n += groups_.size() * (sizeof(std::pair<std::string const, uint32_t>) + sizeof(void*)) + groups_.bucket_count() * sizeof(void*);
+    for (auto const& [key, g] : groups_) n += key.capacity() > inline_chars ? key.capacity() : 0;
+    for (auto const& kv : key_values_) n += kv.byte_size();
+    for (auto const& st : states_) {
+        n += (st.count.capacity() + st.ival.capacity()) * sizeof(int64_t) + st.sum.capacity() * sizeof(__int128) + st.sval.capacity() * sizeof(std::string);
+        for (auto const& s : st.sval) n += s.capacity() > inline_chars ? s.capacity() : 0;
+    }
+    n += first_pos_.capacity() * sizeof(uint64_t) + gids_.capacity() * sizeof(uint32_t) + ivals_.capacity() * sizeof(int64_t);
+    return n;
+}
+
+} // namespace inmemdb
@@ -0,0 +1,135 @@
+#include "inmemdb/client.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <utility>
+
+namespace inmemdb {
+
+[[noreturn]] static void fail(std::string const& what) {
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+static int connect_to(int family, sockaddr const* addr, socklen_t len, std::string const& name) {
+    int fd = ::socket(family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) fail("socket");
+    if (::connect(fd, addr, len) < 0) {
+        int err = errno;
+        ::close(fd);
+        errno = err;
+        fail("Cannot connect to " + name);
+    }
+    return fd;
+}
+
+Client Client::connect_tcp(std::string const& host, uint16_t port) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) throw std::runtime_error("Not an IPv4 address: " + host);
+    int fd = connect_to(AF_INET, reinterpret_cast<sockaddr*>(&addr), sizeof addr, host + ":" + std::to_string(port));
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    return Client(fd);
+}
+
+Client Client::connect_unix(std::string const& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof addr.sun_path) throw std::runtime_error("Unix socket path too long: " + path);
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return Client(connect_to(AF_UNIX, reinterpret_cast<sockaddr*>(&addr), sizeof addr, path));
+}
+
+Client::Client(Client&& other) noexcept
+    : fd_(std::exchange(other.fd_, -1)), next_id_(other.next_id_), out_(std::move(other.out_)),
+      in_(std::move(other.in_)), in_pos_(other.in_pos_) {}
+
+Client& Client::operator=(Client&& other) noexcept {
+    if (this != &other) {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = std::exchange(other.fd_, -1);
+        next_id_ = other.next_id_;
+        out_ = std::move(other.out_);
+        in_ = std::move(other.in_);
+        in_pos_ = other.in_pos_;
+    }
+    return *this;
+}
+
+Client::~Client() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+uint32_t Client::send(std::string_view sql) {
+    uint32_t id = next_id_++;
+    wire::append_frame(out_, wire::FrameType::Query, id, sql);
+    return id;
+}
+
+void Client::flush() {
+    size_t pos = 0;
+    while (pos < out_.size()) {
+        ssize_t w = ::send(fd_, out_.data() + pos, out_.size() - pos, MSG_NOSIGNAL);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            fail("send");
+        }
+        pos += static_cast<size_t>(w);
+    }
+    out_.clear();
+}
+
+Client::Response Client::receive() {
+    flush();
+    // A large answer arrives as ResultPart frames ahead of its Result frame
+    std::string parts;
+    uint32_t parts_id = 0;
+    while (true) {
+        wire::Frame frame;
+        size_t used;
+        while ((used = wire::parse_frame(std::string_view(in_).substr(in_pos_), frame)) == 0) {
+            // Drop consumed input before reading more
+            in_.erase(0, in_pos_);
+            in_pos_ = 0;
+            size_t at = in_.size();
+            in_.resize(at + 64 * 1024);
+            ssize_t r = ::recv(fd_, in_.data() + at, 64 * 1024, 0);
+            in_.resize(at + static_cast<size_t>(std::max<ssize_t>(r, 0)));
+            if (r == 0) throw std::runtime_error("Server closed the connection");
+            if (r < 0 && errno != EINTR) fail("recv");
+        }
+        if (frame.type == wire::FrameType::Query) throw std::runtime_error("Expected a result frame");
+        if (!parts.empty() && frame.id != parts_id) throw std::runtime_error("Result frames of two answers interleaved");
+        if (frame.type == wire::FrameType::ResultPart) {
+            parts_id = frame.id;
+            parts.append(frame.payload);
+            in_pos_ += used;
+            continue;
+        }
+        Response res;
+        res.id = frame.id;
+        if (parts.empty()) {
+            res.results = wire::decode_results(frame.payload);
+        } else {
+            parts.append(frame.payload);
+            res.results = wire::decode_results(parts);
+        }
+        in_pos_ += used;
+        return res;
+    }
+}
+
+std::vector<wire::StatementResult> Client::query(std::string_view sql) {
+    send(sql);
+    return receive().results;
+}
+
+} // namespace inmemdb
@@ -0,0 +1,152 @@
+#include "inmemdb/column.hpp"
+
+namespace inmemdb {
+
+void IntColumn::append(int64_t const* items, size_t n) {
+    while (n > 0) {
+        size_t take = std::min(n, kSegmentRows - std::min(kSegmentRows, tail.size()));
+        tail.append(items, take);
+        items += take;
+        n -= take;
+        if (tail.size() >= kSegmentRows) {
+            extend_zones(); // while the rows are still plain
+            seal();
+        }
+    }
+}
+
+void IntColumn::seal() {
+    size_t full = tail.size() / kSegmentRows;
+    if (full == 0) return;
+    for (size_t s = 0; s < full; ++s)
+        segments.push_back(std::make_shared<IntSegment const>(IntSegment::encode(tail.data() + s * kSegmentRows, kSegmentRows)));
+    AppendBuffer<int64_t> rest;
+    rest.append(tail.data() + full * kSegmentRows, tail.size() - full * kSegmentRows);
+    tail = std::move(rest);
+}
+
+void IntColumn::gather(size_t const* rows, size_t n, int64_t* out) const {
+    constexpr size_t kBlock = IntSegment::kBlockRows;
+    size_t const sealed = sealed_rows();
+    int64_t block[kBlock];
+    size_t cached = SIZE_MAX; // row / kBlock of the block decoded into `block`
+    for (size_t i = 0; i < n; ++i) {
+        size_t r = rows[i];
+        if (r >= sealed) { out[i] = tail[r - sealed]; continue; }
+        IntSegment const& seg = *segments[r / kSegmentRows];
+        size_t off = r % kSegmentRows;
+        // Consecutive rows up to the end of the block decode straight into out
+        size_t m = std::min(n - i, kBlock - off % kBlock), k = 1;
+        while (k < m && rows[i + k] == r + k) ++k;
+        if (k == m && m > 1) {
+            seg.decode(off, off + m, out + i);
+            i += m - 1;
+            continue;
+        }
+        if (r / kBlock != cached) {
+            // A lone row is read in place; a block that holds the next row too
+            // (or any Delta block, whose rows depend on each other) is decoded
+            bool dense = i + 1 < n && rows[i + 1] / kBlock == r / kBlock;
+            if (!dense && seg.encoding != IntEncoding::Delta) { out[i] = seg.at(off); continue; }
+            size_t first = off - off % kBlock;
+            seg.decode(first, std::min(seg.rows, first + kBlock), block);
+            cached = r / kBlock;
+        }
+        out[i] = block[r % kBlock];
+    }
+}
+
+void IntColumn::extend_zones() {
+    size_t const sealed = sealed_rows();
+    int64_t block[kZoneRows];
+    for (size_t b = zones.size(); b < size() / kZoneRows; ++b) {
+        size_t first = b * kZoneRows;
+        int64_t const* v = tail.data() + (first - std::min(first, sealed));
+        if (first < sealed) {
+            // Only rebuilding zones (snapshot load) reaches sealed rows
+            segments[first / kSegmentRows]->decode(first % kSegmentRows, first % kSegmentRows + kZoneRows, block);
+            v = block;
+        }
+        auto [lo, hi] = std::minmax_element(v, v + kZoneRows);
+        zones.push_back({*lo, *hi});
+    }
+}
+
+// Zone of rows [first, first + kZoneRows) of a TEXT column read through at()
+template <class Col>
+static TextZone text_zone(Col const& col, size_t first) {
+    TextZone z{first, first};
+    std::string_view lo = col.at(first), hi = lo;
+    for (size_t r = first + 1; r < first + kZoneRows; ++r) {
+        std::string_view v = col.at(r);
+        if (v < lo) { lo = v; z.min_row = r; }
+        if (v > hi) { hi = v; z.max_row = r; }
+    }
+    return z;
+}
+
+void TextColumn::extend_zones() {
+    for (size_t b = zones.size(); b < size() / kZoneRows; ++b) zones.push_back(text_zone(*this, b * kZoneRows));
+}
+
+void DictColumn::extend_zones() {
+    for (size_t b = zones.size(); b < size() / kZoneRows; ++b) zones.push_back(text_zone(*this, b * kZoneRows));
+}
+
+void extend_zones(ColumnData& col) {
+    if (auto ic = std::get_if<IntColumn>(&col)) ic->extend_zones();
+    else if (auto tc = std::get_if<TextColumn>(&col)) tc->extend_zones();
+    else std::get<DictColumn>(col).extend_zones();
+}
+
+void DictColumn::push_back(std::string_view v) {
+    auto [code, added] = lookup->insert(v, static_cast<uint32_t>(dict.size()));
+    if (added) dict.push_back(v);
+    codes.push_back(code);
+}
+
+uint32_t DictColumn::find(std::string_view v) const {
+    for (size_t c = 0; c < dict.size(); ++c)
+        if (dict.at(c) == v) return static_cast<uint32_t>(c);
+    return kNoCode;
+}
+
+DictColumn DictColumn::encode(TextColumn const& col) {
+    DictColumn out;
+    out.codes.reserve(col.size());
+    for (size_t r = 0; r < col.size(); ++r) out.push_back(col.at(r));
+    out.extend_zones();
+    return out;
+}
+
+TextColumn DictColumn::decode() const {
+    TextColumn out;
+    out.offsets.reserve(size() + 1);
+    for (size_t r = 0; r < size(); ++r) out.push_back(at(r));
+    out.extend_zones();
+    return out;
+}
+
+MemoryStats memory_stats(ColumnData const& col) {
+    MemoryStats m;
+    if (auto ic = std::get_if<IntColumn>(&col)) {
+        m += ic->segments.memory();
+        for (auto const& seg : ic->segments) m += seg->memory();
+        m += ic->tail.memory();
+        m += ic->zones.memory();
+    } else if (auto tc = std::get_if<TextColumn>(&col)) {
+        m += tc->offsets.memory();
+        m += tc->bytes.memory();
+        m += tc->zones.memory();
+    } else {
+        auto const& dc = std::get<DictColumn>(col);
+        m += dc.codes.memory();
+        m += dc.zones.memory();
+        m += dc.dict.offsets.memory();
+        m += dc.dict.bytes.memory();
+        m += dc.lookup->arena.stats();
+    }
+    return m;
+}
+
+} // namespace inmemdb
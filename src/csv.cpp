@@ -0,0 +1,164 @@
+#include "inmemdb/storage.hpp"
+#include "inmemdb/thread_pool.hpp"
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// COPY t FROM 'file.csv': comma-separated fields, one row per line (LF or
+// CRLF), fields optionally in double quotes with "" for a literal quote.
+// Quoted fields may not span lines, so the file can be split at any newline.
+
+namespace inmemdb {
+
+namespace {
+
+struct CsvError {
+    size_t line; // 0-based within the chunk
+    std::string message;
+};
+
+// Read-only mapping of the input file
+struct MappedFile {
+    char const* data = nullptr;
+    size_t size = 0;
+
+    explicit MappedFile(std::string const& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+        struct stat st;
+        if (::fstat(fd, &st) == 0) size = static_cast<size_t>(st.st_size);
+        void* p = size ? ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+        int err = errno;
+        ::close(fd);
+        if (p == MAP_FAILED) throw std::runtime_error("Cannot map " + path + ": " + std::strerror(err));
+        data = static_cast<char const*>(p);
+        if (data) ::madvise(p, size, MADV_SEQUENTIAL);
+    }
+    ~MappedFile() { if (data) ::munmap(const_cast<char*>(data), size); }
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+};
+
+// Parse the lines of `text` into `out`, one BatchColumn per table column
+void parse_chunk(std::string_view text, std::vector<ColumnMeta> const& columns, Batch& out) {
+    std::string unquoted;
+    size_t line = 0;
+    for (size_t pos = 0; pos < text.size(); ++line) {
+        size_t eol = text.find('\n', pos);
+        if (eol == std::string_view::npos) eol = text.size();
+        std::string_view row = text.substr(pos, eol - pos);
+        pos = eol + 1;
+        if (!row.empty() && row.back() == '\r') row.remove_suffix(1);
+        if (row.empty()) continue;
+
+        size_t p = 0;
+        for (size_t c = 0; c < columns.size(); ++c) {
+            if (c > 0) {
+                if (p >= row.size() || row[p] != ',') throw CsvError{line, "expected " + std::to_string(columns.size()) + " fields"};
+                ++p;
+            }
+            std::string_view field;
+            if (p < row.size() && row[p] == '"') {
+                // Quoted: "" stands for one quote; copy only when there is one
+                size_t start = ++p;
+                unquoted.clear();
+                bool escaped = false;
+                while (true) {
+                    size_t q = row.find('"', p);
+                    if (q == std::string_view::npos) throw CsvError{line, "unterminated quoted field"};
+                    if (q + 1 < row.size() && row[q + 1] == '"') {
+                        unquoted.append(row.data() + p, q + 1 - p);
+                        escaped = true;
+                        p = q + 2;
+                        continue;
+                    }
+                    if (escaped) unquoted.append(row.data() + p, q - p);
+                    field = escaped ? std::string_view(unquoted) : row.substr(start, q - start);
+                    p = q + 1;
+                    break;
+                }
+            } else {
+                size_t end = std::min(row.find(',', p), row.size());
+                field = row.substr(p, end - p);
+                p = end;
+            }
+            BatchColumn& col = out.columns[c];
+            if (columns[c].type == ColumnType::Text) {
+                col.push_text(field);
+                continue;
+            }
+            int64_t v;
+            auto res = std::from_chars(field.data(), field.data() + field.size(), v);
+            if (field.empty() || res.ec != std::errc() || res.ptr != field.data() + field.size())
+                throw CsvError{line, "expected integer for column " + columns[c].name + ", got '" + std::string(field) + "'"};
+            col.push_int(v);
+        }
+        if (p != row.size()) throw CsvError{line, "expected " + std::to_string(columns.size()) + " fields"};
+        ++out.rows;
+    }
+}
+
+} // namespace
+
+size_t Database::copy_from(CopyStmt const& stmt, size_t chunk_bytes) {
+    std::vector<ColumnMeta> columns;
+    {
+        std::lock_guard<std::mutex> lock(commit_mu_);
+        check_writable();
+        auto it = tables_.find(stmt.table);
+        if (it == tables_.end()) throw std::runtime_error("Unknown table: " + stmt.table);
+        columns = it->second.columns;
+    }
+
+    MappedFile file(stmt.path);
+    std::string_view text(file.data, file.size);
+    size_t begin = 0;
+    if (stmt.header) begin = std::min(text.find('\n'), text.size() - 1) + 1;
+
+    // Chunk boundaries sit just past a newline
+    std::vector<size_t> bounds{begin};
+    while (bounds.back() < text.size()) {
+        size_t cut = bounds.back() + std::max<size_t>(1, chunk_bytes);
+        if (cut >= text.size()) { bounds.push_back(text.size()); break; }
+        size_t eol = text.find('\n', cut - 1);
+        bounds.push_back(eol == std::string_view::npos ? text.size() : eol + 1);
+    }
+    size_t chunks = bounds.size() - 1;
+
+    std::vector<Batch> parsed(chunks, empty_batch(columns));
+    std::vector<std::optional<CsvError>> errors(chunks);
+    ThreadPool::shared().run(chunks, parallelism_, [&](size_t c, size_t) {
+        try {
+            parse_chunk(text.substr(bounds[c], bounds[c + 1] - bounds[c]), columns, parsed[c]);
+        } catch (CsvError& e) {
+            errors[c] = std::move(e);
+        }
+    });
+    for (size_t c = 0; c < chunks; ++c) {
+        if (!errors[c]) continue;
+        size_t line = errors[c]->line + 1 + (stmt.header ? 1 : 0);
+        line += static_cast<size_t>(std::count(text.begin() + begin, text.begin() + bounds[c], '\n'));
+        throw std::runtime_error(stmt.path + ":" + std::to_string(line) + ": " + errors[c]->message);
+    }
+
+    size_t total = 0;
+    uint64_t seq = 0;
+    {
+        std::lock_guard<std::mutex> lock(commit_mu_);
+        check_writable();
+        Table& tbl = tables_.at(stmt.table);
+        for (auto const& rows : parsed) {
+            if (rows.rows == 0) continue;
+            seq = std::max(seq, commit_batch(tbl, rows));
+            total += rows.rows;
+        }
+    }
+    wait_durable(seq);
+    return total;
+}
+
+} // namespace inmemdb
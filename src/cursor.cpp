@@ -0,0 +1,461 @@
+#include "inmemdb/cursor.hpp"
+#include "inmemdb/storage.hpp"
+#include <stdexcept>
+#include <algorithm>
+#include <tuple>
+
+namespace inmemdb {
+
+// Resolve a possibly qualified column name against the tables of a query.
+// Returns pair<table position, column index>; an unqualified name must
+// belong to exactly one table.
+static std::pair<int, size_t> resolve_column(std::string const& colspec, std::vector<Table const*> const& tables) {
+    // qualified form t.col: split on '.'
+    auto dot = colspec.find('.');
+    if (dot != std::string::npos) {
+        std::string tname = colspec.substr(0, dot);
+        std::string cname = colspec.substr(dot + 1);
+        for (size_t t = 0; t < tables.size(); ++t) {
+            if (tables[t]->name != tname) continue;
+            if (auto idx = tables[t]->find_column(cname)) return {static_cast<int>(t), *idx};
+            throw std::runtime_error("Unknown column: " + colspec);
+        }
+        throw std::runtime_error("Unknown table qualifier: " + tname);
+    }
+    std::optional<std::pair<int, size_t>> found;
+    for (size_t t = 0; t < tables.size(); ++t) {
+        auto idx = tables[t]->find_column(colspec);
+        if (!idx) continue;
+        if (found) throw std::runtime_error("Ambiguous column name: " + colspec);
+        found = {static_cast<int>(t), *idx};
+    }
+    if (!found) throw std::runtime_error("Unknown column: " + colspec);
+    return *found;
+}
+
+// Position of the index that best answers `column op value`: a hash index
+// for equality, otherwise a B+tree. Empty when a scan is needed.
+static std::optional<size_t> choose_index(Table const& t, size_t column, CompareOp op) {
+    std::optional<size_t> best;
+    for (size_t i = 0; i < t.indexes.size(); ++i) {
+        Index const& ix = *t.indexes[i];
+        if (ix.column != column || !ix.supports(op)) continue;
+        if (!best || ix.kind == IndexKind::Hash) best = i;
+    }
+    return best;
+}
+
+// Literal for `meta` parsed from WHERE text
+static Value typed_literal(ColumnMeta const& meta, std::string const& raw) {
+    if (meta.type == ColumnType::Text) return raw;
+    int64_t v{};
+    if (!parse_int64(raw, v)) throw std::runtime_error("Expected integer in WHERE for column " + meta.name);
+    return v;
+}
+
+// Literal for `meta` from a bound parameter value
+static Value bind_literal(ColumnMeta const& meta, std::vector<Value> const& params, size_t param) {
+    if (param >= params.size()) throw std::runtime_error("No value bound for parameter $" + std::to_string(param + 1));
+    Value const& v = params[param];
+    if (auto s = std::get_if<std::string>(&v)) return typed_literal(meta, *s);
+    if (meta.type == ColumnType::Text) return std::to_string(std::get<int64_t>(v));
+    return v;
+}
+
+// Resolve a WHERE node: its columns, the literals typed for them, and the
+// table it reads (-1 when it reads both)
+static SelectPlan::Cond resolve_where(WhereExpr const& e, std::vector<Table const*> const& tables) {
+    SelectPlan::Cond c;
+    c.kind = e.kind;
+    if (!e.children.empty()) {
+        for (auto const& child : e.children) c.children.push_back(resolve_where(child, tables));
+        c.sel = c.children[0].sel;
+        for (auto const& child : c.children) if (child.sel != c.sel) c.sel = -1;
+        return c;
+    }
+    auto [s, idx] = resolve_column(e.cond.column, tables);
+    ColumnMeta const& meta = tables[s]->columns[idx];
+    c.col = {s, idx};
+    c.sel = s;
+    c.op = e.cond.op;
+    auto operand = [&](std::string const& text, std::optional<size_t> param) {
+        return SelectPlan::Cond::Operand{param ? Value{} : typed_literal(meta, text), param};
+    };
+    if (e.kind == WhereExpr::Kind::Compare) c.operands.push_back(operand(e.cond.value, e.cond.param));
+    for (auto const& v : e.values) c.operands.push_back(operand(v.text, v.param));
+    return c;
+}
+
+// a op b as b op' a
+static CompareOp mirrored(CompareOp op) {
+    switch (op) {
+        case CompareOp::Lt: return CompareOp::Gt;
+        case CompareOp::Le: return CompareOp::Ge;
+        case CompareOp::Gt: return CompareOp::Lt;
+        case CompareOp::Ge: return CompareOp::Le;
+        default: return op;
+    }
+}
+
+static CompareOp negated(CompareOp op) {
+    switch (op) {
+        case CompareOp::Eq: return CompareOp::Ne;
+        case CompareOp::Ne: return CompareOp::Eq;
+        case CompareOp::Lt: return CompareOp::Ge;
+        case CompareOp::Le: return CompareOp::Gt;
+        case CompareOp::Gt: return CompareOp::Le;
+        case CompareOp::Ge: return CompareOp::Lt;
+    }
+    return op;
+}
+
+// Compile a resolved WHERE node over table t, binding its parameters
+static Filter compile_filter(SelectPlan::Cond const& c, Table const& t, std::vector<Value> const& params) {
+    using Kind = SelectPlan::Cond::Kind;
+    if (c.kind == Kind::Not && c.children[0].kind == Kind::Compare) {
+        // NOT a < b is a >= b, with no pass over the rows to invert
+        SelectPlan::Cond flipped = c.children[0];
+        flipped.op = negated(flipped.op);
+        return compile_filter(flipped, t, params);
+    }
+    if (!c.children.empty()) {
+        std::vector<Filter> children;
+        for (auto const& child : c.children) children.push_back(compile_filter(child, t, params));
+        auto kind = c.kind == Kind::And ? Filter::Kind::And : c.kind == Kind::Or ? Filter::Kind::Or : Filter::Kind::Not;
+        return Filter::combine(kind, std::move(children));
+    }
+    ColumnMeta const& meta = t.columns[c.col.idx];
+    ColumnData const& col = t.data[c.col.idx];
+    std::vector<Value> values;
+    for (auto const& o : c.operands) values.push_back(o.param ? bind_literal(meta, params, *o.param) : o.literal);
+    if (c.kind == Kind::In) return Filter::leaf(compile_in(col, values));
+    if (c.kind == Kind::Between) return Filter::leaf(compile_between(col, values[0], values[1]));
+    return Filter::leaf(compile_predicate(col, c.op, values[0]));
+}
+
+static std::vector<Table const*> table_ptrs(std::vector<std::shared_ptr<Table const>> const& snaps) {
+    std::vector<Table const*> out;
+    for (auto const& t : snaps) out.push_back(t.get());
+    return out;
+}
+
+std::vector<std::shared_ptr<Table const>> Cursor::snapshot(Database const& db, std::vector<std::string> const& names) {
+    auto snaps = db.snapshot(names);
+    if (!snaps[0]) throw std::runtime_error("Unknown table");
+    for (size_t t = 1; t < snaps.size(); ++t)
+        if (!snaps[t]) throw std::runtime_error("Unknown table in JOIN: " + names[t]);
+    return snaps;
+}
+
+Cursor::Cursor(Database const& db, SelectStmt const& stmt, size_t dop) : dop_(dop) {
+    snaps_ = snapshot(db, stmt.tables());
+    plan_ = plan(table_ptrs(snaps_), stmt);
+    open({});
+}
+
+Cursor::Cursor(Database const& db, std::shared_ptr<SelectPlan const> plan, std::vector<Value> const& params, size_t dop)
+    : plan_(std::move(plan)), snaps_(snapshot(db, plan_->tables)), dop_(dop) {
+    open(params);
+}
+
+// Resolve GROUP BY keys and aggregate arguments; plain columns in the SELECT
+// list must be GROUP BY columns
+static void plan_aggregation(SelectPlan& p, SelectStmt const& stmt, std::vector<Table const*> const& tables) {
+    using ColRef = SelectPlan::ColRef;
+    auto column = [&](std::string const& name) {
+        auto [s, idx] = resolve_column(name, tables);
+        return std::make_pair(ColRef{s, idx}, AggColumn{nullptr, tables[s]->columns[idx].type, s, idx});
+    };
+    std::vector<ColRef> key_refs;
+    for (auto const& name : stmt.group_by) {
+        auto [ref, col] = column(name);
+        key_refs.push_back(ref);
+        p.agg_keys.push_back(col);
+    }
+    for (auto const& item : stmt.items) {
+        p.header.push_back(item.name());
+        if (!item.agg) {
+            auto ref = column(item.column).first;
+            size_t k = 0;
+            while (k < key_refs.size() && !(key_refs[k].sel == ref.sel && key_refs[k].idx == ref.idx)) ++k;
+            if (k == key_refs.size()) throw std::runtime_error("Column " + item.column + " must appear in GROUP BY");
+            p.agg_outputs.push_back({true, k});
+            continue;
+        }
+        std::optional<AggColumn> input;
+        if (!item.column.empty()) {
+            input = column(item.column).second;
+            bool numeric = *item.agg == AggFunc::Sum || *item.agg == AggFunc::Avg;
+            if (numeric && input->type != ColumnType::Int)
+                throw std::runtime_error(std::string(to_string(*item.agg)) + " requires an INT column: " + item.column);
+        }
+        p.agg_outputs.push_back({false, p.aggs.size()});
+        p.aggs.push_back({*item.agg, input});
+    }
+    p.aggregate = true;
+    p.types = HashAggregator(p.agg_keys, p.aggs, p.agg_outputs).output_types();
+}
+
+// ORDER BY keys name output columns (or aggregates in the SELECT list). On a
+// plain SELECT a key column that is not selected is projected as a hidden
+// trailing column that only the sorter sees.
+static void plan_order(SelectPlan& p, SelectStmt const& stmt, std::vector<Table const*> const& tables) {
+    p.row_types = p.types;
+    p.offset = stmt.offset;
+    p.limit = stmt.limit;
+    for (auto const& o : stmt.order_by) {
+        size_t c = 0;
+        if (p.aggregate) {
+            while (c < p.header.size() && p.header[c] != o.item.name()) ++c;
+            if (c == p.header.size()) throw std::runtime_error("ORDER BY " + o.item.name() + " must appear in the SELECT list");
+        } else {
+            if (o.item.agg) throw std::runtime_error("ORDER BY " + o.item.name() + " requires an aggregate query");
+            auto [s, idx] = resolve_column(o.item.column, tables);
+            while (c < p.proj.size() && !(p.proj[c].sel == s && p.proj[c].idx == idx)) ++c;
+            if (c == p.proj.size()) {
+                p.proj.push_back({s, idx});
+                p.row_types.push_back(tables[s]->columns[idx].type);
+            }
+        }
+        p.sort_keys.push_back({c, o.desc});
+    }
+}
+
+std::shared_ptr<SelectPlan const> Cursor::plan(std::vector<Table const*> const& tables, SelectStmt const& stmt) {
+    if (tables.size() > kMaxTables) throw std::runtime_error("A query may join at most " + std::to_string(kMaxTables) + " tables");
+    for (size_t t = 1; t < tables.size(); ++t)
+        for (size_t u = 0; u < t; ++u)
+            if (tables[u]->name == tables[t]->name) throw std::runtime_error("Table " + tables[t]->name + " is joined more than once");
+    bool join = tables.size() > 1;
+    auto p = std::make_shared<SelectPlan>();
+    for (auto t : tables) p->tables.push_back(t->name);
+    auto meta_of = [&](ColRef c) -> ColumnMeta const& { return tables[c.sel]->columns[c.idx]; };
+
+    // Output: aggregates, or a projection where SELECT * over a join emits
+    // qualified headers
+    if (stmt.has_aggregates()) {
+        if (stmt.select_all) throw std::runtime_error("SELECT * cannot be combined with aggregates or GROUP BY");
+        plan_aggregation(*p, stmt, tables);
+    } else if (stmt.select_all) {
+        for (size_t t = 0; t < tables.size(); ++t) {
+            for (size_t i = 0; i < tables[t]->columns.size(); ++i) {
+                p->proj.push_back({static_cast<int>(t), i});
+                p->header.push_back(join ? tables[t]->name + "." + tables[t]->columns[i].name : tables[t]->columns[i].name);
+            }
+        }
+    } else {
+        for (auto const& item : stmt.items) {
+            auto [s, idx] = resolve_column(item.column, tables);
+            p->proj.push_back({s, idx});
+            p->header.push_back(item.column);
+        }
+    }
+    if (!p->aggregate)
+        for (auto const& c : p->proj) p->types.push_back(meta_of(c).type);
+    plan_order(*p, stmt, tables);
+
+    if (stmt.where) {
+        auto root = resolve_where(*stmt.where, tables);
+        if (root.kind == SelectPlan::Cond::Kind::And) p->where = std::move(root.children);
+        else p->where.push_back(std::move(root));
+        for (auto const& c : p->where)
+            if (c.sel < 0) throw std::runtime_error("OR and NOT in the WHERE of a join must stay within one table");
+        // Access path: answer one comparison from an index when one fits,
+        // preferring equality through a hash index
+        int best = -1;
+        for (size_t i = 0; !join && i < p->where.size(); ++i) {
+            auto const& c = p->where[i];
+            if (c.kind != SelectPlan::Cond::Kind::Compare) continue;
+            auto ix = choose_index(*tables[0], c.col.idx, c.op);
+            if (!ix) continue;
+            int rank = c.op != CompareOp::Eq ? 0 : tables[0]->indexes[*ix]->kind == IndexKind::Hash ? 2 : 1;
+            if (rank > best) {
+                best = rank;
+                p->where_index = ix;
+                p->where_indexed = i;
+            }
+        }
+    }
+
+    // JOIN conditions, each oriented as (earlier table) op (joined table);
+    // a column resolves against the tables joined so far
+    for (size_t j = 0; j < stmt.joins.size(); ++j) {
+        auto const& jc = stmt.joins[j];
+        int right = static_cast<int>(j + 1);
+        std::vector<Table const*> visible(tables.begin(), tables.begin() + right + 1);
+        auto [ls, li] = resolve_column(jc.left_col, visible);
+        auto [rs, ri] = resolve_column(jc.right_col, visible);
+        CompareOp op = jc.op;
+        if (ls == right && rs < right) {
+            std::swap(ls, rs);
+            std::swap(li, ri);
+            op = mirrored(op);
+        }
+        if (!(rs == right && ls < right))
+            throw std::runtime_error("JOIN condition must compare a column of " + tables[right]->name + " with one of a table before it");
+        if (meta_of({ls, li}).type != meta_of({rs, ri}).type) throw std::runtime_error("Type mismatch in JOIN columns");
+        p->joins.push_back({{ls, li}, {rs, ri}, op});
+    }
+    return p;
+}
+
+// A WHERE node's parameters all have values
+static bool bound(SelectPlan::Cond const& c, size_t params) {
+    for (auto const& o : c.operands)
+        if (o.param && *o.param >= params) return false;
+    for (auto const& child : c.children)
+        if (!bound(child, params)) return false;
+    return true;
+}
+
+// Selectivity assumed for a WHERE term whose parameters are not known yet
+static constexpr double kUnboundSelectivity = 0.25;
+
+JoinOrder Cursor::join_order(SelectPlan const& p, std::vector<Table const*> const& tables, std::vector<Value> const& params) {
+    JoinGraph g;
+    for (auto t : tables) g.tables.push_back({static_cast<double>(t->row_count), 1});
+    // The same estimates the compiled filters order their terms by
+    for (auto const& c : p.where) {
+        Table const& t = *tables[c.sel];
+        g.tables[c.sel].selectivity *= bound(c, params.size()) ? compile_filter(c, t, params).selectivity : kUnboundSelectivity;
+    }
+    for (auto const& j : p.joins) {
+        Table const& a = *tables[j.left.sel];
+        Table const& b = *tables[j.right.sel];
+        g.edges.push_back({static_cast<size_t>(j.left.sel), static_cast<size_t>(j.right.sel), j.op,
+                           join_selectivity(a.stats[j.left.idx], b.stats[j.right.idx], j.op),
+                           choose_index(a, j.left.idx, CompareOp::Eq), choose_index(b, j.right.idx, CompareOp::Eq)});
+    }
+    return order_joins(g);
+}
+
+// The columns of a join condition as (probe side, inner side), and the
+// operator oriented the same way
+static std::tuple<SelectPlan::ColRef, SelectPlan::ColRef, CompareOp> oriented(SelectPlan::Join const& j, JoinStep const& step) {
+    if (static_cast<size_t>(j.left.sel) == step.probe) return {j.left, j.right, j.op};
+    return {j.right, j.left, mirrored(j.op)};
+}
+
+// Bind the plan to this cursor's snapshots and parameters and assemble the
+// operators. The index lookup and hash join builds run here, once.
+void Cursor::open(std::vector<Value> const& params) {
+    SelectPlan const& p = *plan_;
+    tables_ = table_ptrs(snaps_);
+    ctx_ = std::make_unique<OpContext>();
+    auto source = std::make_unique<RowSource>();
+    source->outer_rows = tables_[0]->row_count;
+
+    // Access path: an index lookup for one WHERE term, or a scan. The other
+    // terms compile into one filter per table, pushed into the scan of the
+    // outer table or run once the table is joined in.
+    std::unique_ptr<RowOperator> lookup;
+    std::vector<Filter> terms[kMaxTables];
+    for (size_t i = 0; i < p.where.size(); ++i) {
+        auto const& c = p.where[i];
+        Table const& wt = *tables_[c.sel];
+        if (p.where_index && i == p.where_indexed) {
+            auto const& o = c.operands[0];
+            Value literal = o.param ? bind_literal(wt.columns[c.col.idx], params, *o.param) : o.literal;
+            lookup = std::make_unique<IndexLookupOp>(*ctx_, 0, *wt.indexes[*p.where_index], c.op, literal, wt.row_count);
+        } else {
+            terms[c.sel].push_back(compile_filter(c, wt, params));
+        }
+    }
+    for (size_t t = 0; t < tables_.size(); ++t)
+        if (!terms[t].empty()) source->where[t] = Filter::combine(Filter::Kind::And, std::move(terms[t]));
+
+    if (!p.joins.empty()) {
+        order_ = join_order(p, tables_, params);
+        source->outer_table = order_.outer;
+        source->outer_rows = tables_[order_.outer]->row_count;
+        for (auto const& step : order_.steps) {
+            auto [probe, inner, op] = oriented(p.joins[step.edge], step);
+            Table const& it = *tables_[inner.sel];
+            source->joins.push_back({step.probe, step.inner,
+                                     JoinMatcher(step.algo, op, tables_[probe.sel]->data[probe.idx], it.data[inner.idx], it.row_count)});
+        }
+        // Matchers are only read from here on, and stay in place
+        for (size_t k = 0; k < order_.steps.size(); ++k) {
+            auto const& step = order_.steps[k];
+            auto& matcher = source->joins[k].matcher;
+            Table const& it = *tables_[step.inner];
+            if (step.algo == JoinAlgo::IndexNestedLoop) matcher.use_index(*it.indexes[*step.index]);
+            if (step.algo == JoinAlgo::Hash) {
+                OperatorStats& st = ctx_->stats.join_build[step.inner];
+                OpTimer t(&st.ns);
+                st.rows_in = st.rows_out = it.row_count;
+                matcher.build(dop_);
+            }
+        }
+    }
+
+    if (dop_ > 1 && (lookup || (p.limit && p.sort_keys.empty()) || source->morsels() <= 1)) dop_ = 1;
+    auto rows = [&]() -> std::unique_ptr<RowOperator> {
+        if (!lookup) return source->build(*ctx_, 0, source->outer_rows);
+        if (!source->where[0]) return std::move(lookup);
+        return std::make_unique<FilterOp>(*ctx_, std::move(lookup), *source->where[0], 0);
+    };
+    std::unique_ptr<BatchOperator> op;
+    if (p.aggregate) {
+        auto bind = [&](AggColumn c) { c.data = &tables_[c.sel]->data[c.idx]; return c; };
+        std::vector<AggColumn> keys;
+        for (auto const& k : p.agg_keys) keys.push_back(bind(k));
+        std::vector<HashAggregator::Aggregate> aggs = p.aggs;
+        for (auto& a : aggs) if (a.input) a.input = bind(*a.input);
+        HashAggregator agg(std::move(keys), std::move(aggs), p.agg_outputs);
+        if (dop_ > 1) op = std::make_unique<AggregateOp>(*ctx_, *source, dop_, std::move(agg));
+        else op = std::make_unique<AggregateOp>(*ctx_, rows(), std::move(agg));
+    } else {
+        Projection proj{{}, &p.row_types};
+        for (auto const& c : p.proj) proj.columns.push_back({static_cast<size_t>(c.sel), &tables_[c.sel]->data[c.idx]});
+        if (dop_ > 1) op = std::make_unique<MorselProjectOp>(*ctx_, *source, std::move(proj), dop_);
+        else op = std::make_unique<ProjectOp>(*ctx_, rows(), std::move(proj));
+    }
+    if (!p.sort_keys.empty())
+        op = std::make_unique<SortOp>(*ctx_, std::move(op), Sorter(p.row_types, p.sort_keys, p.types.size(), p.offset, p.limit));
+    else if (p.limit || p.offset)
+        op = std::make_unique<LimitOp>(*ctx_, std::move(op), p.offset, p.limit);
+    root_ = std::move(op);
+    source_ = std::move(source);
+}
+
+void Cursor::set_profiling(bool on) {
+    ctx_->profile = on;
+    if (!on) return;
+    auto row_bytes = [](ColumnData const& col, size_t rows) {
+        return rows ? static_cast<double>(memory_stats(col).bytes) / static_cast<double>(rows) : 0.0;
+    };
+    // Every column the filters on a table read, once
+    std::vector<size_t> read[kMaxTables];
+    auto collect = [&](auto& self, SelectPlan::Cond const& c) -> void {
+        auto& cols = read[c.col.sel];
+        if (c.children.empty() && std::find(cols.begin(), cols.end(), c.col.idx) == cols.end()) cols.push_back(c.col.idx);
+        for (auto const& child : c.children) self(self, child);
+    };
+    for (size_t i = 0; i < plan_->where.size(); ++i)
+        if (!(plan_->where_index && i == plan_->where_indexed)) collect(collect, plan_->where[i]);
+    for (size_t t = 0; t < tables_.size(); ++t) {
+        ctx_->where_row_bytes[t] = 0;
+        for (size_t idx : read[t]) ctx_->where_row_bytes[t] += row_bytes(tables_[t]->data[idx], tables_[t]->row_count);
+    }
+    for (auto const& step : order_.steps) {
+        auto probe = std::get<0>(oriented(plan_->joins[step.edge], step));
+        Table const& pt = *tables_[probe.sel];
+        ctx_->probe_row_bytes[step.inner] = row_bytes(pt.data[probe.idx], pt.row_count);
+    }
+}
+
+CursorStats Cursor::stats() const {
+    CursorStats s = ctx_->stats;
+    root_->report(s);
+    for (size_t k = 0; k < order_.steps.size(); ++k) {
+        auto const& step = order_.steps[k];
+        if (step.algo != JoinAlgo::Hash) continue;
+        auto inner = std::get<1>(oriented(plan_->joins[step.edge], step));
+        s.join_build[step.inner].bytes = memory_stats(tables_[step.inner]->data[inner.idx]).bytes;
+        s.join_build[step.inner].peak_bytes = source_->joins[k].matcher.footprint();
+    }
+    return s;
+}
+
+} // namespace inmemdb
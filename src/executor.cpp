@@ -15,7 +15,7 @@ QueryResult Executor::execute(Statement const& stmt) {
     if (stmt.index() == 1) { // InsertStmt
         auto const& s = std::get<1>(stmt);
         QueryResult qr; qr.header = {}; qr.success = true;
-        try { db_.insert_row(s); qr.message = "1 row inserted"; }
+        try { db_.insert_row(s); qr.message = s.rows == 1 ? "1 row inserted" : std::to_string(s.rows) + " rows inserted"; }
         catch (std::exception const& ex) { qr.success = false; qr.message = ex.what(); }
         return qr;
     }
@@ -23,7 +23,67 @@ QueryResult Executor::execute(Statement const& stmt) {
         auto const& s = std::get<2>(stmt);
         return db_.select_rows(s);
     }
+    if (stmt.index() == 3) { // CreateIndexStmt
+        auto const& s = std::get<3>(stmt);
+        QueryResult qr; qr.header = {}; qr.success = true;
+        try { db_.create_index(s); qr.message = "Index created"; }
+        catch (std::exception const& ex) { qr.success = false; qr.message = ex.what(); }
+        return qr;
+    }
+    if (stmt.index() == 4) { // SnapshotStmt
+        auto const& s = std::get<4>(stmt);
+        QueryResult qr; qr.header = {}; qr.success = true;
+        try { db_.save_snapshot(s.path); qr.message = "Snapshot written to " + s.path; }
+        catch (std::exception const& ex) { qr.success = false; qr.message = ex.what(); }
+        return qr;
+    }
+    if (stmt.index() == 5) { // CopyStmt
+        auto const& s = std::get<5>(stmt);
+        QueryResult qr; qr.header = {}; qr.success = true;
+        try { qr.message = std::to_string(db_.copy_from(s)) + " row(s) copied"; }
+        catch (std::exception const& ex) { qr.success = false; qr.message = ex.what(); }
+        return qr;
+    }
+    if (stmt.index() == 6) { // PrepareStmt
+        auto const& s = std::get<6>(stmt);
+        QueryResult qr; qr.header = {}; qr.success = true;
+        try { prepared_[s.name] = db_.prepare(s.sql); qr.message = "Statement prepared"; }
+        catch (std::exception const& ex) { qr.success = false; qr.message = ex.what(); }
+        return qr;
+    }
+    if (stmt.index() == 7) { // ExecuteStmt
+        auto const& s = std::get<7>(stmt);
+        auto it = prepared_.find(s.name);
+        if (it == prepared_.end()) {
+            QueryResult qr; qr.success = false; qr.message = "Unknown prepared statement: " + s.name;
+            return qr;
+        }
+        return execute(*it->second, std::vector<Value>(s.values.begin(), s.values.end()));
+    }
+    if (stmt.index() == 8) { // ExplainStmt
+        auto const& s = std::get<8>(stmt);
+        return db_.explain(s);
+    }
     return {};
 }
 
+QueryResult Executor::execute(PreparedStatement const& stmt, std::vector<Value> const& params) {
+    if (params.size() < stmt.params) {
+        QueryResult qr; qr.success = false;
+        qr.message = "Expected " + std::to_string(stmt.params) + " parameter(s), got " + std::to_string(params.size());
+        return qr;
+    }
+    if (stmt.stmt.index() == 2) return db_.select_rows(stmt, params);
+    if (stmt.stmt.index() == 1) { // InsertStmt: substitute the placeholders
+        InsertStmt bound = std::get<1>(stmt.stmt);
+        for (auto const& [value, param] : bound.params) {
+            Value const& v = params[param];
+            bound.values[value] = v.index() == 0 ? std::to_string(std::get<int64_t>(v)) : std::get<std::string>(v);
+        }
+        bound.params.clear();
+        return execute(Statement(std::move(bound)));
+    }
+    return execute(stmt.stmt);
+}
+
 } // namespace inmemdb
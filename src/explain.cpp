@@ -0,0 +1,259 @@
+#include "inmemdb/storage.hpp"
+#include "inmemdb/lexer.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+// EXPLAIN [ANALYZE]: the operator tree of a SelectPlan, root first, with the
+// counters of a profiled cursor run when analyzing
+
+namespace inmemdb {
+
+using Clock = std::chrono::steady_clock;
+
+static double ms_since(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+static std::string fixed3(double v) {
+    char buf[32];
+    std::snprintf(buf, sizeof buf, "%.3f", v);
+    return buf;
+}
+
+namespace {
+
+class PlanWriter {
+public:
+    PlanWriter(SelectPlan const& p, std::vector<Table const*> tables, JoinOrder const& order, CursorStats const* stats)
+        : p_(p), tables_(std::move(tables)), order_(order), stats_(stats) {}
+
+    std::vector<OperatorProfile> describe() {
+        size_t depth = 0;
+        if (!p_.sort_keys.empty()) {
+            std::string keys;
+            for (auto const& k : p_.sort_keys) {
+                if (!keys.empty()) keys += ", ";
+                keys += k.column < p_.header.size() ? p_.header[k.column] : column(p_.proj[k.column]);
+                if (k.desc) keys += " DESC";
+            }
+            // With a LIMIT only the best offset + limit rows are kept
+            if (p_.limit) keys += limit_text() + ", top-" + std::to_string(top_k_bound(p_.offset, *p_.limit)) + " heap";
+            else keys += limit_text();
+            add("Sort", keys, depth++, stats_ ? &stats_->sort : nullptr);
+        } else if (p_.limit || p_.offset) {
+            add("Limit", limit_text().substr(2), depth++, stats_ ? &stats_->limit : nullptr);
+        }
+        if (p_.aggregate) {
+            std::string keys;
+            for (auto const& k : p_.agg_keys) keys += (keys.empty() ? "GROUP BY " : ", ") + column({k.sel, k.idx});
+            add("Aggregate", (keys.empty() ? "" : keys + ": ") + join(p_.header), depth++, stats_ ? &stats_->aggregate : nullptr);
+        } else {
+            add("Project", join(p_.header), depth++, stats_ ? &stats_->project : nullptr);
+        }
+        if (p_.joins.empty()) access(0, depth);
+        else pipeline(order_.steps.size(), depth);
+        return std::move(ops_);
+    }
+
+private:
+    // The row pipeline through its first k join steps: step k - 1 over the
+    // steps before it and, for a hash join, the build of its inner table. A
+    // WHERE on the inner table filters the tuples the step produces.
+    void pipeline(size_t k, size_t depth) {
+        if (k == 0) {
+            access(static_cast<int>(order_.outer), depth);
+            return;
+        }
+        auto const& step = order_.steps[k - 1];
+        size_t inner = step.inner;
+        std::string where = where_text(static_cast<int>(inner));
+        if (!where.empty()) add("Filter", where, depth++, stats_ ? &stats_->filter[inner] : nullptr);
+        auto const& j = p_.joins[step.edge];
+        Table const& it = *tables_[inner];
+        std::string cond = column(j.left) + " " + to_string(j.op) + " " + column(j.right);
+        std::string est = ", est. " + std::to_string(std::llround(step.rows)) + " rows";
+        OperatorStats const* join_stats = stats_ ? &stats_->join[inner] : nullptr;
+        switch (step.algo) {
+            case SelectPlan::JoinAlgo::Hash:
+                add("HashJoin", cond + ", build " + it.name + est, depth, join_stats);
+                break;
+            case SelectPlan::JoinAlgo::IndexNestedLoop:
+                add("IndexNestedLoopJoin", cond + ", probe index " + it.indexes[*step.index]->name + " on " + it.name + est, depth, join_stats);
+                break;
+            default:
+                add("NestedLoopJoin", cond + ", scan " + it.name + " per outer row" + est, depth, join_stats);
+                break;
+        }
+        pipeline(k - 1, depth + 1);
+        if (step.algo == SelectPlan::JoinAlgo::Hash) {
+            auto key = static_cast<size_t>(j.left.sel) == inner ? j.left : j.right;
+            add("HashBuild", column(key) + ", " + std::to_string(it.row_count) + " rows", depth + 1,
+                stats_ ? &stats_->join_build[inner] : nullptr);
+        }
+    }
+
+    // How rows of one table are read: index lookup, or scan under an optional filter
+    void access(int sel, size_t depth) {
+        Table const& t = *tables_[sel];
+        std::string where = where_text(sel);
+        if (!where.empty()) add("Filter", where, depth++, stats_ ? &stats_->filter[sel] : nullptr);
+        if (p_.where_index) {
+            Index const& ix = *t.indexes[*p_.where_index];
+            add("IndexLookup", ix.name + " (" + (ix.kind == IndexKind::Hash ? "hash" : "btree") + ") " + cond_text(p_.where[p_.where_indexed]),
+                depth, stats_ ? &stats_->index : nullptr);
+            return;
+        }
+        add("Scan", table(t), depth, stats_ ? &stats_->scan : nullptr);
+        if (stats_) ops_.back().rows_in = ops_.back().rows_out;
+    }
+
+    void add(std::string name, std::string detail, size_t depth, OperatorStats const* st) {
+        OperatorProfile op{std::move(name), std::move(detail), depth};
+        if (st) {
+            op.ms = static_cast<double>(st->ns) / 1e6;
+            op.rows_in = st->rows_in;
+            op.rows_out = st->rows_out;
+            op.bytes = st->bytes;
+            op.peak_bytes = st->peak_bytes;
+        }
+        ops_.push_back(std::move(op));
+    }
+
+    std::string column(SelectPlan::ColRef c) const {
+        Table const& t = *tables_[c.sel];
+        return tables_.size() > 1 ? t.name + "." + t.columns[c.idx].name : t.columns[c.idx].name;
+    }
+    static std::string table(Table const& t) { return t.name + ", " + std::to_string(t.row_count) + " rows"; }
+    static std::string join(std::vector<std::string> const& names) {
+        std::string s;
+        for (auto const& n : names) s += (s.empty() ? "" : ", ") + n;
+        return s;
+    }
+    // The WHERE terms a filter on one table runs, as written
+    std::string where_text(int sel) const {
+        std::vector<SelectPlan::Cond const*> terms;
+        for (size_t i = 0; i < p_.where.size(); ++i)
+            if (p_.where[i].sel == sel && !(p_.where_index && i == p_.where_indexed)) terms.push_back(&p_.where[i]);
+        std::string s;
+        for (auto c : terms) s += (s.empty() ? "" : " AND ") + cond_text(*c, terms.size() > 1);
+        return s;
+    }
+    // One WHERE node; an OR is parenthesized when `in_and`
+    std::string cond_text(SelectPlan::Cond const& c, bool in_and = false) const {
+        using Kind = SelectPlan::Cond::Kind;
+        auto operand = [](SelectPlan::Cond::Operand const& o) {
+            if (o.param) return "$" + std::to_string(*o.param + 1);
+            if (auto i = std::get_if<int64_t>(&o.literal)) return std::to_string(*i);
+            return "'" + std::get<std::string>(o.literal) + "'";
+        };
+        switch (c.kind) {
+            case Kind::Compare: return column(c.col) + " " + to_string(c.op) + " " + operand(c.operands[0]);
+            case Kind::Between: return column(c.col) + " BETWEEN " + operand(c.operands[0]) + " AND " + operand(c.operands[1]);
+            case Kind::In: {
+                std::string s = column(c.col) + " IN (";
+                for (size_t i = 0; i < c.operands.size(); ++i) s += (i ? ", " : "") + operand(c.operands[i]);
+                return s + ")";
+            }
+            case Kind::Not: {
+                auto const& child = c.children[0];
+                return "NOT " + (child.children.empty() ? cond_text(child) : "(" + cond_text(child) + ")");
+            }
+            default: {
+                bool all = c.kind == Kind::And;
+                std::string s;
+                for (auto const& child : c.children) s += (s.empty() ? "" : all ? " AND " : " OR ") + cond_text(child, all);
+                return all || !in_and ? s : "(" + s + ")";
+            }
+        }
+    }
+    std::string limit_text() const {
+        std::string s;
+        if (p_.limit) s += ", LIMIT " + std::to_string(*p_.limit);
+        if (p_.offset) s += ", OFFSET " + std::to_string(p_.offset);
+        return s;
+    }
+
+    SelectPlan const& p_;
+    std::vector<Table const*> tables_;
+    JoinOrder const& order_;
+    CursorStats const* stats_;
+    std::vector<OperatorProfile> ops_;
+};
+
+} // namespace
+
+QueryResult Database::explain(ExplainStmt const& stmt, size_t dop) const {
+    QueryResult qr;
+    try {
+        QueryProfile prof;
+        prof.analyzed = stmt.analyze;
+        if (stmt.analyze && !stmt.sql.empty()) {
+            // Lexing alone, then a full parse, which lexes as it goes
+            auto t0 = Clock::now();
+            Lexer lex(stmt.sql);
+            while (lex.next().type != TokenType::End) {}
+            prof.lex_ms = ms_since(t0);
+            auto t1 = Clock::now();
+            Parser(Lexer(stmt.sql)).parse_all();
+            prof.parse_ms = std::max(0.0, ms_since(t1) - prof.lex_ms);
+        }
+
+        SelectStmt const& sel = stmt.select;
+        auto snaps = Cursor::snapshot(*this, sel.tables());
+        std::vector<Table const*> tables;
+        for (auto const& t : snaps) tables.push_back(t.get());
+        auto t0 = Clock::now();
+        auto plan = Cursor::plan(tables, sel);
+        prof.plan_ms = ms_since(t0);
+
+        CursorStats stats;
+        JoinOrder order;
+        if (!plan->joins.empty() && !stmt.analyze) order = Cursor::join_order(*plan, tables, {});
+        if (stmt.analyze) {
+            auto t1 = Clock::now();
+            Cursor cur(*this, plan, {}, dop ? dop : parallelism_);
+            cur.set_profiling(true);
+            Batch batch;
+            while (cur.next(batch)) prof.rows += batch.rows;
+            prof.execute_ms = ms_since(t1);
+            stats = cur.stats();
+            order = cur.join_order();
+        }
+        prof.operators = PlanWriter(*plan, tables, order, stmt.analyze ? &stats : nullptr).describe();
+
+        // Rendering for row-oriented clients: the tree as indented lines,
+        // plus the measurements and stage times with ANALYZE
+        auto line = [](OperatorProfile const& op) {
+            std::string s(2 * op.depth, ' ');
+            if (op.depth) s += "-> ";
+            s += op.name;
+            if (!op.detail.empty()) s += " (" + op.detail + ")";
+            return s;
+        };
+        if (!stmt.analyze) {
+            qr.header = {"QUERY PLAN"};
+            for (auto const& op : prof.operators) qr.rows.push_back({line(op)});
+            qr.message = std::to_string(prof.operators.size()) + " operator(s)";
+        } else {
+            qr.header = {"operator", "ms", "rows_in", "rows_out", "bytes", "peak_bytes"};
+            for (auto const& op : prof.operators) {
+                qr.rows.push_back({line(op), fixed3(op.ms), std::to_string(op.rows_in), std::to_string(op.rows_out),
+                                   std::to_string(op.bytes), std::to_string(op.peak_bytes)});
+            }
+            qr.rows.push_back({"Lex", fixed3(prof.lex_ms), "", "", "", ""});
+            qr.rows.push_back({"Parse", fixed3(prof.parse_ms), "", "", "", ""});
+            qr.rows.push_back({"Plan", fixed3(prof.plan_ms), "", "", "", ""});
+            qr.rows.push_back({"Execute", fixed3(prof.execute_ms), "", std::to_string(prof.rows), "", ""});
+            qr.message = std::to_string(prof.rows) + " row(s) returned";
+        }
+        qr.profile = std::move(prof);
+    } catch (std::exception const& ex) {
+        qr = QueryResult{};
+        qr.success = false;
+        qr.message = ex.what();
+    }
+    return qr;
+}
+
+} // namespace inmemdb
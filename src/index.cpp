@@ -0,0 +1,80 @@
+#include "inmemdb/index.hpp"
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+namespace inmemdb {
+
+static IndexData make_index_data(IndexKind kind, ColumnType type, std::pmr::memory_resource* mr) {
+    if (kind == IndexKind::Hash) {
+        if (type == ColumnType::Int) return HashIndex<int64_t>(mr);
+        return HashIndex<std::pmr::string>(mr);
+    }
+    if (type == ColumnType::Int) return BPlusTree<int64_t>(mr);
+    return BPlusTree<std::pmr::string>(mr);
+}
+
+Index::Index(std::string n, size_t col, IndexKind k, ColumnType type)
+    : name(std::move(n)), column(col), kind(k), data(make_index_data(k, type, arena.resource())) {}
+
+void Index::insert(ColumnData const& col, size_t row) {
+    std::unique_lock<std::shared_mutex> lock(mu);
+    if (auto h = std::get_if<HashIndex<int64_t>>(&data)) {
+        h->map[std::get<IntColumn>(col).at(row)].push_back(row);
+    } else if (auto h = std::get_if<HashIndex<std::pmr::string>>(&data)) {
+        // Build the arena copy of the key only when it is new
+        std::string_view key = text_at(col, row);
+        auto it = h->map.find(key);
+        if (it == h->map.end()) it = h->map.try_emplace(std::pmr::string(key, h->map.get_allocator())).first;
+        it->second.push_back(row);
+    } else if (auto t = std::get_if<BPlusTree<int64_t>>(&data)) {
+        t->insert(std::get<IntColumn>(col).at(row), row);
+    } else {
+        std::get<BPlusTree<std::pmr::string>>(data).insert(std::pmr::string(text_at(col, row)), row);
+    }
+}
+bool Index::supports(CompareOp op) const {
+    if (op == CompareOp::Eq) return true;
+    return kind == IndexKind::BTree && op != CompareOp::Ne;
+}
+
+template <typename K, typename Q>
+static void hash_lookup(HashIndex<K> const& h, Q const& key, std::vector<size_t>& out, size_t visible) {
+    auto it = h.map.find(key);
+    if (it == h.map.end()) return;
+    // Row lists are in insertion order, so the visible rows are a prefix
+    auto const& rows = it->second;
+    out.insert(out.end(), rows.begin(), std::lower_bound(rows.begin(), rows.end(), visible));
+}
+
+template <typename K, typename Q>
+static void tree_lookup(BPlusTree<K> const& t, CompareOp op, Q const& key, std::vector<size_t>& out, size_t visible) {
+    auto add = [&](size_t row) { if (row < visible) out.push_back(row); };
+    switch (op) {
+        case CompareOp::Eq: t.scan(&key, true, &key, true, add); break;
+        case CompareOp::Lt: t.template scan<Q>(nullptr, false, &key, false, add); break;
+        case CompareOp::Le: t.template scan<Q>(nullptr, false, &key, true, add); break;
+        case CompareOp::Gt: t.template scan<Q>(&key, false, nullptr, false, add); break;
+        case CompareOp::Ge: t.template scan<Q>(&key, true, nullptr, false, add); break;
+        case CompareOp::Ne: throw std::runtime_error("Unsupported operator for index");
+    }
+}
+
+void Index::lookup(CompareOp op, Value const& value, std::vector<size_t>& out, size_t visible) const {
+    if (!supports(op)) throw std::runtime_error("Index " + name + " cannot answer " + to_string(op));
+    std::shared_lock<std::shared_mutex> lock(mu);
+    if (auto h = std::get_if<HashIndex<int64_t>>(&data)) hash_lookup(*h, std::get<int64_t>(value), out, visible);
+    else if (auto h = std::get_if<HashIndex<std::pmr::string>>(&data)) hash_lookup(*h, std::string_view(std::get<std::string>(value)), out, visible);
+    else if (auto t = std::get_if<BPlusTree<int64_t>>(&data)) tree_lookup(*t, op, std::get<int64_t>(value), out, visible);
+    else tree_lookup(std::get<BPlusTree<std::pmr::string>>(data), op, std::string_view(std::get<std::string>(value)), out, visible);
+}
+
+void Index::probe(ColumnData const& col, size_t row, std::vector<size_t>& out, size_t visible) const {
+    std::shared_lock<std::shared_mutex> lock(mu);
+    if (auto h = std::get_if<HashIndex<int64_t>>(&data)) hash_lookup(*h, std::get<IntColumn>(col).at(row), out, visible);
+    else if (auto h = std::get_if<HashIndex<std::pmr::string>>(&data)) hash_lookup(*h, text_at(col, row), out, visible);
+    else if (auto t = std::get_if<BPlusTree<int64_t>>(&data)) tree_lookup(*t, CompareOp::Eq, std::get<IntColumn>(col).at(row), out, visible);
+    else tree_lookup(std::get<BPlusTree<std::pmr::string>>(data), CompareOp::Eq, text_at(col, row), out, visible);
+}
+
+} // namespace inmemdb
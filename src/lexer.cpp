@@ -1,7 +1,7 @@
 #include "inmemdb/lexer.hpp"
 #include <cctype>
+#include <iterator>
 #include <stdexcept>
-#include <unordered_map>
 
 namespace inmemdb {
 
@@ -12,36 +12,84 @@ void Lexer::skip_ws() {
     while (pos_ < input_.size() && std::isspace(static_cast<unsigned char>(input_[pos_]))) ++pos_;
 }
 
+namespace {
+
+struct Keyword {
+    std::string_view text; // upper case
+    TokenType type;
+};
+
+constexpr Keyword kKeywords2[] = {
+    {"ON", TokenType::KeywordOn}, {"BY", TokenType::KeywordBy}, {"TO", TokenType::KeywordTo}, {"AS", TokenType::KeywordAs},
+    {"OR", TokenType::KeywordOr}, {"IN", TokenType::KeywordIn}};
+constexpr Keyword kKeywords3[] = {
+    {"INT", TokenType::KeywordInt}, {"SUM", TokenType::KeywordSum}, {"MIN", TokenType::KeywordMin},
+    {"MAX", TokenType::KeywordMax}, {"AVG", TokenType::KeywordAvg}, {"ASC", TokenType::KeywordAsc},
+    {"AND", TokenType::KeywordAnd}, {"NOT", TokenType::KeywordNot}};
+constexpr Keyword kKeywords4[] = {
+    {"INTO", TokenType::KeywordInto}, {"FROM", TokenType::KeywordFrom}, {"TEXT", TokenType::KeywordText},
+    {"JOIN", TokenType::KeywordJoin}, {"HASH", TokenType::KeywordHash}, {"DICT", TokenType::KeywordDict},
+    {"DESC", TokenType::KeywordDesc}, {"COPY", TokenType::KeywordCopy}};
+constexpr Keyword kKeywords5[] = {
+    {"TABLE", TokenType::KeywordTable}, {"WHERE", TokenType::KeywordWhere}, {"INNER", TokenType::KeywordInner},
+    {"INDEX", TokenType::KeywordIndex}, {"USING", TokenType::KeywordUsing}, {"BTREE", TokenType::KeywordBtree},
+    {"GROUP", TokenType::KeywordGroup}, {"COUNT", TokenType::KeywordCount}, {"ORDER", TokenType::KeywordOrder},
+    {"LIMIT", TokenType::KeywordLimit}};
+constexpr Keyword kKeywords6[] = {
+    {"CREATE", TokenType::KeywordCreate}, {"INSERT", TokenType::KeywordInsert}, {"VALUES", TokenType::KeywordValues},
+    {"SELECT", TokenType::KeywordSelect}, {"OFFSET", TokenType::KeywordOffset}, {"HEADER", TokenType::KeywordHeader}};
+constexpr Keyword kKeywords7[] = {
+    {"PREPARE", TokenType::KeywordPrepare}, {"EXECUTE", TokenType::KeywordExecute},
+    {"EXPLAIN", TokenType::KeywordExplain}, {"ANALYZE", TokenType::KeywordAnalyze}, {"BETWEEN", TokenType::KeywordBetween}};
+constexpr Keyword kKeywords8[] = {{"SNAPSHOT", TokenType::KeywordSnapshot}};
+
+// Keyword for `word` in any case, or Identifier; candidates are picked by
+// length and compared in place, so nothing is allocated
+TokenType keyword_type(std::string_view word) {
+    Keyword const* begin;
+    Keyword const* end;
+    switch (word.size()) {
+        case 2: begin = std::begin(kKeywords2); end = std::end(kKeywords2); break;
+        case 3: begin = std::begin(kKeywords3); end = std::end(kKeywords3); break;
+        case 4: begin = std::begin(kKeywords4); end = std::end(kKeywords4); break;
+        case 5: begin = std::begin(kKeywords5); end = std::end(kKeywords5); break;
+        case 6: begin = std::begin(kKeywords6); end = std::end(kKeywords6); break;
+        case 7: begin = std::begin(kKeywords7); end = std::end(kKeywords7); break;
+        case 8: begin = std::begin(kKeywords8); end = std::end(kKeywords8); break;
+        default: return TokenType::Identifier;
+    }
+    for (auto k = begin; k != end; ++k) {
+        size_t i = 0;
+        // ASCII upper-casing: clearing bit 5 maps a-z to A-Z, and no keyword has a digit or '_'
+        while (i < word.size() && (word[i] & ~0x20) == k->text[i]) ++i;
+        if (i == word.size()) return k->type;
+    }
+    return TokenType::Identifier;
+}
+
+} // namespace
+
 // Make identifier or keyword
 Token Lexer::make_identifier_or_keyword(std::size_t start) {
     while (pos_ < input_.size() && (std::isalnum(static_cast<unsigned char>(input_[pos_])) || input_[pos_] == '_')) ++pos_;
-    std::string text = input_.substr(start, pos_ - start);
-    std::string upper;
-    upper.reserve(text.size());
-
-    for(char c: text) upper.push_back(static_cast<char>(std::toupper(static_cast<unsigned char>(c))));
-    static const std::unordered_map<std::string, TokenType> keywords = {
-        {"CREATE", TokenType::KeywordCreate}, {"TABLE", TokenType::KeywordTable},
-        {"INSERT", TokenType::KeywordInsert}, {"INTO", TokenType::KeywordInto},
-        {"VALUES", TokenType::KeywordValues}, {"SELECT", TokenType::KeywordSelect},
-        {"FROM", TokenType::KeywordFrom}, {"WHERE", TokenType::KeywordWhere},
-        {"INT", TokenType::KeywordInt}, {"TEXT", TokenType::KeywordText},
-        {"JOIN", TokenType::KeywordJoin}, {"INNER", TokenType::KeywordInner}, {"ON", TokenType::KeywordOn}
-    };
-    auto it = keywords.find(upper);
-    if (it != keywords.end()) return {it->second, upper, start};
-    return {TokenType::Identifier, text, start};
+    std::string_view text(input_.data() + start, pos_ - start);
+    return {keyword_type(text), text, start};
 }
 
 // Number parsing
 Token Lexer::make_number(std::size_t start) {
     while (pos_ < input_.size() && std::isdigit(static_cast<unsigned char>(input_[pos_]))) ++pos_;
-    return {TokenType::Integer, input_.substr(start, pos_ - start), start};
+    return {TokenType::Integer, std::string_view(input_.data() + start, pos_ - start), start};
 }
 
-// String parsing
+// String parsing: a literal without escapes is a view into the input
 Token Lexer::make_string(std::size_t start) {
-    std::string out;
+    size_t begin = pos_;
+    while (pos_ < input_.size() && input_[pos_] != '\'' && input_[pos_] != '\\') ++pos_;
+    if (pos_ >= input_.size()) throw std::runtime_error("Unterminated string literal");
+    if (input_[pos_] == '\'') return {TokenType::String, std::string_view(input_.data() + begin, pos_++ - begin), start};
+
+    std::string out(input_, begin, pos_ - begin);
     while (pos_ < input_.size()) {
         char c = input_[pos_++];
         if (c == '\\') {
@@ -55,7 +103,7 @@ Token Lexer::make_string(std::size_t start) {
                 default: out.push_back(e); break;
             }
         } else if (c == '\'') {
-            return {TokenType::String, out, start};
+            return {TokenType::String, unescaped_.emplace_back(std::move(out)), start};
         } else {
             out.push_back(c);
         }
@@ -90,6 +138,14 @@ Token Lexer::next() {
             return {TokenType::Greater, ">", start};
         case '\'':
             return make_string(start);
+        case '?':
+            return {TokenType::Parameter, "", start};
+        case '$': {
+            size_t digits = pos_;
+            while (pos_ < input_.size() && std::isdigit(static_cast<unsigned char>(input_[pos_]))) ++pos_;
+            if (pos_ == digits) throw std::runtime_error("Expected parameter number after '$'");
+            return {TokenType::Parameter, std::string_view(input_.data() + digits, pos_ - digits), start};
+        }
     }
     // Check for identifier or number
     if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') return make_identifier_or_keyword(start);
@@ -1,12 +1,80 @@
+#include <cstring>
 #include <iostream>
+#include <string>
 #include "inmemdb/lexer.hpp"
 #include "inmemdb/parser.hpp"
 #include "inmemdb/executor.hpp"
 
-int main() {
-    using namespace inmemdb;
+using namespace inmemdb;
+
+// Stream a SELECT batch by batch; cells are only formatted here
+static void print_select(Database const& db, SelectStmt const& stmt) {
+    Cursor cur = db.open_cursor(stmt);
+    auto const& header = cur.header();
+    for (size_t i = 0; i < header.size(); ++i) {
+        if (i) std::cout << '\t';
+        std::cout << header[i];
+    }
+    std::cout << "\n";
+    size_t total = 0;
+    Batch batch;
+    while (cur.next(batch)) {
+        for (size_t r = 0; r < batch.rows; ++r) {
+            for (size_t i = 0; i < batch.columns.size(); ++i) {
+                if (i) std::cout << '\t';
+                auto const& col = batch.columns[i];
+                if (col.type == ColumnType::Int) std::cout << col.int_at(r);
+                else if (col.type == ColumnType::Real) std::cout << col.real_at(r);
+                else std::cout << col.text_at(r);
+            }
+            std::cout << "\n";
+        }
+        total += batch.rows;
+    }
+    std::cout << total << " row(s).\n";
+}
+
+static void usage(char const* prog) {
+    std::cerr << "usage: " << prog << " [--load SNAPSHOT] [--wal PATH] [--sync every|group|os] [--group-us N] [--group-records N]\n";
+}
+
+int main(int argc, char** argv) {
+    WalOptions wal;
+    std::string snapshot;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) { usage(argv[0]); return 2; }
+        std::string val = argv[++i];
+        if (arg == "--load") snapshot = val;
+        else if (arg == "--wal") wal.path = val;
+        else if (arg == "--sync" && val == "every") wal.sync = SyncPolicy::EveryCommit;
+        else if (arg == "--sync" && val == "group") wal.sync = SyncPolicy::Group;
+        else if (arg == "--sync" && val == "os") wal.sync = SyncPolicy::OsBuffered;
+        else if (arg == "--group-us") wal.group_window = std::chrono::microseconds(std::stoll(val));
+        else if (arg == "--group-records") wal.group_records = std::stoull(val);
+        else { usage(argv[0]); return 2; }
+    }
+
     Database db;
     Executor exec(db);
+    if (!snapshot.empty()) {
+        try {
+            size_t n = db.load_snapshot(snapshot);
+            std::cout << "Loaded " << n << " table(s) from " << snapshot << "\n";
+        } catch (std::exception const& ex) {
+            std::cerr << "Snapshot error: " << ex.what() << "\n";
+            return 1;
+        }
+    }
+    if (!wal.path.empty()) {
+        try {
+            size_t n = db.attach_wal(wal);
+            std::cout << "Replayed " << n << " WAL record(s) from " << wal.path << "\n";
+        } catch (std::exception const& ex) {
+            std::cerr << "WAL error: " << ex.what() << "\n";
+            return 1;
+        }
+    }
 
     std::cout << "In-Memory DB CLI. Enter statements; end with semicolon. Ctrl-D to exit.\n";
     std::string buffer;
@@ -21,6 +89,11 @@ int main() {
                 Parser parser{std::move(lx)};
                 auto stmts = parser.parse_all();
                 for (auto const& st : stmts) {
+                    if (auto sel = std::get_if<SelectStmt>(&st)) {
+                        try { print_select(db, *sel); }
+                        catch (std::exception const& ex) { std::cout << "Error: " << ex.what() << "\n"; }
+                        continue;
+                    }
                     auto res = exec.execute(st);
                     if (!res.success) {
                         std::cout << "Error: " << res.message << "\n";
@@ -37,7 +110,8 @@ int main() {
                             }
                             std::cout << "\n";
                         }
-                        std::cout << res.rows.size() << " row(s).\n";
+                        if (res.profile) std::cout << res.message << ".\n";
+                        else std::cout << res.rows.size() << " row(s).\n";
                     } else {
                         std::cout << res.message << "\n";
                     }
@@ -0,0 +1,446 @@
+#include "inmemdb/operators.hpp"
+#include "inmemdb/index.hpp"
+#include "inmemdb/thread_pool.hpp"
+#include <numeric>
+
+namespace inmemdb {
+
+void RowChunk::select(size_t const* sel, size_t k) {
+    for (auto& list : rows) {
+        if (list.empty()) continue;
+        for (size_t i = 0; i < k; ++i) list[i] = list[sel[i]];
+        list.resize(k);
+    }
+}
+
+// Three-way compare of two stored cells; the JOIN path checks types up front
+static int cmp(ColumnData const& a, size_t arow, ColumnData const& b, size_t brow) {
+    if (auto ai = std::get_if<IntColumn>(&a)) {
+        int64_t x = ai->at(arow), y = std::get<IntColumn>(b).at(brow);
+        return (x > y) - (x < y);
+    }
+    int c = text_at(a, arow).compare(text_at(b, brow));
+    return (c > 0) - (c < 0);
+}
+
+// Apply a comparison operator to a cmp() result
+static bool compare_op(CompareOp op, int cval) {
+    switch (op) {
+        case CompareOp::Eq: return cval == 0;
+        case CompareOp::Ne: return cval != 0;
+        case CompareOp::Lt: return cval < 0;
+        case CompareOp::Le: return cval <= 0;
+        case CompareOp::Gt: return cval > 0;
+        case CompareOp::Ge: return cval >= 0;
+    }
+    return false;
+}
+
+// Build a join hash table over rows [0, rows) keyed by key_at(row). In
+// parallel, workers first scatter each morsel's row ids by partition, then
+// build whole partitions reading the morsels in order, so every bucket keeps
+// table order like a serial build.
+template <class K, class KeyAt>
+static void build_join_hash(JoinHashTable<K>& ht, size_t rows, size_t dop, KeyAt key_at) {
+    size_t morsels = (rows + kMorselRows - 1) / kMorselRows;
+    if (dop <= 1 || morsels <= 1) {
+        ht.init(0);
+        ht.parts[0].reserve(rows);
+        for (size_t i = 0; i < rows; ++i) ht.parts[0][key_at(i)].push_back(i);
+        return;
+    }
+    ht.init(JoinMatcher::kPartitionBits);
+    size_t nparts = ht.parts.size();
+    std::vector<std::vector<std::vector<size_t>>> scatter(morsels, std::vector<std::vector<size_t>>(nparts));
+    auto& pool = ThreadPool::shared();
+    pool.run(morsels, dop, [&](size_t m, size_t) {
+        size_t end = std::min(rows, (m + 1) * kMorselRows);
+        for (size_t i = m * kMorselRows; i < end; ++i) scatter[m][ht.part_of(key_at(i))].push_back(i);
+    });
+    pool.run(nparts, dop, [&](size_t p, size_t) {
+        auto& part = ht.parts[p];
+        size_t n = 0;
+        for (auto const& sm : scatter) n += sm[p].size();
+        part.reserve(n);
+        for (auto const& sm : scatter)
+            for (size_t i : sm[p]) part[key_at(i)].push_back(i);
+    });
+}
+
+void JoinMatcher::build(size_t dop) {
+    ColumnData const& bcol = inner_col_;
+    auto bdict = std::get_if<DictColumn>(&bcol);
+    auto pdict = std::get_if<DictColumn>(&outer_col_);
+    if (auto ic = std::get_if<IntColumn>(&bcol)) {
+        build_join_hash(hash_.emplace<IntHash>(), inner_rows_, dop, [ic](size_t i) { return ic->at(i); });
+    } else if (bdict && pdict) {
+        // Both sides dictionary-encoded: bucket by code, and map each probe
+        // code to the build-side code of the same string once
+        auto& ch = hash_.emplace<CodeHash>();
+        ch.buckets.resize(bdict->dict.size());
+        for (size_t i = 0; i < inner_rows_; ++i) ch.buckets[bdict->codes[i]].push_back(i);
+        std::unordered_map<std::string_view, uint32_t> bcodes;
+        for (size_t c = 0; c < bdict->dict.size(); ++c) bcodes.emplace(bdict->dict.at(c), static_cast<uint32_t>(c));
+        ch.xlate.resize(pdict->dict.size());
+        for (size_t c = 0; c < pdict->dict.size(); ++c) {
+            auto it = bcodes.find(pdict->dict.at(c));
+            ch.xlate[c] = it == bcodes.end() ? DictColumn::kNoCode : it->second;
+        }
+    } else {
+        build_join_hash(hash_.emplace<TextHash>(), inner_rows_, dop, [&bcol](size_t i) { return text_at(bcol, i); });
+    }
+}
+
+std::pair<size_t const*, size_t const*> JoinMatcher::find(size_t outer_row, std::vector<size_t>& buf) const {
+    buf.clear();
+    if (algo_ == JoinAlgo::Hash) {
+        std::vector<size_t> const* bucket = nullptr;
+        if (auto ht = std::get_if<IntHash>(&hash_)) {
+            bucket = ht->find(std::get<IntColumn>(outer_col_).at(outer_row));
+        } else if (auto ch = std::get_if<CodeHash>(&hash_)) {
+            uint32_t code = ch->xlate[std::get<DictColumn>(outer_col_).codes[outer_row]];
+            if (code != DictColumn::kNoCode) bucket = &ch->buckets[code];
+        } else {
+            bucket = std::get<TextHash>(hash_).find(text_at(outer_col_, outer_row));
+        }
+        if (bucket) return {bucket->data(), bucket->data() + bucket->size()};
+    } else if (algo_ == JoinAlgo::IndexNestedLoop) {
+        index_->probe(outer_col_, outer_row, buf, inner_rows_);
+        std::sort(buf.begin(), buf.end());
+    } else {
+        // Nested loop; the planner orients op as outer op inner
+        for (size_t r = 0; r < inner_rows_; ++r)
+            if (compare_op(op_, cmp(outer_col_, outer_row, inner_col_, r))) buf.push_back(r);
+    }
+    return {buf.data(), buf.data() + buf.size()};
+}
+
+// Approximate bytes of a join hash table: map nodes, buckets and row lists
+template <class K>
+static size_t hash_bytes(JoinHashTable<K> const& ht) {
+    size_t n = 0;
+    for (auto const& part : ht.parts) {
+        n += part.bucket_count() * sizeof(void*);
+        for (auto const& [key, rows] : part)
+            n += sizeof(std::pair<K const, std::vector<size_t>>) + sizeof(void*) + rows.capacity() * sizeof(size_t);
+    }
+    return n;
+}
+
+size_t JoinMatcher::footprint() const {
+    if (auto ht = std::get_if<IntHash>(&hash_)) return hash_bytes(*ht);
+    if (auto th = std::get_if<TextHash>(&hash_)) return hash_bytes(*th);
+    if (auto ch = std::get_if<CodeHash>(&hash_)) {
+        size_t n = ch->buckets.capacity() * sizeof(std::vector<size_t>) + ch->xlate.capacity() * sizeof(uint32_t);
+        for (auto const& b : ch->buckets) n += b.capacity() * sizeof(size_t);
+        return n;
+    }
+    return 0;
+}
+
+bool ScanOp::next(RowChunk& out, size_t max_rows) {
+    out.clear();
+    auto& rows = out.rows[table_];
+    while (rows.empty() && pos_ < end_) {
+        size_t n = std::min(max_rows, end_ - pos_);
+        rows.resize(n);
+        if (where_) {
+            OpTimer t(ctx_.profile ? &ctx_.stats.filter[table_].ns : nullptr);
+            rows.resize(where_->filter(pos_, pos_ + n, rows.data()));
+            if (ctx_.profile) ctx_.count_filter(table_, n, rows.size());
+        } else {
+            OpTimer t(ctx_.profile ? &ctx_.stats.scan.ns : nullptr);
+            std::iota(rows.begin(), rows.end(), pos_);
+        }
+        if (ctx_.profile) ctx_.stats.scan.rows_out += n;
+        pos_ += n;
+    }
+    return !rows.empty();
+}
+
+IndexLookupOp::IndexLookupOp(OpContext& ctx, size_t table, Index const& index, CompareOp op, Value const& value, size_t visible)
+    : table_(table) {
+    OpTimer t(&ctx.stats.index.ns);
+    index.lookup(op, value, rows_, visible);
+    std::sort(rows_.begin(), rows_.end()); // keep table order like a scan
+    ctx.stats.index.rows_out = rows_.size();
+}
+
+bool IndexLookupOp::next(RowChunk& out, size_t max_rows) {
+    out.clear();
+    size_t n = std::min(max_rows, rows_.size() - pos_);
+    auto first = rows_.begin() + static_cast<std::ptrdiff_t>(pos_);
+    out.rows[table_].assign(first, first + static_cast<std::ptrdiff_t>(n));
+    pos_ += n;
+    return n > 0;
+}
+
+bool FilterOp::next(RowChunk& out, size_t max_rows) {
+    while (child_->next(out, max_rows)) {
+        OpTimer t(ctx_.profile ? &ctx_.stats.filter[table_].ns : nullptr);
+        size_t n = out.size();
+        sel_.resize(n);
+        size_t k = where_.filter(out.rows[table_].data(), n, sel_.data());
+        if (k < n) out.select(sel_.data(), k);
+        if (ctx_.profile) ctx_.count_filter(table_, n, k);
+        if (k > 0) return true;
+    }
+    return false;
+}
+
+bool JoinProbeOp::next(RowChunk& out, size_t max_rows) {
+    out.clear();
+    auto& inner_rows = out.rows[inner_table_];
+    OperatorStats& st = ctx_.stats.join[inner_table_];
+    size_t probes = 0;
+    while (inner_rows.size() < max_rows) {
+        if (it_ == end_ && pos_ == in_.size()) {
+            pos_ = 0;
+            if (done_ || !outer_->next(in_, kChunkRows)) { done_ = true; in_.clear(); break; }
+            present_.clear();
+            for (size_t t = 0; t < kMaxTables; ++t)
+                if (!in_.rows[t].empty()) present_.push_back(t);
+        }
+        // The probe's own time excludes pulling outer tuples
+        OpTimer t(ctx_.profile ? &st.ns : nullptr);
+        auto const& probe_in = in_.rows[probe_table_];
+        while (inner_rows.size() < max_rows) {
+            if (it_ == end_) {
+                if (pos_ == probe_in.size()) break;
+                tuple_ = pos_++;
+                std::tie(it_, end_) = matcher_.find(probe_in[tuple_], buf_);
+                ++probes;
+                continue;
+            }
+            for (size_t table : present_) out.rows[table].push_back(in_.rows[table][tuple_]);
+            inner_rows.push_back(*it_++);
+        }
+    }
+    if (ctx_.profile) {
+        st.rows_in += probes;
+        st.rows_out += inner_rows.size();
+        st.bytes += static_cast<uint64_t>(static_cast<double>(probes) * ctx_.probe_row_bytes[inner_table_]);
+    }
+    return !inner_rows.empty();
+}
+
+std::unique_ptr<RowOperator> RowSource::build(OpContext& ctx, size_t begin, size_t end) const {
+    auto const& pushed = where[outer_table];
+    std::unique_ptr<RowOperator> op = std::make_unique<ScanOp>(ctx, outer_table, begin, end, pushed ? &*pushed : nullptr);
+    for (auto const& j : joins) {
+        op = std::make_unique<JoinProbeOp>(ctx, std::move(op), j.matcher, j.probe_table, j.inner_table);
+        if (where[j.inner_table]) op = std::make_unique<FilterOp>(ctx, std::move(op), *where[j.inner_table], j.inner_table);
+    }
+    return op;
+}
+
+void Projection::reset(Batch& out) const {
+    out.columns.resize(types->size());
+    for (size_t i = 0; i < types->size(); ++i) { out.columns[i].type = (*types)[i]; out.columns[i].clear(); }
+    out.rows = 0;
+}
+
+void Projection::append(Batch& out, RowChunk const& in) const {
+    for (size_t c = 0; c < columns.size(); ++c) {
+        ColumnData const& col = *columns[c].data;
+        auto const& rows = in.rows[columns[c].table];
+        BatchColumn& dst = out.columns[c];
+        if (auto ic = std::get_if<IntColumn>(&col)) {
+            // Decoded in bulk, so Delta blocks are unpacked once per chunk
+            size_t at = dst.ints.size();
+            dst.ints.resize(at + rows.size());
+            ic->gather(rows.data(), rows.size(), dst.ints.data() + at);
+            continue;
+        }
+        for (size_t r : rows) dst.push_text(text_at(col, r));
+    }
+    out.rows += in.size();
+}
+
+size_t BatchOperator::skip(size_t n) {
+    size_t left = n;
+    Batch dropped;
+    while (left > 0 && next(dropped, std::min(left, kChunkRows))) left -= dropped.rows;
+    return n - left;
+}
+
+bool ProjectOp::next(Batch& out, size_t max_rows) {
+    proj_.reset(out);
+    while (out.rows < max_rows && child_->next(chunk_, max_rows - out.rows)) {
+        OpTimer t(ctx_.profile ? &ctx_.stats.project.ns : nullptr);
+        proj_.append(out, chunk_);
+    }
+    if (ctx_.profile) {
+        ctx_.stats.project.rows_in += out.rows;
+        ctx_.stats.project.rows_out += out.rows;
+        ctx_.stats.project.bytes += out.byte_size();
+    }
+    return out.rows > 0;
+}
+
+size_t ProjectOp::skip(size_t n) {
+    size_t left = n;
+    while (left > 0 && child_->next(chunk_, std::min(left, kChunkRows))) left -= chunk_.size();
+    return n - left;
+}
+
+void ProjectOp::report(CursorStats& s) const { child_->report(s); }
+
+void MorselProjectOp::fill() {
+    size_t first = next_morsel_;
+    out_.assign(std::min(kWindowPerWorker * dop_, source_.morsels() - first), Batch{});
+    idx_ = off_ = 0;
+    next_morsel_ += out_.size();
+    OpContext base = ctx_;
+    base.stats = {};
+    std::vector<OpContext> workers(dop_, base);
+    ThreadPool::shared().run(out_.size(), dop_, [&](size_t i, size_t w) {
+        OpContext& wctx = workers[w];
+        size_t m = first + i;
+        auto rows = source_.build(wctx, m * kMorselRows, std::min(source_.outer_rows, (m + 1) * kMorselRows));
+        Batch& b = out_[i];
+        proj_.reset(b);
+        RowChunk chunk;
+        while (rows->next(chunk, kChunkRows)) {
+            OpTimer t(wctx.profile ? &wctx.stats.project.ns : nullptr);
+            proj_.append(b, chunk);
+        }
+        if (wctx.profile) {
+            wctx.stats.project.rows_in += b.rows;
+            wctx.stats.project.rows_out += b.rows;
+            wctx.stats.project.bytes += b.byte_size();
+        }
+    });
+    for (auto const& w : workers) ctx_.stats.merge(w.stats);
+    if (ctx_.profile) {
+        uint64_t held = 0;
+        for (auto const& b : out_) held += b.byte_size();
+        ctx_.stats.project.peak_bytes = std::max(ctx_.stats.project.peak_bytes, held);
+    }
+}
+
+bool MorselProjectOp::next(Batch& out, size_t max_rows) {
+    proj_.reset(out);
+    while (out.rows < max_rows) {
+        if (idx_ == out_.size()) {
+            // A partial batch goes out rather than wait for a whole window
+            if (out.rows > 0 || next_morsel_ == source_.morsels()) break;
+            fill();
+            continue;
+        }
+        Batch& mb = out_[idx_];
+        size_t total = mb.rows;
+        size_t n = std::min(max_rows - out.rows, total - off_);
+        if (out.rows == 0 && n == total) {
+            std::swap(out, mb);
+        } else {
+            for (size_t c = 0; c < out.columns.size(); ++c) out.columns[c].append(mb.columns[c], off_, off_ + n);
+            out.rows += n;
+        }
+        off_ += n;
+        if (off_ == total) { mb = Batch{}; ++idx_; off_ = 0; }
+    }
+    return out.rows > 0;
+}
+
+void AggregateOp::consume_all() {
+    OperatorStats& st = ctx_.stats.aggregate;
+    if (child_) {
+        RowChunk chunk;
+        while (child_->next(chunk, kChunkRows)) {
+            OpTimer t(ctx_.profile ? &st.ns : nullptr);
+            agg_.consume(chunk.rows);
+            st.rows_in += ctx_.profile ? chunk.size() : 0;
+        }
+        return;
+    }
+    std::vector<HashAggregator> partial(dop_, agg_);
+    OpContext base = ctx_;
+    base.stats = {};
+    std::vector<OpContext> workers(dop_, base);
+    ThreadPool::shared().run(source_->morsels(), dop_, [&](size_t m, size_t w) {
+        OpContext& wctx = workers[w];
+        auto rows = source_->build(wctx, m * kMorselRows, std::min(source_->outer_rows, (m + 1) * kMorselRows));
+        RowChunk chunk;
+        uint64_t pos = static_cast<uint64_t>(m) << 32;
+        while (rows->next(chunk, kChunkRows)) {
+            OpTimer t(wctx.profile ? &wctx.stats.aggregate.ns : nullptr);
+            partial[w].consume(chunk.rows, pos);
+            pos += chunk.size();
+            wctx.stats.aggregate.rows_in += wctx.profile ? chunk.size() : 0;
+        }
+    });
+    for (auto const& w : workers) ctx_.stats.merge(w.stats);
+    if (ctx_.profile) {
+        // The partials are all alive at the end of the run
+        uint64_t held = 0;
+        for (auto const& p : partial) held += p.footprint();
+        st.peak_bytes = std::max(st.peak_bytes, held);
+    }
+    OpTimer t(ctx_.profile ? &st.ns : nullptr);
+    for (auto const& p : partial) agg_.merge(p);
+}
+
+bool AggregateOp::next(Batch& out, size_t max_rows) {
+    if (!consumed_) {
+        consume_all();
+        consumed_ = true;
+    }
+    OperatorStats& st = ctx_.stats.aggregate;
+    OpTimer t(ctx_.profile ? &st.ns : nullptr);
+    bool more = agg_.next(out, max_rows);
+    if (ctx_.profile) { st.rows_out += out.rows; st.bytes += out.byte_size(); }
+    return more;
+}
+
+void AggregateOp::report(CursorStats& s) const {
+    if (child_) child_->report(s);
+    s.aggregate.peak_bytes = std::max<uint64_t>(s.aggregate.peak_bytes, agg_.footprint());
+}
+
+bool SortOp::next(Batch& out, size_t max_rows) {
+    OperatorStats& st = ctx_.stats.sort;
+    if (!sorted_) {
+        Batch in;
+        while (child_->next(in, kChunkRows)) {
+            OpTimer t(ctx_.profile ? &st.ns : nullptr);
+            sorter_.consume(in);
+            if (!ctx_.profile) continue;
+            st.rows_in += in.rows;
+            st.peak_bytes = std::max<uint64_t>(st.peak_bytes, sorter_.footprint());
+        }
+        OpTimer t(ctx_.profile ? &st.ns : nullptr);
+        sorter_.finish();
+        sorted_ = true;
+    }
+    OpTimer t(ctx_.profile ? &st.ns : nullptr);
+    bool more = sorter_.next(out, max_rows);
+    if (ctx_.profile) { st.rows_out += out.rows; st.bytes += out.byte_size(); }
+    return more;
+}
+
+void SortOp::report(CursorStats& s) const {
+    child_->report(s);
+    s.sort.peak_bytes = std::max<uint64_t>(s.sort.peak_bytes, sorter_.footprint());
+}
+
+bool LimitOp::next(Batch& out, size_t max_rows) {
+    OperatorStats& st = ctx_.stats.limit;
+    if (offset_ > 0) {
+        size_t skipped = child_->skip(offset_);
+        if (ctx_.profile) st.rows_in += skipped;
+        offset_ = 0;
+    }
+    if (limit_) max_rows = std::min(max_rows, *limit_ - emitted_);
+    if (max_rows == 0) {
+        for (auto& c : out.columns) c.clear();
+        out.rows = 0;
+        return false;
+    }
+    bool more = child_->next(out, max_rows);
+    emitted_ += out.rows;
+    if (ctx_.profile) { st.rows_in += out.rows; st.rows_out += out.rows; }
+    return more;
+}
+
+} // namespace inmemdb
@@ -0,0 +1,94 @@
+#include "inmemdb/optimizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace inmemdb {
+
+double join_selectivity(ColumnStats const& a, ColumnStats const& b, CompareOp op) {
+    if (!a.min || !b.min) return 0; // an empty side matches nothing
+    double eq = 0;
+    if (auto amin = std::get_if<int64_t>(&*a.min)) {
+        // Values spread evenly over [min, max]: only the overlap can match
+        auto wide = [](int64_t lo, int64_t hi) { return static_cast<double>(hi) - static_cast<double>(lo) + 1; };
+        int64_t amax = std::get<int64_t>(*a.max), bmin = std::get<int64_t>(*b.min), bmax = std::get<int64_t>(*b.max);
+        int64_t lo = std::max(*amin, bmin), hi = std::min(amax, bmax);
+        if (lo <= hi) {
+            double fa = wide(lo, hi) / wide(*amin, amax), fb = wide(lo, hi) / wide(bmin, bmax);
+            eq = fa * fb / std::max({1.0, a.distinct() * fa, b.distinct() * fb});
+        }
+    } else if (!(*a.max < *b.min || *b.max < *a.min)) {
+        eq = 1 / std::max({1.0, a.distinct(), b.distinct()});
+    }
+    switch (op) {
+        case CompareOp::Eq: return eq;
+        case CompareOp::Ne: return 1 - eq;
+        default: return 1.0 / 3;
+    }
+}
+
+JoinOrder order_joins(JoinGraph const& g) {
+    size_t n = g.tables.size();
+    if (n == 0 || n > kMaxTables) throw std::runtime_error("Cannot order a join of " + std::to_string(n) + " tables");
+    // Cheapest pipeline producing each set of tables. The tuples a set
+    // yields do not depend on the order it was joined in, so extending the
+    // cheapest plan of a set is always best.
+    struct State {
+        double cost = std::numeric_limits<double>::infinity();
+        double rows = 0;
+        size_t outer = 0;
+        size_t prev = 0; // set before `step`
+        JoinStep step;
+    };
+    std::vector<State> best(size_t{1} << n);
+    for (size_t t = 0; t < n; ++t) {
+        State& s = best[size_t{1} << t];
+        s.cost = 0;
+        s.rows = g.tables[t].rows * g.tables[t].selectivity;
+        s.outer = t;
+    }
+    // Adding a table only sets a bit, so every set is final once reached
+    for (size_t set = 1; set < best.size(); ++set) {
+        State const& cur = best[set];
+        if (std::isinf(cur.cost)) continue;
+        for (size_t e = 0; e < g.edges.size(); ++e) {
+            auto const& edge = g.edges[e];
+            // Extend the set by the edge's side not yet in it
+            size_t probe = edge.a, inner = edge.b;
+            std::optional<size_t> index = edge.index_b;
+            if (!(set >> edge.a & 1)) {
+                std::swap(probe, inner);
+                index = edge.index_a;
+            }
+            if (!(set >> probe & 1) || (set >> inner & 1)) continue;
+            auto const& rel = g.tables[inner];
+            double matches = cur.rows * rel.rows * edge.selectivity; // before the inner table's WHERE
+            JoinStep step{e, probe, inner, JoinAlgo::NestedLoop, std::nullopt, matches * rel.selectivity};
+            double work = cur.rows * rel.rows; // every pair is compared
+            if (edge.op == CompareOp::Eq) {
+                step.algo = JoinAlgo::Hash;
+                work = kHashBuildCost * rel.rows + cur.rows;
+                if (index && kIndexProbeCost * cur.rows < work) {
+                    step.algo = JoinAlgo::IndexNestedLoop;
+                    step.index = index;
+                    work = kIndexProbeCost * cur.rows;
+                }
+            }
+            double cost = cur.cost + work + kTupleCost * matches;
+            State& next = best[set | (size_t{1} << inner)];
+            if (cost < next.cost) next = State{cost, step.rows, cur.outer, set, step};
+        }
+    }
+
+    size_t set = best.size() - 1;
+    if (std::isinf(best[set].cost)) throw std::runtime_error("Every table must be joined to another");
+    JoinOrder order;
+    order.outer = best[set].outer;
+    order.cost = best[set].cost;
+    for (; set & (set - 1); set = best[set].prev) order.steps.push_back(best[set].step);
+    std::reverse(order.steps.begin(), order.steps.end());
+    return order;
+}
+
+} // namespace inmemdb
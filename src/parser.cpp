@@ -1,4 +1,7 @@
 #include "inmemdb/parser.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
 #include <stdexcept>
 #include <cctype>
 #include <optional>
@@ -25,7 +28,10 @@ void Parser::expect(TokenType t, const char* msg) {
 }
 
 std::vector<Statement> Parser::parse_all() {
+    // Statements are large variants; size the vector up front (one per ';',
+    // an overcount at worst) so a long script is not moved on every regrowth
     std::vector<Statement> out;
+    out.reserve(std::count(lex_.input().begin(), lex_.input().end(), ';') + 1);
     while (true) {
         if (current().type == TokenType::End) break;
         out.push_back(parse_statement());
@@ -39,19 +45,51 @@ std::vector<Statement> Parser::parse_all() {
 }
 
 Statement Parser::parse_statement() {
+    next_param_ = 0;
     switch (current().type) {
         case TokenType::KeywordCreate: return parse_create();
         case TokenType::KeywordInsert: return parse_insert();
         case TokenType::KeywordSelect: return parse_select();
-        default: throw std::runtime_error("Expected a statement (CREATE/INSERT/SELECT)");
+        case TokenType::KeywordSnapshot: return parse_snapshot();
+        case TokenType::KeywordCopy: return parse_copy();
+        case TokenType::KeywordPrepare: return parse_prepare();
+        case TokenType::KeywordExecute: return parse_execute();
+        case TokenType::KeywordExplain: return parse_explain();
+        default: throw std::runtime_error("Expected a statement (CREATE/INSERT/SELECT/SNAPSHOT/COPY/PREPARE/EXECUTE/EXPLAIN)");
     }
 }
 
-CreateTableStmt Parser::parse_create() {
+Statement Parser::parse_create() {
     expect(TokenType::KeywordCreate, "Expected CREATE");
-    expect(TokenType::KeywordTable, "Expected TABLE after CREATE");
+    if (accept(TokenType::KeywordIndex)) return parse_create_index();
+    expect(TokenType::KeywordTable, "Expected TABLE or INDEX after CREATE");
+    return parse_create_table();
+}
+
+// CREATE INDEX name ON table(col) [USING HASH|BTREE]; CREATE INDEX already consumed
+CreateIndexStmt Parser::parse_create_index() {
+    CreateIndexStmt stmt;
+    if (current().type != TokenType::Identifier) throw std::runtime_error("Expected index name");
+    stmt.name = current().text; advance();
+    expect(TokenType::KeywordOn, "Expected ON after index name");
+    if (current().type != TokenType::Identifier) throw std::runtime_error("Expected table name after ON");
+    stmt.table = current().text; advance();
+    expect(TokenType::LParen, "Expected '('");
+    if (current().type != TokenType::Identifier) throw std::runtime_error("Expected column name");
+    stmt.column = current().text; advance();
+    expect(TokenType::RParen, "Expected ')' after index column");
+    if (accept(TokenType::KeywordUsing)) {
+        if (accept(TokenType::KeywordHash)) stmt.kind = IndexKind::Hash;
+        else if (accept(TokenType::KeywordBtree)) stmt.kind = IndexKind::BTree;
+        else throw std::runtime_error("Expected HASH or BTREE after USING");
+    }
+    return stmt;
+}
+
+// CREATE TABLE name(col type, ...); CREATE TABLE already consumed
+CreateTableStmt Parser::parse_create_table() {
     if (current().type != TokenType::Identifier) throw std::runtime_error("Expected table name");
-    std::string table = current().text; advance();
+    std::string table(current().text); advance();
     expect(TokenType::LParen, "Expected '('");
 
     // parse column
@@ -61,44 +99,129 @@ CreateTableStmt Parser::parse_create() {
         if (!first) expect(TokenType::Comma, "Expected ',' between column definitions");
         first = false;
         if (current().type != TokenType::Identifier) throw std::runtime_error("Expected column name");
-        std::string colname = current().text; advance();
+        std::string colname(current().text); advance();
         ColumnType ctype;
+        bool dict = false;
         if (accept(TokenType::KeywordInt)) ctype = ColumnType::Int;
-        else if (accept(TokenType::KeywordText)) ctype = ColumnType::Text;
+        else if (accept(TokenType::KeywordText)) { ctype = ColumnType::Text; dict = accept(TokenType::KeywordDict); }
         else throw std::runtime_error("Expected column type INT or TEXT");
-        columns.push_back({colname, ctype});
+        columns.push_back({std::move(colname), ctype, dict});
     }
     expect(TokenType::RParen, "Expected ')' after column list");
-    return CreateTableStmt{table, std::move(columns)};
+    return CreateTableStmt{std::move(table), std::move(columns)};
 }
 
 InsertStmt Parser::parse_insert() {
     expect(TokenType::KeywordInsert, "Expected INSERT");
     expect(TokenType::KeywordInto, "Expected INTO after INSERT");
     if (current().type != TokenType::Identifier) throw std::runtime_error("Expected table name after INSERT INTO");
-    std::string table = current().text; advance();
+    std::string table(current().text); advance();
     expect(TokenType::KeywordValues, "Expected VALUES");
-    expect(TokenType::LParen, "Expected '(' after VALUES");
 
-    std::vector<std::string> values;
-    bool first = true;
-    while (current().type != TokenType::RParen) {
-        if (!first) expect(TokenType::Comma, "Expected ',' between values");
-        first = false;
-        if (current().type == TokenType::Integer || current().type == TokenType::String || current().type == TokenType::Identifier) {
-            values.push_back(current().text);
-            advance();
-        } else {
-            throw std::runtime_error("Expected literal value");
+    // VALUES (...), (...), ...: every tuple as wide as the first
+    InsertStmt stmt{std::move(table), {}, 0};
+    size_t width = 0;
+    do {
+        size_t tuple_begin = current().pos;
+        expect(TokenType::LParen, "Expected '(' before values");
+        bool first = true;
+        while (current().type != TokenType::RParen) {
+            if (!first) expect(TokenType::Comma, "Expected ',' between values");
+            first = false;
+            if (current().type == TokenType::Integer || current().type == TokenType::String || current().type == TokenType::Identifier) {
+                stmt.values.emplace_back(current().text);
+                advance();
+            } else if (current().type == TokenType::Parameter) {
+                stmt.params.emplace_back(stmt.values.size(), parse_param());
+                stmt.values.emplace_back();
+            } else {
+                throw std::runtime_error("Expected literal value");
+            }
         }
+        expect(TokenType::RParen, "Expected ')' after values");
+        if (++stmt.rows == 1) {
+            // Guess the tuple count from the first tuple's length and the
+            // next ';', so long VALUES lists do not regrow the vector
+            width = stmt.values.size();
+            size_t tuple_bytes = std::max<size_t>(1, current().pos - tuple_begin);
+            size_t end = std::min(lex_.input().find(';', current().pos), lex_.input().size());
+            stmt.values.reserve(width * (1 + (end - current().pos) / tuple_bytes));
+        }
+        else if (stmt.values.size() != width * stmt.rows) throw std::runtime_error("Every VALUES row needs the same number of values");
+    } while (accept(TokenType::Comma));
+    return stmt;
+}
+
+CopyStmt Parser::parse_copy() {
+    expect(TokenType::KeywordCopy, "Expected COPY");
+    CopyStmt stmt;
+    if (current().type != TokenType::Identifier) throw std::runtime_error("Expected table name after COPY");
+    stmt.table = current().text; advance();
+    expect(TokenType::KeywordFrom, "Expected FROM after COPY table");
+    if (current().type != TokenType::String) throw std::runtime_error("Expected quoted file path after COPY ... FROM");
+    stmt.path = current().text; advance();
+    stmt.header = accept(TokenType::KeywordHeader);
+    return stmt;
+}
+
+// PREPARE name AS statement
+PrepareStmt Parser::parse_prepare() {
+    expect(TokenType::KeywordPrepare, "Expected PREPARE");
+    if (current().type != TokenType::Identifier) throw std::runtime_error("Expected statement name after PREPARE");
+    PrepareStmt stmt{std::string(current().text), ""};
+    advance();
+    expect(TokenType::KeywordAs, "Expected AS after PREPARE name");
+    if (current().type == TokenType::KeywordPrepare || current().type == TokenType::KeywordExecute)
+        throw std::runtime_error("Cannot PREPARE a PREPARE or EXECUTE statement");
+    // Parse the body to validate it, then keep its source text
+    size_t begin = current().pos;
+    parse_statement();
+    stmt.sql = lex_.input().substr(begin, current().pos - begin);
+    return stmt;
+}
+
+// EXECUTE name [(value, ...)]
+ExecuteStmt Parser::parse_execute() {
+    expect(TokenType::KeywordExecute, "Expected EXECUTE");
+    if (current().type != TokenType::Identifier) throw std::runtime_error("Expected statement name after EXECUTE");
+    ExecuteStmt stmt{std::string(current().text), {}};
+    advance();
+    if (!accept(TokenType::LParen)) return stmt;
+    while (current().type != TokenType::RParen) {
+        if (!stmt.values.empty()) expect(TokenType::Comma, "Expected ',' between values");
+        if (current().type != TokenType::Integer && current().type != TokenType::String && current().type != TokenType::Identifier)
+            throw std::runtime_error("Expected literal value in EXECUTE");
+        stmt.values.emplace_back(current().text);
+        advance();
     }
-    expect(TokenType::RParen, "Expected ')' after values");
-    return InsertStmt{table, std::move(values)};
+    expect(TokenType::RParen, "Expected ')' after EXECUTE values");
+    return stmt;
+}
+
+// EXPLAIN [ANALYZE] SELECT ...
+ExplainStmt Parser::parse_explain() {
+    expect(TokenType::KeywordExplain, "Expected EXPLAIN");
+    ExplainStmt stmt;
+    stmt.analyze = accept(TokenType::KeywordAnalyze);
+    if (current().type != TokenType::KeywordSelect) throw std::runtime_error("Expected SELECT after EXPLAIN");
+    size_t begin = current().pos;
+    stmt.select = parse_select();
+    stmt.sql = lex_.input().substr(begin, current().pos - begin);
+    return stmt;
+}
+
+SnapshotStmt Parser::parse_snapshot() {
+    expect(TokenType::KeywordSnapshot, "Expected SNAPSHOT");
+    expect(TokenType::KeywordTo, "Expected TO after SNAPSHOT");
+    if (current().type != TokenType::String) throw std::runtime_error("Expected quoted file path after SNAPSHOT TO");
+    SnapshotStmt stmt{std::string(current().text)};
+    advance();
+    return stmt;
 }
 
 std::string Parser::parse_column_name() {
     if (current().type != TokenType::Identifier) throw std::runtime_error("Expected identifier");
-    std::string name = current().text; advance();
+    std::string name(current().text); advance();
     if (accept(TokenType::Dot)) {
         if (current().type != TokenType::Identifier) throw std::runtime_error("Expected identifier after '.'");
         name += ".";
@@ -107,6 +230,113 @@ std::string Parser::parse_column_name() {
     return name;
 }
 
+std::optional<CompareOp> Parser::parse_compare_op() {
+    CompareOp op;
+    switch(current().type) {
+        case TokenType::Equal: op = CompareOp::Eq; break;
+        case TokenType::NotEqual: op = CompareOp::Ne; break;
+        case TokenType::Less: op = CompareOp::Lt; break;
+        case TokenType::LessEqual: op = CompareOp::Le; break;
+        case TokenType::Greater: op = CompareOp::Gt; break;
+        case TokenType::GreaterEqual: op = CompareOp::Ge; break;
+        default: return std::nullopt;
+    }
+    advance();
+    return op;
+}
+
+// Operands of one AND/OR level, with same-kind groups from parentheses
+// spliced in so the tree stays flat
+static WhereExpr combine(WhereExpr::Kind kind, std::vector<WhereExpr> operands) {
+    if (operands.size() == 1) return std::move(operands[0]);
+    std::vector<WhereExpr> flat;
+    for (auto& e : operands) {
+        if (e.kind == kind) for (auto& c : e.children) flat.push_back(std::move(c));
+        else flat.push_back(std::move(e));
+    }
+    return WhereExpr(kind, std::move(flat));
+}
+
+WhereExpr Parser::parse_or() {
+    std::vector<WhereExpr> operands{parse_and()};
+    while (accept(TokenType::KeywordOr)) operands.push_back(parse_and());
+    return combine(WhereExpr::Kind::Or, std::move(operands));
+}
+
+WhereExpr Parser::parse_and() {
+    std::vector<WhereExpr> operands{parse_not()};
+    while (accept(TokenType::KeywordAnd)) operands.push_back(parse_not());
+    return combine(WhereExpr::Kind::And, std::move(operands));
+}
+
+WhereExpr Parser::parse_not() {
+    if (!accept(TokenType::KeywordNot)) return parse_condition();
+    return WhereExpr(WhereExpr::Kind::Not, {parse_not()});
+}
+
+WhereExpr Parser::parse_condition() {
+    if (accept(TokenType::LParen)) {
+        WhereExpr e = parse_or();
+        expect(TokenType::RParen, "Expected ')' in WHERE");
+        return e;
+    }
+    std::string col = parse_column_name();
+    bool negate = accept(TokenType::KeywordNot);
+    WhereExpr e;
+    if (accept(TokenType::KeywordIn)) {
+        e.kind = WhereExpr::Kind::In;
+        expect(TokenType::LParen, "Expected '(' after IN");
+        do { e.values.push_back(parse_where_value()); } while (accept(TokenType::Comma));
+        expect(TokenType::RParen, "Expected ')' after IN list");
+    } else if (accept(TokenType::KeywordBetween)) {
+        e.kind = WhereExpr::Kind::Between;
+        e.values.push_back(parse_where_value());
+        expect(TokenType::KeywordAnd, "Expected AND in BETWEEN");
+        e.values.push_back(parse_where_value());
+    } else {
+        if (negate) throw std::runtime_error("Expected IN or BETWEEN after NOT");
+        auto op = parse_compare_op();
+        if (!op) throw std::runtime_error("Expected comparison operator in WHERE");
+        WhereValue v = parse_where_value();
+        return WhereCond{std::move(col), *op, std::move(v.text), v.param};
+    }
+    e.cond.column = std::move(col);
+    if (!negate) return e;
+    return WhereExpr(WhereExpr::Kind::Not, {std::move(e)});
+}
+
+WhereValue Parser::parse_where_value() {
+    if (current().type == TokenType::Parameter) return {"", parse_param()};
+    if (current().type != TokenType::Integer && current().type != TokenType::String && current().type != TokenType::Identifier)
+        throw std::runtime_error("Expected literal value in WHERE");
+    WhereValue v{std::string(current().text), std::nullopt};
+    advance();
+    return v;
+}
+
+// column, or COUNT(*) / COUNT(col) / SUM / MIN / MAX / AVG(col)
+SelectItem Parser::parse_select_item() {
+    std::optional<AggFunc> agg;
+    switch (current().type) {
+        case TokenType::KeywordCount: agg = AggFunc::Count; break;
+        case TokenType::KeywordSum: agg = AggFunc::Sum; break;
+        case TokenType::KeywordMin: agg = AggFunc::Min; break;
+        case TokenType::KeywordMax: agg = AggFunc::Max; break;
+        case TokenType::KeywordAvg: agg = AggFunc::Avg; break;
+        default: return SelectItem{parse_column_name(), std::nullopt};
+    }
+    advance();
+    expect(TokenType::LParen, "Expected '(' after aggregate function");
+    SelectItem item{"", agg};
+    if (*agg == AggFunc::Count && accept(TokenType::Star)) {
+        // COUNT(*) counts rows
+    } else {
+        item.column = parse_column_name();
+    }
+    expect(TokenType::RParen, "Expected ')' after aggregate argument");
+    return item;
+}
+
 SelectStmt Parser::parse_select() {
     expect(TokenType::KeywordSelect, "Expected SELECT");
     SelectStmt stmt;
@@ -118,7 +348,7 @@ SelectStmt Parser::parse_select() {
         while (true) {
             if (!first) expect(TokenType::Comma, "Expected ',' between column names");
             first = false;
-            stmt.columns.push_back(parse_column_name());
+            stmt.items.push_back(parse_select_item());
             if (current().type != TokenType::Comma) break;
         }
     }
@@ -128,39 +358,69 @@ SelectStmt Parser::parse_select() {
     if (current().type != TokenType::Identifier) throw std::runtime_error("Expected table name after FROM");
     stmt.table = current().text; advance();
     
-    // Optional INNER JOIN or JOIN
-    bool sawInner = accept(TokenType::KeywordInner);
-    if (sawInner || current().type == TokenType::KeywordJoin) {
+    // Any number of [INNER] JOIN t ON a = b
+    while (accept(TokenType::KeywordInner) || current().type == TokenType::KeywordJoin) {
         expect(TokenType::KeywordJoin, "Expected JOIN");
         if (current().type != TokenType::Identifier) throw std::runtime_error("Expected right table name after JOIN");
-        std::string right = current().text; advance();
+        std::string right(current().text); advance();
         expect(TokenType::KeywordOn, "Expected ON");
         std::string left_col = parse_column_name();
-        expect(TokenType::Equal, "Expected '=' in JOIN condition");
+        auto op = parse_compare_op();
+        if (!op) throw std::runtime_error("Expected comparison operator in JOIN condition");
         std::string right_col = parse_column_name();
-        stmt.join = JoinClause{right, left_col, right_col};
+        stmt.joins.push_back(JoinClause{std::move(right), std::move(left_col), std::move(right_col), *op});
     }
 
     // check for optional WHERE clause
-    if (accept(TokenType::KeywordWhere)) {
-        std::string col = parse_column_name();
-        std::string op;
-        switch(current().type) {
-            case TokenType::Equal: op = "="; break;
-            case TokenType::NotEqual: op = "!="; break;
-            case TokenType::Less: op = "<"; break;
-            case TokenType::LessEqual: op = "<="; break;
-            case TokenType::Greater: op = ">"; break;
-            case TokenType::GreaterEqual: op = ">="; break;
-            default: throw std::runtime_error("Expected comparison operator in WHERE");
-        }
-        advance();
-        if (current().type != TokenType::Integer && current().type != TokenType::String && current().type != TokenType::Identifier)
-            throw std::runtime_error("Expected literal value in WHERE");
-        std::string value = current().text; advance();
-        stmt.where = WhereCond{col, op, value};
+    if (accept(TokenType::KeywordWhere)) stmt.where = parse_or();
+
+    // Optional GROUP BY col[, col]
+    if (accept(TokenType::KeywordGroup)) {
+        expect(TokenType::KeywordBy, "Expected BY after GROUP");
+        do { stmt.group_by.push_back(parse_column_name()); } while (accept(TokenType::Comma));
+    }
+
+    // Optional ORDER BY item [ASC|DESC][, ...]
+    if (accept(TokenType::KeywordOrder)) {
+        expect(TokenType::KeywordBy, "Expected BY after ORDER");
+        do {
+            OrderItem o{parse_select_item()};
+            if (accept(TokenType::KeywordDesc)) o.desc = true;
+            else accept(TokenType::KeywordAsc);
+            stmt.order_by.push_back(std::move(o));
+        } while (accept(TokenType::Comma));
+    }
+
+    // Optional LIMIT n [OFFSET m]
+    if (accept(TokenType::KeywordLimit)) {
+        stmt.limit = parse_row_count("LIMIT");
+        if (accept(TokenType::KeywordOffset)) stmt.offset = parse_row_count("OFFSET");
     }
     return stmt;
 }
 
+// Digits of an Integer or $n token; the lexer only lets digits through
+static size_t parse_count(std::string_view digits) {
+    size_t n = 0;
+    if (std::from_chars(digits.data(), digits.data() + digits.size(), n).ec == std::errc::result_out_of_range)
+        throw std::runtime_error("Number out of range: " + std::string(digits));
+    return n;
+}
+
+size_t Parser::parse_param() {
+    std::string_view text = current().text;
+    size_t n = text.empty() ? ++next_param_ : parse_count(text);
+    if (n == 0) throw std::runtime_error("Parameters are numbered from $1");
+    advance();
+    return n - 1;
+}
+
+size_t Parser::parse_row_count(char const* clause) {
+    if (current().type != TokenType::Integer)
+        throw std::runtime_error(std::string("Expected row count after ") + clause);
+    size_t n = parse_count(current().text);
+    advance();
+    return n;
+}
+
 }
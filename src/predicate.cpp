@@ -0,0 +1,651 @@
+#include "inmemdb/predicate.hpp"
+#include "inmemdb/simd.hpp"
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace inmemdb {
+
+template <CompareOp Op, typename T>
+static inline bool apply(T const& a, T const& b) {
+    if constexpr (Op == CompareOp::Eq) return a == b;
+    else if constexpr (Op == CompareOp::Ne) return a != b;
+    else if constexpr (Op == CompareOp::Lt) return a < b;
+    else if constexpr (Op == CompareOp::Le) return a <= b;
+    else if constexpr (Op == CompareOp::Gt) return a > b;
+    else return a >= b;
+}
+
+// What [min, max] decides for `x op v` over every x in it
+template <CompareOp Op, typename T>
+static Zone zone_test(T const& v, T const& min, T const& max) {
+    if constexpr (Op == CompareOp::Eq) return v < min || v > max ? Zone::None : min == max ? Zone::All : Zone::Some;
+    else if constexpr (Op == CompareOp::Ne) return v < min || v > max ? Zone::All : min == max ? Zone::None : Zone::Some;
+    else if constexpr (Op == CompareOp::Lt) return max < v ? Zone::All : min >= v ? Zone::None : Zone::Some;
+    else if constexpr (Op == CompareOp::Le) return max <= v ? Zone::All : min > v ? Zone::None : Zone::Some;
+    else if constexpr (Op == CompareOp::Gt) return min > v ? Zone::All : max <= v ? Zone::None : Zone::Some;
+    else return min >= v ? Zone::All : max < v ? Zone::None : Zone::Some;
+}
+
+// Rows [begin, end) of a sealed segment, evaluated on its encoding; `first`
+// is added to every row written. When the zone test leaves rows undecided v
+// lies in [min, max], so for BitPacked it maps to the code v - min and the
+// codes are compared without being decoded. RunLength tests once per run.
+template <CompareOp Op>
+static size_t segment_range(Predicate const& p, IntSegment const& seg, size_t begin, size_t end, size_t first, size_t* sel) {
+    int64_t const v = p.int_value;
+    size_t n = 0;
+    switch (zone_test<Op, int64_t>(v, seg.min, seg.max)) {
+        case Zone::None: return 0;
+        case Zone::All:
+            for (size_t r = begin; r < end; ++r) sel[n++] = first + r;
+            return n;
+        case Zone::Some: break;
+    }
+    constexpr size_t kBlock = IntSegment::kBlockRows;
+    switch (seg.encoding) {
+        case IntEncoding::Plain:
+            n = p.int_kernel(seg.values.data(), begin, end, v, sel);
+            for (size_t i = 0; i < n; ++i) sel[i] += first;
+            return n;
+        case IntEncoding::BitPacked: {
+            uint64_t const code = static_cast<uint64_t>(v) - static_cast<uint64_t>(seg.min);
+            uint64_t codes[kBlock];
+            for (size_t b = begin / kBlock; b * kBlock < end; ++b) {
+                seg.unpack(b, codes);
+                size_t lo = std::max(begin, b * kBlock), hi = std::min(end, (b + 1) * kBlock);
+                for (size_t r = lo; r < hi; ++r) { sel[n] = first + r; n += apply<Op>(codes[r - b * kBlock], code); }
+            }
+            return n;
+        }
+        case IntEncoding::Delta: {
+            int64_t values[kBlock];
+            for (size_t b = begin / kBlock; b * kBlock < end; ++b) {
+                size_t lo = std::max(begin, b * kBlock), hi = std::min(end, (b + 1) * kBlock);
+                seg.decode(lo, hi, values);
+                for (size_t r = lo; r < hi; ++r) { sel[n] = first + r; n += apply<Op>(values[r - lo], v); }
+            }
+            return n;
+        }
+        case IntEncoding::RunLength: {
+            auto const& ends = seg.run_ends;
+            size_t k = static_cast<size_t>(std::upper_bound(ends.begin(), ends.end(), begin) - ends.begin());
+            for (size_t r = begin; r < end; ++k) {
+                size_t stop = std::min<size_t>(end, ends[k]);
+                if (apply<Op>(seg.values[k], v))
+                    for (; r < stop; ++r) sel[n++] = first + r;
+                r = stop;
+            }
+            return n;
+        }
+    }
+    return n;
+}
+
+// INT range filters: sealed segments on their encoding, the plain tail
+// through the SIMD kernel chosen by compile_predicate()
+template <CompareOp Op>
+static size_t int_range(Predicate const& p, size_t begin, size_t end, size_t* sel) {
+    IntColumn const& col = *p.ints;
+    size_t const sealed = col.sealed_rows();
+    size_t n = 0;
+    while (begin < std::min(end, sealed)) {
+        size_t first = begin - begin % IntColumn::kSegmentRows;
+        size_t stop = std::min(end, first + IntColumn::kSegmentRows);
+        n += segment_range<Op>(p, *col.segments[first / IntColumn::kSegmentRows], begin - first, stop - first, first, sel + n);
+        begin = stop;
+    }
+    if (begin < end) {
+        size_t m = p.int_kernel(col.tail.data(), begin - sealed, end - sealed, p.int_value, sel + n);
+        for (size_t i = n; i < n + m; ++i) sel[i] += sealed;
+        n += m;
+    }
+    return n;
+}
+
+// The remaining kernels write every candidate and advance only on a match,
+// which keeps the loops branch-free
+
+template <CompareOp Op>
+static size_t int_gather(Predicate const& p, size_t const* rows, size_t count, size_t* pos) {
+    int64_t const v = p.int_value;
+    int64_t values[1024];
+    size_t n = 0;
+    for (size_t i = 0; i < count; i += std::size(values)) {
+        size_t m = std::min(count - i, std::size(values));
+        p.ints->gather(rows + i, m, values);
+        for (size_t j = 0; j < m; ++j) { pos[n] = i + j; n += apply<Op>(values[j], v); }
+    }
+    return n;
+}
+
+template <CompareOp Op>
+static size_t text_range(Predicate const& p, size_t begin, size_t end, size_t* sel) {
+    TextColumn const& col = *p.texts;
+    std::string_view const v = p.text_value;
+    size_t n = 0;
+    for (size_t r = begin; r < end; ++r) { sel[n] = r; n += apply<Op>(col.at(r), v); }
+    return n;
+}
+
+template <CompareOp Op>
+static size_t text_gather(Predicate const& p, size_t const* rows, size_t count, size_t* pos) {
+    TextColumn const& col = *p.texts;
+    std::string_view const v = p.text_value;
+    size_t n = 0;
+    for (size_t i = 0; i < count; ++i) { pos[n] = i; n += apply<Op>(col.at(rows[i]), v); }
+    return n;
+}
+
+// Dictionary columns: = and != compare the literal's code; the other
+// operators look each code up in a match table built once from the dictionary
+
+template <bool Equal>
+static size_t dict_code_range(Predicate const& p, size_t begin, size_t end, size_t* sel) {
+    uint32_t const* codes = p.dict->codes.data();
+    uint32_t const code = p.code;
+    size_t n = 0;
+    for (size_t r = begin; r < end; ++r) { sel[n] = r; n += (codes[r] == code) == Equal; }
+    return n;
+}
+
+template <bool Equal>
+static size_t dict_code_gather(Predicate const& p, size_t const* rows, size_t count, size_t* pos) {
+    uint32_t const* codes = p.dict->codes.data();
+    uint32_t const code = p.code;
+    size_t n = 0;
+    for (size_t i = 0; i < count; ++i) { pos[n] = i; n += (codes[rows[i]] == code) == Equal; }
+    return n;
+}
+
+static size_t dict_table_range(Predicate const& p, size_t begin, size_t end, size_t* sel) {
+    uint32_t const* codes = p.dict->codes.data();
+    uint8_t const* match = p.code_match.data();
+    size_t n = 0;
+    for (size_t r = begin; r < end; ++r) { sel[n] = r; n += match[codes[r]]; }
+    return n;
+}
+
+static size_t dict_table_gather(Predicate const& p, size_t const* rows, size_t count, size_t* pos) {
+    uint32_t const* codes = p.dict->codes.data();
+    uint8_t const* match = p.code_match.data();
+    size_t n = 0;
+    for (size_t i = 0; i < count; ++i) { pos[n] = i; n += match[codes[rows[i]]]; }
+    return n;
+}
+
+// IN and BETWEEN. Both test values against a span [lo, hi] first: the
+// BETWEEN bounds, or the smallest and largest IN value, so an IN only
+// hashes values inside its span
+
+// What [min, max] decides for a value in [lo, hi] (BETWEEN) or in an IN
+// list spanning [lo, hi]
+template <Predicate::Kind K, typename T>
+static Zone span_test(T const& lo, T const& hi, T const& min, T const& max) {
+    if (max < lo || min > hi) return Zone::None;
+    if constexpr (K == Predicate::Kind::Between) if (lo <= min && max <= hi) return Zone::All;
+    return Zone::Some;
+}
+
+template <Predicate::Kind K>
+static inline bool int_test(Predicate const& p, int64_t v) {
+    // One unsigned compare for lo <= v <= hi; compile_between() rules out lo > hi
+    bool in_span = static_cast<uint64_t>(v) - static_cast<uint64_t>(p.int_value) <=
+                   static_cast<uint64_t>(p.int_high) - static_cast<uint64_t>(p.int_value);
+    if constexpr (K == Predicate::Kind::Between) return in_span;
+    else return in_span && p.int_set.count(v);
+}
+
+template <Predicate::Kind K>
+static inline bool text_test(Predicate const& p, std::string_view v) {
+    if constexpr (K == Predicate::Kind::Between) return v >= p.text_value && v <= p.text_high;
+    else return p.text_set.find(v) != p.text_set.end();
+}
+
+// Sealed segments that the span settles are not decoded; the others are
+// decoded a zone block at a time
+template <Predicate::Kind K>
+static size_t int_span_range(Predicate const& p, size_t begin, size_t end, size_t* sel) {
+    IntColumn const& col = *p.ints;
+    size_t const sealed = col.sealed_rows();
+    int64_t values[kZoneRows];
+    size_t n = 0;
+    while (begin < end) {
+        size_t stop = std::min(end, begin + kZoneRows);
+        int64_t const* v = values;
+        if (begin < sealed) {
+            size_t first = begin - begin % IntColumn::kSegmentRows;
+            IntSegment const& seg = *col.segments[first / IntColumn::kSegmentRows];
+            Zone z = span_test<K, int64_t>(p.int_value, p.int_high, seg.min, seg.max);
+            if (z != Zone::Some) {
+                stop = std::min(end, first + IntColumn::kSegmentRows);
+                if (z == Zone::All)
+                    for (size_t r = begin; r < stop; ++r) sel[n++] = r;
+                begin = stop;
+                continue;
+            }
+            stop = std::min(stop, first + IntColumn::kSegmentRows);
+            seg.decode(begin - first, stop - first, values);
+        } else {
+            v = col.tail.data() + (begin - sealed);
+        }
+        for (size_t r = begin; r < stop; ++r) { sel[n] = r; n += int_test<K>(p, v[r - begin]); }
+        begin = stop;
+    }
+    return n;
+}
+
+template <Predicate::Kind K>
+static size_t int_span_gather(Predicate const& p, size_t const* rows, size_t count, size_t* pos) {
+    int64_t values[kZoneRows];
+    size_t n = 0;
+    for (size_t i = 0; i < count; i += std::size(values)) {
+        size_t m = std::min(count - i, std::size(values));
+        p.ints->gather(rows + i, m, values);
+        for (size_t j = 0; j < m; ++j) { pos[n] = i + j; n += int_test<K>(p, values[j]); }
+    }
+    return n;
+}
+
+template <Predicate::Kind K>
+static size_t text_span_range(Predicate const& p, size_t begin, size_t end, size_t* sel) {
+    TextColumn const& col = *p.texts;
+    size_t n = 0;
+    for (size_t r = begin; r < end; ++r) { sel[n] = r; n += text_test<K>(p, col.at(r)); }
+    return n;
+}
+
+template <Predicate::Kind K>
+static size_t text_span_gather(Predicate const& p, size_t const* rows, size_t count, size_t* pos) {
+    TextColumn const& col = *p.texts;
+    size_t n = 0;
+    for (size_t i = 0; i < count; ++i) { pos[n] = i; n += text_test<K>(p, col.at(rows[i])); }
+    return n;
+}
+
+// BETWEEN with low > high
+static size_t no_range(Predicate const&, size_t, size_t, size_t*) { return 0; }
+static size_t no_gather(Predicate const&, size_t const*, size_t, size_t*) { return 0; }
+static Zone no_zone(Predicate const&, size_t) { return Zone::None; }
+
+// Zone-map verdicts per block
+
+template <CompareOp Op>
+static Zone int_zone(Predicate const& p, size_t b) {
+    IntZone const& z = p.ints->zones[b];
+    return zone_test<Op, int64_t>(p.int_value, z.min, z.max);
+}
+
+template <CompareOp Op>
+static Zone text_zone(Predicate const& p, size_t b) {
+    TextZone const& z = p.texts->zones[b];
+    return zone_test<Op, std::string_view>(p.text_value, p.texts->at(z.min_row), p.texts->at(z.max_row));
+}
+
+template <CompareOp Op>
+static Zone dict_zone(Predicate const& p, size_t b) {
+    TextZone const& z = p.dict->zones[b];
+    return zone_test<Op, std::string_view>(p.text_value, p.dict->at(z.min_row), p.dict->at(z.max_row));
+}
+
+template <Predicate::Kind K>
+static Zone int_span_zone(Predicate const& p, size_t b) {
+    IntZone const& z = p.ints->zones[b];
+    return span_test<K, int64_t>(p.int_value, p.int_high, z.min, z.max);
+}
+
+template <Predicate::Kind K>
+static Zone text_span_zone(Predicate const& p, size_t b) {
+    TextZone const& z = p.texts->zones[b];
+    return span_test<K, std::string_view>(p.text_value, p.text_high, p.texts->at(z.min_row), p.texts->at(z.max_row));
+}
+
+template <Predicate::Kind K>
+static Zone dict_span_zone(Predicate const& p, size_t b) {
+    TextZone const& z = p.dict->zones[b];
+    return span_test<K, std::string_view>(p.text_value, p.text_high, p.dict->at(z.min_row), p.dict->at(z.max_row));
+}
+
+// Stretches of undecided blocks (and the rows past the last zone) go to the
+// kernel in one call each
+size_t Predicate::filter_zoned(size_t begin, size_t end, size_t* sel) const {
+    size_t n = 0, pending = begin;
+    for (size_t r = begin; r < end && r / kZoneRows < zones;) {
+        size_t stop = std::min(end, (r / kZoneRows + 1) * kZoneRows);
+        Zone z = zone(*this, r / kZoneRows);
+        if (z != Zone::Some) {
+            if (pending < r) n += range(*this, pending, r, sel + n);
+            if (z == Zone::All)
+                for (size_t i = r; i < stop; ++i) sel[n++] = i;
+            pending = stop;
+        }
+        r = stop;
+    }
+    if (pending < end) n += range(*this, pending, end, sel + n);
+    return n;
+}
+
+// Kernel tables indexed by CompareOp
+#define INMEMDB_KERNELS(k) { k<CompareOp::Eq>, k<CompareOp::Ne>, k<CompareOp::Lt>, \
+                             k<CompareOp::Le>, k<CompareOp::Gt>, k<CompareOp::Ge> }
+static constexpr Predicate::RangeKernel kIntRange[] = INMEMDB_KERNELS(int_range);
+static constexpr Predicate::GatherKernel kIntGather[] = INMEMDB_KERNELS(int_gather);
+static constexpr Predicate::RangeKernel kTextRange[] = INMEMDB_KERNELS(text_range);
+static constexpr Predicate::GatherKernel kTextGather[] = INMEMDB_KERNELS(text_gather);
+static constexpr Predicate::ZoneKernel kIntZone[] = INMEMDB_KERNELS(int_zone);
+static constexpr Predicate::ZoneKernel kTextZone[] = INMEMDB_KERNELS(text_zone);
+static constexpr Predicate::ZoneKernel kDictZone[] = INMEMDB_KERNELS(dict_zone);
+#undef INMEMDB_KERNELS
+
+// Relative per-row costs: an INT compare or dictionary code test is 1
+static constexpr double kTextCost = 4;    // string compare
+static constexpr double kSpanCost = 1.5;  // INT BETWEEN, decoded rather than run on the encoding
+static constexpr double kIntSetCost = 3;  // INT IN, hashing the values inside the list's span
+static constexpr double kTextSetCost = 8; // TEXT IN, hashing every string
+
+Predicate compile_predicate(ColumnData const& column, CompareOp op, Value const& literal) {
+    Predicate p;
+    p.op = op;
+    auto k = static_cast<size_t>(op);
+    if (auto ic = std::get_if<IntColumn>(&column)) {
+        auto v = std::get_if<int64_t>(&literal);
+        if (!v) throw std::runtime_error("Type mismatch in comparison");
+        p.ints = ic;
+        p.int_value = *v;
+        p.int_kernel = int_filter_kernel(op);
+        p.cost = 1;
+        p.range = kIntRange[k];
+        p.gather = kIntGather[k];
+        p.zone = kIntZone[k];
+        p.zones = ic->zones.size();
+    } else {
+        auto v = std::get_if<std::string>(&literal);
+        if (!v) throw std::runtime_error("Type mismatch in comparison");
+        p.text_value = *v;
+        if (auto dc = std::get_if<DictColumn>(&column)) {
+            p.dict = dc;
+            p.zone = kDictZone[k];
+            p.zones = dc->zones.size();
+            p.cost = 1;
+            if (op == CompareOp::Eq || op == CompareOp::Ne) {
+                p.code = dc->find(*v);
+                p.range = op == CompareOp::Eq ? dict_code_range<true> : dict_code_range<false>;
+                p.gather = op == CompareOp::Eq ? dict_code_gather<true> : dict_code_gather<false>;
+            } else {
+                // Run the TEXT kernel over the distinct values once
+                Predicate on_dict;
+                on_dict.texts = &dc->dict;
+                on_dict.text_value = *v;
+                on_dict.range = kTextRange[k];
+                std::vector<size_t> hits(dc->dict.size());
+                hits.resize(on_dict.filter(size_t{0}, dc->dict.size(), hits.data()));
+                p.code_match.assign(dc->dict.size(), 0);
+                for (size_t c : hits) p.code_match[c] = 1;
+                p.range = dict_table_range;
+                p.gather = dict_table_gather;
+            }
+        } else {
+            p.texts = &std::get<TextColumn>(column);
+            p.cost = kTextCost;
+            p.zone = kTextZone[k];
+            p.zones = p.texts->zones.size();
+            p.range = kTextRange[k];
+            p.gather = kTextGather[k];
+        }
+    }
+    return p;
+}
+
+// IN and BETWEEN share their setup: the span [lo, hi] in int_value/int_high
+// or text_value/text_high, then kernels per column kind. A dictionary column
+// tests each distinct value once into a per-code match table.
+template <Predicate::Kind K>
+static void compile_span(Predicate& p, ColumnData const& column) {
+    if (auto ic = std::get_if<IntColumn>(&column)) {
+        p.ints = ic;
+        p.cost = K == Predicate::Kind::Between ? kSpanCost : kIntSetCost;
+        p.range = int_span_range<K>;
+        p.gather = int_span_gather<K>;
+        p.zone = int_span_zone<K>;
+        p.zones = ic->zones.size();
+    } else if (auto dc = std::get_if<DictColumn>(&column)) {
+        p.dict = dc;
+        p.cost = 1;
+        p.code_match.assign(dc->dict.size(), 0);
+        for (size_t c = 0; c < dc->dict.size(); ++c) p.code_match[c] = text_test<K>(p, dc->dict.at(c));
+        p.range = dict_table_range;
+        p.gather = dict_table_gather;
+        p.zone = dict_span_zone<K>;
+        p.zones = dc->zones.size();
+    } else {
+        p.texts = &std::get<TextColumn>(column);
+        p.cost = K == Predicate::Kind::Between ? kTextCost : kTextSetCost;
+        p.range = text_span_range<K>;
+        p.gather = text_span_gather<K>;
+        p.zone = text_span_zone<K>;
+        p.zones = p.texts->zones.size();
+    }
+}
+
+Predicate compile_in(ColumnData const& column, std::vector<Value> const& list) {
+    Predicate p;
+    p.kind = Predicate::Kind::In;
+    bool ints = std::holds_alternative<IntColumn>(column);
+    for (size_t i = 0; i < list.size(); ++i) {
+        if (ints) {
+            auto v = std::get_if<int64_t>(&list[i]);
+            if (!v) throw std::runtime_error("Type mismatch in IN list");
+            p.int_set.insert(*v);
+            p.int_value = i == 0 ? *v : std::min(p.int_value, *v);
+            p.int_high = i == 0 ? *v : std::max(p.int_high, *v);
+        } else {
+            auto v = std::get_if<std::string>(&list[i]);
+            if (!v) throw std::runtime_error("Type mismatch in IN list");
+            p.text_set.insert(*v);
+            if (i == 0 || *v < p.text_value) p.text_value = *v;
+            if (i == 0 || *v > p.text_high) p.text_high = *v;
+        }
+    }
+    compile_span<Predicate::Kind::In>(p, column);
+    return p;
+}
+
+Predicate compile_between(ColumnData const& column, Value const& low, Value const& high) {
+    Predicate p;
+    p.kind = Predicate::Kind::Between;
+    bool empty;
+    if (std::holds_alternative<IntColumn>(column)) {
+        auto lo = std::get_if<int64_t>(&low), hi = std::get_if<int64_t>(&high);
+        if (!lo || !hi) throw std::runtime_error("Type mismatch in BETWEEN");
+        p.int_value = *lo;
+        p.int_high = *hi;
+        empty = *lo > *hi;
+    } else {
+        auto lo = std::get_if<std::string>(&low), hi = std::get_if<std::string>(&high);
+        if (!lo || !hi) throw std::runtime_error("Type mismatch in BETWEEN");
+        p.text_value = *lo;
+        p.text_high = *hi;
+        empty = *lo > *hi;
+    }
+    compile_span<Predicate::Kind::Between>(p, column);
+    if (empty) {
+        p.range = no_range;
+        p.gather = no_gather;
+        p.zone = no_zone;
+    }
+    return p;
+}
+
+// Smallest and largest value of an INT column: segment headers for the
+// sealed rows, zones and then the values for the tail; false when empty
+static bool int_bounds(IntColumn const& col, int64_t& min, int64_t& max) {
+    if (col.size() == 0) return false;
+    min = INT64_MAX;
+    max = INT64_MIN;
+    auto widen = [&](int64_t lo, int64_t hi) { min = std::min(min, lo); max = std::max(max, hi); };
+    for (auto const& seg : col.segments) widen(seg->min, seg->max);
+    size_t r = col.sealed_rows();
+    for (; r / kZoneRows < col.zones.size(); r += kZoneRows) widen(col.zones[r / kZoneRows].min, col.zones[r / kZoneRows].max);
+    for (; r < col.size(); ++r) widen(col.at(r), col.at(r));
+    return true;
+}
+
+double estimate_selectivity(Predicate const& p) {
+    using Kind = Predicate::Kind;
+    if (p.dict) {
+        // Codes are assumed equally frequent
+        double codes = static_cast<double>(p.dict->dict.size());
+        if (codes == 0) return 0;
+        if (p.code_match.empty()) {
+            double eq = p.code == DictColumn::kNoCode ? 0 : 1 / codes;
+            return p.op == CompareOp::Eq ? eq : 1 - eq;
+        }
+        return static_cast<double>(std::count(p.code_match.begin(), p.code_match.end(), 1)) / codes;
+    }
+    if (p.ints) {
+        // Values are assumed spread evenly over [min, max]
+        int64_t min, max;
+        if (!int_bounds(*p.ints, min, max)) return 0;
+        double lo = static_cast<double>(min), span = static_cast<double>(max) - lo + 1;
+        double eq = 1 / std::min(span, static_cast<double>(p.ints->size()));
+        auto below = [&](int64_t v) { return std::clamp((static_cast<double>(v) - lo) / span, 0.0, 1.0); };
+        auto inside = [&](int64_t v) { return v >= min && v <= max; };
+        int64_t v = p.int_value;
+        if (p.kind == Kind::Between) return std::max(0.0, below(p.int_high) + eq - below(v));
+        if (p.kind == Kind::In)
+            return std::min(1.0, eq * static_cast<double>(std::count_if(p.int_set.begin(), p.int_set.end(), inside)));
+        switch (p.op) {
+            case CompareOp::Eq: return inside(v) ? eq : 0;
+            case CompareOp::Ne: return inside(v) ? 1 - eq : 1;
+            case CompareOp::Lt: return below(v);
+            case CompareOp::Le: return std::min(1.0, below(v) + eq);
+            case CompareOp::Gt: return std::max(0.0, 1 - below(v) - eq);
+            case CompareOp::Ge: return 1 - below(v);
+        }
+    }
+    // Plain TEXT keeps no statistics
+    if (p.kind == Kind::Between) return 0.25;
+    if (p.kind == Kind::In) return std::min(1.0, 0.05 * static_cast<double>(p.text_set.size()));
+    return p.op == CompareOp::Eq ? 0.05 : p.op == CompareOp::Ne ? 0.95 : 1.0 / 3;
+}
+
+Filter Filter::leaf(Predicate p) {
+    Filter f;
+    f.selectivity = estimate_selectivity(p);
+    f.cost = p.cost;
+    f.pred = std::move(p);
+    return f;
+}
+
+Filter Filter::combine(Kind kind, std::vector<Filter> children) {
+    if (children.size() == 1 && kind != Kind::Not) return std::move(children[0]);
+    Filter f;
+    f.kind = kind;
+    if (kind == Kind::Not) {
+        f.selectivity = 1 - children[0].selectivity;
+        f.cost = children[0].cost;
+        f.children = std::move(children);
+        return f;
+    }
+    bool all = kind == Kind::And;
+    auto rank = [all](Filter const& c) { return c.cost / std::max(all ? 1 - c.selectivity : c.selectivity, 1e-9); };
+    std::stable_sort(children.begin(), children.end(), [&](Filter const& a, Filter const& b) { return rank(a) < rank(b); });
+    // Expected work per input row, and the fraction of rows each child still sees
+    double reach = 1;
+    f.cost = 0;
+    for (auto const& c : children) {
+        f.cost += reach * c.cost;
+        reach *= all ? c.selectivity : 1 - c.selectivity;
+    }
+    f.selectivity = all ? reach : 1 - reach;
+    f.children = std::move(children);
+    return f;
+}
+
+// Compound filters work through blocks of this many rows with scratch on the stack
+static constexpr size_t kFilterBlock = kZoneRows;
+
+size_t Filter::filter(size_t begin, size_t end, size_t* sel) const {
+    if (kind == Kind::Leaf) return pred.filter(begin, end, sel);
+    if (kind == Kind::And) {
+        // The first child filters the range itself, with zone maps and
+        // encoded segments; the others narrow what it kept, in place
+        size_t n = children[0].filter(begin, end, sel);
+        size_t pos[kFilterBlock];
+        for (size_t c = 1; c < children.size() && n > 0; ++c) {
+            size_t kept = 0;
+            for (size_t i = 0; i < n; i += kFilterBlock) {
+                size_t k = children[c].filter(sel + i, std::min(kFilterBlock, n - i), pos);
+                for (size_t j = 0; j < k; ++j) sel[kept++] = sel[i + pos[j]];
+            }
+            n = kept;
+        }
+        return n;
+    }
+    size_t rows[kFilterBlock], pos[kFilterBlock], n = 0;
+    for (size_t b = begin; b < end; b += kFilterBlock) {
+        size_t m = std::min(kFilterBlock, end - b);
+        std::iota(rows, rows + m, b);
+        size_t k = filter_block(rows, m, pos);
+        for (size_t j = 0; j < k; ++j) sel[n++] = b + pos[j];
+    }
+    return n;
+}
+
+size_t Filter::filter(size_t const* rows, size_t n, size_t* pos) const {
+    if (kind == Kind::Leaf) return pred.filter(rows, n, pos);
+    size_t out = 0;
+    for (size_t i = 0; i < n; i += kFilterBlock) {
+        size_t k = filter_block(rows + i, std::min(kFilterBlock, n - i), pos + out);
+        for (size_t j = out; j < out + k; ++j) pos[j] += i;
+        out += k;
+    }
+    return out;
+}
+
+// A compound filter over at most kFilterBlock rows
+size_t Filter::filter_block(size_t const* rows, size_t n, size_t* pos) const {
+    size_t cand[kFilterBlock], idx[kFilterBlock], hit[kFilterBlock];
+    if (kind == Kind::And) {
+        // Survivors' rows and positions shrink child by child
+        size_t k = children[0].filter(rows, n, idx);
+        for (size_t j = 0; j < k; ++j) cand[j] = rows[idx[j]];
+        for (size_t c = 1; c < children.size() && k > 0; ++c) {
+            size_t h = children[c].filter(cand, k, hit);
+            for (size_t j = 0; j < h; ++j) { cand[j] = cand[hit[j]]; idx[j] = idx[hit[j]]; }
+            k = h;
+        }
+        std::copy(idx, idx + k, pos);
+        return k;
+    }
+    uint8_t matched[kFilterBlock] = {};
+    if (kind == Kind::Not) {
+        size_t h = children[0].filter(rows, n, hit);
+        for (size_t j = 0; j < h; ++j) matched[hit[j]] = 1;
+    } else {
+        // Each child only tests the rows no earlier child matched
+        size_t k = n;
+        std::copy(rows, rows + n, cand);
+        std::iota(idx, idx + n, size_t{0});
+        for (size_t c = 0; c < children.size() && k > 0; ++c) {
+            size_t h = children[c].filter(cand, k, hit);
+            for (size_t j = 0; j < h; ++j) matched[idx[hit[j]]] = 1;
+            size_t rest = 0;
+            for (size_t j = 0; j < k; ++j) {
+                cand[rest] = cand[j];
+                idx[rest] = idx[j];
+                rest += !matched[idx[j]];
+            }
+            k = rest;
+        }
+    }
+    bool want = kind == Kind::Or;
+    size_t k = 0;
+    for (size_t i = 0; i < n; ++i) { pos[k] = i; k += matched[i] == want; }
+    return k;
+}
+
+} // namespace inmemdb
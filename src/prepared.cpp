@@ -0,0 +1,122 @@
+#include "inmemdb/storage.hpp"
+#include "inmemdb/lexer.hpp"
+
+namespace inmemdb {
+
+// Cache key: the tokens separated by single spaces with keywords spelled
+// upper case, so layout and keyword case do not matter; string literals are
+// quoted to stay distinct from names
+static std::string normalize_sql(std::string const& sql) {
+    Lexer lex(sql);
+    std::string key;
+    for (Token t = lex.next(); t.type != TokenType::End; t = lex.next()) {
+        if (!key.empty()) key += ' ';
+        if (t.type == TokenType::String) {
+            key += '\'';
+            for (char c : t.text) {
+                if (c == '\'' || c == '\\') key += '\\';
+                key += c;
+            }
+            key += '\'';
+        } else if (t.type == TokenType::Parameter) {
+            key += t.text.empty() ? "?" : "$";
+            key += t.text;
+        } else if (t.type == TokenType::Identifier || t.type == TokenType::Integer) {
+            key += t.text;
+        } else {
+            key += to_string(t.type);
+        }
+    }
+    while (key.size() >= 1 && key.back() == ';') key.resize(key.size() >= 2 ? key.size() - 2 : 0);
+    return key;
+}
+
+// One past the highest placeholder in a WHERE tree
+static size_t param_count(WhereExpr const& e) {
+    size_t n = e.cond.param ? *e.cond.param + 1 : 0;
+    for (auto const& v : e.values) if (v.param) n = std::max(n, *v.param + 1);
+    for (auto const& c : e.children) n = std::max(n, param_count(c));
+    return n;
+}
+
+static size_t param_count(Statement const& stmt) {
+    size_t n = 0;
+    if (auto sel = std::get_if<SelectStmt>(&stmt)) {
+        if (sel->where) n = param_count(*sel->where);
+    } else if (auto ins = std::get_if<InsertStmt>(&stmt)) {
+        for (auto const& [_, p] : ins->params) n = std::max(n, p + 1);
+    }
+    return n;
+}
+
+std::shared_ptr<SelectPlan const> Database::plan_select(SelectStmt const& stmt) const {
+    auto snaps = Cursor::snapshot(*this, stmt.tables());
+    std::vector<Table const*> tables;
+    for (auto const& t : snaps) tables.push_back(t.get());
+    return Cursor::plan(tables, stmt);
+}
+
+std::shared_ptr<PreparedStatement const> Database::prepare(std::string const& sql) {
+    std::string key = normalize_sql(sql);
+    uint64_t version = schema_version_;
+    {
+        std::lock_guard<std::mutex> lock(plan_mu_);
+        auto it = plan_cache_.find(key);
+        if (it != plan_cache_.end() && it->second->second->schema_version == version) {
+            plan_lru_.splice(plan_lru_.begin(), plan_lru_, it->second);
+            ++plan_hits_;
+            return it->second->second;
+        }
+        ++plan_misses_;
+    }
+
+    // Parse and plan without the lock; a concurrent miss on the same text
+    // just plans twice
+    auto stmts = Parser(Lexer(sql)).parse_all();
+    if (stmts.size() != 1) throw std::runtime_error("PREPARE needs exactly one statement");
+    auto ps = std::make_shared<PreparedStatement>();
+    ps->stmt = std::move(stmts[0]);
+    ps->params = param_count(ps->stmt);
+    ps->schema_version = version;
+    if (auto sel = std::get_if<SelectStmt>(&ps->stmt)) ps->plan = plan_select(*sel);
+
+    std::lock_guard<std::mutex> lock(plan_mu_);
+    auto it = plan_cache_.find(key);
+    if (it != plan_cache_.end()) {
+        plan_lru_.erase(it->second);
+        plan_cache_.erase(it);
+    }
+    plan_lru_.emplace_front(key, ps);
+    plan_cache_.emplace(std::move(key), plan_lru_.begin());
+    while (plan_lru_.size() > plan_capacity_) {
+        plan_cache_.erase(plan_lru_.back().first);
+        plan_lru_.pop_back();
+    }
+    return ps;
+}
+
+Cursor Database::open_cursor(PreparedStatement const& stmt, std::vector<Value> const& params, size_t dop) const {
+    auto sel = std::get_if<SelectStmt>(&stmt.stmt);
+    if (!sel) throw std::runtime_error("Prepared statement is not a SELECT");
+    if (params.size() < stmt.params)
+        throw std::runtime_error("Expected " + std::to_string(stmt.params) + " parameter(s), got " + std::to_string(params.size()));
+    // A handle kept across CREATE INDEX gets a fresh plan for this run
+    auto plan = stmt.schema_version == schema_version_ ? stmt.plan : plan_select(*sel);
+    return Cursor(*this, std::move(plan), params, dop ? dop : parallelism_);
+}
+
+void Database::set_plan_cache_capacity(size_t n) {
+    std::lock_guard<std::mutex> lock(plan_mu_);
+    plan_capacity_ = n;
+    while (plan_lru_.size() > plan_capacity_) {
+        plan_cache_.erase(plan_lru_.back().first);
+        plan_lru_.pop_back();
+    }
+}
+
+PlanCacheStats Database::plan_cache_stats() const {
+    std::lock_guard<std::mutex> lock(plan_mu_);
+    return {plan_hits_, plan_misses_, plan_lru_.size()};
+}
+
+} // namespace inmemdb
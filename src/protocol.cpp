@@ -0,0 +1,153 @@
+#include "inmemdb/protocol.hpp"
+#include "inmemdb/codec.hpp"
+#include <cstring>
+
+namespace inmemdb::wire {
+
+static void put_fixed32(std::string& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+static uint32_t get_fixed32(char const* p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+    return v;
+}
+
+size_t begin_frame(std::string& out, FrameType type, uint32_t id) {
+    size_t at = out.size();
+    put_fixed32(out, 0);
+    out.push_back(static_cast<char>(type));
+    put_fixed32(out, id);
+    return at;
+}
+
+void end_frame(std::string& out, size_t at) {
+    size_t size = out.size() - at - 4;
+    if (size > kMaxFrame) {
+        out.resize(at);
+        throw std::runtime_error("Frame of " + std::to_string(size) + " bytes exceeds the limit");
+    }
+    uint32_t len = static_cast<uint32_t>(size);
+    for (int i = 0; i < 4; ++i) out[at + i] = static_cast<char>(len >> (8 * i));
+}
+
+void append_frame(std::string& out, FrameType type, uint32_t id, std::string_view payload) {
+    size_t at = begin_frame(out, type, id);
+    out.append(payload);
+    end_frame(out, at);
+}
+
+size_t parse_frame(std::string_view buf, Frame& frame) {
+    if (buf.size() < 4) return 0;
+    uint32_t len = get_fixed32(buf.data());
+    if (len > kMaxFrame) throw std::runtime_error("Frame of " + std::to_string(len) + " bytes exceeds the limit");
+    if (len < kFrameHeader - 4) throw std::runtime_error("Frame too short");
+    if (buf.size() - 4 < len) return 0;
+    uint8_t type = static_cast<uint8_t>(buf[4]);
+    if (type < static_cast<uint8_t>(FrameType::Query) || type > static_cast<uint8_t>(FrameType::ResultPart))
+        throw std::runtime_error("Unknown frame type " + std::to_string(type));
+    frame.type = static_cast<FrameType>(type);
+    frame.id = get_fixed32(buf.data() + 5);
+    frame.payload = buf.substr(kFrameHeader, len - (kFrameHeader - 4));
+    return 4 + len;
+}
+
+static uint8_t type_code(ColumnType t) {
+    return t == ColumnType::Int ? 0 : t == ColumnType::Text ? 1 : 2;
+}
+
+void put_columns(std::string& out, std::vector<std::string> const& header, std::vector<ColumnType> const& types) {
+    ByteWriter w{out};
+    w.put_varint(header.size());
+    for (size_t c = 0; c < header.size(); ++c) {
+        w.put_u8(type_code(types[c]));
+        w.put_string(header[c]);
+    }
+}
+
+void put_rows(std::string& out, Batch const& batch) {
+    if (batch.rows == 0) return;
+    ByteWriter w{out};
+    w.put_varint(batch.rows);
+    for (auto const& col : batch.columns) {
+        if (col.type == ColumnType::Int) {
+            for (int64_t v : col.ints) w.put_svarint(v);
+        } else if (col.type == ColumnType::Real) {
+            for (double d : col.reals) {
+                char raw[sizeof d];
+                std::memcpy(raw, &d, sizeof d);
+                out.append(raw, sizeof raw);
+            }
+        } else {
+            for (size_t r = 0; r < batch.rows; ++r) w.put_string(col.text_at(r));
+        }
+    }
+}
+
+void put_status(std::string& out, bool success, std::string_view message) {
+    ByteWriter w{out};
+    w.put_varint(0);
+    w.put_u8(success ? 1 : 0);
+    w.put_string(message);
+}
+
+void put_result(std::string& out, QueryResult const& qr) {
+    put_columns(out, qr.header, std::vector<ColumnType>(qr.header.size(), ColumnType::Text));
+    Batch batch;
+    batch.columns.resize(qr.header.size());
+    for (auto& c : batch.columns) c.type = ColumnType::Text;
+    for (auto const& row : qr.rows) {
+        for (size_t c = 0; c < batch.columns.size(); ++c) batch.columns[c].push_text(c < row.size() ? row[c] : "");
+        ++batch.rows;
+    }
+    put_rows(out, batch);
+    put_status(out, qr.success, qr.message);
+}
+
+void put_error(std::string& out, std::string_view message) {
+    put_columns(out, {}, {});
+    put_status(out, false, message);
+}
+
+std::vector<StatementResult> decode_results(std::string_view payload) {
+    ByteReader r{payload};
+    size_t count = r.get_varint();
+    if (count > payload.size()) throw std::runtime_error("Bad statement count in result");
+    std::vector<StatementResult> out(count);
+    for (auto& res : out) {
+        size_t cols = r.get_varint();
+        if (cols > payload.size()) throw std::runtime_error("Bad column count in result");
+        res.rows.columns.resize(cols);
+        for (auto& col : res.rows.columns) {
+            uint8_t t = r.get_u8();
+            if (t > 2) throw std::runtime_error("Bad column type in result");
+            col.type = t == 0 ? ColumnType::Int : t == 1 ? ColumnType::Text : ColumnType::Real;
+            res.header.emplace_back(r.get_string());
+        }
+        while (size_t n = r.get_varint()) {
+            if (n > payload.size()) throw std::runtime_error("Bad row count in result");
+            for (auto& col : res.rows.columns) {
+                for (size_t i = 0; i < n; ++i) {
+                    if (col.type == ColumnType::Int) {
+                        col.push_int(r.get_svarint());
+                    } else if (col.type == ColumnType::Real) {
+                        if (payload.size() - r.pos < sizeof(double)) throw std::runtime_error("Truncated record");
+                        double d;
+                        std::memcpy(&d, payload.data() + r.pos, sizeof d);
+                        r.pos += sizeof d;
+                        col.push_real(d);
+                    } else {
+                        col.push_text(r.get_string());
+                    }
+                }
+            }
+            res.rows.rows += n;
+        }
+        res.success = r.get_u8() != 0;
+        res.message = r.get_string();
+    }
+    return out;
+}
+
+} // namespace inmemdb::wire
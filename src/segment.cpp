@@ -0,0 +1,229 @@
+#include "inmemdb/column.hpp"
+#include <array>
+#include <bit>
+#include <utility>
+
+// Sealed INT segments. Codes are unsigned offsets from `base` computed with
+// wrapping arithmetic, so any int64 range packs into at most 64 bits.
+
+namespace inmemdb {
+
+static constexpr size_t kBlock = IntSegment::kBlockRows;
+
+const char* to_string(IntEncoding e) {
+    switch (e) {
+        case IntEncoding::Plain: return "plain";
+        case IntEncoding::BitPacked: return "bitpacked";
+        case IntEncoding::Delta: return "delta";
+        case IntEncoding::RunLength: return "rle";
+    }
+    return "?";
+}
+
+// Unpack the 64 codes of one block; with B fixed every shift is a constant
+template <unsigned B>
+static void unpack_block(uint64_t const* w, uint64_t* out) {
+    if constexpr (B == 0) {
+        std::fill(out, out + kBlock, uint64_t{0});
+    } else {
+#pragma GCC unroll 64
+        for (unsigned i = 0; i < kBlock; ++i) {
+            unsigned const bit = i * B, word = bit / 64, shift = bit % 64;
+            uint64_t v = w[word] >> shift;
+            if (shift + B > 64) v |= w[word + 1] << (64 - shift);
+            if constexpr (B < 64) v &= (uint64_t{1} << B) - 1;
+            out[i] = v;
+        }
+    }
+}
+
+using UnpackFn = void (*)(uint64_t const*, uint64_t*);
+
+template <size_t... B>
+static constexpr std::array<UnpackFn, sizeof...(B)> unpack_table(std::index_sequence<B...>) {
+    return {unpack_block<B>...};
+}
+static constexpr auto kUnpack = unpack_table(std::make_index_sequence<65>{});
+
+static uint64_t extract(uint64_t const* w, unsigned bits, size_t i) {
+    if (bits == 0) return 0;
+    size_t const bit = i * bits, word = bit / 64;
+    unsigned const shift = bit % 64;
+    uint64_t v = w[word] >> shift;
+    if (shift + bits > 64) v |= w[word + 1] << (64 - shift);
+    return bits == 64 ? v : v & ((uint64_t{1} << bits) - 1);
+}
+
+static void deposit(uint64_t* w, unsigned bits, size_t i, uint64_t code) {
+    if (bits == 0) return;
+    size_t const bit = i * bits, word = bit / 64;
+    unsigned const shift = bit % 64;
+    w[word] |= code << shift;
+    if (shift + bits > 64) w[word + 1] |= code >> (64 - shift);
+}
+
+IntSegment IntSegment::encode(int64_t const* items, size_t n) {
+    IntSegment seg;
+    seg.rows = n;
+    if (n == 0) return seg;
+
+    // One pass for the value range, the run count and the step range; the
+    // first row of a block is stored whole, so its step does not count
+    int64_t lo = items[0], hi = items[0], dlo = 0, dhi = 0;
+    size_t runs = 1;
+    bool any_step = false, delta_ok = true;
+    for (size_t i = 1; i < n; ++i) {
+        lo = std::min(lo, items[i]);
+        hi = std::max(hi, items[i]);
+        runs += items[i] != items[i - 1];
+        if (i % kBlock == 0) continue;
+        int64_t d;
+        if (__builtin_sub_overflow(items[i], items[i - 1], &d)) delta_ok = false;
+        dlo = any_step ? std::min(dlo, d) : d;
+        dhi = any_step ? std::max(dhi, d) : d;
+        any_step = true;
+    }
+    seg.min = lo;
+    seg.max = hi;
+
+    size_t const blocks = seg.blocks();
+    unsigned const for_bits = std::bit_width(static_cast<uint64_t>(hi) - static_cast<uint64_t>(lo));
+    unsigned const delta_bits = std::bit_width(static_cast<uint64_t>(dhi) - static_cast<uint64_t>(dlo));
+    size_t best = n * sizeof(int64_t);
+    auto consider = [&](IntEncoding e, size_t bytes) {
+        if (bytes < best) { best = bytes; seg.encoding = e; }
+    };
+    consider(IntEncoding::BitPacked, blocks * for_bits * sizeof(uint64_t));
+    if (delta_ok) consider(IntEncoding::Delta, blocks * (delta_bits + 1) * sizeof(uint64_t));
+    consider(IntEncoding::RunLength, runs * (sizeof(int64_t) + sizeof(uint32_t)));
+
+    std::vector<uint64_t> words;
+    switch (seg.encoding) {
+        case IntEncoding::Plain:
+            seg.values.append(items, n);
+            break;
+        case IntEncoding::BitPacked:
+            seg.bits = static_cast<uint8_t>(for_bits);
+            seg.base = lo;
+            words.assign(blocks * for_bits, 0);
+            for (size_t i = 0; i < n; ++i)
+                deposit(words.data(), for_bits, i, static_cast<uint64_t>(items[i]) - static_cast<uint64_t>(lo));
+            seg.packed.append(words.data(), words.size());
+            break;
+        case IntEncoding::Delta:
+            seg.bits = static_cast<uint8_t>(delta_bits);
+            seg.base = dlo;
+            words.assign(blocks * delta_bits, 0);
+            seg.values.reserve(blocks);
+            for (size_t i = 0; i < n; ++i) {
+                if (i % kBlock == 0) { seg.values.push_back(items[i]); continue; }
+                uint64_t step = static_cast<uint64_t>(items[i]) - static_cast<uint64_t>(items[i - 1]);
+                deposit(words.data(), delta_bits, i, step - static_cast<uint64_t>(dlo));
+            }
+            seg.packed.append(words.data(), words.size());
+            break;
+        case IntEncoding::RunLength:
+            seg.values.reserve(runs);
+            seg.run_ends.reserve(runs);
+            for (size_t i = 1; i <= n; ++i) {
+                if (i < n && items[i] == items[i - 1]) continue;
+                seg.values.push_back(items[i - 1]);
+                seg.run_ends.push_back(static_cast<uint32_t>(i));
+            }
+            break;
+    }
+    return seg;
+}
+
+void IntSegment::unpack(size_t b, uint64_t* out) const {
+    kUnpack[bits](packed.data() + b * bits, out);
+}
+
+// All 64 values of block b of a BitPacked or Delta segment
+static void decode_block(IntSegment const& seg, size_t b, int64_t* out) {
+    uint64_t codes[kBlock];
+    seg.unpack(b, codes);
+    uint64_t const base = static_cast<uint64_t>(seg.base);
+    if (seg.encoding == IntEncoding::BitPacked) {
+        for (size_t j = 0; j < kBlock; ++j) out[j] = static_cast<int64_t>(base + codes[j]);
+        return;
+    }
+    uint64_t v = static_cast<uint64_t>(seg.values[b]);
+    out[0] = static_cast<int64_t>(v);
+    for (size_t j = 1; j < kBlock; ++j) {
+        v += codes[j] + base;
+        out[j] = static_cast<int64_t>(v);
+    }
+}
+
+int64_t IntSegment::at(size_t i) const {
+    switch (encoding) {
+        case IntEncoding::Plain:
+            return values[i];
+        case IntEncoding::BitPacked:
+            return static_cast<int64_t>(static_cast<uint64_t>(base) + extract(packed.data(), bits, i));
+        case IntEncoding::Delta: {
+            size_t const b = i / kBlock;
+            uint64_t v = static_cast<uint64_t>(values[b]);
+            for (size_t j = b * kBlock + 1; j <= i; ++j) v += extract(packed.data(), bits, j) + static_cast<uint64_t>(base);
+            return static_cast<int64_t>(v);
+        }
+        case IntEncoding::RunLength:
+            return values[static_cast<size_t>(std::upper_bound(run_ends.begin(), run_ends.end(), i) - run_ends.begin())];
+    }
+    return 0;
+}
+
+void IntSegment::decode(size_t begin, size_t end, int64_t* out) const {
+    switch (encoding) {
+        case IntEncoding::Plain:
+            std::copy(values.begin() + begin, values.begin() + end, out);
+            return;
+        case IntEncoding::RunLength: {
+            size_t k = static_cast<size_t>(std::upper_bound(run_ends.begin(), run_ends.end(), begin) - run_ends.begin());
+            for (size_t r = begin; r < end; ++k) {
+                size_t stop = std::min<size_t>(end, run_ends[k]);
+                std::fill(out + (r - begin), out + (stop - begin), values[k]);
+                r = stop;
+            }
+            return;
+        }
+        case IntEncoding::BitPacked: case IntEncoding::Delta: {
+            int64_t block[kBlock];
+            for (size_t b = begin / kBlock; b * kBlock < end; ++b) {
+                decode_block(*this, b, block);
+                size_t lo = std::max(begin, b * kBlock), hi = std::min(end, (b + 1) * kBlock);
+                std::copy(block + (lo - b * kBlock), block + (hi - b * kBlock), out + (lo - begin));
+            }
+            return;
+        }
+    }
+}
+
+bool IntSegment::consistent() const {
+    size_t const nb = blocks();
+    switch (encoding) {
+        case IntEncoding::Plain:
+            return values.size() == rows;
+        case IntEncoding::BitPacked:
+            return bits <= 64 && packed.size() == nb * bits;
+        case IntEncoding::Delta:
+            return bits <= 64 && values.size() == nb && packed.size() == nb * bits;
+        case IntEncoding::RunLength:
+            if (run_ends.empty() || values.size() != run_ends.size() || run_ends.back() != rows || run_ends[0] == 0) return false;
+            for (size_t k = 1; k < run_ends.size(); ++k)
+                if (run_ends[k] <= run_ends[k - 1]) return false;
+            return true;
+    }
+    return false;
+}
+
+MemoryStats IntSegment::memory() const {
+    MemoryStats m{sizeof(IntSegment), 1};
+    m += values.memory();
+    m += packed.memory();
+    m += run_ends.memory();
+    return m;
+}
+
+} // namespace inmemdb
@@ -0,0 +1,536 @@
+#include "inmemdb/server.hpp"
+#include "inmemdb/codec.hpp"
+#include "inmemdb/executor.hpp"
+#include "inmemdb/lexer.hpp"
+#include "inmemdb/protocol.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <optional>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace inmemdb {
+
+namespace {
+
+constexpr size_t kReadChunk = 64 * 1024;
+constexpr size_t kMaxUnsent = 16u << 20; // stop reading a connection, and producing answers for it, while this much output waits
+
+[[noreturn]] void fail(std::string const& what) {
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+struct Request {
+    uint32_t id;
+    std::string sql;
+};
+
+struct Loop;
+
+struct Connection {
+    Connection(int fd, Loop& loop, Database& db) : fd(fd), loop(loop), exec(db) {}
+
+    int fd; // -1 once closed
+    Loop& loop;
+    Executor exec; // the session; used by one worker at a time
+
+    // Event loop only
+    std::string in, out;
+    size_t out_pos = 0;
+    bool eof = false;
+    uint32_t events = 0; // registered with epoll
+
+    // Shared with the workers
+    std::mutex mu;
+    std::vector<Request> pending;
+    std::string done; // encoded answers the loop has not taken yet
+    size_t unsent = 0; // bytes in done and out not written yet
+    bool busy = false; // queued for or running on a worker
+    bool closed = false;
+    std::condition_variable drained; // unsent went down or closed was set
+};
+
+struct Loop {
+    int ep = -1;
+    int wake = -1; // eventfd: workers finished answers, or stop
+    std::vector<int> listeners;
+    std::unordered_map<int, std::shared_ptr<Connection>> conns;
+    std::thread thread;
+
+    std::mutex mu;
+    std::vector<std::shared_ptr<Connection>> ready; // connections with new answers
+
+    ~Loop() {
+        for (auto& [fd, c] : conns) ::close(fd);
+        for (int fd : listeners) ::close(fd);
+        if (wake >= 0) ::close(wake);
+        if (ep >= 0) ::close(ep);
+    }
+    void watch(int fd, uint32_t events) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = fd;
+        if (::epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev) < 0) fail("epoll_ctl");
+    }
+};
+
+int listen_tcp(std::string const& host, uint16_t port, bool reuse_port) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) throw std::runtime_error("Not an IPv4 address: " + host);
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) fail("socket");
+    int one = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+    if ((reuse_port && ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof one) < 0) ||
+        ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0 || ::listen(fd, SOMAXCONN) < 0) {
+        int err = errno;
+        ::close(fd);
+        errno = err;
+        fail("Cannot listen on " + host + ":" + std::to_string(port));
+    }
+    return fd;
+}
+
+int listen_unix(std::string const& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof addr.sun_path) throw std::runtime_error("Unix socket path too long: " + path);
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    // A socket file left by an earlier run; anything else at the path stays
+    struct stat st;
+    if (::lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) ::unlink(path.c_str());
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) fail("socket");
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0 || ::listen(fd, SOMAXCONN) < 0) {
+        int err = errno;
+        ::close(fd);
+        errno = err;
+        fail("Cannot listen on " + path);
+    }
+    return fd;
+}
+
+// Run a SELECT through a cursor, encoding each batch as it comes; flush()
+// after every batch lets the caller send what is encoded so far
+template <class Open>
+void stream(std::string& out, Open open, std::function<void()> const& flush) {
+    std::optional<Cursor> cur;
+    try {
+        cur.emplace(open());
+    } catch (std::exception const& ex) {
+        wire::put_error(out, ex.what());
+        return;
+    }
+    wire::put_columns(out, cur->header(), cur->types());
+    size_t rows = 0;
+    try {
+        Batch batch;
+        while (cur->next(batch)) {
+            wire::put_rows(out, batch);
+            rows += batch.rows;
+            flush();
+        }
+    } catch (std::exception const& ex) {
+        wire::put_status(out, false, ex.what());
+        return;
+    }
+    wire::put_status(out, true, std::to_string(rows) + " row(s)");
+}
+
+} // namespace
+
+struct Server::State {
+    explicit State(Database& db) : db(db) {}
+
+    Database& db;
+    std::vector<std::unique_ptr<Loop>> loops;
+    std::vector<std::thread> workers;
+    std::atomic<bool> stopping{false};
+
+    // Connections with requests and no worker yet
+    std::mutex mu;
+    std::condition_variable cv;
+    std::deque<std::shared_ptr<Connection>> queue;
+
+    void run_loop(Loop& l);
+    void accept_all(Loop& l, int listener);
+    void on_readable(Loop& l, std::shared_ptr<Connection> const& c);
+    void on_writable(Loop& l, Connection& c);
+    void take_answers(Loop& l);
+    void update_events(Loop& l, Connection& c);
+    void close_conn(Loop& l, Connection& c);
+
+    void schedule(std::shared_ptr<Connection> c);
+    void run_worker();
+    void serve(std::shared_ptr<Connection> const& c);
+    void answer(Connection& c, std::string const& sql, std::string& out, std::function<void()> const& flush);
+    bool deliver(std::shared_ptr<Connection> const& c, std::string& out, bool last);
+};
+
+void Server::State::run_loop(Loop& l) {
+    epoll_event events[64];
+    while (!stopping.load(std::memory_order_relaxed)) {
+        int n = ::epoll_wait(l.ep, events, 64, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == l.wake) {
+                uint64_t count;
+                [[maybe_unused]] auto r = ::read(l.wake, &count, sizeof count);
+                take_answers(l);
+                continue;
+            }
+            if (std::find(l.listeners.begin(), l.listeners.end(), fd) != l.listeners.end()) {
+                accept_all(l, fd);
+                continue;
+            }
+            auto it = l.conns.find(fd);
+            if (it == l.conns.end()) continue;
+            auto c = it->second;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                close_conn(l, *c);
+                continue;
+            }
+            if (events[i].events & EPOLLIN) on_readable(l, c);
+            if (c->fd >= 0 && (events[i].events & EPOLLOUT)) on_writable(l, *c);
+        }
+    }
+}
+
+void Server::State::accept_all(Loop& l, int listener) {
+    while (true) {
+        int fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            return; // EAGAIN, or out of descriptors until a connection closes
+        }
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one); // fails harmlessly on Unix sockets
+        auto c = std::make_shared<Connection>(fd, l, db);
+        c->events = EPOLLIN;
+        l.watch(fd, c->events);
+        l.conns.emplace(fd, std::move(c));
+    }
+}
+
+// Read what arrived, cut it into requests and hand them to a worker
+void Server::State::on_readable(Loop& l, std::shared_ptr<Connection> const& c) {
+    while (!c->eof) {
+        size_t at = c->in.size();
+        c->in.resize(at + kReadChunk);
+        ssize_t r = ::read(c->fd, c->in.data() + at, kReadChunk);
+        c->in.resize(at + static_cast<size_t>(std::max<ssize_t>(r, 0)));
+        if (r > 0) {
+            if (static_cast<size_t>(r) < kReadChunk) break;
+            continue;
+        }
+        if (r == 0) { c->eof = true; break; }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        close_conn(l, *c);
+        return;
+    }
+
+    std::vector<Request> requests;
+    size_t pos = 0;
+    try {
+        wire::Frame frame;
+        while (size_t used = wire::parse_frame(std::string_view(c->in).substr(pos), frame)) {
+            if (frame.type != wire::FrameType::Query) throw std::runtime_error("Expected a query frame");
+            requests.push_back({frame.id, std::string(frame.payload)});
+            pos += used;
+        }
+    } catch (std::exception const&) {
+        close_conn(l, *c); // not speaking the protocol
+        return;
+    }
+    c->in.erase(0, pos);
+    if (!requests.empty()) {
+        bool idle;
+        {
+            std::lock_guard<std::mutex> lock(c->mu);
+            for (auto& r : requests) c->pending.push_back(std::move(r));
+            idle = !c->busy;
+            c->busy = true;
+        }
+        if (idle) schedule(c);
+    }
+    update_events(l, *c);
+}
+
+void Server::State::on_writable(Loop& l, Connection& c) {
+    size_t sent = 0;
+    while (c.out_pos < c.out.size()) {
+        ssize_t w = ::send(c.fd, c.out.data() + c.out_pos, c.out.size() - c.out_pos, MSG_NOSIGNAL);
+        if (w > 0) { c.out_pos += static_cast<size_t>(w); sent += static_cast<size_t>(w); continue; }
+        if (w < 0 && errno == EINTR) continue;
+        if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        close_conn(l, c);
+        return;
+    }
+    if (sent > 0) {
+        {
+            std::lock_guard<std::mutex> lock(c.mu);
+            c.unsent -= sent;
+        }
+        c.drained.notify_all();
+    }
+    if (c.out_pos == c.out.size()) {
+        c.out.clear();
+        c.out_pos = 0;
+    }
+    update_events(l, c);
+}
+
+// Move the answers workers finished into each connection's output and write
+// them; whatever accumulated since the last wake-up goes out in one send
+void Server::State::take_answers(Loop& l) {
+    std::vector<std::shared_ptr<Connection>> ready;
+    {
+        std::lock_guard<std::mutex> lock(l.mu);
+        ready.swap(l.ready);
+    }
+    for (auto const& c : ready) {
+        if (c->fd < 0) continue;
+        {
+            std::lock_guard<std::mutex> lock(c->mu);
+            if (c->out.empty()) c->out.swap(c->done);
+            else c->out += c->done;
+            c->done.clear();
+        }
+        on_writable(l, *c);
+    }
+}
+
+// Read while output is not piling up; after EOF, close once every answer is out
+void Server::State::update_events(Loop& l, Connection& c) {
+    bool unsent = c.out_pos < c.out.size();
+    if (c.eof && !unsent) {
+        bool idle;
+        {
+            std::lock_guard<std::mutex> lock(c.mu);
+            idle = !c.busy && c.done.empty();
+        }
+        if (idle) { close_conn(l, c); return; }
+    }
+    uint32_t want = (c.eof || c.out.size() - c.out_pos > kMaxUnsent ? 0u : uint32_t(EPOLLIN)) | (unsent ? uint32_t(EPOLLOUT) : 0u);
+    if (want == c.events) return;
+    epoll_event ev{};
+    ev.events = want;
+    ev.data.fd = c.fd;
+    ::epoll_ctl(l.ep, EPOLL_CTL_MOD, c.fd, &ev);
+    c.events = want;
+}
+
+void Server::State::close_conn(Loop& l, Connection& c) {
+    int fd = c.fd;
+    ::epoll_ctl(l.ep, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    c.fd = -1;
+    {
+        std::lock_guard<std::mutex> lock(c.mu);
+        c.closed = true;
+    }
+    c.drained.notify_all();
+    l.conns.erase(fd); // a worker may still hold the connection; its answers are dropped
+}
+
+void Server::State::schedule(std::shared_ptr<Connection> c) {
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        queue.push_back(std::move(c));
+    }
+    cv.notify_one();
+}
+
+void Server::State::run_worker() {
+    while (true) {
+        std::shared_ptr<Connection> c;
+        {
+            std::unique_lock<std::mutex> lock(mu);
+            cv.wait(lock, [&] { return stopping.load() || !queue.empty(); });
+            if (stopping) return;
+            c = std::move(queue.front());
+            queue.pop_front();
+        }
+        serve(c);
+    }
+}
+
+// Answer everything the connection has queued, in order; requests that
+// arrive meanwhile wait for the next turn, which goes to the back of the
+// queue so a busy pipeline does not starve others. Answers are cut into
+// frames as they grow and handed over a chunk at a time, so a large result
+// is never held whole and goes out at the pace the client reads it.
+void Server::State::serve(std::shared_ptr<Connection> const& c) {
+    std::vector<Request> requests;
+    {
+        std::lock_guard<std::mutex> lock(c->mu);
+        requests.swap(c->pending);
+    }
+    std::string out, payload;
+    for (auto const& r : requests) {
+        auto flush = [&] {
+            size_t pos = 0;
+            for (; payload.size() - pos >= wire::kResultChunk; pos += wire::kResultChunk)
+                wire::append_frame(out, wire::FrameType::ResultPart, r.id, std::string_view(payload).substr(pos, wire::kResultChunk));
+            payload.erase(0, pos);
+            if (out.size() >= wire::kResultChunk) deliver(c, out, false);
+        };
+        answer(*c, r.sql, payload, flush);
+        flush();
+        wire::append_frame(out, wire::FrameType::Result, r.id, payload);
+        payload.clear();
+    }
+    if (deliver(c, out, true)) schedule(c);
+}
+
+// Hand finished frames to the connection's loop, first waiting while more
+// than kMaxUnsent bytes are queued for it; a closed connection drops them.
+// With `last` the worker is done with the connection; returns whether
+// requests came in meanwhile, making it busy again.
+bool Server::State::deliver(std::shared_ptr<Connection> const& c, std::string& out, bool last) {
+    bool more = false;
+    {
+        std::unique_lock<std::mutex> lock(c->mu);
+        c->drained.wait(lock, [&] { return c->unsent <= kMaxUnsent || c->closed; });
+        if (!c->closed) {
+            c->unsent += out.size();
+            c->done += out;
+        }
+        if (last) {
+            more = !c->pending.empty();
+            c->busy = more;
+        }
+    }
+    out.clear();
+    Loop& l = c->loop;
+    {
+        std::lock_guard<std::mutex> lock(l.mu);
+        l.ready.push_back(c);
+    }
+    uint64_t one = 1;
+    [[maybe_unused]] auto w = ::write(l.wake, &one, sizeof one);
+    return more;
+}
+
+void Server::State::answer(Connection& c, std::string const& sql, std::string& out, std::function<void()> const& flush) {
+    std::vector<Statement> stmts;
+    try {
+        stmts = Parser(Lexer(sql)).parse_all();
+    } catch (std::exception const& ex) {
+        ByteWriter{out}.put_varint(1);
+        wire::put_error(out, ex.what());
+        return;
+    }
+    ByteWriter{out}.put_varint(stmts.size());
+    for (auto const& st : stmts) {
+        if (auto sel = std::get_if<SelectStmt>(&st)) {
+            stream(out, [&] { return db.open_cursor(*sel); }, flush);
+            continue;
+        }
+        if (auto ex = std::get_if<ExecuteStmt>(&st)) {
+            auto ps = c.exec.prepared(ex->name);
+            if (ps && ps->stmt.index() == 2 && ex->values.size() >= ps->params) { // SELECT; the executor reports bad arity
+                std::vector<Value> params(ex->values.begin(), ex->values.end());
+                stream(out, [&] { return db.open_cursor(*ps, params); }, flush);
+                continue;
+            }
+        }
+        try {
+            wire::put_result(out, c.exec.execute(st));
+        } catch (std::exception const& ex) {
+            wire::put_error(out, ex.what());
+        }
+        flush();
+    }
+}
+
+Server::Server(Database& db, ServerOptions options) : db_(db), options_(std::move(options)) {}
+
+Server::~Server() { stop(); }
+
+void Server::start() {
+    if (state_) return;
+    auto st = std::make_unique<State>(db_);
+    size_t nloops = std::max<size_t>(1, options_.io_threads);
+    for (size_t i = 0; i < nloops; ++i) {
+        auto l = std::make_unique<Loop>();
+        l->ep = ::epoll_create1(EPOLL_CLOEXEC);
+        if (l->ep < 0) fail("epoll_create1");
+        l->wake = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (l->wake < 0) fail("eventfd");
+        l->watch(l->wake, EPOLLIN);
+        if (options_.tcp) {
+            // Port 0 resolves on the first bind; the other loops share that port
+            int fd = listen_tcp(options_.host, i == 0 ? options_.port : port_, nloops > 1);
+            l->listeners.push_back(fd);
+            l->watch(fd, EPOLLIN);
+            if (i == 0) {
+                sockaddr_in addr{};
+                socklen_t len = sizeof addr;
+                ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+                port_ = ntohs(addr.sin_port);
+            }
+        }
+        if (i == 0 && !options_.unix_path.empty()) {
+            int fd = listen_unix(options_.unix_path);
+            l->listeners.push_back(fd);
+            l->watch(fd, EPOLLIN);
+        }
+        st->loops.push_back(std::move(l));
+    }
+    if (st->loops[0]->listeners.empty()) throw std::runtime_error("Server has neither a TCP port nor a Unix socket");
+
+    for (size_t i = 0; i < std::max<size_t>(1, options_.workers); ++i) st->workers.emplace_back([s = st.get()] { s->run_worker(); });
+    for (auto& l : st->loops) l->thread = std::thread([s = st.get(), lp = l.get()] { s->run_loop(*lp); });
+    state_ = std::move(st);
+}
+
+void Server::stop() {
+    if (!state_) return;
+    state_->stopping = true;
+    {
+        std::lock_guard<std::mutex> lock(state_->mu);
+    }
+    state_->cv.notify_all();
+    for (auto& l : state_->loops) {
+        uint64_t one = 1;
+        [[maybe_unused]] auto w = ::write(l->wake, &one, sizeof one);
+    }
+    for (auto& l : state_->loops) l->thread.join();
+    // Workers waiting for a connection to drain would wait forever
+    for (auto& l : state_->loops) {
+        for (auto& [fd, c] : l->conns) {
+            {
+                std::lock_guard<std::mutex> lock(c->mu);
+                c->closed = true;
+            }
+            c->drained.notify_all();
+        }
+    }
+    for (auto& t : state_->workers) t.join();
+    if (!options_.unix_path.empty()) ::unlink(options_.unix_path.c_str());
+    state_.reset();
+}
+
+} // namespace inmemdb
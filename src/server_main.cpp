@@ -0,0 +1,67 @@
+#include <csignal>
+#include <iostream>
+#include <string>
+#include "inmemdb/server.hpp"
+
+using namespace inmemdb;
+
+static void usage(char const* prog) {
+    std::cerr << "usage: " << prog << " [--host ADDR] [--port N] [--no-tcp] [--unix PATH] [--io-threads N] [--workers N]"
+                 " [--load SNAPSHOT] [--wal PATH] [--sync every|group|os]\n";
+}
+
+int main(int argc, char** argv) {
+    ServerOptions options;
+    WalOptions wal;
+    std::string snapshot;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--no-tcp") { options.tcp = false; continue; }
+        if (i + 1 >= argc) { usage(argv[0]); return 2; }
+        std::string val = argv[++i];
+        if (arg == "--host") options.host = val;
+        else if (arg == "--port") options.port = static_cast<uint16_t>(std::stoul(val));
+        else if (arg == "--unix") options.unix_path = val;
+        else if (arg == "--io-threads") options.io_threads = std::stoull(val);
+        else if (arg == "--workers") options.workers = std::stoull(val);
+        else if (arg == "--load") snapshot = val;
+        else if (arg == "--wal") wal.path = val;
+        else if (arg == "--sync" && val == "every") wal.sync = SyncPolicy::EveryCommit;
+        else if (arg == "--sync" && val == "group") wal.sync = SyncPolicy::Group;
+        else if (arg == "--sync" && val == "os") wal.sync = SyncPolicy::OsBuffered;
+        else { usage(argv[0]); return 2; }
+    }
+
+    Database db;
+    try {
+        if (!snapshot.empty()) std::cout << "Loaded " << db.load_snapshot(snapshot) << " table(s) from " << snapshot << "\n";
+        if (!wal.path.empty()) std::cout << "Replayed " << db.attach_wal(wal) << " WAL record(s) from " << wal.path << "\n";
+    } catch (std::exception const& ex) {
+        std::cerr << "Startup error: " << ex.what() << "\n";
+        return 1;
+    }
+
+    // Block the stop signals before any thread starts so only sigwait sees them
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, nullptr);
+
+    Server server(db, options);
+    try {
+        server.start();
+    } catch (std::exception const& ex) {
+        std::cerr << "Server error: " << ex.what() << "\n";
+        return 1;
+    }
+    if (options.tcp) std::cout << "Listening on " << options.host << ":" << server.port() << "\n";
+    if (!options.unix_path.empty()) std::cout << "Listening on " << options.unix_path << "\n";
+    std::cout.flush();
+
+    int sig = 0;
+    sigwait(&stop_signals, &sig);
+    std::cout << "Stopping\n";
+    server.stop();
+    return 0;
+}
@@ -0,0 +1,144 @@
+#include "inmemdb/simd.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define INMEMDB_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace inmemdb {
+
+const char* to_string(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Scalar: return "scalar";
+        case SimdLevel::SSE42: return "sse4.2";
+        case SimdLevel::AVX2: return "avx2";
+    }
+    return "?";
+}
+
+SimdLevel detect_simd_level() {
+#ifdef INMEMDB_X86_SIMD
+    static const SimdLevel level = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+        if (__builtin_cpu_supports("sse4.2")) return SimdLevel::SSE42;
+        return SimdLevel::Scalar;
+    }();
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+template <CompareOp Op>
+static inline bool apply(int64_t a, int64_t b) {
+    if constexpr (Op == CompareOp::Eq) return a == b;
+    else if constexpr (Op == CompareOp::Ne) return a != b;
+    else if constexpr (Op == CompareOp::Lt) return a < b;
+    else if constexpr (Op == CompareOp::Le) return a <= b;
+    else if constexpr (Op == CompareOp::Gt) return a > b;
+    else return a >= b;
+}
+
+// Branch-free scalar loop: write every candidate, advance only on a match
+template <CompareOp Op>
+static size_t filter_scalar(int64_t const* data, size_t begin, size_t end, int64_t value, size_t* sel) {
+    size_t n = 0;
+    for (size_t r = begin; r < end; ++r) { sel[n] = r; n += apply<Op>(data[r], value); }
+    return n;
+}
+
+#ifdef INMEMDB_X86_SIMD
+
+// Lane offsets for each 4-bit match mask, packed to the front
+struct LaneTable {
+    uint8_t lanes[16][4];
+    uint8_t count[16];
+    constexpr LaneTable() : lanes{}, count{} {
+        for (int m = 0; m < 16; ++m) {
+            uint8_t n = 0;
+            for (uint8_t b = 0; b < 4; ++b) if (m & (1 << b)) lanes[m][n++] = b;
+            count[m] = n;
+        }
+    }
+};
+static constexpr LaneTable kLanes{};
+
+// Append rows base + lane for the set bits of a 4-row match mask. All four
+// slots are written and only the matches are kept; since n never exceeds the
+// rows already consumed, the extra writes stay inside sel.
+static inline size_t emit_lanes(unsigned mask, size_t base, size_t* sel, size_t n) {
+    sel[n] = base + kLanes.lanes[mask][0];
+    sel[n + 1] = base + kLanes.lanes[mask][1];
+    sel[n + 2] = base + kLanes.lanes[mask][2];
+    sel[n + 3] = base + kLanes.lanes[mask][3];
+    return n + kLanes.count[mask];
+}
+
+// Lt, Le and Ge are derived from the two native compares: a < v is v > a,
+// a <= v is !(a > v) and a >= v is !(v > a)
+template <CompareOp Op>
+__attribute__((target("avx2")))
+static size_t filter_avx2(int64_t const* data, size_t begin, size_t end, int64_t value, size_t* sel) {
+    __m256i const v = _mm256_set1_epi64x(value);
+    size_t n = 0;
+    size_t r = begin;
+    for (; r + 4 <= end; r += 4) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data + r));
+        __m256i m;
+        if constexpr (Op == CompareOp::Eq || Op == CompareOp::Ne) m = _mm256_cmpeq_epi64(a, v);
+        else if constexpr (Op == CompareOp::Gt || Op == CompareOp::Le) m = _mm256_cmpgt_epi64(a, v);
+        else m = _mm256_cmpgt_epi64(v, a);
+        unsigned bits = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(m)));
+        if constexpr (Op == CompareOp::Ne || Op == CompareOp::Le || Op == CompareOp::Ge) bits ^= 0xF;
+        n = emit_lanes(bits, r, sel, n);
+    }
+    for (; r < end; ++r) { sel[n] = r; n += apply<Op>(data[r], value); }
+    return n;
+}
+
+template <CompareOp Op>
+__attribute__((target("sse4.2")))
+static size_t filter_sse42(int64_t const* data, size_t begin, size_t end, int64_t value, size_t* sel) {
+    __m128i const v = _mm_set1_epi64x(value);
+    size_t n = 0;
+    size_t r = begin;
+    for (; r + 4 <= end; r += 4) {
+        __m128i a0 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + r));
+        __m128i a1 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + r + 2));
+        __m128i m0, m1;
+        if constexpr (Op == CompareOp::Eq || Op == CompareOp::Ne) { m0 = _mm_cmpeq_epi64(a0, v); m1 = _mm_cmpeq_epi64(a1, v); }
+        else if constexpr (Op == CompareOp::Gt || Op == CompareOp::Le) { m0 = _mm_cmpgt_epi64(a0, v); m1 = _mm_cmpgt_epi64(a1, v); }
+        else { m0 = _mm_cmpgt_epi64(v, a0); m1 = _mm_cmpgt_epi64(v, a1); }
+        unsigned bits = static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(m0)))
+                      | (static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(m1))) << 2);
+        if constexpr (Op == CompareOp::Ne || Op == CompareOp::Le || Op == CompareOp::Ge) bits ^= 0xF;
+        n = emit_lanes(bits, r, sel, n);
+    }
+    for (; r < end; ++r) { sel[n] = r; n += apply<Op>(data[r], value); }
+    return n;
+}
+
+#endif // INMEMDB_X86_SIMD
+
+#define INMEMDB_KERNELS(k) { k<CompareOp::Eq>, k<CompareOp::Ne>, k<CompareOp::Lt>, \
+                             k<CompareOp::Le>, k<CompareOp::Gt>, k<CompareOp::Ge> }
+static constexpr IntFilterKernel kScalar[] = INMEMDB_KERNELS(filter_scalar);
+#ifdef INMEMDB_X86_SIMD
+static constexpr IntFilterKernel kSse42[] = INMEMDB_KERNELS(filter_sse42);
+static constexpr IntFilterKernel kAvx2[] = INMEMDB_KERNELS(filter_avx2);
+#endif
+#undef INMEMDB_KERNELS
+
+IntFilterKernel int_filter_kernel(CompareOp op, SimdLevel level) {
+    auto k = static_cast<size_t>(op);
+    SimdLevel best = detect_simd_level();
+    if (static_cast<int>(level) > static_cast<int>(best)) level = best;
+#ifdef INMEMDB_X86_SIMD
+    if (level == SimdLevel::AVX2) return kAvx2[k];
+    if (level == SimdLevel::SSE42) return kSse42[k];
+#endif
+    return kScalar[k];
+}
+
+} // namespace inmemdb
@@ -0,0 +1,356 @@
+#include "inmemdb/storage.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+
+// Snapshot file layout (version 5, host byte order, little-endian only):
+//   header   64 bytes: magic, version, catalog offset/size/crc32 and the
+//            number of WAL records the tables hold (0 without a WAL)
+//   blocks   raw column arrays, each starting on a kSnapshotAlign boundary
+//   catalog  varint-encoded schema: per table its columns with the offset and
+//            item count of every block, then its index definitions
+// INT columns are written as their encoded segments plus the plain tail, so
+// they stay compressed on disk and after loading. Every column ends with its
+// zone map. Older files still load: version 1 INT columns are one plain block
+// that becomes the tail, zones missing before version 3 are rebuilt, and
+// DICT columns count as declared before version 4, which records that.
+// Files before version 5 hold no WAL records.
+// The loader maps the file and hands the blocks to AppendBuffer::view, so
+// columns are read straight from the page cache and only copied when a table
+// is appended to.
+
+namespace inmemdb {
+
+static constexpr char kSnapshotMagic[8] = {'I', 'M', 'D', 'B', 'S', 'N', 'A', 'P'};
+static constexpr uint32_t kSnapshotVersion = 5;
+static constexpr size_t kSnapshotAlign = 64;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order; // 0x01020304 as written by the host
+    uint64_t catalog_offset;
+    uint64_t catalog_size;
+    uint32_t catalog_crc;
+    uint32_t padding;
+    uint64_t wal_records; // replay of the same log resumes after these
+    char reserved[16];
+};
+static_assert(sizeof(SnapshotHeader) == 64, "snapshot header is one 64-byte block");
+
+enum class SnapshotStorage : uint8_t { Int = 0, Text = 1, Dict = 2, IntSegments = 3 };
+
+static std::runtime_error io_error(char const* what, std::string const& path) {
+    return std::runtime_error(std::string(what) + " " + path + ": " + std::strerror(errno));
+}
+
+namespace {
+
+// Sequential writer that pads every block to kSnapshotAlign
+class BlockWriter {
+public:
+    BlockWriter(int fd, std::string const& path) : fd_(fd), path_(path) {}
+
+    void write(void const* data, size_t n) {
+        auto p = static_cast<char const*>(data);
+        while (n > 0) {
+            ssize_t w = ::write(fd_, p, n);
+            if (w < 0 && errno == EINTR) continue;
+            if (w < 0) throw io_error("Cannot write snapshot", path_);
+            p += w;
+            n -= static_cast<size_t>(w);
+            offset_ += static_cast<size_t>(w);
+        }
+    }
+
+    // Write a column array and record (offset, count) in the catalog
+    template <class T>
+    void block(ByteWriter& catalog, T const* items, size_t count) {
+        static char const zeros[kSnapshotAlign] = {};
+        write(zeros, (kSnapshotAlign - offset_ % kSnapshotAlign) % kSnapshotAlign);
+        catalog.put_varint(offset_);
+        catalog.put_varint(count);
+        write(items, count * sizeof(T));
+    }
+
+    size_t offset() const { return offset_; }
+
+private:
+    int fd_;
+    std::string const& path_;
+    size_t offset_ = 0;
+};
+
+// A read-only mapping of a whole snapshot file; mapped blocks keep it alive
+struct Mapping {
+    void const* addr = MAP_FAILED;
+    size_t size = 0;
+    ~Mapping() { if (addr != MAP_FAILED) ::munmap(const_cast<void*>(addr), size); }
+};
+
+class BlockReader {
+public:
+    BlockReader(std::shared_ptr<Mapping const> map, ByteReader& catalog, uint32_t version)
+        : map_(std::move(map)), catalog_(catalog), version_(version) {}
+
+    template <class T>
+    AppendBuffer<T> block() {
+        uint64_t offset = catalog_.get_varint();
+        uint64_t count = catalog_.get_varint();
+        if (offset % alignof(T) != 0 || offset > map_->size || count > (map_->size - offset) / sizeof(T))
+            throw std::runtime_error("Corrupt snapshot: column block out of range");
+        auto items = reinterpret_cast<T const*>(static_cast<char const*>(map_->addr) + offset);
+        return AppendBuffer<T>::view(items, count, map_);
+    }
+
+    TextColumn text(size_t rows) {
+        TextColumn col;
+        col.offsets = block<uint64_t>();
+        col.bytes = block<char>();
+        if (col.offsets.size() != rows + 1 || col.offsets[0] != 0 || col.offsets.back() != col.bytes.size())
+            throw std::runtime_error("Corrupt snapshot: bad TEXT offsets");
+        return col;
+    }
+
+    // The saved zone map of a column of `rows` rows, or one rebuilt from the data
+    template <class Col>
+    void zones(Col& col, size_t rows) {
+        if (version_ < 3) { col.extend_zones(); return; }
+        col.zones = block<std::remove_cvref_t<decltype(col.zones[0])>>();
+        if (col.zones.size() != rows / kZoneRows) throw std::runtime_error("Corrupt snapshot: bad zone map");
+        if constexpr (!std::is_same_v<Col, IntColumn>) {
+            for (size_t b = 0; b < col.zones.size(); ++b)
+                if (col.zones[b].min_row / kZoneRows != b || col.zones[b].max_row / kZoneRows != b)
+                    throw std::runtime_error("Corrupt snapshot: bad zone map");
+        }
+    }
+
+    IntColumn segmented_int(size_t rows) {
+        IntColumn col;
+        for (uint64_t n = catalog_.get_varint(); n > 0; --n) {
+            IntSegment seg;
+            seg.encoding = static_cast<IntEncoding>(catalog_.get_u8());
+            seg.bits = catalog_.get_u8();
+            seg.rows = catalog_.get_varint();
+            seg.min = catalog_.get_svarint();
+            seg.max = catalog_.get_svarint();
+            seg.base = catalog_.get_svarint();
+            seg.values = block<int64_t>();
+            seg.packed = block<uint64_t>();
+            seg.run_ends = block<uint32_t>();
+            if (seg.rows != IntColumn::kSegmentRows || !seg.consistent())
+                throw std::runtime_error("Corrupt snapshot: bad INT segment");
+            col.segments.push_back(std::make_shared<IntSegment const>(std::move(seg)));
+        }
+        col.tail = block<int64_t>();
+        if (col.size() != rows) throw std::runtime_error("Corrupt snapshot: bad INT column length");
+        return col;
+    }
+
+private:
+    std::shared_ptr<Mapping const> map_;
+    ByteReader& catalog_;
+    uint32_t version_;
+};
+
+} // namespace
+
+void Database::save_snapshot(std::string const& path) const {
+    // One consistent cut of every table; the copies share storage with the
+    // live tables, so writing does not hold the commit lock
+    std::vector<Table> tables;
+    uint64_t wal_records = 0;
+    bool wal_ok = false;
+    {
+        std::lock_guard<std::mutex> lock(commit_mu_);
+        for (auto const& [_, t] : tables_) tables.push_back(t);
+        if (wal_) wal_records = wal_->records();
+        wal_ok = wal_ && wal_failure_.empty();
+    }
+    // The log must hold every record the snapshot claims before the snapshot
+    // exists. After a WAL failure it never will; restoring the snapshot
+    // with that log is then refused
+    if (wal_ok) wal_->wait(wal_records);
+    std::sort(tables.begin(), tables.end(), [](Table const& a, Table const& b) { return a.name < b.name; });
+
+    // Written to a temporary file and renamed, so a crash never leaves a torn snapshot at `path`
+    std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) throw io_error("Cannot create snapshot", tmp);
+    try {
+        BlockWriter out(fd, tmp);
+        SnapshotHeader header{};
+        out.write(&header, sizeof header);
+
+        std::string catalog;
+        ByteWriter cat{catalog};
+        cat.put_varint(tables.size());
+        for (auto const& t : tables) {
+            cat.put_string(t.name);
+            cat.put_varint(t.row_count);
+            cat.put_varint(t.columns.size());
+            for (size_t i = 0; i < t.columns.size(); ++i) {
+                cat.put_string(t.columns[i].name);
+                cat.put_u8(static_cast<uint8_t>(t.columns[i].type));
+                if (auto ic = std::get_if<IntColumn>(&t.data[i])) {
+                    cat.put_u8(static_cast<uint8_t>(SnapshotStorage::IntSegments));
+                    cat.put_varint(ic->segments.size());
+                    for (auto const& seg : ic->segments) {
+                        cat.put_u8(static_cast<uint8_t>(seg->encoding));
+                        cat.put_u8(seg->bits);
+                        cat.put_varint(seg->rows);
+                        cat.put_svarint(seg->min);
+                        cat.put_svarint(seg->max);
+                        cat.put_svarint(seg->base);
+                        out.block(cat, seg->values.data(), seg->values.size());
+                        out.block(cat, seg->packed.data(), seg->packed.size());
+                        out.block(cat, seg->run_ends.data(), seg->run_ends.size());
+                    }
+                    out.block(cat, ic->tail.data(), t.row_count - ic->sealed_rows());
+                    out.block(cat, ic->zones.data(), ic->zones.size());
+                } else if (auto tc = std::get_if<TextColumn>(&t.data[i])) {
+                    cat.put_u8(static_cast<uint8_t>(SnapshotStorage::Text));
+                    out.block(cat, tc->offsets.data(), t.row_count + 1);
+                    out.block(cat, tc->bytes.data(), tc->offsets[t.row_count]);
+                    out.block(cat, tc->zones.data(), tc->zones.size());
+                } else {
+                    auto const& dc = std::get<DictColumn>(t.data[i]);
+                    cat.put_u8(static_cast<uint8_t>(SnapshotStorage::Dict));
+                    cat.put_u8(t.columns[i].declared_dict);
+                    out.block(cat, dc.codes.data(), t.row_count);
+                    out.block(cat, dc.dict.offsets.data(), dc.dict.offsets.size());
+                    out.block(cat, dc.dict.bytes.data(), dc.dict.bytes.size());
+                    out.block(cat, dc.zones.data(), dc.zones.size());
+                }
+            }
+            // Indexes are saved as definitions and rebuilt on load
+            cat.put_varint(t.indexes.size());
+            for (auto const& ix : t.indexes) {
+                cat.put_string(ix->name);
+                cat.put_varint(ix->column);
+                cat.put_u8(static_cast<uint8_t>(ix->kind));
+            }
+        }
+
+        std::memcpy(header.magic, kSnapshotMagic, sizeof header.magic);
+        header.version = kSnapshotVersion;
+        header.byte_order = 0x01020304;
+        header.catalog_offset = out.offset();
+        header.catalog_size = catalog.size();
+        header.catalog_crc = crc32(catalog);
+        header.wal_records = wal_records;
+        out.write(catalog.data(), catalog.size());
+        if (::pwrite(fd, &header, sizeof header, 0) != static_cast<ssize_t>(sizeof header))
+            throw io_error("Cannot write snapshot", tmp);
+        if (::fsync(fd) != 0) throw io_error("Cannot sync snapshot", tmp);
+    } catch (...) {
+        ::close(fd);
+        ::unlink(tmp.c_str());
+        throw;
+    }
+    ::close(fd);
+    if (::rename(tmp.c_str(), path.c_str()) != 0) throw io_error("Cannot rename snapshot to", path);
+}
+
+size_t Database::load_snapshot(std::string const& path) {
+    auto map = std::make_shared<Mapping>();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw io_error("Cannot open snapshot", path);
+    struct stat st;
+    if (::fstat(fd, &st) != 0) { ::close(fd); throw io_error("Cannot stat snapshot", path); }
+    map->size = static_cast<size_t>(st.st_size);
+    if (map->size >= sizeof(SnapshotHeader)) map->addr = ::mmap(nullptr, map->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map->size < sizeof(SnapshotHeader)) throw std::runtime_error("Not a snapshot file: " + path);
+    if (map->addr == MAP_FAILED) throw io_error("Cannot map snapshot", path);
+
+    auto base = static_cast<char const*>(map->addr);
+    SnapshotHeader header;
+    std::memcpy(&header, base, sizeof header);
+    if (std::memcmp(header.magic, kSnapshotMagic, sizeof header.magic) != 0) throw std::runtime_error("Not a snapshot file: " + path);
+    if (header.version < 1 || header.version > kSnapshotVersion) throw std::runtime_error("Unsupported snapshot version " + std::to_string(header.version));
+    if (header.byte_order != 0x01020304) throw std::runtime_error("Snapshot was written with a different byte order");
+    if (header.catalog_offset > map->size || header.catalog_size > map->size - header.catalog_offset)
+        throw std::runtime_error("Corrupt snapshot: catalog out of range");
+    std::string_view catalog(base + header.catalog_offset, header.catalog_size);
+    if (crc32(catalog) != header.catalog_crc) throw std::runtime_error("Corrupt snapshot: catalog checksum mismatch");
+
+    ByteReader cat{catalog};
+    BlockReader blocks(map, cat, header.version);
+    std::vector<Table> tables(cat.get_varint());
+    for (auto& t : tables) {
+        t.name = std::string(cat.get_string());
+        t.row_count = cat.get_varint();
+        t.columns.resize(cat.get_varint());
+        for (auto& meta : t.columns) {
+            meta.name = std::string(cat.get_string());
+            meta.type = static_cast<ColumnType>(cat.get_u8());
+            auto storage = static_cast<SnapshotStorage>(cat.get_u8());
+            if (storage == SnapshotStorage::Int) {
+                IntColumn col;
+                col.tail = blocks.block<int64_t>();
+                if (col.size() != t.row_count) throw std::runtime_error("Corrupt snapshot: bad INT column length");
+                col.extend_zones();
+                t.data.push_back(std::move(col));
+            } else if (storage == SnapshotStorage::IntSegments) {
+                IntColumn col = blocks.segmented_int(t.row_count);
+                blocks.zones(col, t.row_count);
+                t.data.push_back(std::move(col));
+            } else if (storage == SnapshotStorage::Text) {
+                TextColumn col = blocks.text(t.row_count);
+                blocks.zones(col, t.row_count);
+                t.data.push_back(std::move(col));
+            } else if (storage == SnapshotStorage::Dict) {
+                // Before version 4 the schema was not recorded; keeping such
+                // columns as they are is what those versions did
+                meta.declared_dict = header.version < 4 || cat.get_u8() != 0;
+                DictColumn col;
+                col.codes = blocks.block<uint32_t>();
+                if (col.size() != t.row_count) throw std::runtime_error("Corrupt snapshot: bad DICT column length");
+                auto offsets = blocks.block<uint64_t>();
+                col.dict.offsets = offsets;
+                col.dict.bytes = blocks.block<char>();
+                if (offsets.empty() || offsets.back() != col.dict.bytes.size())
+                    throw std::runtime_error("Corrupt snapshot: bad dictionary");
+                for (size_t c = 0; c < col.dict.size(); ++c) col.lookup->insert(col.dict.at(c), static_cast<uint32_t>(c));
+                blocks.zones(col, t.row_count);
+                meta.dict = true;
+                t.data.push_back(std::move(col));
+            } else {
+                throw std::runtime_error("Corrupt snapshot: unknown column storage");
+            }
+        }
+        // Statistics are not stored; they are rebuilt like the indexes
+        t.stats.resize(t.columns.size());
+        for (size_t i = 0; i < t.columns.size(); ++i) t.stats[i].add(t.data[i], 0, t.row_count);
+        for (uint64_t n = cat.get_varint(); n > 0; --n) {
+            std::string name(cat.get_string());
+            size_t column = cat.get_varint();
+            auto kind = static_cast<IndexKind>(cat.get_u8());
+            if (column >= t.columns.size()) throw std::runtime_error("Corrupt snapshot: bad index column");
+            auto ix = std::make_shared<Index>(std::move(name), column, kind, t.columns[column].type);
+            for (size_t r = 0; r < t.row_count; ++r) ix->insert(t.data[column], r);
+            t.indexes.push_back(std::move(ix));
+        }
+    }
+
+    uint64_t wal_records = header.version < 5 ? 0 : header.wal_records;
+    std::lock_guard<std::mutex> lock(commit_mu_);
+    if (wal_) throw std::runtime_error("Load snapshots before attaching a WAL");
+    if (wal_records && snapshot_wal_records_ && wal_records != snapshot_wal_records_)
+        throw std::runtime_error("Snapshot " + path + " was taken at a different WAL position than the loaded ones");
+    for (auto const& t : tables) {
+        if (tables_.count(t.name)) throw std::runtime_error("Table already exists: " + t.name);
+        for (auto const& ix : t.indexes) check_index_name(ix->name);
+    }
+    for (auto& t : tables) tables_.emplace(t.name, std::move(t));
+    snapshot_wal_records_ = std::max(snapshot_wal_records_, wal_records);
+    ++schema_version_;
+    return tables.size();
+}
+
+} // namespace inmemdb
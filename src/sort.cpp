@@ -0,0 +1,100 @@
+#include "inmemdb/sort.hpp"
+#include <algorithm>
+
+namespace inmemdb {
+
+static void append_row(Batch& dst, Batch const& src, size_t r) {
+    for (size_t c = 0; c < dst.columns.size(); ++c) {
+        BatchColumn const& s = src.columns[c];
+        BatchColumn& d = dst.columns[c];
+        if (s.type == ColumnType::Int) d.push_int(s.int_at(r));
+        else if (s.type == ColumnType::Real) d.push_real(s.real_at(r));
+        else d.push_text(s.text_at(r));
+    }
+    ++dst.rows;
+}
+
+static void reset(Batch& b, std::vector<ColumnType> const& types, size_t width) {
+    b.columns.resize(width);
+    for (size_t c = 0; c < width; ++c) { b.columns[c].type = types[c]; b.columns[c].clear(); }
+    b.rows = 0;
+}
+
+Sorter::Sorter(std::vector<ColumnType> types, std::vector<Key> keys, size_t width, size_t offset, std::optional<size_t> limit)
+    : types_(std::move(types)), keys_(std::move(keys)), width_(width), offset_(offset) {
+    if (limit) {
+        bound_ = top_k_bound(offset, *limit);
+        // Rejected rows may use as much room again as the heap, plus some slack
+        if (*bound_ <= (SIZE_MAX - 1024) / 2) compact_at_ = 2 * *bound_ + 1024;
+    }
+    reset(rows_, types_, types_.size());
+}
+
+int Sorter::compare(Batch const& a, size_t ra, Batch const& b, size_t rb) const {
+    for (auto const& k : keys_) {
+        BatchColumn const& ca = a.columns[k.column];
+        BatchColumn const& cb = b.columns[k.column];
+        int c = 0;
+        if (ca.type == ColumnType::Int) c = ca.int_at(ra) < cb.int_at(rb) ? -1 : cb.int_at(rb) < ca.int_at(ra);
+        else if (ca.type == ColumnType::Real) c = ca.real_at(ra) < cb.real_at(rb) ? -1 : cb.real_at(rb) < ca.real_at(ra);
+        else c = ca.text_at(ra).compare(cb.text_at(rb));
+        if (c != 0) return (k.desc ? -c : c) < 0 ? -1 : 1;
+    }
+    return 0;
+}
+
+bool Sorter::before(size_t a, size_t b) const {
+    int c = compare(rows_, a, rows_, b);
+    return c < 0 || (c == 0 && a < b);
+}
+
+void Sorter::consume(Batch const& in) {
+    auto heap_less = [this](size_t a, size_t b) { return before(a, b); };
+    for (size_t r = 0; r < in.rows; ++r) {
+        if (!bound_) {
+            order_.push_back(rows_.rows);
+            append_row(rows_, in, r);
+            continue;
+        }
+        if (*bound_ == 0) return;
+        if (order_.size() == *bound_) {
+            // The heap top is the worst kept row; a later row only replaces it
+            // when strictly better
+            if (compare(in, r, rows_, order_.front()) >= 0) continue;
+            std::pop_heap(order_.begin(), order_.end(), heap_less);
+            order_.pop_back();
+        }
+        order_.push_back(rows_.rows);
+        append_row(rows_, in, r);
+        std::push_heap(order_.begin(), order_.end(), heap_less);
+        if (rows_.rows >= compact_at_) compact();
+    }
+}
+
+// Drop buffered rows that fell out of the heap. Kept rows are copied in
+// arrival order so index order still breaks ties.
+void Sorter::compact() {
+    std::sort(order_.begin(), order_.end());
+    Batch kept;
+    reset(kept, types_, types_.size());
+    for (size_t i = 0; i < order_.size(); ++i) {
+        append_row(kept, rows_, order_[i]);
+        order_[i] = i;
+    }
+    rows_ = std::move(kept);
+    std::make_heap(order_.begin(), order_.end(), [this](size_t a, size_t b) { return before(a, b); });
+}
+
+void Sorter::finish() {
+    std::sort(order_.begin(), order_.end(), [this](size_t a, size_t b) { return before(a, b); });
+    pos_ = std::min(offset_, order_.size());
+}
+
+bool Sorter::next(Batch& out, size_t max_rows) {
+    reset(out, types_, width_);
+    size_t end = std::min(order_.size(), pos_ + max_rows);
+    for (; pos_ < end; ++pos_) append_row(out, rows_, order_[pos_]);
+    return out.rows > 0;
+}
+
+} // namespace inmemdb
@@ -0,0 +1,84 @@
+#include "inmemdb/stats.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <functional>
+#include <numeric>
+
+namespace inmemdb {
+
+// Final mix of MurmurHash3: every input bit affects every output bit, which
+// the register index and rank both rely on
+static uint64_t mix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+void HyperLogLog::add_hash(uint64_t h) {
+    size_t reg = static_cast<size_t>(h >> (64 - kBits));
+    uint64_t rest = h << kBits;
+    auto rank = static_cast<uint8_t>(rest == 0 ? 64 - kBits + 1 : std::countl_zero(rest) + 1);
+    registers_[reg] = std::max(registers_[reg], rank);
+}
+
+void HyperLogLog::add(int64_t v) { add_hash(mix64(static_cast<uint64_t>(v))); }
+
+void HyperLogLog::add(std::string_view v) { add_hash(mix64(std::hash<std::string_view>{}(v))); }
+
+double HyperLogLog::estimate() const {
+    constexpr double m = kRegisters;
+    double sum = 0;
+    size_t zeros = 0;
+    for (uint8_t r : registers_) {
+        sum += std::ldexp(1.0, -r);
+        zeros += r == 0;
+    }
+    double e = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+    // Few values: count the empty registers instead (linear counting)
+    if (e <= 2.5 * m && zeros > 0) e = m * std::log(m / static_cast<double>(zeros));
+    return e;
+}
+
+void ColumnStats::add(ColumnData const& col, size_t begin, size_t end) {
+    if (begin >= end) return;
+    rows += end - begin;
+    if (auto ic = std::get_if<IntColumn>(&col)) {
+        // Decoded a zone at a time, so sealed segments unpack each block once
+        size_t ids[kZoneRows];
+        int64_t vals[kZoneRows];
+        int64_t lo = min ? std::get<int64_t>(*min) : INT64_MAX, hi = max ? std::get<int64_t>(*max) : INT64_MIN;
+        for (size_t at = begin; at < end;) {
+            size_t n = std::min(kZoneRows, end - at);
+            std::iota(ids, ids + n, at);
+            ic->gather(ids, n, vals);
+            for (size_t i = 0; i < n; ++i) {
+                sketch.add(vals[i]);
+                lo = std::min(lo, vals[i]);
+                hi = std::max(hi, vals[i]);
+            }
+            at += n;
+        }
+        min = lo;
+        max = hi;
+        return;
+    }
+    std::string_view lo = text_at(col, begin), hi = lo;
+    for (size_t r = begin; r < end; ++r) {
+        std::string_view v = text_at(col, r);
+        sketch.add(v);
+        lo = std::min(lo, v);
+        hi = std::max(hi, v);
+    }
+    if (!min || lo < std::get<std::string>(*min)) min = std::string(lo);
+    if (!max || hi > std::get<std::string>(*max)) max = std::string(hi);
+}
+
+double ColumnStats::distinct() const {
+    return std::min(sketch.estimate(), static_cast<double>(rows));
+}
+
+} // namespace inmemdb
@@ -5,16 +5,19 @@
 #include <optional>
 #include <cstdlib>
 #include <cerrno>
+#include <mutex>
 
 namespace inmemdb {
 
-static std::string to_string(Value const& v) {
-    if (auto pi = std::get_if<int64_t>(&v)) return std::to_string(*pi);
-    return *std::get_if<std::string>(&v);
+// Stringify one result cell for QueryResult
+static std::string cell_to_string(BatchColumn const& col, size_t row) {
+    if (col.type == ColumnType::Int) return std::to_string(col.int_at(row));
+    if (col.type == ColumnType::Real) { std::ostringstream os; os << col.real_at(row); return os.str(); }
+    return std::string(col.text_at(row));
 }
 
 // Integer parsing
-static bool parse_int64(const std::string& raw, int64_t& out) {
+bool parse_int64(const std::string& raw, int64_t& out) {
     errno = 0;
     char* end = nullptr;
     long long v = std::strtoll(raw.c_str(), &end, 10);
@@ -23,234 +26,337 @@ static bool parse_int64(const std::string& raw, int64_t& out) {
     return true;
 }
 
+// WAL payloads. Values are stored typed: INT as zigzag varints, TEXT as
+// length-prefixed bytes.
+static std::string encode_create_table(CreateTableStmt const& stmt) {
+    std::string out;
+    ByteWriter w{out};
+    w.put_string(stmt.table);
+    w.put_varint(stmt.columns.size());
+    for (auto const& c : stmt.columns) {
+        w.put_string(c.name);
+        w.put_u8(static_cast<uint8_t>(c.type));
+        w.put_u8(c.dict);
+    }
+    return out;
+}
+
+static std::string encode_create_index(CreateIndexStmt const& stmt) {
+    std::string out;
+    ByteWriter w{out};
+    w.put_string(stmt.name);
+    w.put_string(stmt.table);
+    w.put_string(stmt.column);
+    w.put_u8(static_cast<uint8_t>(stmt.kind));
+    return out;
+}
+
+// Table name, then the rows one after another
+static std::string encode_insert(Table const& tbl, Batch const& rows) {
+    std::string out;
+    ByteWriter w{out};
+    w.put_string(tbl.name);
+    for (size_t r = 0; r < rows.rows; ++r) {
+        for (auto const& col : rows.columns) {
+            if (col.type == ColumnType::Int) w.put_svarint(col.int_at(r));
+            else w.put_string(col.text_at(r));
+        }
+    }
+    return out;
+}
+
 // Create a new table
-Table& Database::create_table(CreateTableStmt const& stmt) {
-    if (tables_.find(stmt.table) != tables_.end()) 
-        throw std::runtime_error("Table already exists: " + stmt.table);
+void Database::create_table(CreateTableStmt const& stmt) {
     Table t; t.name = stmt.table;
-    for (auto const& c : stmt.columns) 
-        t.columns.push_back({c.name, c.type});
-    auto [it, _] = tables_.emplace(stmt.table, std::move(t));
-    return it->second;
+    for (auto const& c : stmt.columns) {
+        if (c.dict && c.type != ColumnType::Text) throw std::runtime_error("DICT requires a TEXT column: " + c.name);
+        t.columns.push_back({c.name, c.type, c.dict, c.dict});
+        if (c.type == ColumnType::Int) t.data.emplace_back(IntColumn{});
+        else if (c.dict) t.data.emplace_back(DictColumn{});
+        else t.data.emplace_back(TextColumn{});
+    }
+    t.stats.resize(t.columns.size());
+    uint64_t seq = 0;
+    {
+        std::lock_guard<std::mutex> lock(commit_mu_);
+        check_writable();
+        if (!tables_.emplace(stmt.table, std::move(t)).second)
+            throw std::runtime_error("Table already exists: " + stmt.table);
+        ++schema_version_;
+        if (wal_) seq = wal_->append(WalRecordType::CreateTable, encode_create_table(stmt));
+    }
+    wait_durable(seq);
 }
 
-// Insert a row into a table
-void Database::insert_row(InsertStmt const& stmt) {
-    auto it = tables_.find(stmt.table);
-    if (it == tables_.end()) throw std::runtime_error("Unknown table: " + stmt.table);
-    Table& tbl = it->second;
-    if (tbl.columns.size() != stmt.values.size()) throw std::runtime_error("Column count mismatch in INSERT");
+void Database::check_index_name(std::string const& name) const {
+    for (auto const& [_, t] : tables_)
+        for (auto const& ix : t.indexes)
+            if (ix->name == name) throw std::runtime_error("Index already exists: " + name);
+}
+
+// Create a secondary index. It is filled from a snapshot without holding the
+// commit lock, then catches up with rows inserted meanwhile and is published.
+void Database::create_index(CreateIndexStmt const& stmt) {
+    std::shared_ptr<Index> ix;
+    Table snap;
+    {
+        std::lock_guard<std::mutex> lock(commit_mu_);
+        check_writable();
+        check_index_name(stmt.name);
+        auto it = tables_.find(stmt.table);
+        if (it == tables_.end()) throw std::runtime_error("Unknown table: " + stmt.table);
+        snap = it->second;
+    }
+    auto col = snap.find_column(stmt.column);
+    if (!col) throw std::runtime_error("Unknown column: " + stmt.column);
+    ix = std::make_shared<Index>(stmt.name, *col, stmt.kind, snap.columns[*col].type);
+    for (size_t r = 0; r < snap.row_count; ++r) ix->insert(snap.data[*col], r);
 
-    Row row;
-    row.values.reserve(tbl.columns.size());
+    uint64_t seq = 0;
+    {
+        std::lock_guard<std::mutex> lock(commit_mu_);
+        check_writable();
+        check_index_name(stmt.name);
+        Table& tbl = tables_.at(stmt.table);
+        for (size_t r = snap.row_count; r < tbl.row_count; ++r) ix->insert(tbl.data[*col], r);
+        tbl.indexes.push_back(std::move(ix));
+        ++schema_version_;
+        if (wal_) seq = wal_->append(WalRecordType::CreateIndex, encode_create_index(stmt));
+    }
+    wait_durable(seq);
+}
+
+// Dictionary-encode the plain TEXT columns whose sample shows low cardinality
+static void choose_dict_encoding(Table& tbl) {
     for (size_t i = 0; i < tbl.columns.size(); ++i) {
-        auto const& meta = tbl.columns[i];
-        auto const& raw = stmt.values[i];
-        if (meta.type == ColumnType::Int) {
-            int64_t v{};
-            if (!parse_int64(raw, v)) throw std::runtime_error("Expected integer for column " + meta.name);
-            row.values.push_back(v);
-        } else { // Text
-            row.values.push_back(raw);
-        }
+        auto tc = std::get_if<TextColumn>(&tbl.data[i]);
+        if (!tc) continue;
+        DictColumn dc = DictColumn::encode(*tc);
+        if (dc.dict.size() * kDictMinRowsPerValue > tbl.row_count) continue;
+        tbl.data[i] = std::move(dc);
+        tbl.columns[i].dict = true;
     }
-    tbl.rows.push_back(std::move(row));
 }
 
-// Comparison helper
-static int cmp(Value const& a, Value const& b) {
-    if (auto ai = std::get_if<int64_t>(&a)) {
-        auto bi = std::get_if<int64_t>(&b);
-        if (!bi) throw std::runtime_error("Type mismatch in comparison");
-        if (*ai < *bi) return -1; if (*ai > *bi) return 1; return 0;
-    } else {
-        auto const* as = std::get_if<std::string>(&a);
-        auto const* bs = std::get_if<std::string>(&b);
-        if (!as || !bs) throw std::runtime_error("Type mismatch in comparison");
-        if (*as < *bs) return -1; if (*as > *bs) return 1; return 0;
+// Give up dictionaries that grew past what the sample promised; the
+// checks are O(1) per column, only a decode touches the rows
+static void drop_dict_encoding(Table& tbl) {
+    for (size_t i = 0; i < tbl.columns.size(); ++i) {
+        auto dc = std::get_if<DictColumn>(&tbl.data[i]);
+        if (!dc || tbl.columns[i].declared_dict) continue;
+        size_t values = dc->dict.size();
+        if (values <= kDictMaxValues && values * kDictMinRowsPerValue <= 2 * tbl.row_count) continue;
+        tbl.data[i] = dc->decode();
+        tbl.columns[i].dict = false;
     }
 }
 
-// Resolve a possibly qualified column name against up to two tables.
-// Returns pair<tableSelector, index> where tableSelector: 0 for left, 1 for right.
-static std::pair<int, size_t> resolve_column(
-    std::string const& colspec,
-    Table const& left,
-    Table const* right // nullable when no join
-) {
-    // qualified form t.col: split on '.'
-    auto dot = colspec.find('.');
-    if (dot != std::string::npos) {
-        std::string tname = colspec.substr(0, dot);
-        std::string cname = colspec.substr(dot + 1);
-        if (tname == left.name) {
-            for (size_t i = 0; i < left.columns.size(); ++i)
-                if (left.columns[i].name == cname) return {0, i};
-            throw std::runtime_error("Unknown column: " + colspec);
-        } else if (right && tname == right->name) {
-            for (size_t i = 0; i < right->columns.size(); ++i)
-                if (right->columns[i].name == cname) return {1, i};
-            throw std::runtime_error("Unknown column: " + colspec);
-        } else {
-            throw std::runtime_error("Unknown table qualifier: " + tname);
-        }
+Batch empty_batch(std::vector<ColumnMeta> const& columns) {
+    Batch b;
+    b.columns.resize(columns.size());
+    for (size_t i = 0; i < columns.size(); ++i) b.columns[i].type = columns[i].type;
+    return b;
+}
+
+// Append validated rows to every column, index and column statistic. Readers see them only
+// once row_count moves, so a batch becomes visible as a whole.
+static void append_batch(Table& tbl, Batch const& rows) {
+    for (size_t i = 0; i < tbl.columns.size(); ++i) {
+        BatchColumn const& col = rows.columns[i];
+        if (auto ic = std::get_if<IntColumn>(&tbl.data[i])) ic->append(col.ints.data(), rows.rows);
+        else if (auto dc = std::get_if<DictColumn>(&tbl.data[i])) for (size_t r = 0; r < rows.rows; ++r) dc->push_back(col.text_at(r));
+        else { auto& tc = std::get<TextColumn>(tbl.data[i]); for (size_t r = 0; r < rows.rows; ++r) tc.push_back(col.text_at(r)); }
+        extend_zones(tbl.data[i]);
     }
-    // unqualified: prefer left, then right if present; error if ambiguous
-    std::optional<size_t> lidx;
-    for (size_t i = 0; i < left.columns.size(); ++i) if (left.columns[i].name == colspec) { lidx = i; break; }
-    std::optional<size_t> ridx;
-    if (right) {
-        for (size_t i = 0; i < right->columns.size(); ++i) if (right->columns[i].name == colspec) { ridx = i; break; }
+    for (auto& ix : tbl.indexes)
+        for (size_t r = tbl.row_count; r < tbl.row_count + rows.rows; ++r) ix->insert(tbl.data[ix->column], r);
+    size_t before = tbl.row_count;
+    for (size_t i = 0; i < tbl.columns.size(); ++i) tbl.stats[i].add(tbl.data[i], before, before + rows.rows);
+    tbl.row_count += rows.rows;
+    if (before < kDictSampleRows && tbl.row_count >= kDictSampleRows) choose_dict_encoding(tbl);
+    else if (tbl.row_count >= kDictSampleRows) drop_dict_encoding(tbl);
+}
+
+void Database::check_writable() const {
+    if (!wal_failure_.empty()) throw std::runtime_error("Database is read-only after a WAL failure: " + wal_failure_);
+}
+
+// Wait until the WAL record `seq` (0 for none) is durable. Its change is
+// already visible and cannot be taken back, so a failed write leaves it in
+// memory and makes the database read-only instead.
+void Database::wait_durable(uint64_t seq) {
+    if (!seq) return;
+    try {
+        wal_->wait(seq);
+    } catch (std::exception const& e) {
+        std::lock_guard<std::mutex> lock(commit_mu_);
+        if (wal_failure_.empty()) wal_failure_ = e.what();
+        throw std::runtime_error("Change applied in memory but not logged (" + wal_failure_ +
+                                 "); the database is now read-only");
     }
-    if (lidx && ridx) throw std::runtime_error("Ambiguous column name: " + colspec);
-    if (lidx) return {0, *lidx};
-    if (ridx) return {1, *ridx};
-    throw std::runtime_error("Unknown column: " + colspec);
 }
 
-QueryResult Database::select_rows(SelectStmt const& stmt) const {
-    QueryResult qr;
-    auto itL = tables_.find(stmt.table);
-    if (itL == tables_.end()) { qr.success = false; qr.message = "Unknown table"; return qr; }
-    Table const& left = itL->second;
+// Log and append a batch; returns the WAL sequence number to wait for, or 0
+uint64_t Database::commit_batch(Table& tbl, Batch const& rows) {
+    uint64_t seq = 0;
+    if (wal_) seq = wal_->append(WalRecordType::Insert, encode_insert(tbl, rows));
+    append_batch(tbl, rows);
+    return seq;
+}
 
-    if (!stmt.join) {
-        // Single-table path (existing behavior)
-        std::vector<size_t> col_indexes;
-        if (stmt.select_all) {
-            for (size_t i = 0; i < left.columns.size(); ++i) col_indexes.push_back(i);
-            for (auto const& c : left.columns) qr.header.push_back(c.name);
-        } else {
-            for (auto const& name : stmt.columns) {
-                auto idx = left.find_column(name);
-                if (!idx) { qr.success = false; qr.message = "Unknown column: " + name; return qr; }
-                col_indexes.push_back(*idx);
-            }
-            qr.header = stmt.columns;
-        }
+// Insert one or more rows into a table; all or none of them are added
+void Database::insert_row(InsertStmt const& stmt) {
+    uint64_t seq = 0;
+    {
+        std::lock_guard<std::mutex> lock(commit_mu_);
+        check_writable();
+        auto it = tables_.find(stmt.table);
+        if (it == tables_.end()) throw std::runtime_error("Unknown table: " + stmt.table);
+        Table& tbl = it->second;
+        size_t width = tbl.columns.size();
+        if (stmt.rows == 0 || width * stmt.rows != stmt.values.size()) throw std::runtime_error("Column count mismatch in INSERT");
+        if (!stmt.params.empty()) throw std::runtime_error("INSERT has placeholders; run it through a prepared statement");
 
-        std::optional<size_t> where_col_idx;
-        Value where_value;
-        std::string where_op;
-        if (stmt.where) {
-            auto idx = left.find_column(stmt.where->column);
-            if (!idx) { qr.success = false; qr.message = "Unknown column in WHERE: " + stmt.where->column; return qr; }
-            where_col_idx = *idx;
-            where_op = stmt.where->op;
-            auto const& meta = left.columns[*idx];
-            if (meta.type == ColumnType::Int) {
-                int64_t v{}; auto const& raw = stmt.where->value;
-                if (!parse_int64(raw, v)) { qr.success = false; qr.message = "Expected integer in WHERE for column " + meta.name; return qr; }
-                where_value = v;
-            } else { where_value = stmt.where->value; }
+        // Validate every value before appending so a bad row leaves the columns aligned
+        Batch rows = empty_batch(tbl.columns);
+        for (size_t v = 0; v < stmt.values.size(); ++v) {
+            auto const& meta = tbl.columns[v % width];
+            BatchColumn& col = rows.columns[v % width];
+            int64_t n;
+            if (meta.type == ColumnType::Text) col.push_text(stmt.values[v]);
+            else if (parse_int64(stmt.values[v], n)) col.push_int(n);
+            else throw std::runtime_error("Expected integer for column " + meta.name);
         }
+        rows.rows = stmt.rows;
+        seq = commit_batch(tbl, rows);
+    }
+    // Wait for durability outside the commit lock so concurrent inserts share a sync
+    wait_durable(seq);
+}
+
+size_t Database::attach_wal(WalOptions const& options) {
+    if (wal_) throw std::runtime_error("A WAL is already attached");
+    uint64_t skip = snapshot_wal_records_;
+    size_t n = WriteAheadLog::replay(options.path, [this](WalRecordType type, std::string_view payload) {
+        apply_wal_record(type, payload);
+    }, skip);
+    if (n < skip)
+        throw std::runtime_error("WAL " + options.path + " has " + std::to_string(n) + " records but the snapshot holds " +
+                                 std::to_string(skip));
+    auto wal = std::make_unique<WriteAheadLog>(options, n);
+    std::lock_guard<std::mutex> lock(commit_mu_);
+    wal_ = std::move(wal);
+    return n - skip;
+}
 
-        for (auto const& row : left.rows) {
-            bool include = true;
-            if (where_col_idx) {
-                try {
-                    int cval = cmp(row.values[*where_col_idx], where_value);
-                    if (where_op == "=") include = (cval == 0);
-                    else if (where_op == "!=") include = (cval != 0);
-                    else if (where_op == "<") include = (cval < 0);
-                    else if (where_op == "<=") include = (cval <= 0);
-                    else if (where_op == ">") include = (cval > 0);
-                    else if (where_op == ">=") include = (cval >= 0);
-                    else throw std::runtime_error("Unsupported operator");
-                } catch (std::exception const& ex) { qr.success = false; qr.message = ex.what(); return qr; }
+void Database::apply_wal_record(WalRecordType type, std::string_view payload) {
+    ByteReader r{payload};
+    if (type == WalRecordType::CreateTable) {
+        CreateTableStmt stmt;
+        stmt.table = std::string(r.get_string());
+        for (uint64_t n = r.get_varint(); n > 0; --n) {
+            ColumnDef c;
+            c.name = std::string(r.get_string());
+            c.type = static_cast<ColumnType>(r.get_u8());
+            c.dict = r.get_u8() != 0;
+            stmt.columns.push_back(std::move(c));
+        }
+        create_table(stmt);
+    } else if (type == WalRecordType::CreateIndex) {
+        CreateIndexStmt stmt;
+        stmt.name = std::string(r.get_string());
+        stmt.table = std::string(r.get_string());
+        stmt.column = std::string(r.get_string());
+        stmt.kind = static_cast<IndexKind>(r.get_u8());
+        create_index(stmt);
+    } else if (type == WalRecordType::Insert) {
+        std::lock_guard<std::mutex> lock(commit_mu_);
+        auto it = tables_.find(std::string(r.get_string()));
+        if (it == tables_.end()) throw std::runtime_error("WAL insert into unknown table");
+        Table& tbl = it->second;
+        Batch rows = empty_batch(tbl.columns);
+        for (; r.pos < payload.size(); ++rows.rows) {
+            for (auto& col : rows.columns) {
+                if (col.type == ColumnType::Int) col.push_int(r.get_svarint());
+                else col.push_text(r.get_string());
             }
-            if (!include) continue;
-            std::vector<std::string> outrow;
-            outrow.reserve(col_indexes.size());
-            for (auto idx : col_indexes) outrow.push_back(to_string(row.values[idx]));
-            qr.rows.push_back(std::move(outrow));
         }
-        qr.message = std::to_string(qr.rows.size()) + " row(s)";
-        return qr;
+        append_batch(tbl, rows);
+    } else {
+        throw std::runtime_error("Unknown WAL record type");
     }
+}
 
-    // JOIN path
-    auto itR = tables_.find(stmt.join->right_table);
-    if (itR == tables_.end()) { qr.success = false; qr.message = "Unknown right table in JOIN"; return qr; }
-    Table const& right = itR->second;
-
-    // Resolve JOIN columns
-    auto [lSel, lIdx] = resolve_column(stmt.join->left_col, left, &right);
-    auto [rSel, rIdx] = resolve_column(stmt.join->right_col, left, &right);
-    if (!(lSel == 0 && rSel == 1)) { qr.success = false; qr.message = "JOIN condition must be left_col from left table and right_col from right table"; return qr; }
-
-    // Type compatibility check
-    auto const& lmeta = left.columns[lIdx];
-    auto const& rmeta = right.columns[rIdx];
-    if (lmeta.type != rmeta.type) { qr.success = false; qr.message = "Type mismatch in JOIN columns"; return qr; }
+Table const* Database::find_table(std::string const& name) const {
+    std::lock_guard<std::mutex> lock(commit_mu_);
+    auto it = tables_.find(name);
+    return it == tables_.end() ? nullptr : &it->second;
+}
 
-    // Build projection plan: for select_all, list left.* then right.* headers as qualified names; otherwise resolve each requested column
-    struct Proj { int sel; size_t idx; }; // sel: 0 left, 1 right
-    std::vector<Proj> proj;
-    if (stmt.select_all) {
-        for (size_t i = 0; i < left.columns.size(); ++i) { proj.push_back({0, i}); qr.header.push_back(left.name + "." + left.columns[i].name); }
-        for (size_t i = 0; i < right.columns.size(); ++i) { proj.push_back({1, i}); qr.header.push_back(right.name + "." + right.columns[i].name); }
-    } else {
-        for (auto const& c : stmt.columns) {
-            auto [s, idx] = resolve_column(c, left, &right);
-            proj.push_back({s, idx});
-            qr.header.push_back(c);
-        }
+std::vector<std::shared_ptr<Table const>> Database::snapshot(std::vector<std::string> const& names) const {
+    std::vector<std::shared_ptr<Table const>> out;
+    std::lock_guard<std::mutex> lock(commit_mu_);
+    for (auto const& name : names) {
+        auto it = tables_.find(name);
+        out.push_back(it == tables_.end() ? nullptr : std::make_shared<Table const>(it->second));
     }
+    return out;
+}
 
-    // Prepare WHERE if present
-    std::optional<std::pair<int,size_t>> where_sel_idx;
-    Value where_value;
-    std::string where_op;
-    if (stmt.where) {
-        auto [s, idx] = resolve_column(stmt.where->column, left, &right);
-        where_sel_idx = std::make_pair(s, idx);
-        where_op = stmt.where->op;
-        auto const& meta = (s==0 ? left.columns[idx] : right.columns[idx]);
-        if (meta.type == ColumnType::Int) {
-            int64_t v{}; auto const& raw = stmt.where->value;
-            if (!parse_int64(raw, v)) { qr.success = false; qr.message = "Expected integer in WHERE for column " + meta.name; return qr; }
-            where_value = v;
-        } else { where_value = stmt.where->value; }
+MemoryUsage Database::memory_usage() const {
+    MemoryUsage out;
+    std::lock_guard<std::mutex> lock(commit_mu_);
+    for (auto const& [name, t] : tables_) {
+        TableMemory tm{name, t.row_count, {}, {}, {}};
+        for (size_t i = 0; i < t.columns.size(); ++i) {
+            tm.columns.push_back({t.columns[i].name, memory_stats(t.data[i])});
+            tm.total += tm.columns.back().usage;
+        }
+        for (auto const& ix : t.indexes) {
+            tm.indexes.push_back({ix->name, ix->memory()});
+            tm.total += tm.indexes.back().usage;
+        }
+        out.total += tm.total;
+        out.tables.push_back(std::move(tm));
     }
+    std::sort(out.tables.begin(), out.tables.end(), [](TableMemory const& a, TableMemory const& b) { return a.name < b.name; });
+    return out;
+}
 
-    // Nested-loop INNER JOIN
-    for (auto const& lrow : left.rows) {
-        Value const& lv = lrow.values[lIdx];
-        for (auto const& rrow : right.rows) {
-            Value const& rv = rrow.values[rIdx];
-            bool match = false;
-            try { match = (cmp(lv, rv) == 0); }
-            catch (std::exception const& ex) { qr.success = false; qr.message = ex.what(); return qr; }
-            if (!match) continue;
-
-            // WHERE
-            if (where_sel_idx) {
-                Value const& cv = (where_sel_idx->first==0 ? lrow.values[where_sel_idx->second] : rrow.values[where_sel_idx->second]);
-                int cval = cmp(cv, where_value);
-                bool include = false;
-                if (where_op == "=") include = (cval == 0);
-                else if (where_op == "!=") include = (cval != 0);
-                else if (where_op == "<") include = (cval < 0);
-                else if (where_op == "<=") include = (cval <= 0);
-                else if (where_op == ">") include = (cval > 0);
-                else if (where_op == ">=") include = (cval >= 0);
-                else { qr.success = false; qr.message = "Unsupported operator"; return qr; }
-                if (!include) continue;
-            }
+Cursor Database::open_cursor(SelectStmt const& stmt, size_t dop) const {
+    return Cursor(*this, stmt, dop ? dop : parallelism_);
+}
 
-            // Project
-            std::vector<std::string> outrow;
-            outrow.reserve(proj.size());
-            for (auto const& p : proj) {
-                outrow.push_back(to_string(p.sel==0 ? lrow.values[p.idx] : rrow.values[p.idx]));
+// Drain a cursor and stringify every cell
+template <class Open>
+static QueryResult drain(Open open) {
+    QueryResult qr;
+    try {
+        Cursor cur = open();
+        qr.header = cur.header();
+        Batch batch;
+        while (cur.next(batch)) {
+            for (size_t r = 0; r < batch.rows; ++r) {
+                std::vector<std::string> outrow;
+                outrow.reserve(batch.columns.size());
+                for (auto const& c : batch.columns) outrow.push_back(cell_to_string(c, r));
+                qr.rows.push_back(std::move(outrow));
             }
-            qr.rows.push_back(std::move(outrow));
         }
+    } catch (std::exception const& ex) {
+        qr.success = false; qr.message = ex.what(); qr.header.clear(); qr.rows.clear();
+        return qr;
     }
-
     qr.message = std::to_string(qr.rows.size()) + " row(s)";
     return qr;
 }
 
+QueryResult Database::select_rows(SelectStmt const& stmt, size_t dop) const {
+    return drain([&] { return open_cursor(stmt, dop); });
+}
+
+QueryResult Database::select_rows(PreparedStatement const& stmt, std::vector<Value> const& params, size_t dop) const {
+    return drain([&] { return open_cursor(stmt, params, dop); });
+}
+
 } // namespace inmemdb
@@ -0,0 +1,89 @@
+#include "inmemdb/thread_pool.hpp"
+#include <algorithm>
+
+namespace inmemdb {
+
+ThreadPool::ThreadPool(size_t threads) { ensure_threads(threads); }
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& t : threads_) t.join();
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+void ThreadPool::ensure_threads(size_t n) {
+    std::lock_guard<std::mutex> lock(mu_);
+    while (threads_.size() < n) threads_.emplace_back([this] { helper_loop(); });
+}
+
+void ThreadPool::helper_loop() {
+    std::unique_lock<std::mutex> lock(mu_);
+    while (true) {
+        wake_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+        if (stop_) return;
+        auto job = queue_.front();
+        size_t worker = job->claimed++;
+        if (job->claimed == job->workers) queue_.pop_front();
+        ++job->active;
+        lock.unlock();
+        work(*job, worker);
+        lock.lock();
+        --job->active;
+        idle_.notify_all();
+    }
+}
+
+// Drain this worker's own range first, then steal from the others in turn
+void ThreadPool::work(Job& job, size_t worker) {
+    for (size_t k = 0; k < job.workers; ++k) {
+        Range& r = job.ranges[(worker + k) % job.workers];
+        for (size_t m; (m = r.next.fetch_add(1, std::memory_order_relaxed)) < r.end;) {
+            try {
+                (*job.fn)(m, worker);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(job.error_mu);
+                if (!job.error) job.error = std::current_exception();
+            }
+        }
+    }
+}
+
+void ThreadPool::run(size_t n, size_t dop, MorselFn const& fn) {
+    dop = std::max<size_t>(1, std::min(dop, n));
+    if (dop == 1) {
+        for (size_t m = 0; m < n; ++m) fn(m, 0);
+        return;
+    }
+    ensure_threads(dop - 1);
+    auto job = std::make_shared<Job>();
+    job->fn = &fn;
+    job->workers = dop;
+    job->ranges.reset(new Range[dop]);
+    for (size_t w = 0; w < dop; ++w) {
+        job->ranges[w].next = n * w / dop;
+        job->ranges[w].end = n * (w + 1) / dop;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        queue_.push_back(job);
+    }
+    wake_.notify_all();
+    work(*job, 0);
+    // Every morsel has been taken; retire the job and wait for helpers still
+    // finishing theirs
+    std::unique_lock<std::mutex> lock(mu_);
+    auto it = std::find(queue_.begin(), queue_.end(), job);
+    if (it != queue_.end()) queue_.erase(it);
+    idle_.wait(lock, [&] { return job->active == 0; });
+    if (job->error) std::rethrow_exception(job->error);
+}
+
+} // namespace inmemdb
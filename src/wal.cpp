@@ -0,0 +1,139 @@
+#include "inmemdb/wal.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace inmemdb {
+
+static void put_u32(std::string& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+static uint32_t get_u32(char const* p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+    return v;
+}
+
+static std::runtime_error io_error(char const* what, std::string const& path) {
+    return std::runtime_error(std::string(what) + " " + path + ": " + std::strerror(errno));
+}
+
+WriteAheadLog::WriteAheadLog(WalOptions options, uint64_t records)
+    : options_(std::move(options)), appended_(records), written_(records) {
+    fd_ = ::open(options_.path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0) throw io_error("Cannot open WAL", options_.path);
+    if (options_.sync == SyncPolicy::Group) flusher_ = std::thread([this] { flusher_loop(); });
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    {
+        std::unique_lock<std::mutex> lock(mu_);
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+    if (flusher_.joinable()) flusher_.join();
+    std::unique_lock<std::mutex> lock(mu_);
+    durable_cv_.wait(lock, [this] { return !flushing_; });
+    if (pending_records_ > 0) flush_locked(lock);
+    ::close(fd_);
+}
+
+uint64_t WriteAheadLog::append(WalRecordType type, std::string_view payload) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (error_) std::rethrow_exception(error_);
+    size_t start = pending_.size();
+    put_u32(pending_, static_cast<uint32_t>(payload.size() + 1));
+    pending_.push_back(static_cast<char>(type));
+    pending_.append(payload);
+    put_u32(pending_, crc32(std::string_view(pending_).substr(start + 4)));
+    if (pending_records_++ == 0) first_pending_ = std::chrono::steady_clock::now();
+    if (options_.sync == SyncPolicy::Group) work_cv_.notify_one();
+    return ++appended_;
+}
+
+void WriteAheadLog::wait(uint64_t seq) {
+    std::unique_lock<std::mutex> lock(mu_);
+    while (written_ < seq) {
+        if (error_) std::rethrow_exception(error_);
+        // Without a flusher the first waiter writes every pending record
+        // (its own and any that queued behind it) while the others wait
+        if (options_.sync == SyncPolicy::Group || flushing_) durable_cv_.wait(lock);
+        else flush_locked(lock);
+    }
+}
+
+uint64_t WriteAheadLog::records() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return appended_;
+}
+
+// Write out everything pending with the lock released; called with it held
+void WriteAheadLog::flush_locked(std::unique_lock<std::mutex>& lock) {
+    flushing_ = true;
+    std::string buf = std::move(pending_);
+    pending_.clear();
+    pending_records_ = 0;
+    uint64_t last = appended_;
+    lock.unlock();
+    std::exception_ptr err;
+    for (size_t off = 0; off < buf.size();) {
+        ssize_t n = ::write(fd_, buf.data() + off, buf.size() - off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) { err = std::make_exception_ptr(io_error("Cannot write WAL", options_.path)); break; }
+        off += static_cast<size_t>(n);
+    }
+    if (!err && options_.sync != SyncPolicy::OsBuffered && ::fdatasync(fd_) != 0)
+        err = std::make_exception_ptr(io_error("Cannot sync WAL", options_.path));
+    lock.lock();
+    flushing_ = false;
+    if (err) error_ = err;
+    else written_ = last;
+    durable_cv_.notify_all();
+}
+
+void WriteAheadLog::flusher_loop() {
+    std::unique_lock<std::mutex> lock(mu_);
+    while (true) {
+        work_cv_.wait(lock, [this] { return stop_ || pending_records_ > 0; });
+        if (stop_) return; // the destructor flushes the rest
+        // Let the group fill up until the window closes
+        work_cv_.wait_until(lock, first_pending_ + options_.group_window,
+                            [this] { return stop_ || pending_records_ >= options_.group_records; });
+        flush_locked(lock);
+    }
+}
+
+size_t WriteAheadLog::replay(std::string const& path, std::function<void(WalRecordType, std::string_view)> const& apply,
+                             size_t skip) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) return 0;
+        throw io_error("Cannot open WAL", path);
+    }
+    std::string data;
+    char chunk[1 << 16];
+    for (ssize_t n; (n = ::read(fd, chunk, sizeof chunk)) != 0;) {
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) { ::close(fd); throw io_error("Cannot read WAL", path); }
+        data.append(chunk, static_cast<size_t>(n));
+    }
+    ::close(fd);
+
+    size_t off = 0, records = 0;
+    while (data.size() - off >= 9) {
+        uint32_t size = get_u32(data.data() + off);
+        if (size == 0 || size > data.size() - off - 8) break;
+        std::string_view body(data.data() + off + 4, size);
+        if (crc32(body) != get_u32(data.data() + off + 4 + size)) break;
+        if (records >= skip) apply(static_cast<WalRecordType>(body[0]), body.substr(1));
+        off += 8 + size;
+        ++records;
+    }
+    if (off < data.size() && ::truncate(path.c_str(), static_cast<off_t>(off)) != 0)
+        throw io_error("Cannot truncate torn WAL tail of", path);
+    return records;
+}
+
+} // namespace inmemdb
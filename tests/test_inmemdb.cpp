@@ -1,11 +1,24 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <csignal>
+#include <sys/resource.h>
+#include <unistd.h>
 
 #include "inmemdb/lexer.hpp"
 #include "inmemdb/parser.hpp"
 #include "inmemdb/executor.hpp"
 #include "inmemdb/storage.hpp"
+#include "inmemdb/simd.hpp"
+#include "inmemdb/server.hpp"
+#include "inmemdb/client.hpp"
 
 using namespace inmemdb;
 
@@ -68,9 +81,1285 @@ static void test_inner_join() {
     EXPECT_EQ(sel.rows[0][1], std::string("100"));
 }
 
+static void test_join_text_key_and_non_equi() {
+    Database db;
+    auto rr = run_sql(db,
+        "CREATE TABLE a(k TEXT, x INT);\n"
+        "CREATE TABLE b(k TEXT, y INT);\n"
+        "INSERT INTO a VALUES('p', 1);\n"
+        "INSERT INTO a VALUES('q', 2);\n"
+        "INSERT INTO a VALUES('r', 3);\n"
+        "INSERT INTO b VALUES('q', 10);\n"
+        "INSERT INTO b VALUES('r', 20);\n"
+        "SELECT a.x, b.y FROM a JOIN b ON a.k = b.k;\n"
+        "SELECT a.x, b.y FROM a JOIN b ON a.x < b.y;\n"
+    );
+    auto const& eq = rr.results[7];
+    EXPECT_TRUE(eq.success);
+    EXPECT_EQ(eq.rows.size(), 2u);
+    EXPECT_EQ(eq.rows[0][0], std::string("2"));
+    EXPECT_EQ(eq.rows[0][1], std::string("10"));
+    EXPECT_EQ(eq.rows[1][0], std::string("3"));
+    EXPECT_EQ(eq.rows[1][1], std::string("20"));
+    auto const& lt = rr.results[8];
+    EXPECT_TRUE(lt.success);
+    EXPECT_EQ(lt.rows.size(), 6u);
+}
+
+static void test_rejected_insert_keeps_columns_aligned() {
+    Database db;
+    auto rr = run_sql(db,
+        "CREATE TABLE t(name TEXT, n INT);\n"
+        "INSERT INTO t VALUES('a', 1);\n"
+        "INSERT INTO t VALUES('b', oops);\n"
+        "INSERT INTO t VALUES('c', 3);\n"
+        "SELECT * FROM t;\n"
+    );
+    EXPECT_TRUE(!rr.results[2].success);
+    auto const& sel = rr.results.back();
+    EXPECT_TRUE(sel.success);
+    EXPECT_EQ(sel.rows.size(), 2u);
+    EXPECT_EQ(sel.rows[1][0], std::string("c"));
+    EXPECT_EQ(sel.rows[1][1], std::string("3"));
+}
+
+static void test_indexes_match_scans() {
+    // Same data with and without indexes; every operator must agree
+    Database plain, indexed;
+    run_sql(plain, "CREATE TABLE t(k INT, s TEXT);");
+    run_sql(indexed,
+        "CREATE TABLE t(k INT, s TEXT);\n"
+        "CREATE INDEX t_k ON t(k) USING BTREE;\n"
+        "CREATE INDEX t_s ON t(s) USING HASH;\n"
+    );
+    std::string sql;
+    for (int i = 0; i < 3000; ++i) {
+        int k = (i * 7919) % 500; // duplicates force B+tree splits across equal keys
+        sql += "INSERT INTO t VALUES(" + std::to_string(k) + ", 's" + std::to_string(k % 7) + "');\n";
+    }
+    run_sql(plain, sql);
+    run_sql(indexed, sql);
+    for (std::string op : {"=", "!=", "<", "<=", ">", ">="}) {
+        std::string q = "SELECT * FROM t WHERE k " + op + " 250;";
+        auto a = run_sql(plain, q).results[0];
+        auto b = run_sql(indexed, q).results[0];
+        EXPECT_TRUE(b.success);
+        EXPECT_EQ(a.rows.size(), b.rows.size());
+        EXPECT_TRUE(a.rows == b.rows);
+    }
+    auto a = run_sql(plain, "SELECT k FROM t WHERE s = 's3';").results[0];
+    auto b = run_sql(indexed, "SELECT k FROM t WHERE s = 's3';").results[0];
+    EXPECT_TRUE(a.rows == b.rows);
+    auto bad = run_sql(indexed, "CREATE INDEX t_k ON t(s);").results[0];
+    EXPECT_TRUE(!bad.success);
+}
+
+static void test_index_nested_loop_join() {
+    Database db;
+    auto rr = run_sql(db,
+        "CREATE TABLE users(id INT, name TEXT);\n"
+        "CREATE TABLE orders(user_id INT, total INT);\n"
+        "INSERT INTO users VALUES(1, Alice);\n"
+        "INSERT INTO users VALUES(2, Bob);\n"
+        "INSERT INTO orders VALUES(1, 100);\n"
+        "INSERT INTO orders VALUES(2, 75);\n"
+        "INSERT INTO orders VALUES(1, 50);\n"
+        "CREATE INDEX orders_user ON orders(user_id) USING HASH;\n"
+        "SELECT users.name, orders.total FROM users JOIN orders ON users.id = orders.user_id;\n"
+    );
+    auto const& sel = rr.results.back();
+    EXPECT_TRUE(sel.success);
+    EXPECT_EQ(sel.rows.size(), 3u);
+    EXPECT_EQ(sel.rows[0][1], std::string("100"));
+    EXPECT_EQ(sel.rows[1][1], std::string("50"));
+    EXPECT_EQ(sel.rows[2][0], std::string("Bob"));
+}
+
+static void test_cursor_batches() {
+    Database db;
+    std::string sql = "CREATE TABLE t(id INT, tag TEXT);\n";
+    for (int i = 0; i < 10; ++i) sql += "INSERT INTO t VALUES(" + std::to_string(i) + ", 'x" + std::to_string(i) + "');\n";
+    run_sql(db, sql);
+    SelectStmt stmt;
+    stmt.select_all = true;
+    stmt.table = "t";
+    stmt.where = WhereCond{"id", CompareOp::Ge, "3"};
+    Cursor cur = db.open_cursor(stmt);
+    EXPECT_EQ(cur.header().size(), 2u);
+    EXPECT_TRUE(cur.types()[0] == ColumnType::Int);
+    Batch batch;
+    std::vector<size_t> sizes;
+    int64_t sum = 0;
+    while (cur.next(batch, 4)) {
+        sizes.push_back(batch.rows);
+        for (size_t r = 0; r < batch.rows; ++r) sum += batch.columns[0].int_at(r);
+        EXPECT_EQ(batch.columns[1].text_at(0).substr(0, 1), std::string_view("x"));
+    }
+    EXPECT_EQ(sizes.size(), 2u); // 7 rows in batches of at most 4
+    EXPECT_EQ(sum, 42);
+    bool threw = false;
+    try { stmt.table = "missing"; db.open_cursor(stmt); } catch (std::exception const&) { threw = true; }
+    EXPECT_TRUE(threw);
+}
+
+static void test_where_on_either_join_side() {
+    Database db;
+    auto rr = run_sql(db,
+        "CREATE TABLE users(id INT, name TEXT);\n"
+        "CREATE TABLE orders(user_id INT, total INT);\n"
+        "INSERT INTO users VALUES(1, Alice);\n"
+        "INSERT INTO users VALUES(2, Bob);\n"
+        "INSERT INTO orders VALUES(1, 100);\n"
+        "INSERT INTO orders VALUES(1, 50);\n"
+        "INSERT INTO orders VALUES(2, 75);\n"
+        "SELECT orders.total FROM users JOIN orders ON users.id = orders.user_id WHERE users.name = 'Alice';\n"
+        "SELECT users.name FROM users JOIN orders ON users.id = orders.user_id WHERE orders.total < 80;\n"
+        "SELECT users.name FROM users JOIN orders ON users.id = orders.user_id WHERE users.name > 'Zed';\n"
+    );
+    auto const& a = rr.results[7];
+    EXPECT_EQ(a.rows.size(), 2u);
+    EXPECT_EQ(a.rows[0][0], std::string("100"));
+    EXPECT_EQ(a.rows[1][0], std::string("50"));
+    auto const& b = rr.results[8];
+    EXPECT_EQ(b.rows.size(), 2u);
+    EXPECT_EQ(b.rows[0][0], std::string("Alice"));
+    EXPECT_EQ(b.rows[1][0], std::string("Bob"));
+    EXPECT_TRUE(rr.results[9].success);
+    EXPECT_EQ(rr.results[9].rows.size(), 0u);
+}
+
+static void test_simd_filter_kernels_match_scalar() {
+    // Every supported level must select exactly the rows the scalar kernel does,
+    // including ragged tails and ranges that do not start on a vector boundary
+    std::vector<int64_t> data;
+    uint64_t x = 12345;
+    for (int i = 0; i < 1003; ++i) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        data.push_back(static_cast<int64_t>(x >> 33) % 41 - 20);
+    }
+    data[7] = INT64_MIN;
+    data[8] = INT64_MAX;
+    std::vector<size_t> expect(data.size()), got(data.size());
+    for (int o = 0; o < 6; ++o) {
+        auto op = static_cast<CompareOp>(o);
+        for (int64_t value : {int64_t{-20}, int64_t{0}, int64_t{7}, INT64_MAX}) {
+            for (size_t begin : {size_t{0}, size_t{3}}) {
+                size_t n = int_filter_kernel(op, SimdLevel::Scalar)(data.data(), begin, data.size(), value, expect.data());
+                for (auto level : {SimdLevel::SSE42, SimdLevel::AVX2}) {
+                    size_t m = int_filter_kernel(op, level)(data.data(), begin, data.size(), value, got.data());
+                    EXPECT_EQ(m, n);
+                    EXPECT_TRUE(std::equal(expect.begin(), expect.begin() + static_cast<std::ptrdiff_t>(n), got.begin()));
+                }
+            }
+        }
+    }
+}
+
+static void test_dict_columns_match_plain_text() {
+    Database plain, dict;
+    run_sql(plain, "CREATE TABLE t(id INT, status TEXT); CREATE TABLE s(status TEXT, label TEXT);");
+    run_sql(dict, "CREATE TABLE t(id INT, status TEXT DICT); CREATE TABLE s(status TEXT DICT, label TEXT);");
+    std::string sql;
+    char const* statuses[] = {"open", "closed", "pending"};
+    for (int i = 0; i < 50; ++i) sql += "INSERT INTO t VALUES(" + std::to_string(i) + ", '" + statuses[i % 3] + "');\n";
+    sql += "INSERT INTO s VALUES('closed', 'C'); INSERT INTO s VALUES('pending', 'P'); INSERT INTO s VALUES('gone', 'G');";
+    run_sql(plain, sql);
+    run_sql(dict, sql);
+    EXPECT_TRUE(std::holds_alternative<DictColumn>(dict.find_table("t")->data[1]));
+    for (std::string q : {
+             "SELECT id FROM t WHERE status = 'pending';",
+             "SELECT id FROM t WHERE status != 'open';",
+             "SELECT id FROM t WHERE status = 'missing';",
+             "SELECT id FROM t WHERE status != 'missing';",
+             "SELECT id FROM t WHERE status < 'open';",
+             "SELECT id FROM t WHERE status >= 'open';",
+             "SELECT t.id, s.label FROM t JOIN s ON t.status = s.status;",
+             "SELECT s.label, t.id FROM s JOIN t ON s.status = t.status WHERE t.id < 10;"}) {
+        auto a = run_sql(plain, q).results[0];
+        auto b = run_sql(dict, q).results[0];
+        EXPECT_TRUE(b.success);
+        EXPECT_EQ(a.rows.size(), b.rows.size());
+        EXPECT_TRUE(a.rows == b.rows);
+    }
+}
+
+static void test_low_cardinality_text_is_dict_encoded() {
+    Database db;
+    run_sql(db, "CREATE TABLE t(country TEXT, name TEXT, code TEXT DICT);");
+    for (size_t i = 0; i < kDictSampleRows; ++i)
+        db.insert_row(InsertStmt{"t", {i % 2 ? "DE" : "FR", "user" + std::to_string(i), "k" + std::to_string(i % 3)}});
+    Table const* t = db.find_table("t");
+    EXPECT_TRUE(std::holds_alternative<DictColumn>(t->data[0]));
+    EXPECT_TRUE(std::holds_alternative<TextColumn>(t->data[1]));
+    auto sel = run_sql(db, "SELECT name FROM t WHERE country = 'DE';").results[0];
+    EXPECT_EQ(sel.rows.size(), kDictSampleRows / 2);
+    EXPECT_EQ(sel.rows[0][0], std::string("user1"));
+
+    // A column that only looked low-cardinality goes back to plain TEXT, even
+    // after a snapshot round trip; a declared DICT column stays encoded
+    std::string path = "/tmp/inmemdb_dict_" + std::to_string(::getpid()) + ".snap";
+    run_sql(db, "SNAPSHOT TO '" + path + "';");
+    Database loaded;
+    loaded.load_snapshot(path);
+    std::remove(path.c_str());
+    for (Database* d : {&db, &loaded}) {
+        for (size_t i = 0; i < kDictSampleRows; ++i)
+            d->insert_row(InsertStmt{"t", {"c" + std::to_string(i), "user" + std::to_string(kDictSampleRows + i), "x" + std::to_string(i)}});
+        Table const* lt = d->find_table("t");
+        EXPECT_TRUE(std::holds_alternative<TextColumn>(lt->data[0]) && !lt->columns[0].dict);
+        EXPECT_TRUE(std::holds_alternative<DictColumn>(lt->data[2]) && lt->columns[2].dict && lt->columns[2].declared_dict);
+    }
+    t = db.find_table("t");
+    sel = run_sql(db, "SELECT name FROM t WHERE country = 'DE' OR country = 'c7';").results[0];
+    EXPECT_EQ(sel.rows.size(), kDictSampleRows / 2 + 1);
+    EXPECT_EQ(sel.rows.back()[0], "user" + std::to_string(kDictSampleRows + 7));
+}
+
+static void test_group_by_aggregates() {
+    Database db;
+    run_sql(db,
+        "CREATE TABLE sales(region TEXT, item TEXT, qty INT);\n"
+        "INSERT INTO sales VALUES('north', 'apple', 3);\n"
+        "INSERT INTO sales VALUES('south', 'pear', 5);\n"
+        "INSERT INTO sales VALUES('north', 'fig', 4);\n"
+        "CREATE TABLE regions(name TEXT, manager TEXT);\n"
+        "INSERT INTO regions VALUES('north', 'ann');\n"
+        "INSERT INTO regions VALUES('south', 'bob');\n");
+    auto g = run_sql(db, "SELECT region, COUNT(*), SUM(qty), MIN(item), MAX(qty), AVG(qty) FROM sales GROUP BY region;").results[0];
+    EXPECT_TRUE(g.success);
+    EXPECT_EQ(g.header.size(), 6u);
+    EXPECT_EQ(g.header[1], std::string("COUNT(*)"));
+    EXPECT_EQ(g.rows.size(), 2u);
+    auto sorted = g.rows;
+    std::sort(sorted.begin(), sorted.end());
+    EXPECT_TRUE((sorted[0] == std::vector<std::string>{"north", "2", "7", "apple", "4", "3.5"}));
+    EXPECT_TRUE((sorted[1] == std::vector<std::string>{"south", "1", "5", "pear", "5", "5"}));
+
+    // Without GROUP BY there is exactly one group, even for no input rows
+    auto all = run_sql(db, "SELECT COUNT(*), SUM(qty) FROM sales WHERE qty > 3;").results[0];
+    EXPECT_TRUE((all.rows == std::vector<std::vector<std::string>>{{"2", "9"}}));
+    auto none = run_sql(db, "SELECT COUNT(qty) FROM sales WHERE qty > 100;").results[0];
+    EXPECT_TRUE((none.rows == std::vector<std::vector<std::string>>{{"0"}}));
+
+    auto j = run_sql(db, "SELECT regions.manager, SUM(sales.qty) FROM sales JOIN regions ON sales.region = regions.name GROUP BY regions.manager;").results[0];
+    sorted = j.rows;
+    std::sort(sorted.begin(), sorted.end());
+    EXPECT_TRUE((sorted == std::vector<std::vector<std::string>>{{"ann", "7"}, {"bob", "5"}}));
+
+    EXPECT_TRUE(!run_sql(db, "SELECT item, COUNT(*) FROM sales GROUP BY region;").results[0].success);
+    EXPECT_TRUE(!run_sql(db, "SELECT SUM(item) FROM sales;").results[0].success);
+
+    // Sums past INT64 are an error, not a wrap; AVG and sums that come back
+    // into range are exact
+    run_sql(db, "CREATE TABLE big(g INT, v INT);");
+    db.insert_row(InsertStmt{"big", {"1", "9223372036854775807", "1", "9223372036854775807", "2", "9223372036854775807", "2", "1", "2", "-2"}, 5});
+    auto over = run_sql(db, "SELECT SUM(v) FROM big WHERE g = 1;").results[0];
+    EXPECT_TRUE(!over.success && over.message.find("Integer overflow in SUM") != std::string::npos);
+    auto back = run_sql(db, "SELECT SUM(v), AVG(v) FROM big WHERE g = 2;").results[0];
+    EXPECT_TRUE((back.success && back.rows == std::vector<std::vector<std::string>>{{"9223372036854775806", "3.07446e+18"}}));
+    EXPECT_TRUE(run_sql(db, "SELECT AVG(v) FROM big WHERE g = 1;").results[0].success);
+}
+
+static void test_order_by_limit() {
+    Database db;
+    run_sql(db, "CREATE TABLE t(id INT, tag TEXT, v INT);");
+    for (int i = 0; i < 5000; ++i)
+        db.insert_row(InsertStmt{"t", {std::to_string(i), "tag" + std::to_string(i % 7), std::to_string((i * 7919) % 100)}});
+
+    // Top-K (bounded heap) must return the same rows as slicing the full sort, ties in table order
+    auto full = run_sql(db, "SELECT id, tag FROM t ORDER BY v DESC, tag;").results[0];
+    EXPECT_EQ(full.rows.size(), 5000u);
+    for (auto const& [limit, offset] : std::vector<std::pair<size_t, size_t>>{{10, 0}, {25, 40}, {1, 4999}, {3000, 100}}) {
+        auto top = run_sql(db, "SELECT id, tag FROM t ORDER BY v DESC, tag LIMIT " + std::to_string(limit) +
+                                   " OFFSET " + std::to_string(offset) + ";").results[0];
+        EXPECT_TRUE(top.success);
+        auto end = std::min(full.rows.size(), offset + limit);
+        EXPECT_TRUE((top.rows == std::vector<std::vector<std::string>>(full.rows.begin() + offset, full.rows.begin() + end)));
+    }
+    auto asc = run_sql(db, "SELECT id FROM t ORDER BY v LIMIT 3;").results[0];
+    EXPECT_TRUE((asc.rows == std::vector<std::vector<std::string>>{{"0"}, {"100"}, {"200"}}));
+
+    // Limits near SIZE_MAX keep every row: offset + limit and the compaction
+    // threshold saturate instead of wrapping
+    auto huge = run_sql(db, "SELECT id, tag FROM t ORDER BY v DESC, tag LIMIT 18446744073709551615 OFFSET 1;").results[0];
+    EXPECT_TRUE((huge.success && huge.rows == std::vector<std::vector<std::string>>(full.rows.begin() + 1, full.rows.end())));
+    auto half = run_sql(db, "SELECT id, tag FROM t ORDER BY v DESC, tag LIMIT 9223372036854775808;").results[0];
+    EXPECT_TRUE(half.rows == full.rows);
+    auto plan = run_sql(db, "EXPLAIN SELECT id FROM t ORDER BY id LIMIT 18446744073709551615 OFFSET 2;").results[0];
+    EXPECT_EQ(plan.rows[0][0], std::string("Sort (id, LIMIT 18446744073709551615, OFFSET 2, top-18446744073709551615 heap)"));
+    bool threw = false;
+    try { Parser(Lexer("SELECT id FROM t LIMIT 18446744073709551616;")).parse_all(); } catch (std::exception const&) { threw = true; }
+    EXPECT_TRUE(threw);
+
+    // Plain LIMIT returns the first rows in table order
+    auto first = run_sql(db, "SELECT * FROM t LIMIT 2 OFFSET 3;").results[0];
+    EXPECT_EQ(first.header.size(), 3u);
+    EXPECT_TRUE((first.rows == std::vector<std::vector<std::string>>{{"3", "tag3", "57"}, {"4", "tag4", "76"}}));
+    EXPECT_EQ(run_sql(db, "SELECT id FROM t WHERE v < 50 LIMIT 0;").results[0].rows.size(), 0u);
+
+    auto groups = run_sql(db, "SELECT tag, COUNT(*) FROM t GROUP BY tag ORDER BY COUNT(*) DESC, tag LIMIT 2;").results[0];
+    EXPECT_TRUE((groups.rows == std::vector<std::vector<std::string>>{{"tag0", "715"}, {"tag1", "715"}}));
+    EXPECT_TRUE(!run_sql(db, "SELECT tag, COUNT(*) FROM t GROUP BY tag ORDER BY v;").results[0].success);
+}
+
+static void test_parallel_matches_serial() {
+    Database db;
+    run_sql(db, "CREATE TABLE facts(id INT, k INT, tag TEXT, v INT);");
+    run_sql(db, "CREATE TABLE dims(k INT, name TEXT);");
+    const size_t rows = 3 * Cursor::kMorselRows + 123;
+    for (size_t i = 0; i < rows; ++i)
+        db.insert_row(InsertStmt{"facts", {std::to_string(i), std::to_string((i * 7919) % 5000),
+                                           "tag" + std::to_string(i % 13), std::to_string(i % 1000)}});
+    for (size_t i = 0; i < 2 * Cursor::kMorselRows; ++i)
+        db.insert_row(InsertStmt{"dims", {std::to_string(i % 4000), "dim" + std::to_string(i)}});
+    for (std::string q : {
+             "SELECT id, tag FROM facts WHERE v < 100;",
+             "SELECT * FROM facts;",
+             "SELECT facts.id, dims.name FROM facts JOIN dims ON facts.k = dims.k WHERE dims.name >= 'dim3';",
+             "SELECT facts.id, dims.name FROM facts JOIN dims ON facts.k = dims.k WHERE facts.v = 7;",
+             "SELECT dims.name, facts.id FROM dims JOIN facts ON dims.name = facts.tag;",
+             "SELECT tag, COUNT(*), SUM(v), MIN(id), MAX(tag), AVG(k) FROM facts GROUP BY tag;",
+             "SELECT k, tag, COUNT(*) FROM facts WHERE v > 500 GROUP BY k, tag;",
+             "SELECT COUNT(*), SUM(v), MIN(tag) FROM facts;",
+             "SELECT dims.name, SUM(facts.v) FROM facts JOIN dims ON facts.k = dims.k GROUP BY dims.name;",
+             "SELECT id FROM facts ORDER BY v DESC, id LIMIT 20;"}) {
+        SelectStmt stmt = std::get<SelectStmt>(Parser(Lexer(q)).parse_all()[0]);
+        auto serial = db.select_rows(stmt, 1);
+        auto parallel = db.select_rows(stmt, 4);
+        EXPECT_TRUE(parallel.success);
+        EXPECT_EQ(serial.rows.size(), parallel.rows.size());
+        EXPECT_TRUE(serial.rows == parallel.rows);
+    }
+
+    // Batches from a parallel cursor respect max_rows
+    SelectStmt all = std::get<SelectStmt>(Parser(Lexer("SELECT id FROM facts;")).parse_all()[0]);
+    Cursor cur = db.open_cursor(all, 3);
+    Batch b;
+    size_t total = 0;
+    while (cur.next(b, 1000)) { EXPECT_TRUE(b.rows <= 1000); total += b.rows; }
+    EXPECT_EQ(total, rows);
+
+    // Only a window of morsels is projected ahead of the consumer
+    run_sql(db, "CREATE TABLE wide(id INT);");
+    InsertStmt ins{"wide", {}, 10 * Cursor::kMorselRows, {}};
+    for (size_t i = 0; i < ins.rows; ++i) ins.values.push_back(std::to_string(i));
+    db.insert_row(ins);
+    const size_t window = 2 * MorselProjectOp::kWindowPerWorker * Cursor::kMorselRows; // dop 2
+    Cursor wide = db.open_cursor(std::get<SelectStmt>(Parser(Lexer("SELECT id FROM wide;")).parse_all()[0]), 2);
+    wide.set_profiling(true);
+    EXPECT_TRUE(wide.next(b, 1000) && b.columns[0].int_at(0) == 0);
+    EXPECT_EQ(wide.stats().project.rows_out, uint64_t(window));
+    int64_t expect = 1000;
+    total = b.rows;
+    while (wide.next(b, 1000)) {
+        EXPECT_EQ(b.columns[0].int_at(0), expect);
+        expect += static_cast<int64_t>(b.rows);
+        total += b.rows;
+    }
+    EXPECT_EQ(total, ins.rows);
+    EXPECT_EQ(wide.stats().project.rows_out, uint64_t(ins.rows));
+    EXPECT_TRUE(wide.stats().project.peak_bytes <= window * sizeof(int64_t));
+}
+
+// Readers racing a writer must always see a prefix of the inserted rows:
+// row i has v = 2 * i, so every snapshot of n rows sums to n * (n - 1)
+static void test_concurrent_snapshots() {
+    Database db;
+    run_sql(db, "CREATE TABLE t(id INT, v INT, tag TEXT); CREATE INDEX t_id ON t(id) USING HASH;");
+    const int64_t rows = 3 * static_cast<int64_t>(kDictSampleRows);
+    std::atomic<bool> done{false};
+    std::atomic<int> bad{0};
+    std::thread writer([&] {
+        for (int64_t i = 0; i < rows; ++i) {
+            db.insert_row(InsertStmt{"t", {std::to_string(i), std::to_string(2 * i), "tag" + std::to_string(i % 4)}});
+            if (i == rows / 2) run_sql(db, "CREATE INDEX t_v ON t(v);");
+        }
+        done = true;
+    });
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&, r] {
+            int64_t last = 0;
+            while (!done) {
+                auto q = run_sql(db, "SELECT tag, COUNT(*), SUM(v) FROM t GROUP BY tag;").results[0];
+                int64_t n = 0, sum = 0;
+                for (auto const& row : q.rows) { n += std::stoll(row[1]); sum += std::stoll(row[2]); }
+                if (!q.success || sum != n * (n - 1) || n < last) ++bad;
+                last = n;
+                if (n == 0) continue;
+                // Rows seen once stay visible through the hash and B+tree indexes
+                std::string k = std::to_string((n - 1) / (r + 1));
+                auto point = run_sql(db, "SELECT v FROM t WHERE id = " + k + ";").results[0];
+                if (point.rows.size() != 1 || point.rows[0][0] != std::to_string(2 * std::stoll(k))) ++bad;
+                auto range = run_sql(db, "SELECT COUNT(*) FROM t WHERE v < 100;").results[0];
+                int64_t c = std::stoll(range.rows[0][0]);
+                if (c < std::min<int64_t>(n, 50) || c > 50) ++bad;
+            }
+        });
+    }
+    writer.join();
+    for (auto& t : readers) t.join();
+    EXPECT_EQ(bad.load(), 0);
+    auto total = run_sql(db, "SELECT COUNT(*), SUM(v) FROM t WHERE id >= 0;").results[0];
+    EXPECT_TRUE((total.rows == std::vector<std::vector<std::string>>{{std::to_string(rows), std::to_string(rows * (rows - 1))}}));
+}
+
+static void test_wal_replay() {
+    SyncPolicy policies[] = {SyncPolicy::EveryCommit, SyncPolicy::Group, SyncPolicy::OsBuffered};
+    for (SyncPolicy policy : policies) {
+        std::string path = "inmemdb_test_" + std::to_string(::getpid()) + ".wal";
+        std::remove(path.c_str());
+        WalOptions opts{path, policy, std::chrono::microseconds(200), 64};
+        const int rows = static_cast<int>(kDictSampleRows) + 100;
+        {
+            Database db;
+            EXPECT_EQ(db.attach_wal(opts), size_t(0));
+            run_sql(db, "CREATE TABLE t(id INT, tag TEXT, note TEXT); CREATE INDEX t_id ON t(id) USING HASH;");
+            std::vector<std::thread> writers;
+            for (int w = 0; w < 4; ++w) {
+                writers.emplace_back([&, w] {
+                    for (int i = w; i < rows; i += 4)
+                        db.insert_row(InsertStmt{"t", {std::to_string(i), "tag" + std::to_string(i % 3), "n" + std::to_string(i)}});
+                });
+            }
+            for (auto& t : writers) t.join();
+            auto bad = run_sql(db, "INSERT INTO t VALUES(x, a, b);").results[0];
+            EXPECT_TRUE(!bad.success);
+        }
+        auto check = [&](Database& db, int expect_rows) {
+            auto n = run_sql(db, "SELECT COUNT(*), SUM(id) FROM t;").results[0];
+            int64_t sum = 0;
+            for (int i = 0; i < expect_rows; ++i) sum += i;
+            EXPECT_TRUE((n.rows == std::vector<std::vector<std::string>>{{std::to_string(expect_rows), std::to_string(sum)}}));
+            auto point = run_sql(db, "SELECT note FROM t WHERE id = 43;").results[0];
+            EXPECT_TRUE((point.rows == std::vector<std::vector<std::string>>{{"n43"}}));
+            Table const* t = db.find_table("t");
+            EXPECT_EQ(t->indexes.size(), size_t(1));
+            EXPECT_TRUE(std::holds_alternative<DictColumn>(t->data[1]));
+        };
+        {
+            Database db;
+            EXPECT_EQ(db.attach_wal(opts), size_t(2 + rows));
+            check(db, rows);
+        }
+        // A torn record at the tail is dropped and cut off; later appends replay
+        { std::ofstream(path, std::ios::app | std::ios::binary) << std::string("\x20\x00\x00\x00\x02garbage", 12); }
+        {
+            Database db;
+            EXPECT_EQ(db.attach_wal(opts), size_t(2 + rows));
+            run_sql(db, "INSERT INTO t VALUES(" + std::to_string(rows) + ", tag0, last);");
+        }
+        {
+            Database db;
+            EXPECT_EQ(db.attach_wal(opts), size_t(3 + rows));
+            check(db, rows + 1);
+        }
+        std::remove(path.c_str());
+    }
+
+    // A failed WAL write keeps the rows it could not log but refuses later writes
+    std::string path = "inmemdb_test_" + std::to_string(::getpid()) + ".wal";
+    std::remove(path.c_str());
+    Database db;
+    db.attach_wal(WalOptions{path, SyncPolicy::EveryCommit, std::chrono::microseconds(200), 64});
+    run_sql(db, "CREATE TABLE t(id INT);");
+    rlimit saved;
+    ::getrlimit(RLIMIT_FSIZE, &saved);
+    auto old_handler = std::signal(SIGXFSZ, SIG_IGN);
+    std::ifstream log(path, std::ios::binary | std::ios::ate);
+    rlimit full = saved;
+    full.rlim_cur = static_cast<rlim_t>(log.tellg());
+    ::setrlimit(RLIMIT_FSIZE, &full);
+    auto failed = run_sql(db, "INSERT INTO t VALUES(1);").results[0];
+    ::setrlimit(RLIMIT_FSIZE, &saved);
+    std::signal(SIGXFSZ, old_handler);
+    EXPECT_TRUE(!failed.success && failed.message.find("now read-only") != std::string::npos);
+    auto later = run_sql(db, "INSERT INTO t VALUES(2); CREATE TABLE u(x INT); SELECT COUNT(*) FROM t;").results;
+    EXPECT_TRUE(!later[0].success && later[0].message.find("read-only after a WAL failure") != std::string::npos);
+    EXPECT_TRUE(!later[1].success);
+    EXPECT_TRUE((later[2].rows == std::vector<std::vector<std::string>>{{"1"}}));
+    std::remove(path.c_str());
+}
+
+static void test_snapshot_roundtrip() {
+    std::string path = "inmemdb_test_" + std::to_string(::getpid()) + ".snap";
+    const int rows = static_cast<int>(kDictSampleRows) + 10;
+    std::vector<std::string> queries = {
+        "SELECT COUNT(*), SUM(id), MIN(note), MAX(note) FROM t;",
+        "SELECT tag, COUNT(*), SUM(id) FROM t GROUP BY tag ORDER BY tag;",
+        "SELECT note FROM t WHERE id = 77;",
+        "SELECT COUNT(*) FROM t WHERE tag = tag2;",
+        "SELECT t.id, u.label FROM t JOIN u ON t.id = u.id WHERE t.id < 5;",
+    };
+    std::vector<QueryResult> expected;
+    {
+        Database db;
+        run_sql(db, "CREATE TABLE t(id INT, tag TEXT, note TEXT); CREATE TABLE u(id INT, label TEXT DICT); CREATE TABLE empty(x INT, y TEXT);"
+                    "CREATE INDEX t_id ON t(id) USING HASH; CREATE INDEX u_id ON u(id);");
+        for (int i = 0; i < rows; ++i) db.insert_row(InsertStmt{"t", {std::to_string(i), "tag" + std::to_string(i % 5), "n" + std::to_string(i)}});
+        for (int i = 0; i < 10; ++i) db.insert_row(InsertStmt{"u", {std::to_string(i), "l" + std::to_string(i % 2)}});
+        auto r = run_sql(db, "SNAPSHOT TO '" + path + "';").results[0];
+        EXPECT_TRUE(r.success);
+        for (auto const& q : queries) expected.push_back(run_sql(db, q).results[0]);
+        // Rows committed after the snapshot are not part of it
+        db.insert_row(InsertStmt{"t", {"77", "tag0", "late"}});
+    }
+    Database db;
+    EXPECT_EQ(db.load_snapshot(path), size_t(3));
+    Table const* t = db.find_table("t");
+    EXPECT_EQ(t->row_count, size_t(rows));
+    EXPECT_EQ(t->indexes.size(), size_t(1));
+    EXPECT_TRUE(std::holds_alternative<DictColumn>(t->data[1]));
+    EXPECT_TRUE(std::holds_alternative<TextColumn>(t->data[2]));
+    for (size_t i = 0; i < queries.size(); ++i) {
+        auto got = run_sql(db, queries[i]).results[0];
+        EXPECT_TRUE(got.success);
+        EXPECT_TRUE(got.header == expected[i].header && got.rows == expected[i].rows);
+    }
+    // Appending copies the mapped columns; existing and new values and dictionary codes stay correct
+    run_sql(db, "INSERT INTO t VALUES(100000, tag2, fresh); INSERT INTO u VALUES(10, l1); INSERT INTO empty VALUES(1, a);");
+    auto after = run_sql(db, "SELECT note FROM t WHERE id = 100000; SELECT COUNT(*) FROM t WHERE tag = tag2; SELECT COUNT(*) FROM u WHERE label = l1; SELECT y FROM empty;");
+    EXPECT_TRUE((after.results[0].rows == std::vector<std::vector<std::string>>{{"fresh"}}));
+    EXPECT_EQ(after.results[1].rows[0][0], std::to_string(std::stoll(expected[3].rows[0][0]) + 1));
+    EXPECT_EQ(after.results[2].rows[0][0], std::string("6"));
+    EXPECT_TRUE((after.results[3].rows == std::vector<std::vector<std::string>>{{"a"}}));
+    EXPECT_EQ(std::get<DictColumn>(db.find_table("u")->data[1]).dict.size(), size_t(2));
+
+    // Loading twice clashes; a damaged catalog is rejected
+    bool threw = false;
+    try { db.load_snapshot(path); } catch (std::exception const&) { threw = true; }
+    EXPECT_TRUE(threw);
+    { std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary); f.seekp(-1, std::ios::end); f.put('\x7f'); }
+    threw = false;
+    try { Database other; other.load_snapshot(path); } catch (std::exception const&) { threw = true; }
+    EXPECT_TRUE(threw);
+
+    // A snapshot taken with a WAL attached replays only the records written after it
+    std::string wal_path = path + ".wal";
+    std::remove(wal_path.c_str());
+    WalOptions opts{wal_path, SyncPolicy::Group, std::chrono::microseconds(200), 64};
+    {
+        Database live;
+        live.attach_wal(opts);
+        run_sql(live, "CREATE TABLE w(id INT); INSERT INTO w VALUES(1), (2); SNAPSHOT TO '" + path + "';"
+                      "INSERT INTO w VALUES(3); CREATE INDEX w_id ON w(id);");
+    }
+    {
+        Database restored;
+        restored.load_snapshot(path);
+        EXPECT_EQ(restored.attach_wal(opts), size_t(2));
+        auto rows = run_sql(restored, "SELECT COUNT(*), SUM(id) FROM w;").results[0];
+        EXPECT_TRUE((rows.rows == std::vector<std::vector<std::string>>{{"3", "6"}}));
+        EXPECT_EQ(restored.find_table("w")->indexes.size(), size_t(1));
+        run_sql(restored, "INSERT INTO w VALUES(4); SNAPSHOT TO '" + path + "';");
+    }
+    {
+        Database restored;
+        restored.load_snapshot(path);
+        EXPECT_EQ(restored.attach_wal(opts), size_t(0));
+        auto rows = run_sql(restored, "SELECT COUNT(*), SUM(id) FROM w;").results[0];
+        EXPECT_TRUE((rows.rows == std::vector<std::vector<std::string>>{{"4", "10"}}));
+    }
+    // A log shorter than the snapshot is not the one it was taken with
+    std::remove(wal_path.c_str());
+    threw = false;
+    try { Database other; other.load_snapshot(path); other.attach_wal(opts); } catch (std::exception const&) { threw = true; }
+    EXPECT_TRUE(threw);
+    std::remove(wal_path.c_str());
+    std::remove(path.c_str());
+}
+
+static void test_bulk_load() {
+    Database db;
+    db.set_parallelism(4);
+    auto rr = run_sql(db, "CREATE TABLE t(id INT, name TEXT, qty INT);"
+                          "INSERT INTO t VALUES (1, 'a b', 10), (2, c, 20), (3, 'd,e', 30);"
+                          "INSERT INTO t VALUES (4, f, 40), (x, g, 50);");
+    EXPECT_EQ(rr.results[1].message, std::string("3 rows inserted"));
+    EXPECT_TRUE(!rr.results[2].success); // a bad row rejects the whole statement
+    auto all = run_sql(db, "SELECT id, name, qty FROM t;").results[0];
+    EXPECT_TRUE((all.rows == std::vector<std::vector<std::string>>{{"1", "a b", "10"}, {"2", "c", "20"}, {"3", "d,e", "30"}}));
+    bool threw = false;
+    try { run_sql(db, "INSERT INTO t VALUES (5, h, 1), (6, i);"); } catch (std::exception const&) { threw = true; }
+    EXPECT_TRUE(threw);
+
+    // COPY in many small chunks matches the same rows inserted one by one
+    std::string path = "inmemdb_test_" + std::to_string(::getpid()) + ".csv";
+    const int rows = 5000;
+    {
+        std::ofstream f(path, std::ios::binary);
+        f << "id,name,qty\r\n";
+        for (int i = 0; i < rows; ++i) {
+            if (i % 7 == 0) f << i << ",\"say \"\"hi\"\", " << i << "\"," << -i << "\r\n";
+            else f << i << ",n" << i % 13 << "," << -i << "\n";
+            if (i % 1000 == 0) f << "\n";
+        }
+    }
+    run_sql(db, "CREATE TABLE c(id INT, name TEXT, qty INT); CREATE TABLE r(id INT, name TEXT, qty INT); CREATE INDEX c_id ON c(id) USING HASH;");
+    for (int i = 0; i < rows; ++i) {
+        std::string name = i % 7 == 0 ? "say \"hi\", " + std::to_string(i) : "n" + std::to_string(i % 13);
+        db.insert_row(InsertStmt{"r", {std::to_string(i), name, std::to_string(-i)}});
+    }
+    EXPECT_EQ(db.copy_from(CopyStmt{"c", path, true}, 256), size_t(rows));
+    for (std::string q : {"SELECT id, name, qty FROM # ORDER BY id;", "SELECT name, COUNT(*), SUM(qty) FROM # GROUP BY name;", "SELECT name FROM # WHERE id = 4998;"}) {
+        auto a = run_sql(db, q.replace(q.find('#'), 1, "c")).results[0];
+        auto b = run_sql(db, q.replace(q.find(" c"), 2, " r")).results[0];
+        EXPECT_TRUE(a.success && a.rows == b.rows);
+    }
+    auto copied = run_sql(db, "COPY c FROM '" + path + "' HEADER;").results[0];
+    EXPECT_EQ(copied.message, std::to_string(rows) + " row(s) copied");
+
+    // A bad line reports its line number and adds nothing
+    { std::ofstream f(path, std::ios::binary | std::ios::app); f << "1,ok,2\n1,bad\n"; }
+    auto bad = run_sql(db, "COPY c FROM '" + path + "' HEADER;").results[0];
+    EXPECT_TRUE(!bad.success);
+    EXPECT_TRUE(bad.message.find(":" + std::to_string(rows + 8) + ": expected 3 fields") != std::string::npos);
+    EXPECT_EQ(db.find_table("c")->row_count, size_t(2 * rows));
+    std::remove(path.c_str());
+}
+
+static void test_prepared_statements() {
+    Database db;
+    run_sql(db, "CREATE TABLE t(id INT, name TEXT, qty INT);");
+    for (int i = 0; i < 300; ++i) db.insert_row(InsertStmt{"t", {std::to_string(i), "n" + std::to_string(i % 5), std::to_string(i * 2)}});
+
+    // Placeholders give the same rows as the literal query, before and after an index
+    auto ps = db.prepare("SELECT id, qty FROM t WHERE id >= ? ORDER BY id LIMIT 3;");
+    auto by_name = db.prepare("SELECT COUNT(*) FROM t WHERE name = $1;");
+    EXPECT_EQ(ps->params, size_t(1));
+    for (int round = 0; round < 2; ++round) {
+        auto a = db.select_rows(*ps, {Value(int64_t(250))});
+        auto b = run_sql(db, "SELECT id, qty FROM t WHERE id >= 250 ORDER BY id LIMIT 3;").results[0];
+        EXPECT_TRUE(a.success && a.rows == b.rows);
+        auto c = db.select_rows(*by_name, {Value(std::string("n3"))});
+        EXPECT_TRUE((c.success && c.rows == std::vector<std::vector<std::string>>{{"60"}}));
+        run_sql(db, "CREATE INDEX t_id ON t(id) USING BTREE;");
+    }
+
+    // Re-spaced text hits the cache; a schema change replans
+    auto stats = db.plan_cache_stats();
+    auto again = db.prepare("select id,   qty from t where id >= ?  order by id limit 3");
+    EXPECT_EQ(db.plan_cache_stats().hits, stats.hits);
+    EXPECT_TRUE(again != ps); // made before CREATE INDEX
+    EXPECT_TRUE(db.prepare("SELECT id, qty FROM t WHERE id >= ? ORDER BY id LIMIT 3") == again);
+    EXPECT_EQ(db.plan_cache_stats().hits, stats.hits + 1);
+    EXPECT_TRUE(db.prepare("SELECT id FROM t WHERE name = 'n1'") != db.prepare("SELECT id FROM t WHERE name = n1"));
+
+    db.set_plan_cache_capacity(2);
+    EXPECT_EQ(db.plan_cache_stats().entries, size_t(2));
+    auto first = db.prepare("SELECT id FROM t WHERE id = 1;");
+    db.prepare("SELECT id FROM t WHERE id = 2;");
+    db.prepare("SELECT id FROM t WHERE id = 3;");
+    EXPECT_TRUE(db.prepare("SELECT id FROM t WHERE id = 1;") != first); // evicted
+
+    // PREPARE / EXECUTE in SQL, including INSERT
+    auto rr = run_sql(db, "PREPARE ins AS INSERT INTO t VALUES ($2, $1, $3);"
+                          "EXECUTE ins('zz', 1000, 7);"
+                          "PREPARE get AS SELECT name, qty FROM t WHERE id = ?;"
+                          "EXECUTE get(1000);"
+                          "EXECUTE get;"
+                          "EXECUTE nope(1);");
+    EXPECT_EQ(rr.results[0].message, std::string("Statement prepared"));
+    EXPECT_EQ(rr.results[1].message, std::string("1 row inserted"));
+    EXPECT_TRUE((rr.results[3].success && rr.results[3].rows == std::vector<std::vector<std::string>>{{"zz", "7"}}));
+    EXPECT_TRUE(!rr.results[4].success); // missing parameter
+    EXPECT_TRUE(!rr.results[5].success);
+    EXPECT_TRUE(!run_sql(db, "INSERT INTO t VALUES (?, a, 1);").results[0].success);
+}
+
+static void test_lexer_tokens() {
+    Lexer lex("sElEcT Selects int_col, 'it\\'s', 'plain', $12 FROM t;");
+    std::vector<Token> toks;
+    for (Token t = lex.next(); t.type != TokenType::End; t = lex.next()) toks.push_back(t);
+    EXPECT_EQ(toks.size(), size_t(12));
+    EXPECT_TRUE(toks[0].type == TokenType::KeywordSelect);
+    EXPECT_TRUE(toks[1].type == TokenType::Identifier && toks[1].text == "Selects");
+    EXPECT_TRUE(toks[2].type == TokenType::Identifier && toks[2].text == "int_col");
+    EXPECT_TRUE(toks[4].type == TokenType::String && toks[4].text == "it's"); // unescaped copy
+    EXPECT_TRUE(toks[6].type == TokenType::String && toks[6].text == "plain");
+    EXPECT_TRUE(toks[8].type == TokenType::Parameter && toks[8].text == "12");
+    EXPECT_TRUE(toks[9].type == TokenType::KeywordFrom);
+
+    // Keywords in any case; AST strings outlive the lexer
+    Database db;
+    auto rr = run_sql(db, "create TABLE Items(Id int, Name text); Insert into Items values (1, 'a;b'), (2, 'c\\'d');");
+    EXPECT_EQ(rr.results[1].message, std::string("2 rows inserted"));
+    auto sel = run_sql(db, "select Name from Items Where Id >= 1 order BY Id desc;").results[0];
+    EXPECT_TRUE((sel.rows == std::vector<std::vector<std::string>>{{"c'd"}, {"a;b"}}));
+}
+
+static void test_memory_usage() {
+    Database db;
+    run_sql(db, "CREATE TABLE m(id INT, note TEXT, tag TEXT DICT);"
+                "CREATE INDEX m_id ON m(id) USING HASH; CREATE INDEX m_note ON m(note) USING BTREE;"
+                "CREATE INDEX m_note_h ON m(note) USING HASH;");
+    const size_t rows = 20000;
+    for (size_t i = 0; i < rows; ++i)
+        db.insert_row(InsertStmt{"m", {std::to_string(i), "a note long enough to leave SSO #" + std::to_string(i % 5000), "tag" + std::to_string(i % 4)}});
+
+    auto mu = db.memory_usage();
+    EXPECT_EQ(mu.tables.size(), size_t(1));
+    auto const& t = mu.tables[0];
+    EXPECT_EQ(t.rows, rows);
+    EXPECT_EQ(t.columns.size(), size_t(3));
+    EXPECT_EQ(t.indexes.size(), size_t(3));
+    // Sequential ids seal into a Delta segment
+    EXPECT_TRUE(t.columns[0].name == "id" && t.columns[0].usage.bytes > 0 && t.columns[0].usage.bytes < rows * sizeof(int64_t) / 2);
+    EXPECT_TRUE(t.columns[1].usage.bytes >= rows * 30);
+    EXPECT_TRUE(t.columns[2].usage.bytes >= rows * sizeof(uint32_t) && t.columns[2].usage.bytes < t.columns[1].usage.bytes);
+    MemoryStats sum;
+    for (auto const& c : t.columns) sum += c.usage;
+    for (auto const& ix : t.indexes) {
+        // Arena-backed: a few chunks, not one or more allocations per row
+        EXPECT_TRUE(ix.usage.bytes > 0 && ix.usage.allocations < rows / 50);
+        sum += ix.usage;
+    }
+    EXPECT_TRUE(sum.bytes == t.total.bytes && sum.allocations == t.total.allocations);
+    EXPECT_EQ(mu.total.bytes, t.total.bytes);
+
+    // Arena string keys answer lookups like before
+    auto eq = run_sql(db, "SELECT COUNT(*) FROM m WHERE note = 'a note long enough to leave SSO #42';").results[0];
+    EXPECT_TRUE((eq.rows == std::vector<std::vector<std::string>>{{"4"}}));
+    auto range = run_sql(db, "SELECT COUNT(*) FROM m WHERE note >= 'a note long enough to leave SSO #4999';").results[0];
+    size_t expected = 0;
+    for (size_t k = 0; k < 5000; ++k) expected += std::to_string(k) >= "4999" ? 4 : 0;
+    EXPECT_TRUE((range.rows == std::vector<std::vector<std::string>>{{std::to_string(expected)}}));
+    auto grown = db.memory_usage().tables[0].indexes[0].usage;
+    for (size_t i = rows; i < 2 * rows; ++i) db.insert_row(InsertStmt{"m", {std::to_string(i), "x", "tag0"}});
+    EXPECT_TRUE(db.memory_usage().tables[0].indexes[0].usage.bytes > grown.bytes);
+}
+
+// Sealed segments pick their encoding from the data, round-trip every value,
+// and WHERE, projection and aggregates over them match a plain evaluation
+static void test_int_compression() {
+    const size_t n = IntColumn::kSegmentRows;
+    std::vector<std::vector<int64_t>> cases(6, std::vector<int64_t>(n));
+    for (size_t i = 0; i < n; ++i) {
+        cases[0][i] = 1700000000 + static_cast<int64_t>(i) * 10 + static_cast<int64_t>(i % 3); // timestamps
+        cases[1][i] = static_cast<int64_t>((i * 7919) % 1000) - 500;                            // small counters
+        cases[2][i] = static_cast<int64_t>(i / 1000);                                            // long runs
+        cases[3][i] = static_cast<int64_t>((i * 0x9E3779B97F4A7C15ull) ^ (i << 40));             // random 64-bit
+        cases[4][i] = i % 2 ? INT64_MIN : INT64_MAX;                                              // extremes
+        cases[5][i] = 42;                                                                         // constant
+    }
+    std::vector<IntEncoding> expect = {IntEncoding::Delta, IntEncoding::BitPacked, IntEncoding::RunLength,
+                                       IntEncoding::Plain, IntEncoding::Plain, IntEncoding::BitPacked};
+    for (size_t c = 0; c < cases.size(); ++c) {
+        IntSegment seg = IntSegment::encode(cases[c].data(), n);
+        EXPECT_TRUE(seg.encoding == expect[c] && seg.consistent());
+        std::vector<int64_t> all(n);
+        seg.decode(0, n, all.data());
+        EXPECT_TRUE(all == cases[c]);
+        bool same = true;
+        for (size_t i = 0; i < n; i += 37) same = same && seg.at(i) == cases[c][i];
+        std::vector<int64_t> part(100);
+        seg.decode(1000, 1100, part.data());
+        EXPECT_TRUE(same && std::equal(part.begin(), part.end(), cases[c].begin() + 1000));
+    }
+    EXPECT_TRUE(IntSegment::encode(cases[0].data(), n).memory().bytes * 8 < n * sizeof(int64_t));
+
+    // Three sealed segments and a plain tail; the reference is computed here.
+    // SQL has no negative literals, so every column stays above zero.
+    Database db;
+    run_sql(db, "CREATE TABLE z(ts INT, small INT, status INT);");
+    const size_t rows = 3 * n + 1000;
+    InsertStmt ins{"z", {}, rows, {}};
+    std::vector<int64_t> ts(rows), small(rows), status(rows);
+    for (size_t i = 0; i < rows; ++i) {
+        ts[i] = 1700000000 + static_cast<int64_t>(i) * 10 + static_cast<int64_t>(i % 3);
+        small[i] = static_cast<int64_t>((i * 7919) % 1000) + 1;
+        status[i] = static_cast<int64_t>(i / 5000) + 1;
+        for (int64_t v : {ts[i], small[i], status[i]}) ins.values.push_back(std::to_string(v));
+    }
+    db.insert_row(ins);
+    auto const& zcol = std::get<IntColumn>(db.find_table("z")->data[0]);
+    EXPECT_EQ(zcol.segments.size(), size_t(3));
+    EXPECT_EQ(zcol.tail.size(), size_t(1000));
+
+    std::vector<std::pair<std::string, std::vector<int64_t> const*>> cols = {{"ts", &ts}, {"small", &small}, {"status", &status}};
+    std::vector<std::string> ops = {"=", "!=", "<", "<=", ">", ">="};
+    for (auto const& [name, data] : cols) {
+        auto [lo, hi] = std::minmax_element(data->begin(), data->end());
+        for (int64_t lit : {*lo - 1, *lo, (*data)[rows / 2], (*data)[n + 77], *hi, *hi + 1}) {
+            for (auto const& op : ops) {
+                int64_t count = 0, sum = 0;
+                for (size_t i = 0; i < rows; ++i) {
+                    int64_t x = (*data)[i];
+                    bool m = op == "=" ? x == lit : op == "!=" ? x != lit : op == "<" ? x < lit
+                           : op == "<=" ? x <= lit : op == ">" ? x > lit : x >= lit;
+                    if (m) { ++count; sum += ts[i]; }
+                }
+                auto r = run_sql(db, "SELECT COUNT(*), SUM(ts) FROM z WHERE " + name + " " + op + " " + std::to_string(lit) + ";").results[0];
+                std::vector<std::string> want = {std::to_string(count), count ? std::to_string(sum) : "NULL"};
+                EXPECT_TRUE(r.success && r.rows.size() == 1 && (r.rows[0] == want || (count == 0 && r.rows[0][0] == "0")));
+            }
+        }
+    }
+    // Projection decodes the right rows across a segment boundary
+    auto proj = run_sql(db, "SELECT ts, small, status FROM z WHERE ts >= " + std::to_string(ts[n - 2]) + " LIMIT 4;").results[0];
+    EXPECT_EQ(proj.rows.size(), size_t(4));
+    for (size_t i = 0; i < proj.rows.size(); ++i)
+        EXPECT_TRUE((proj.rows[i] == std::vector<std::string>{std::to_string(ts[n - 2 + i]), std::to_string(small[n - 2 + i]), std::to_string(status[n - 2 + i])}));
+    EXPECT_TRUE(db.memory_usage().tables[0].columns[0].usage.bytes < rows * sizeof(int64_t) / 3);
+
+    // Snapshots keep the segments encoded
+    std::string path = "inmemdb_test_z_" + std::to_string(::getpid()) + ".snap";
+    db.save_snapshot(path);
+    Database loaded;
+    loaded.load_snapshot(path);
+    auto const& lcol = std::get<IntColumn>(loaded.find_table("z")->data[0]);
+    EXPECT_TRUE(lcol.segments.size() == 3 && lcol.segments[0]->encoding == zcol.segments[0]->encoding);
+    std::string q = "SELECT COUNT(*), SUM(small), MIN(status), MAX(ts) FROM z WHERE small < 10;";
+    EXPECT_TRUE(run_sql(loaded, q).results[0].rows == run_sql(db, q).results[0].rows);
+    std::remove(path.c_str());
+}
+
+// Counts the rows a zoned filter still hands to the kernel
+static Predicate::RangeKernel g_zone_inner = nullptr;
+static size_t g_zone_scanned = 0;
+static size_t counting_range(Predicate const& p, size_t begin, size_t end, size_t* sel) {
+    g_zone_scanned += end - begin;
+    return g_zone_inner(p, begin, end, sel);
+}
+
+// Full blocks keep min/max per column; scans skip or accept whole blocks by
+// them and answer exactly like a plain scan
+static void test_zone_maps() {
+    Database db;
+    run_sql(db, "CREATE TABLE ev(ts INT, day TEXT, kind TEXT DICT);");
+    const size_t rows = 10 * kZoneRows + 100;
+    InsertStmt ins{"ev", {}, rows, {}};
+    auto day_of = [](size_t i) { std::string d = std::to_string(i / 4); return "d" + std::string(4 - d.size(), '0') + d; };
+    for (size_t i = 0; i < rows; ++i) {
+        ins.values.push_back(std::to_string(1700000000 + i * 60));
+        ins.values.push_back(day_of(i));
+        ins.values.push_back(i < 3 * kZoneRows ? "old" : "new");
+    }
+    db.insert_row(ins);
+    Table const* t = db.find_table("ev");
+    EXPECT_EQ(std::get<IntColumn>(t->data[0]).zones.size(), size_t(10));
+    EXPECT_EQ(std::get<TextColumn>(t->data[1]).zones.size(), size_t(10));
+    EXPECT_EQ(std::get<DictColumn>(t->data[2]).zones.size(), size_t(10));
+    EXPECT_EQ(std::get<IntColumn>(t->data[0]).zones[2].min, int64_t(1700000000 + 2 * kZoneRows * 60));
+
+    // A late time range only scans the block it starts in and the open tail
+    size_t from = 9 * kZoneRows + 10;
+    Predicate p = compile_predicate(t->data[0], CompareOp::Ge, int64_t(1700000000 + from * 60));
+    g_zone_inner = p.range;
+    p.range = counting_range;
+    std::vector<size_t> sel(rows);
+    g_zone_scanned = 0;
+    EXPECT_EQ(p.filter(size_t{0}, rows, sel.data()), rows - from);
+    EXPECT_EQ(g_zone_scanned, kZoneRows + 100);
+    EXPECT_TRUE(sel[0] == from && sel[rows - from - 1] == rows - 1);
+    Predicate all = compile_predicate(t->data[2], CompareOp::Eq, std::string("new"));
+    g_zone_inner = all.range;
+    all.range = counting_range;
+    g_zone_scanned = 0;
+    EXPECT_EQ(all.filter(size_t{0}, rows, sel.data()), rows - 3 * kZoneRows);
+    EXPECT_EQ(g_zone_scanned, size_t(100));
+
+    std::vector<std::string> ops = {"=", "!=", "<", "<=", ">", ">="};
+    std::vector<std::string> days = {"d0000", day_of(kZoneRows), day_of(5 * kZoneRows + 3), day_of(rows - 1), "e"};
+    for (auto const& op : ops) {
+        for (auto const& d : days) {
+            size_t expect = 0;
+            for (size_t i = 0; i < rows; ++i) {
+                int c = day_of(i).compare(d);
+                expect += op == "=" ? c == 0 : op == "!=" ? c != 0 : op == "<" ? c < 0 : op == "<=" ? c <= 0 : op == ">" ? c > 0 : c >= 0;
+            }
+            auto r = run_sql(db, "SELECT COUNT(*) FROM ev WHERE day " + op + " '" + d + "';").results[0];
+            EXPECT_TRUE((r.rows == std::vector<std::vector<std::string>>{{std::to_string(expect)}}));
+        }
+    }
+    // Also on the outer side of a join
+    run_sql(db, "CREATE TABLE kinds(kind TEXT, label TEXT); INSERT INTO kinds VALUES('new', 'fresh');");
+    auto j = run_sql(db, "SELECT COUNT(*) FROM ev JOIN kinds ON ev.kind = kinds.kind WHERE ev.ts >= " + std::to_string(1700000000 + from * 60) + ";").results[0];
+    EXPECT_TRUE((j.rows == std::vector<std::vector<std::string>>{{std::to_string(rows - from)}}));
+
+    // Zones travel with snapshots
+    std::string path = "inmemdb_test_zones_" + std::to_string(::getpid()) + ".snap";
+    db.save_snapshot(path);
+    Database loaded;
+    loaded.load_snapshot(path);
+    Table const* lt = loaded.find_table("ev");
+    EXPECT_TRUE(std::get<TextColumn>(lt->data[1]).zones.size() == 10 && std::get<DictColumn>(lt->data[2]).zones.size() == 10);
+    std::string q = "SELECT COUNT(*), MIN(day) FROM ev WHERE day >= 'd0012';";
+    EXPECT_TRUE(run_sql(loaded, q).results[0].rows == run_sql(db, q).results[0].rows);
+    std::remove(path.c_str());
+}
+
+static void test_explain() {
+    Database db;
+    run_sql(db, "CREATE TABLE t(id INT, grp INT); CREATE TABLE u(id INT, name TEXT);");
+    const size_t rows = 3 * Cursor::kMorselRows + 5;
+    InsertStmt ins{"t", {}, rows, {}};
+    for (size_t i = 0; i < rows; ++i) {
+        ins.values.push_back(std::to_string(i));
+        ins.values.push_back(std::to_string(i % 7));
+    }
+    db.insert_row(ins);
+    InsertStmt uins{"u", {}, 100, {}};
+    for (size_t i = 0; i < 100; ++i) {
+        uins.values.push_back(std::to_string(i * 10));
+        uins.values.push_back("n" + std::to_string(i));
+    }
+    db.insert_row(uins);
+    auto explain = [&](std::string const& sql, size_t dop = 1) {
+        return db.explain(std::get<ExplainStmt>(Parser(Lexer(sql)).parse_all().at(0)), dop);
+    };
+    auto find = [](QueryResult const& r, std::string const& name) -> OperatorProfile const* {
+        for (auto const& op : r.profile->operators) if (op.name == name) return &op;
+        return nullptr;
+    };
+
+    // Plain EXPLAIN shows the tree without running it
+    auto plain = explain("EXPLAIN SELECT id FROM t WHERE grp = 3 ORDER BY id DESC LIMIT 5;");
+    EXPECT_TRUE(plain.success && plain.profile && !plain.profile->analyzed);
+    EXPECT_TRUE((plain.header == std::vector<std::string>{"QUERY PLAN"}));
+    EXPECT_EQ(plain.rows.size(), size_t(4));
+    EXPECT_EQ(plain.rows[0][0], std::string("Sort (id DESC, LIMIT 5, top-5 heap)"));
+    EXPECT_EQ(plain.rows[2][0], std::string("    -> Filter (grp = 3)"));
+    EXPECT_EQ(plain.rows[3][0], "      -> Scan (t, " + std::to_string(rows) + " rows)");
+    EXPECT_EQ(plain.profile->operators[3].rows_out, uint64_t(0));
+
+    // ANALYZE counts rows through every operator, serial or morsel-parallel
+    size_t matches = (rows + 3) / 7;
+    for (size_t dop : {size_t{1}, size_t{4}}) {
+        auto r = explain("EXPLAIN ANALYZE SELECT id FROM t WHERE grp = 3 ORDER BY id DESC LIMIT 5;", dop);
+        EXPECT_TRUE(r.success && r.profile->analyzed);
+        EXPECT_EQ(r.profile->rows, uint64_t(5));
+        EXPECT_EQ(find(r, "Scan")->rows_out, uint64_t(rows));
+        EXPECT_EQ(find(r, "Filter")->rows_in, uint64_t(rows));
+        EXPECT_EQ(find(r, "Filter")->rows_out, uint64_t(matches));
+        EXPECT_TRUE(find(r, "Filter")->bytes > 0);
+        EXPECT_EQ(find(r, "Project")->rows_out, uint64_t(matches));
+        EXPECT_TRUE(find(r, "Sort")->rows_in == matches && find(r, "Sort")->rows_out == 5 && find(r, "Sort")->peak_bytes > 0);
+        EXPECT_TRUE(r.rows.size() == 8 && r.rows[4][0] == "Lex" && r.rows[7][0] == "Execute" && r.rows[7][3] == "5");
+        EXPECT_TRUE(r.profile->execute_ms > 0);
+
+        auto g = explain("EXPLAIN ANALYZE SELECT grp, COUNT(*) FROM t GROUP BY grp;", dop);
+        EXPECT_TRUE(find(g, "Aggregate")->rows_in == rows && find(g, "Aggregate")->rows_out == 7);
+        EXPECT_TRUE(find(g, "Aggregate")->peak_bytes > 0);
+    }
+
+    // Joins: the build side, the probe and a WHERE on the joined pairs
+    auto j = explain("EXPLAIN ANALYZE SELECT t.id, u.name FROM t JOIN u ON t.id = u.id WHERE u.name != 'n3';");
+    EXPECT_TRUE(j.success);
+    EXPECT_TRUE(find(j, "HashBuild")->rows_in == 100 && find(j, "HashBuild")->peak_bytes > 0);
+    EXPECT_TRUE(find(j, "HashJoin")->rows_in == rows && find(j, "HashJoin")->rows_out == 100);
+    EXPECT_TRUE(find(j, "Filter")->rows_in == 100 && find(j, "Filter")->rows_out == 99);
+    EXPECT_EQ(j.profile->rows, uint64_t(99));
+    EXPECT_EQ(find(j, "Filter")->depth + 1, find(j, "HashJoin")->depth);
+
+    // An index answers the WHERE instead of a scan
+    run_sql(db, "CREATE INDEX t_id ON t(id) USING BTREE;");
+    auto ix = explain("EXPLAIN ANALYZE SELECT grp FROM t WHERE id < 10 LIMIT 3 OFFSET 2;");
+    EXPECT_TRUE(find(ix, "Scan") == nullptr && find(ix, "IndexLookup")->rows_out == 10);
+    EXPECT_EQ(find(ix, "IndexLookup")->detail, std::string("t_id (btree) id < 10"));
+    EXPECT_TRUE(find(ix, "Limit")->rows_in == 5 && find(ix, "Limit")->rows_out == 3);
+
+    // Through the executor, and errors surface in the result
+    auto rr = run_sql(db, "EXPLAIN SELECT * FROM t WHERE id = 1; EXPLAIN ANALYZE SELECT nope FROM t;").results;
+    EXPECT_TRUE(rr[0].success && rr[0].rows[0][0] == "Project (id, grp)" && rr[0].rows[1][0] == "  -> IndexLookup (t_id (btree) id = 1)");
+    EXPECT_TRUE(!rr[1].success && !rr[1].profile);
+    bool threw = false;
+    try { run_sql(db, "EXPLAIN INSERT INTO t VALUES(1, 2);"); } catch (std::exception const&) { threw = true; }
+    EXPECT_TRUE(threw);
+}
+
+// AND/OR/NOT, IN and BETWEEN match a plain evaluation over sealed
+// segments, the tail, DICT and TEXT columns, serial or parallel, through an
+// index or a join, and with placeholders
+static void test_compound_where() {
+    Database db;
+    run_sql(db, "CREATE TABLE w(id INT, grp INT, status TEXT DICT, name TEXT);");
+    const size_t rows = 2 * IntColumn::kSegmentRows + 500;
+    char const* statuses[] = {"open", "closed", "pending", "void"};
+    InsertStmt ins{"w", {}, rows, {}};
+    for (size_t i = 0; i < rows; ++i)
+        for (std::string v : {std::to_string(i), std::to_string(i % 10), std::string(statuses[(i * 7) % 4]), "n" + std::to_string(i % 4999)})
+            ins.values.push_back(v);
+    db.insert_row(ins);
+    auto status = [&](size_t i) { return std::string(statuses[(i * 7) % 4]); };
+    auto name = [](size_t i) { return "n" + std::to_string(i % 4999); }; // too many values for DICT
+
+    std::vector<std::pair<std::string, std::function<bool(size_t)>>> cases = {
+        {"grp = 3 AND name = 'n5'", [&](size_t i) { return i % 10 == 3 && name(i) == "n5"; }},
+        {"grp IN (1, 4, 7) OR status = 'void'", [&](size_t i) { return i % 10 == 1 || i % 10 == 4 || i % 10 == 7 || status(i) == "void"; }},
+        {"NOT (id < 100 OR id >= 30000) AND status IN ('open', 'pending')",
+         [&](size_t i) { return i >= 100 && i < 30000 && (status(i) == "open" || status(i) == "pending"); }},
+        {"id BETWEEN 16000 AND 16500 AND grp NOT IN (2, 3)", [&](size_t i) { return i >= 16000 && i <= 16500 && i % 10 != 2 && i % 10 != 3; }},
+        {"name BETWEEN 'n10' AND 'n20' AND (grp > 5 OR id <= 50)",
+         [&](size_t i) { return name(i) >= "n10" && name(i) <= "n20" && (i % 10 > 5 || i <= 50); }},
+        {"status NOT BETWEEN 'closed' AND 'open' OR NOT name IN ('n1', 'n2', 'n3')",
+         [&](size_t i) { return !(status(i) >= "closed" && status(i) <= "open") || !(name(i) == "n1" || name(i) == "n2" || name(i) == "n3"); }},
+        {"(grp = 1 OR grp = 2) AND (name = 'n1' OR name = 'n2' OR id > 33000)",
+         [&](size_t i) { return (i % 10 == 1 || i % 10 == 2) && (name(i) == "n1" || name(i) == "n2" || i > 33000); }},
+        {"id BETWEEN 10 AND 5", [](size_t) { return false; }},
+    };
+    for (size_t dop : {size_t{1}, size_t{4}}) {
+        db.set_parallelism(dop);
+        for (auto const& [where, match] : cases) {
+            uint64_t count = 0, sum = 0;
+            for (size_t i = 0; i < rows; ++i) if (match(i)) { ++count; sum += i; }
+            auto r = run_sql(db, "SELECT COUNT(*), SUM(id) FROM w WHERE " + where + ";").results[0];
+            std::vector<std::string> want = {std::to_string(count), std::to_string(sum)};
+            EXPECT_TRUE(r.success && r.rows.size() == 1 && r.rows[0] == want);
+        }
+    }
+    db.set_parallelism(1);
+
+    // Cheap INT terms run before string compares unless those settle far more rows
+    Table const& w = *db.find_table("w");
+    std::vector<Filter> terms;
+    terms.push_back(Filter::leaf(compile_predicate(w.data[3], CompareOp::Ne, Value(std::string("n0")))));
+    terms.push_back(Filter::leaf(compile_predicate(w.data[1], CompareOp::Lt, Value(int64_t(5)))));
+    terms.push_back(Filter::leaf(compile_predicate(w.data[2], CompareOp::Eq, Value(std::string("void")))));
+    Filter all = Filter::combine(Filter::Kind::And, std::move(terms));
+    EXPECT_TRUE(all.children.size() == 3 && all.children[0].pred.dict && all.children[1].pred.ints && all.children[2].pred.texts);
+    EXPECT_TRUE(all.selectivity > 0.05 && all.selectivity < 0.2);
+
+    // One term through an index, the rest as a filter above it
+    run_sql(db, "CREATE INDEX w_id ON w(id) USING BTREE;");
+    auto plan = run_sql(db, "EXPLAIN SELECT id FROM w WHERE grp IN (1, 2) AND id < 50 AND NOT (name = 'n1' OR name = 'n2');").results[0];
+    EXPECT_TRUE(plan.success && plan.rows.size() == 3);
+    EXPECT_EQ(plan.rows[1][0], std::string("  -> Filter (grp IN (1, 2) AND NOT (name = 'n1' OR name = 'n2'))"));
+    EXPECT_EQ(plan.rows[2][0], std::string("    -> IndexLookup (w_id (btree) id < 50)"));
+    auto ix = run_sql(db, "SELECT id FROM w WHERE grp IN (1, 2) AND id < 50 AND NOT (name = 'n1' OR name = 'n2');").results[0];
+    EXPECT_TRUE((ix.rows == std::vector<std::vector<std::string>>{{"11"}, {"12"}, {"21"}, {"22"}, {"31"}, {"32"}, {"41"}, {"42"}}));
+
+    // Terms on either side of a join filter their own table
+    run_sql(db, "CREATE TABLE g(grp INT, label TEXT);");
+    for (int k = 0; k < 10; ++k) db.insert_row(InsertStmt{"g", {std::to_string(k), k % 2 ? "odd" : "even"}});
+    auto j = run_sql(db, "SELECT COUNT(*) FROM w JOIN g ON w.grp = g.grp WHERE w.id BETWEEN 100 AND 199 AND (g.label = 'odd' OR g.grp = 0);").results[0];
+    EXPECT_TRUE((j.success && j.rows == std::vector<std::vector<std::string>>{{"60"}}));
+    auto mixed = run_sql(db, "SELECT COUNT(*) FROM w JOIN g ON w.grp = g.grp WHERE w.id < 5 OR g.label = 'odd';").results[0];
+    EXPECT_TRUE(!mixed.success);
+
+    // Placeholders inside IN and BETWEEN, numbered in order
+    auto ps = db.prepare("SELECT COUNT(*) FROM w WHERE grp IN (?, ?) AND id BETWEEN ? AND ?;");
+    EXPECT_EQ(ps->params, size_t(4));
+    auto c = db.select_rows(*ps, {Value(int64_t(1)), Value(int64_t(2)), Value(int64_t(0)), Value(int64_t(99))});
+    EXPECT_TRUE((c.success && c.rows == std::vector<std::vector<std::string>>{{"20"}}));
+
+    // Malformed expressions are parse errors
+    for (std::string bad : {"SELECT id FROM w WHERE grp IN ();", "SELECT id FROM w WHERE (grp = 1;", "SELECT id FROM w WHERE grp NOT = 1;",
+                            "SELECT id FROM w WHERE id BETWEEN 1 OR 2;"}) {
+        bool threw = false;
+        try { Parser(Lexer(bad)).parse_all(); } catch (std::exception const&) { threw = true; }
+        EXPECT_TRUE(threw);
+    }
+}
+
+// Joins of several tables give the same rows in any written order, serial
+// or parallel, and run in the order the column statistics make cheapest
+static void test_multiway_join() {
+    // Sketches count distinct values within a few standard errors
+    HyperLogLog many, few;
+    for (int64_t i = 0; i < 10000; ++i) {
+        many.add(i * 7919);
+        many.add(i * 7919);
+    }
+    for (int i = 0; i < 20; ++i) few.add("v" + std::to_string(i));
+    EXPECT_TRUE(many.estimate() > 8500 && many.estimate() < 11500);
+    EXPECT_TRUE(few.estimate() > 18 && few.estimate() < 22);
+
+    Database db;
+    run_sql(db, "CREATE TABLE sales(id INT, cust INT, prod INT, store INT, qty INT);"
+                "CREATE TABLE cust(id INT, region TEXT);"
+                "CREATE TABLE prod(id INT, cat INT);"
+                "CREATE TABLE store(id INT, city TEXT);");
+    const size_t rows = 20000;
+    InsertStmt ins{"sales", {}, rows, {}};
+    auto cust = [](size_t i) { return (i * 37 + 11) % 500; };
+    auto prod = [](size_t i) { return i / 3 % 200; };
+    auto store = [](size_t i) { return i / 7 % 20; };
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t v : {i, cust(i), prod(i), store(i), i % 7}) ins.values.push_back(std::to_string(v));
+    db.insert_row(ins);
+    for (int i = 0; i < 500; ++i) db.insert_row(InsertStmt{"cust", {std::to_string(i), "r" + std::to_string(i % 4)}});
+    for (int i = 0; i < 200; ++i) db.insert_row(InsertStmt{"prod", {std::to_string(i), std::to_string(i % 10)}});
+    for (int i = 0; i < 20; ++i) db.insert_row(InsertStmt{"store", {std::to_string(i), "c" + std::to_string(i % 5)}});
+
+    ColumnStats const& cust_stats = db.find_table("sales")->stats[1];
+    EXPECT_EQ(cust_stats.rows, uint64_t(rows));
+    EXPECT_TRUE(cust_stats.distinct() > 425 && cust_stats.distinct() < 575);
+    EXPECT_TRUE(*cust_stats.min == Value(int64_t(0)) && *cust_stats.max == Value(int64_t(499)));
+    EXPECT_TRUE(*db.find_table("store")->stats[1].max == Value(std::string("c4")));
+
+    uint64_t count = 0, sum = 0;
+    for (size_t i = 0; i < rows; ++i)
+        if (cust(i) % 4 == 1 && prod(i) % 10 < 3 && store(i) % 5 == 2) { ++count; sum += i % 7; }
+    EXPECT_TRUE(count > 0);
+    std::vector<std::vector<std::string>> want = {{std::to_string(count), std::to_string(sum)}};
+    std::string where = " WHERE cust.region = 'r1' AND prod.cat < 3 AND store.city = 'c2';";
+    // ON conditions name either side first
+    std::vector<std::string> queries = {
+        "SELECT COUNT(*), SUM(sales.qty) FROM sales JOIN cust ON sales.cust = cust.id JOIN prod ON prod.id = sales.prod"
+        " JOIN store ON sales.store = store.id" + where,
+        "SELECT COUNT(*), SUM(qty) FROM store JOIN sales ON store.id = sales.store JOIN prod ON sales.prod = prod.id"
+        " INNER JOIN cust ON cust.id = sales.cust" + where,
+    };
+    for (size_t dop : {size_t{1}, size_t{4}}) {
+        db.set_parallelism(dop);
+        for (auto const& q : queries) {
+            auto r = run_sql(db, q).results[0];
+            EXPECT_TRUE(r.success && r.rows == want);
+        }
+    }
+    db.set_parallelism(1);
+
+    // The fact table is scanned and probes a hash table over each filtered dimension
+    auto plan = run_sql(db, "EXPLAIN ANALYZE " + queries[1]).results[0];
+    EXPECT_TRUE(plan.success && plan.profile);
+    size_t joins = 0, builds = 0;
+    for (auto const& op : plan.profile->operators) {
+        joins += op.name == "HashJoin";
+        if (op.name == "HashBuild") builds += op.rows_in;
+        EXPECT_TRUE(op.name != "Scan" || op.detail == "sales, 20000 rows");
+    }
+    EXPECT_TRUE(joins == 3 && builds == 720);
+    EXPECT_EQ(plan.profile->rows, uint64_t(1));
+
+    // Rows of every joined table reach the projection
+    auto wide = run_sql(db, "SELECT sales.id, cust.region, prod.cat, store.city FROM sales JOIN cust ON sales.cust = cust.id"
+                            " JOIN prod ON sales.prod = prod.id JOIN store ON sales.store = store.id WHERE sales.id = 1234;").results[0];
+    std::vector<std::string> row = {"1234", "r" + std::to_string(cust(1234) % 4), std::to_string(prod(1234) % 10), "c" + std::to_string(store(1234) % 5)};
+    EXPECT_TRUE(wide.success && wide.rows.size() == 1 && wide.rows[0] == row);
+
+    auto ps = db.prepare("SELECT COUNT(*) FROM sales JOIN store ON sales.store = store.id JOIN cust ON cust.id = sales.cust"
+                         " WHERE store.city = ? AND cust.region = ?;");
+    auto c = db.select_rows(*ps, {Value(std::string("c2")), Value(std::string("r0"))});
+    size_t c2_r0 = 0;
+    for (size_t i = 0; i < rows; ++i) c2_r0 += store(i) % 5 == 2 && cust(i) % 4 == 0;
+    EXPECT_TRUE(c.success && c.rows.size() == 1 && c.rows[0][0] == std::to_string(c2_r0));
+
+    // A table joined twice, a condition on a table not yet joined, and an ambiguous column
+    for (std::string bad : {"SELECT * FROM sales JOIN sales ON sales.id = sales.id;",
+                            "SELECT * FROM sales JOIN cust ON prod.id = cust.id JOIN prod ON sales.prod = prod.id;",
+                            "SELECT * FROM sales JOIN cust ON cust.id = cust.id;",
+                            "SELECT id FROM sales JOIN cust ON sales.cust = cust.id;"})
+        EXPECT_TRUE(!run_sql(db, bad).results[0].success);
+}
+
+static void test_server() {
+    Database db;
+    ServerOptions options;
+    options.port = 0;
+    options.io_threads = 2;
+    options.workers = 3;
+    options.unix_path = "inmemdb_test_" + std::to_string(::getpid()) + ".sock";
+    Server server(db, options);
+    server.start();
+    EXPECT_TRUE(server.port() != 0);
+
+    Client c = Client::connect_tcp("127.0.0.1", server.port());
+    auto created = c.query("CREATE TABLE t(id INT, name TEXT); INSERT INTO t VALUES (1, 'a');");
+    EXPECT_TRUE(created.size() == 2 && created[0].success && created[1].success);
+
+    // Pipelined: later queries see earlier inserts and answers keep their order
+    std::vector<uint32_t> ids;
+    for (int i = 2; i <= 50; ++i) {
+        ids.push_back(c.send("INSERT INTO t VALUES (" + std::to_string(i) + ", 'n" + std::to_string(i) + "');"));
+        ids.push_back(c.send("SELECT COUNT(*) FROM t;"));
+    }
+    for (size_t k = 0; k < ids.size(); ++k) {
+        auto res = c.receive();
+        EXPECT_EQ(res.id, ids[k]);
+        if (k % 2 == 1) {
+            auto const& cnt = res.results.at(0);
+            EXPECT_TRUE(cnt.success && cnt.rows.rows == 1 && cnt.rows.columns[0].int_at(0) == int64_t(k / 2 + 2));
+        }
+    }
+
+    // Typed columns straight from the cursor
+    auto sel = c.query("SELECT id, name FROM t WHERE id <= 2 ORDER BY id;").at(0);
+    EXPECT_TRUE(sel.success && sel.rows.rows == 2);
+    EXPECT_TRUE((sel.header == std::vector<std::string>{"id", "name"}));
+    EXPECT_TRUE(sel.rows.columns[0].int_at(1) == 2 && sel.rows.columns[1].text_at(1) == "n2");
+    auto avg = c.query("SELECT AVG(id) FROM t;").at(0);
+    EXPECT_TRUE(avg.success && avg.rows.columns[0].type == ColumnType::Real && avg.rows.columns[0].real_at(0) == 25.5);
+
+    // Errors are answers, not dropped connections
+    auto bad = c.query("SELECT nope FROM t;");
+    EXPECT_TRUE(bad.size() == 1 && !bad[0].success && !bad[0].message.empty());
+    auto garbled = c.query("SELEKT 1;");
+    EXPECT_TRUE(garbled.size() == 1 && !garbled[0].success);
+
+    // Sessions keep their prepared statements; a second session shares the data
+    auto prep = c.query("PREPARE byid AS SELECT name FROM t WHERE id = ?; EXECUTE byid(7);");
+    EXPECT_TRUE(prep.size() == 2 && prep[1].success && prep[1].rows.rows == 1 && prep[1].rows.columns[0].text_at(0) == "n7");
+    Client other = Client::connect_unix(options.unix_path);
+    EXPECT_TRUE(!other.query("EXECUTE byid(7);").at(0).success);
+    auto big = other.query("SELECT id FROM t;").at(0);
+    EXPECT_TRUE(big.success && big.rows.rows == 50);
+
+    // Results past kResultChunk come in several frames; pipelined answers stay whole and in order
+    InsertStmt wide{"wide", {}, 30000};
+    for (int i = 0; i < 30000; ++i) {
+        wide.values.push_back(std::to_string(i));
+        wide.values.push_back(std::string(100, char('a' + i % 26)));
+    }
+    c.query("CREATE TABLE wide(id INT, pad TEXT);");
+    db.insert_row(wide);
+    uint32_t first = c.send("SELECT id, pad FROM wide; SELECT COUNT(*) FROM wide;");
+    uint32_t second = c.send("SELECT pad FROM wide WHERE id = 29999;");
+    auto huge = c.receive();
+    EXPECT_EQ(huge.id, first);
+    EXPECT_TRUE(huge.results.size() == 2 && huge.results[0].success && huge.results[0].rows.rows == 30000);
+    EXPECT_TRUE(huge.results[0].rows.columns[0].int_at(29999) == 29999 && huge.results[0].rows.columns[1].text_at(29999) == std::string(100, 'v'));
+    EXPECT_TRUE(huge.results[1].rows.columns[0].int_at(0) == 30000);
+    auto after = c.receive();
+    EXPECT_EQ(after.id, second);
+    EXPECT_TRUE(after.results.at(0).rows.columns[0].text_at(0) == std::string(100, 'v'));
+
+    // Many connections at once, spread over both event loops
+    std::vector<std::thread> threads;
+    std::atomic<int> good{0};
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&] {
+            Client cl = Client::connect_tcp("127.0.0.1", server.port());
+            for (int i = 0; i < 20; ++i) cl.send("SELECT COUNT(*) FROM t WHERE id > 10;");
+            for (int i = 0; i < 20; ++i) {
+                auto r = cl.receive().results.at(0);
+                if (r.success && r.rows.columns[0].int_at(0) == 40) ++good;
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    EXPECT_EQ(good.load(), 160);
+    server.stop();
+}
+
 int main() {
     test_basic_single_table();
     test_inner_join();
+    test_join_text_key_and_non_equi();
+    test_rejected_insert_keeps_columns_aligned();
+    test_indexes_match_scans();
+    test_index_nested_loop_join();
+    test_cursor_batches();
+    test_where_on_either_join_side();
+    test_simd_filter_kernels_match_scalar();
+    test_dict_columns_match_plain_text();
+    test_low_cardinality_text_is_dict_encoded();
+    test_group_by_aggregates();
+    test_order_by_limit();
+    test_parallel_matches_serial();
+    test_concurrent_snapshots();
+    test_wal_replay();
+    test_snapshot_roundtrip();
+    test_bulk_load();
+    test_prepared_statements();
+    test_lexer_tokens();
+    test_memory_usage();
+    test_int_compression();
+    test_zone_maps();
+    test_explain();
+    test_compound_where();
+    test_multiway_join();
+    test_server();
     if (g_failures == 0) {
         std::cout << "All tests passed\n";
         return 0;